@@ -5,3 +5,15 @@ fun print_i32(n: Int) {
 fun print_bool(b: Boolean) {
     println(b)
 }
+
+fun print_i64(n: Long) {
+    println(n)
+}
+
+fun print_u32(n: UInt) {
+    println(n)
+}
+
+fun print_u64(n: ULong) {
+    println(n)
+}
@@ -0,0 +1,23 @@
+#!/usr/bin/env python3
+"""Runs a command and prints "<first-output seconds> <total seconds>".
+
+The first figure is the time from process start until the first byte appears
+on stdout, i.e. what a user waits for before a script shows anything.
+"""
+import subprocess
+import sys
+import time
+
+start = time.perf_counter()
+proc = subprocess.Popen(sys.argv[1:], stdout=subprocess.PIPE)
+first = None
+while True:
+    chunk = proc.stdout.read1(65536) if hasattr(proc.stdout, "read1") else proc.stdout.read(1)
+    if not chunk:
+        break
+    if first is None:
+        first = time.perf_counter() - start
+proc.wait()
+total = time.perf_counter() - start
+print(f"{first if first is not None else total:.3f} {total:.3f}")
+sys.exit(proc.returncode)
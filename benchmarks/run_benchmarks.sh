@@ -1,13 +1,21 @@
 #!/bin/bash
 
+# Quick single-run comparison with kotlinc and C. For repeated, pinned runs
+# with statistics and hardware counters, use ./build/kotlin-lite-bench.
+
 # Build the compiler first
-mkdir -p build && cd build && cmake .. > /dev/null && make -j$(sysctl -n hw.ncpu) > /dev/null || exit 1
+JOBS=$(nproc 2>/dev/null || getconf _NPROCESSORS_ONLN 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 2)
+mkdir -p build && cd build && cmake .. > /dev/null && make -j"$JOBS" > /dev/null || exit 1
 cd ..
 
 KOTLIN_LITE="./build/kotlin-lite"
 
 KOTLINC="kotlinc"
 
+# The JVM column needs kotlinc and java; without them it shows n/a
+HAVE_JVM=0
+command -v "$KOTLINC" > /dev/null && command -v java > /dev/null && HAVE_JVM=1
+
 
 
 # Create a temporary directory for benchmark files
@@ -54,17 +62,23 @@ for b in "${BENCHMARKS[@]}"; do
 
     # 2. kotlinc (JVM) with warmup
 
-    $KOTLINC "$FILE" benchmarks/compat.kt -include-runtime -d "$TMP_DIR/bench_jvm.jar"
+    JVM_TIME="n/a"
 
-    java -jar "$TMP_DIR/bench_jvm.jar" > /dev/null # warmup
+    if [ "$HAVE_JVM" = 1 ]; then
 
-    START=$(python3 -c 'import time; print(time.time())')
+        $KOTLINC "$FILE" benchmarks/compat.kt -include-runtime -d "$TMP_DIR/bench_jvm.jar"
 
-    java -jar "$TMP_DIR/bench_jvm.jar" > /dev/null
+        java -jar "$TMP_DIR/bench_jvm.jar" > /dev/null # warmup
 
-    END=$(python3 -c 'import time; print(time.time())')
+        START=$(python3 -c 'import time; print(time.time())')
 
-    JVM_TIME=$(python3 -c "print(f'{$END - $START:.3f}')")
+        java -jar "$TMP_DIR/bench_jvm.jar" > /dev/null
+
+        END=$(python3 -c 'import time; print(time.time())')
+
+        JVM_TIME=$(python3 -c "print(f'{$END - $START:.3f}')")
+
+    fi
 
     
 
@@ -97,3 +111,41 @@ done
 
 
 echo "----------------------------------------------------------------------------"
+
+
+
+# Interpreter (--run --interp) against the native --run path: latency until the
+# first line of output, and whole-run time compared to the native binary alone.
+
+echo ""
+
+echo "-----------------------------------------------------------------------------------------"
+
+echo "| Benchmark     | 1st out native | 1st out interp | Total native | Total interp | Interp/Lite |"
+
+echo "-----------------------------------------------------------------------------------------"
+
+
+
+for b in "${BENCHMARKS[@]}"; do
+
+    FILE="benchmarks/$b"
+
+    read NATIVE_FIRST NATIVE_TOTAL < <(python3 benchmarks/measure_latency.py $KOTLIN_LITE "$FILE" --run)
+
+    read INTERP_FIRST INTERP_TOTAL < <(python3 benchmarks/measure_latency.py $KOTLIN_LITE "$FILE" --run --interp)
+
+    # Steady-state speed: the interpreter's whole run against the compiled binary's run
+    $KOTLIN_LITE "$FILE" -o "$TMP_DIR/bench_lite" > /dev/null
+
+    read _ LITE_TOTAL < <(python3 benchmarks/measure_latency.py "$TMP_DIR/bench_lite")
+
+    RATIO=$(python3 -c "print(f'{float($INTERP_TOTAL)/max(float($LITE_TOTAL), 0.001):.1f}x')")
+
+    printf "| %-13s | %-14s | %-14s | %-12s | %-12s | %-11s |\n" "$b" "$NATIVE_FIRST" "$INTERP_FIRST" "$NATIVE_TOTAL" "$INTERP_TOTAL" "$RATIO"
+
+done
+
+
+
+echo "-----------------------------------------------------------------------------------------"
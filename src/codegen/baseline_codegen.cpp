@@ -0,0 +1,649 @@
+#include "baseline_codegen.hpp"
+#include "x86_assembler.hpp"
+#include "ir/builtins.hpp"
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace kotlin_lite {
+
+const MachineCode::Symbol* MachineCode::findFunction(const std::string& name) const {
+    for (const auto& sym : functions) {
+        if (sym.name == name) return &sym;
+    }
+    return nullptr;
+}
+
+namespace {
+
+using namespace x86;
+using OpKind = ir::Instruction::OpKind;
+
+const Reg kArgRegs[] = {RDI, RSI, RDX, RCX, R8, R9};
+const size_t kNumArgRegs = sizeof(kArgRegs) / sizeof(kArgRegs[0]);
+// Preserved across calls; pushed in the prologue when used
+const Reg kCalleeSaved[] = {RBX, R12, R13, R14, R15};
+// Clobbered by calls, so only for values whose interval contains none.
+// RAX, RCX, RDX and the argument registers are never allocated: instruction
+// selection uses them as scratch.
+const Reg kCallerSaved[] = {R10, R11};
+
+bool isCompare(OpKind kind) {
+    return kind >= OpKind::ICmpEq && kind <= OpKind::ICmpGe;
+}
+
+Cond compareCond(OpKind kind) {
+    switch (kind) {
+        case OpKind::ICmpEq: return CondE;
+        case OpKind::ICmpNe: return CondNE;
+        case OpKind::ICmpLt: return CondL;
+        case OpKind::ICmpLe: return CondLE;
+        case OpKind::ICmpGt: return CondG;
+        default: return CondGE;
+    }
+}
+
+// Condition codes come in pairs that differ in the lowest bit
+Cond invert(Cond cond) { return static_cast<Cond>(cond ^ 1); }
+
+bool producesValue(const ir::Instruction& inst) {
+    return inst.type != ir::Type::Void && inst.kind != OpKind::Br && inst.kind != OpKind::CondBr &&
+           inst.kind != OpKind::Ret;
+}
+
+struct Interval {
+    const ir::Value* value;
+    int start = INT_MAX;
+    int end = -1;
+    bool crossesCall = false;
+    Operand loc = Operand::imm(0);
+
+    void cover(int pos) {
+        start = std::min(start, pos);
+        end = std::max(end, pos);
+    }
+};
+
+class FunctionCompiler {
+public:
+    FunctionCompiler(const ir::Function& func, Assembler& as, const std::map<std::string, Assembler::Label>& labels,
+                     BaselineCodegen::Statistics& stats)
+        : func_(func), as_(as), function_labels_(labels), stats_(stats) {}
+
+    void compile() {
+        number();
+        computeLiveness();
+        buildIntervals();
+        allocate();
+
+        as_.bind(function_labels_.at(func_.name));
+        emitPrologue();
+        for (size_t i = 0; i < blocks_.size(); ++i) {
+            emitBlock(*blocks_[i], i + 1 < blocks_.size() ? blocks_[i + 1] : nullptr);
+        }
+    }
+
+private:
+    const ir::Function& func_;
+    Assembler& as_;
+    const std::map<std::string, Assembler::Label>& function_labels_;
+    BaselineCodegen::Statistics& stats_;
+
+    // Linear order: instruction positions are even, block bounds are the
+    // positions of the first and last (terminator) instruction. Arguments are
+    // defined at 0.
+    std::vector<const ir::BasicBlock*> blocks_;
+    std::unordered_map<const ir::BasicBlock*, size_t> block_index_;
+    std::vector<int> block_start_;
+    std::vector<int> block_end_;
+    std::unordered_map<const ir::Instruction*, int> position_;
+    std::vector<int> call_positions_;
+    std::vector<Assembler::Label> block_labels_;
+
+    std::unordered_map<const ir::Value*, size_t> value_index_;
+    std::vector<Interval> intervals_;
+    std::vector<int> use_count_; // by value index
+
+    using BitSet = std::vector<uint64_t>;
+    std::vector<BitSet> live_in_;
+    std::vector<BitSet> live_out_;
+
+    std::vector<Reg> saved_regs_;
+    int spill_slots_ = 0;
+
+    // --- Numbering and liveness ---
+
+    void number() {
+        // Values live in 32-bit registers and slots: Long, Byte, Short and the
+        // unsigned operations are left to the LLVM backend
+        auto unsupported = [&](ir::Type type) { return type != ir::Type::I32 && type != ir::Type::I1 && type != ir::Type::Void; };
+        bool wide = unsupported(func_.returnType);
+        for (const auto& arg : func_.args) wide |= unsupported(arg.type);
+        for (const auto& bb : func_.blocks) {
+            for (const auto& inst : bb->instructions) {
+                wide |= unsupported(inst->type) || (inst->kind >= OpKind::UDiv && inst->kind <= OpKind::LShr) ||
+                        (inst->kind >= OpKind::ICmpULt && inst->kind <= OpKind::ICmpUGe) ||
+                        (inst->kind >= OpKind::ZExt && inst->kind <= OpKind::Trunc);
+            }
+        }
+        if (wide) {
+            throw std::runtime_error("Baseline codegen: @" + func_.name +
+                                     " uses integer types other than Int and Boolean or unsigned operations");
+        }
+
+        size_t count = func_.instructionCount();
+        position_.reserve(count);
+        value_index_.reserve(count + func_.args.size());
+        int pos = 2;
+        for (size_t i = 0; i < func_.args.size(); ++i) {
+            if (!func_.args[i].ssaValue) continue;
+            value_index_[func_.args[i].ssaValue] = intervals_.size();
+            intervals_.push_back(Interval{func_.args[i].ssaValue});
+        }
+        for (const auto& bb : func_.blocks) {
+            if (!bb->getTerminator()) {
+                throw std::runtime_error("Baseline codegen: block %" + bb->label + " in @" + func_.name +
+                                         " has no terminator");
+            }
+            block_index_[bb.get()] = blocks_.size();
+            blocks_.push_back(bb.get());
+            block_labels_.push_back(as_.newLabel());
+            block_start_.push_back(pos);
+            for (const auto& inst : bb->instructions) {
+                position_[inst.get()] = pos;
+                if (inst->kind == OpKind::Call) call_positions_.push_back(pos);
+                if (producesValue(*inst)) {
+                    value_index_[inst.get()] = intervals_.size();
+                    intervals_.push_back(Interval{inst.get()});
+                }
+                pos += 2;
+            }
+            block_end_.push_back(pos - 2);
+        }
+        use_count_.assign(intervals_.size(), 0);
+        for (const auto& bb : func_.blocks) {
+            for (const auto& inst : bb->instructions) {
+                for (ir::Value* op : inst->getOperands()) {
+                    int i = index(op);
+                    if (i >= 0) use_count_[i]++;
+                }
+            }
+        }
+    }
+
+    int index(const ir::Value* v) const {
+        auto it = value_index_.find(v);
+        return it == value_index_.end() ? -1 : static_cast<int>(it->second);
+    }
+
+    static void set(BitSet& bits, int i) { bits[i / 64] |= uint64_t(1) << (i % 64); }
+    static bool test(const BitSet& bits, int i) { return bits[i / 64] >> (i % 64) & 1; }
+
+    // Operands of `succ`'s phis flowing in from `pred`
+    template <typename F>
+    void forEachPhiUse(const ir::BasicBlock& pred, const ir::BasicBlock& succ, F f) const {
+        for (const auto& inst : succ.instructions) {
+            if (inst->kind != OpKind::Phi) break;
+            auto phi = static_cast<const ir::PhiInst*>(inst.get());
+            auto it = phi->incomings.find(const_cast<ir::BasicBlock*>(&pred));
+            if (it != phi->incomings.end()) f(phi, it->second);
+        }
+    }
+
+    void computeLiveness() {
+        size_t words = (intervals_.size() + 63) / 64;
+        std::vector<BitSet> uses(blocks_.size(), BitSet(words));
+        std::vector<BitSet> defs(blocks_.size(), BitSet(words));
+        live_in_.assign(blocks_.size(), BitSet(words));
+        live_out_.assign(blocks_.size(), BitSet(words));
+
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            for (const auto& inst : blocks_[b]->instructions) {
+                if (inst->kind != OpKind::Phi) {
+                    for (ir::Value* op : inst->getOperands()) {
+                        int i = index(op);
+                        if (i >= 0 && !test(defs[b], i)) set(uses[b], i);
+                    }
+                }
+                int i = index(inst.get());
+                if (i >= 0) set(defs[b], i);
+            }
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t b = blocks_.size(); b-- > 0;) {
+                BitSet out(words);
+                for (const ir::BasicBlock* succ : blocks_[b]->getSuccessors()) {
+                    const BitSet& in = live_in_[block_index_.at(succ)];
+                    for (size_t w = 0; w < words; ++w) out[w] |= in[w];
+                    forEachPhiUse(*blocks_[b], *succ, [&](const ir::PhiInst*, const ir::Value* v) {
+                        int i = index(v);
+                        if (i >= 0) set(out, i);
+                    });
+                }
+                BitSet in(words);
+                for (size_t w = 0; w < words; ++w) in[w] = uses[b][w] | (out[w] & ~defs[b][w]);
+                if (in != live_in_[b] || out != live_out_[b]) {
+                    live_in_[b] = std::move(in);
+                    live_out_[b] = std::move(out);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // One interval per value, spanning every position where it is live
+    // (lifetime holes are ignored).
+    void buildIntervals() {
+        for (auto& interval : intervals_) {
+            if (dynamic_cast<const ir::ArgumentValue*>(interval.value)) interval.cover(0);
+        }
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            const ir::BasicBlock& bb = *blocks_[b];
+            for (size_t i = 0; i < intervals_.size(); ++i) {
+                if (test(live_in_[b], static_cast<int>(i))) intervals_[i].cover(block_start_[b]);
+                if (test(live_out_[b], static_cast<int>(i))) intervals_[i].cover(block_end_[b]);
+            }
+            for (const auto& inst : bb.instructions) {
+                int pos = position_.at(inst.get());
+                int def = index(inst.get());
+                if (def >= 0) intervals_[def].cover(pos);
+                if (inst->kind == OpKind::Phi) {
+                    // The edge copies write the phi at the end of each predecessor
+                    auto phi = static_cast<const ir::PhiInst*>(inst.get());
+                    for (const auto& [pred, value] : phi->incomings) {
+                        int predEnd = block_end_[block_index_.at(pred)];
+                        intervals_[def].cover(predEnd);
+                        int i = index(value);
+                        if (i >= 0) intervals_[i].cover(predEnd);
+                    }
+                    continue;
+                }
+                for (ir::Value* op : inst->getOperands()) {
+                    if (dynamic_cast<const ir::Function*>(op)) {
+                        throw std::runtime_error("Baseline codegen: function operands are not supported (in @" +
+                                                 func_.name + ")");
+                    }
+                    int i = index(op);
+                    if (i >= 0) intervals_[i].cover(pos);
+                }
+            }
+        }
+        for (auto& interval : intervals_) {
+            if (interval.end < 0) interval.cover(0);
+            auto call = std::upper_bound(call_positions_.begin(), call_positions_.end(), interval.start);
+            interval.crossesCall = call != call_positions_.end() && *call < interval.end;
+        }
+    }
+
+    // --- Linear scan ---
+
+    Operand newSpillSlot() { return Operand::stack(0 - 8 * ++spill_slots_); }
+
+    void allocate() {
+        std::vector<Interval*> order;
+        for (auto& interval : intervals_) order.push_back(&interval);
+        std::sort(order.begin(), order.end(), [](const Interval* a, const Interval* b) {
+            return a->start != b->start ? a->start < b->start : a->end < b->end;
+        });
+
+        std::vector<Interval*> active; // holding a register
+        std::vector<Reg> free;
+        for (Reg r : kCalleeSaved) free.push_back(r);
+        for (Reg r : kCallerSaved) free.push_back(r);
+        auto isCallerSaved = [](Reg r) { return r == R10 || r == R11; };
+
+        for (Interval* current : order) {
+            for (auto it = active.begin(); it != active.end();) {
+                if ((*it)->end < current->start) {
+                    free.push_back((*it)->loc.reg);
+                    it = active.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            // Caller-saved registers cost no save/restore, so short values take them first
+            auto pick = free.end();
+            for (auto it = free.begin(); it != free.end(); ++it) {
+                if (current->crossesCall && isCallerSaved(*it)) continue;
+                if (pick == free.end() || (isCallerSaved(*it) && !isCallerSaved(*pick))) pick = it;
+            }
+            if (pick != free.end()) {
+                current->loc = Operand::r(*pick);
+                free.erase(pick);
+                active.push_back(current);
+                continue;
+            }
+
+            // Spill whichever usable interval ends last
+            Interval* victim = nullptr;
+            for (Interval* a : active) {
+                if (current->crossesCall && isCallerSaved(a->loc.reg)) continue;
+                if (!victim || a->end > victim->end) victim = a;
+            }
+            if (victim && victim->end > current->end) {
+                current->loc = victim->loc;
+                victim->loc = newSpillSlot();
+                std::replace(active.begin(), active.end(), victim, current);
+            } else {
+                current->loc = newSpillSlot();
+            }
+        }
+
+        for (const auto& interval : intervals_) {
+            if (interval.loc.isStack()) {
+                stats_.valuesSpilled++;
+                continue;
+            }
+            stats_.valuesInRegisters++;
+            Reg r = interval.loc.reg;
+            if (!isCallerSaved(r) && std::find(saved_regs_.begin(), saved_regs_.end(), r) == saved_regs_.end()) {
+                saved_regs_.push_back(r);
+            }
+        }
+        std::sort(saved_regs_.begin(), saved_regs_.end());
+
+        // Spill slots sit below the saved registers
+        int savedBytes = 8 * static_cast<int>(saved_regs_.size());
+        for (auto& interval : intervals_) {
+            if (interval.loc.isStack()) interval.loc.value -= savedBytes;
+        }
+    }
+
+    Operand loc(const ir::Value* v) const {
+        if (auto c = dynamic_cast<const ir::Constant*>(v)) return Operand::imm(c->value);
+        int i = index(v);
+        if (i < 0) throw std::runtime_error("Baseline codegen: unsupported operand " + v->getName() + " in @" + func_.name);
+        return intervals_[i].loc;
+    }
+
+    // --- Emission ---
+
+    void move(const Operand& dst, const Operand& src) {
+        if (dst == src) return;
+        if (dst.isReg()) {
+            as_.mov(dst.reg, src);
+        } else if (src.isReg()) {
+            as_.mov(dst, src.reg);
+        } else {
+            as_.mov(RAX, src);
+            as_.mov(dst, RAX);
+        }
+    }
+
+    void emitPrologue() {
+        // push rbp leaves rsp 16-byte aligned; keep it so after the spill area
+        as_.push(RBP);
+        as_.movRbpRsp();
+        for (Reg r : saved_regs_) as_.push(r);
+        int frame = 8 * (static_cast<int>(saved_regs_.size()) + spill_slots_);
+        as_.subRsp((frame + 15) / 16 * 16 - 8 * static_cast<int>(saved_regs_.size()));
+
+        for (size_t i = 0; i < func_.args.size(); ++i) {
+            int v = func_.args[i].ssaValue ? index(func_.args[i].ssaValue) : -1;
+            if (v < 0) continue;
+            Operand incoming = i < kNumArgRegs ? Operand::r(kArgRegs[i])
+                                               : Operand::stack(16 + 8 * static_cast<int>(i - kNumArgRegs));
+            move(intervals_[v].loc, incoming);
+        }
+    }
+
+    void emitEpilogue() {
+        as_.leaRspRbp(-8 * static_cast<int>(saved_regs_.size()));
+        for (auto it = saved_regs_.rbegin(); it != saved_regs_.rend(); ++it) as_.pop(*it);
+        as_.pop(RBP);
+        as_.ret();
+    }
+
+    // Sequentializes the parallel copies for the phis of `succ` on the edge from `pred`.
+    void emitEdgeMoves(const ir::BasicBlock& pred, const ir::BasicBlock& succ) {
+        std::vector<std::pair<Operand, Operand>> moves; // (dst, src)
+        forEachPhiUse(pred, succ, [&](const ir::PhiInst* phi, const ir::Value* v) {
+            Operand dst = loc(phi);
+            Operand src = loc(v);
+            if (dst != src) moves.emplace_back(dst, src);
+        });
+
+        while (!moves.empty()) {
+            // A move is safe once no pending move still reads its destination
+            auto ready = std::find_if(moves.begin(), moves.end(), [&](const auto& m) {
+                return std::none_of(moves.begin(), moves.end(), [&](const auto& other) { return other.second == m.first; });
+            });
+            if (ready != moves.end()) {
+                move(ready->first, ready->second);
+                moves.erase(ready);
+                continue;
+            }
+            // Only cycles remain: park one destination's old value in edx
+            Operand parked = moves.front().first;
+            as_.mov(RDX, parked);
+            for (auto& m : moves) {
+                if (m.second == parked) m.second = Operand::r(RDX);
+            }
+        }
+    }
+
+    bool hasEdgeMoves(const ir::BasicBlock& pred, const ir::BasicBlock& succ) const {
+        bool any = false;
+        forEachPhiUse(pred, succ, [&](const ir::PhiInst* phi, const ir::Value* v) {
+            if (loc(phi) != loc(v)) any = true;
+        });
+        return any;
+    }
+
+    Assembler::Label label(const ir::BasicBlock* bb) const { return block_labels_[block_index_.at(bb)]; }
+
+    void jumpTo(const ir::BasicBlock* target, const ir::BasicBlock* next) {
+        if (target != next) as_.jmp(label(target));
+    }
+
+    void emitBlock(const ir::BasicBlock& bb, const ir::BasicBlock* next) {
+        as_.bind(label(&bb));
+        const ir::Instruction* term = bb.getTerminator();
+
+        // A compare feeding only the block's conditional branch fuses into it
+        const ir::BinaryInst* fused = nullptr;
+        if (term->kind == OpKind::CondBr && bb.instructions.size() >= 2) {
+            auto cond = static_cast<const ir::CondBranchInst*>(term)->condition;
+            const ir::Instruction* beforeTerm = std::prev(bb.instructions.end(), 2)->get();
+            if (beforeTerm == cond && isCompare(beforeTerm->kind) && use_count_[index(cond)] == 1) {
+                fused = static_cast<const ir::BinaryInst*>(beforeTerm);
+            }
+        }
+
+        for (const auto& inst : bb.instructions) {
+            if (inst.get() == term) break;
+            if (inst.get() == fused || inst->kind == OpKind::Phi) continue;
+            emitInstruction(*inst);
+        }
+
+        switch (term->kind) {
+            case OpKind::Br: {
+                const ir::BasicBlock* target = static_cast<const ir::BranchInst*>(term)->target;
+                emitEdgeMoves(bb, *target);
+                jumpTo(target, next);
+                break;
+            }
+            case OpKind::CondBr: {
+                auto cbr = static_cast<const ir::CondBranchInst*>(term);
+                if (cbr->thenBB == cbr->elseBB) {
+                    emitEdgeMoves(bb, *cbr->thenBB);
+                    jumpTo(cbr->thenBB, next);
+                    break;
+                }
+                Cond cond = CondNE;
+                if (fused) {
+                    cond = compareCond(fused->kind);
+                    emitCompare(fused);
+                } else {
+                    Operand c = loc(cbr->condition);
+                    Reg r = c.isReg() ? c.reg : RAX;
+                    as_.mov(r, c);
+                    as_.test(r, r);
+                }
+                bool thenMoves = hasEdgeMoves(bb, *cbr->thenBB);
+                bool elseMoves = hasEdgeMoves(bb, *cbr->elseBB);
+                if (!thenMoves && !elseMoves && cbr->thenBB == next) {
+                    as_.jcc(invert(cond), label(cbr->elseBB));
+                    break;
+                }
+                // The else edge falls through; a then edge with copies goes through a stub
+                Assembler::Label thenStub = thenMoves ? as_.newLabel() : label(cbr->thenBB);
+                as_.jcc(cond, thenStub);
+                emitEdgeMoves(bb, *cbr->elseBB);
+                if (thenMoves) {
+                    as_.jmp(label(cbr->elseBB));
+                    as_.bind(thenStub);
+                    emitEdgeMoves(bb, *cbr->thenBB);
+                    jumpTo(cbr->thenBB, next);
+                } else {
+                    jumpTo(cbr->elseBB, next);
+                }
+                break;
+            }
+            case OpKind::Ret: {
+                auto ret = static_cast<const ir::ReturnInst*>(term);
+                if (ret->value) as_.mov(RAX, loc(ret->value));
+                emitEpilogue();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Sets the flags for `cmp->left <op> cmp->right`
+    void emitCompare(const ir::BinaryInst* cmp) {
+        Operand lhs = loc(cmp->left);
+        Reg r = lhs.isReg() ? lhs.reg : RAX;
+        as_.mov(r, lhs);
+        as_.cmp(r, loc(cmp->right));
+    }
+
+    void emitInstruction(const ir::Instruction& inst) {
+        switch (inst.kind) {
+            case OpKind::Call:
+                emitCall(static_cast<const ir::CallInst&>(inst));
+                return;
+            case OpKind::Not: {
+                Operand dst = loc(&inst);
+                Reg r = dst.isReg() ? dst.reg : RAX;
+                as_.mov(r, loc(static_cast<const ir::UnaryInst&>(inst).operand));
+                as_.xorImm(r, 1);
+                as_.mov(dst, r);
+                return;
+            }
+            default:
+                break;
+        }
+
+        auto& bin = static_cast<const ir::BinaryInst&>(inst);
+        Operand dst = loc(&inst);
+        Operand lhs = loc(bin.left);
+        Operand rhs = loc(bin.right);
+
+        if (isCompare(inst.kind)) {
+            emitCompare(&bin);
+            as_.setcc(compareCond(inst.kind), RAX);
+            as_.movzxByte(RAX, RAX);
+            as_.mov(dst, RAX);
+            return;
+        }
+
+        if (inst.kind == OpKind::SDiv || inst.kind == OpKind::SRem) {
+            as_.mov(RAX, lhs);
+            as_.mov(RCX, rhs);
+            as_.cdq();
+            as_.idiv(RCX);
+            as_.mov(dst, inst.kind == OpKind::SDiv ? RAX : RDX);
+            return;
+        }
+
+        if (inst.kind == OpKind::Shl) {
+            Reg r = dst.isReg() ? dst.reg : RAX;
+            if (rhs.isImm()) {
+                as_.mov(r, lhs);
+                as_.shl(r, static_cast<uint8_t>(rhs.value & 31));
+            } else {
+                as_.mov(RCX, rhs);
+                as_.mov(r, lhs);
+                as_.shlCl(r);
+            }
+            as_.mov(dst, r);
+            return;
+        }
+
+        // Compute in the destination register unless that would clobber rhs
+        Reg r = dst.isReg() && !(rhs.isReg() && rhs.reg == dst.reg) ? dst.reg : RAX;
+        as_.mov(r, lhs);
+        switch (inst.kind) {
+            case OpKind::Add: as_.add(r, rhs); break;
+            case OpKind::Sub: as_.sub(r, rhs); break;
+            case OpKind::Mul: as_.imul(r, rhs); break;
+            default: throw std::runtime_error("Baseline codegen: unsupported instruction in @" + func_.name);
+        }
+        as_.mov(dst, r);
+    }
+
+    void emitCall(const ir::CallInst& call) {
+        // The baseline never removes dead code, so the argument was computed anyway
+        if (call.callee == "blackhole") return;
+        // Argument sources are never argument registers, so plain moves suffice
+        size_t stackArgs = call.args.size() > kNumArgRegs ? call.args.size() - kNumArgRegs : 0;
+        int padding = stackArgs % 2 ? 8 : 0;
+        as_.subRsp(padding);
+        for (size_t i = call.args.size(); i-- > kNumArgRegs;) {
+            as_.mov(RAX, loc(call.args[i]));
+            as_.push(RAX);
+        }
+        for (size_t i = 0; i < call.args.size() && i < kNumArgRegs; ++i) {
+            as_.mov(kArgRegs[i], loc(call.args[i]));
+        }
+
+        auto it = function_labels_.find(call.callee);
+        if (it != function_labels_.end()) {
+            as_.call(it->second);
+        } else if (ir::findBuiltin(call.callee)) {
+            as_.callExternal(call.callee);
+        } else {
+            throw std::runtime_error("Baseline codegen: call to unknown function '" + call.callee + "'");
+        }
+        as_.addRsp(static_cast<int32_t>(8 * stackArgs) + padding);
+        if (producesValue(call)) as_.mov(loc(&call), RAX);
+    }
+};
+
+} // namespace
+
+MachineCode BaselineCodegen::generate(const ir::Module& module) {
+    stats_ = Statistics();
+    Assembler as;
+    std::map<std::string, Assembler::Label> labels;
+    for (const auto& func : module.functions) {
+        if (func->blocks.empty()) throw std::runtime_error("Baseline codegen: function '" + func->name + "' has no body");
+        labels[func->name] = as.newLabel();
+    }
+    for (const auto& func : module.functions) {
+        FunctionCompiler(*func, as, labels, stats_).compile();
+        stats_.functions++;
+    }
+
+    MachineCode out;
+    out.text = as.finish();
+    for (size_t i = 0; i < module.functions.size(); ++i) {
+        const std::string& name = module.functions[i]->name;
+        size_t start = as.labelOffset(labels.at(name));
+        size_t end = i + 1 < module.functions.size() ? as.labelOffset(labels.at(module.functions[i + 1]->name))
+                                                     : out.text.size();
+        out.functions.push_back({name, start, end - start, !options_.isInternal(name)});
+    }
+    for (const auto& call : as.externalCalls()) out.relocations.push_back({call.offset, call.symbol});
+    return out;
+}
+
+} // namespace kotlin_lite
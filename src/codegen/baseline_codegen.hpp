@@ -0,0 +1,65 @@
+#pragma once
+#include "ir/ir.hpp"
+#include "codegen_options.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+
+// x86-64 machine code for a whole module, before linking.
+struct MachineCode {
+    struct Symbol {
+        std::string name;
+        size_t offset;
+        size_t size;
+        bool global;
+    };
+    // Call to a function outside the module (the runtime's print_*): the rel32
+    // at `offset` must become `symbol - (offset + 4)`, i.e. R_X86_64_PLT32
+    // with addend -4.
+    struct Relocation {
+        size_t offset;
+        std::string symbol;
+    };
+
+    std::vector<uint8_t> text;
+    std::vector<Symbol> functions;
+    std::vector<Relocation> relocations;
+
+    const Symbol* findFunction(const std::string& name) const;
+};
+
+// Baseline backend: lowers the custom SSA IR straight to x86-64, without
+// LLVM, for fast debug builds and `--backend=baseline --run`.
+//
+// Every function goes through one linear scan over live intervals computed
+// from block-order liveness. Values live across a call get callee-saved
+// registers (rbx, r12-r15); short values may also use r10/r11; the rest are
+// spilled to rbp-relative stack slots. Phis become parallel copies on the
+// incoming edges. Calls follow the SysV ABI, so the output links against
+// src/runtime/runtime.c like the LLVM backend's.
+class BaselineCodegen {
+public:
+    struct Statistics {
+        size_t functions = 0;
+        size_t valuesInRegisters = 0;
+        size_t valuesSpilled = 0;
+    };
+
+    BaselineCodegen() = default;
+    explicit BaselineCodegen(CodegenOptions options) : options_(std::move(options)) {}
+
+    // Throws std::runtime_error for calls to unknown functions and for IR the
+    // backend cannot lower (blocks without terminators, function operands).
+    MachineCode generate(const ir::Module& module);
+
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    CodegenOptions options_;
+    Statistics stats_;
+};
+
+} // namespace kotlin_lite
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <string>
+
+namespace kotlin_lite {
+
+// Shared by the LLVM and the baseline x86-64 backends.
+struct CodegenOptions {
+    // Whole-program mode: every function except the entry point and the
+    // exported ones gets internal linkage and the fast calling convention.
+    bool wholeProgram = false;
+    std::set<std::string> exported;
+
+    // Keep the frame pointer in every function, so that the runtime's
+    // sampling profiler (KL_SAMPLE_FILE) can walk the stack. The baseline
+    // backend always keeps it.
+    bool framePointers = true;
+
+    // --profile-generate: the program counts into an array of `counters`
+    // described by `layout` (see ir::ProfileInstrumentation) and writes the
+    // profile to `file` at exit. Only the LLVM backend supports it.
+    struct ProfileGeneration {
+        std::string file;
+        std::string layout;
+        size_t counters = 0;
+    };
+    std::optional<ProfileGeneration> profileGenerate;
+
+    // --instrument: count calls and cycles per function and iterations per
+    // loop; the runtime reports them to `<file>.txt` and `<file>.json` at
+    // exit. Functions with fewer than `minTimedInstructions` IR instructions
+    // and no loops are only counted, and their cycles go to their callers.
+    // Only the LLVM backend supports it.
+    struct Instrumentation {
+        std::string file;
+        size_t minTimedInstructions = 24;
+    };
+    std::optional<Instrumentation> instrument;
+
+    // -g: DWARF line tables and variable locations, for the source `file`
+    // in `directory`. Only the LLVM backend supports it.
+    struct DebugInfo {
+        std::string file;
+        std::string directory;
+    };
+    std::optional<DebugInfo> debugInfo;
+
+    // A tuned build: hints put on every loop for LLVM's unroller and
+    // vectorizer. 0 leaves the choice to LLVM; an unroll count or vector
+    // width of 1 turns that transform off. Only the LLVM backend supports it.
+    struct LoopHints {
+        unsigned unrollCount = 0;
+        unsigned vectorWidth = 0;
+        unsigned interleaveCount = 0;
+    };
+    std::optional<LoopHints> loopHints;
+
+    // --target-cpu / --target-features: every function is compiled for this
+    // CPU and these features ("+avx2,-fma"), which it carries as its
+    // "target-cpu" and "target-features" attributes. Only the LLVM backend
+    // supports it.
+    struct Target {
+        std::string cpu = "generic";
+        std::string features;
+    };
+    std::optional<Target> target;
+
+    // --multiversion: these functions are also compiled for the x86-64
+    // levels v2, v3 and v4, and calls reach the version for the running CPU
+    // through an ifunc. Only the LLVM backend supports it.
+    std::set<std::string> multiversion;
+
+    // The result cache of a `@Memoize` function that gives no capacity of
+    // its own, in entries. Only the LLVM backend supports it.
+    unsigned memoizeCapacity = 65536;
+
+    bool isInternal(const std::string& name) const {
+        return wholeProgram && name != "main" && !exported.count(name);
+    }
+};
+
+} // namespace kotlin_lite
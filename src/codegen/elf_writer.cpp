@@ -0,0 +1,152 @@
+#include "elf_writer.hpp"
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+namespace kotlin_lite {
+
+namespace {
+
+class StringTable {
+public:
+    StringTable() : data_(1, '\0') {}
+
+    uint32_t add(const std::string& s) {
+        uint32_t offset = static_cast<uint32_t>(data_.size());
+        data_.insert(data_.end(), s.begin(), s.end());
+        data_.push_back('\0');
+        return offset;
+    }
+
+    const std::vector<char>& data() const { return data_; }
+
+private:
+    std::vector<char> data_;
+};
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void align(std::vector<uint8_t>& out, size_t alignment) {
+    while (out.size() % alignment) out.push_back(0);
+}
+
+} // namespace
+
+std::vector<uint8_t> writeElfObject(const MachineCode& code) {
+    enum Section { Null, Text, RelaText, Symtab, Strtab, Shstrtab, NoteGnuStack, NumSections };
+
+    StringTable shstrtab;
+    StringTable strtab;
+    const char* const names[NumSections] = {"", ".text", ".rela.text", ".symtab", ".strtab", ".shstrtab",
+                                            ".note.GNU-stack"};
+    std::vector<Elf64_Shdr> headers(NumSections);
+    std::memset(headers.data(), 0, sizeof(Elf64_Shdr) * headers.size());
+    for (int i = Text; i < NumSections; ++i) headers[i].sh_name = shstrtab.add(names[i]);
+
+    // Locals (null, .text section symbol, internal functions) must precede globals
+    std::vector<Elf64_Sym> symbols(2);
+    std::memset(symbols.data(), 0, sizeof(Elf64_Sym) * symbols.size());
+    symbols[1].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+    symbols[1].st_shndx = Text;
+    auto addFunction = [&](const MachineCode::Symbol& sym, unsigned char binding) {
+        Elf64_Sym s{};
+        s.st_name = strtab.add(sym.name);
+        s.st_info = ELF64_ST_INFO(binding, STT_FUNC);
+        s.st_shndx = Text;
+        s.st_value = sym.offset;
+        s.st_size = sym.size;
+        symbols.push_back(s);
+    };
+    for (const auto& sym : code.functions) {
+        if (!sym.global) addFunction(sym, STB_LOCAL);
+    }
+    uint32_t firstGlobal = static_cast<uint32_t>(symbols.size());
+    for (const auto& sym : code.functions) {
+        if (sym.global) addFunction(sym, STB_GLOBAL);
+    }
+    std::map<std::string, uint32_t> undefined;
+    for (const auto& reloc : code.relocations) {
+        if (undefined.count(reloc.symbol)) continue;
+        Elf64_Sym s{};
+        s.st_name = strtab.add(reloc.symbol);
+        s.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+        s.st_shndx = SHN_UNDEF;
+        undefined[reloc.symbol] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back(s);
+    }
+
+    std::vector<Elf64_Rela> relocations;
+    for (const auto& reloc : code.relocations) {
+        Elf64_Rela r{};
+        r.r_offset = reloc.offset;
+        r.r_info = ELF64_R_INFO(undefined.at(reloc.symbol), R_X86_64_PLT32);
+        r.r_addend = -4;
+        relocations.push_back(r);
+    }
+
+    std::vector<uint8_t> out(sizeof(Elf64_Ehdr));
+
+    auto place = [&](Section index, uint32_t type, const void* data, size_t size, size_t alignment) {
+        align(out, alignment);
+        Elf64_Shdr& h = headers[index];
+        h.sh_type = type;
+        h.sh_offset = out.size();
+        h.sh_size = size;
+        h.sh_addralign = alignment;
+        if (size) out.insert(out.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    };
+    place(Text, SHT_PROGBITS, code.text.data(), code.text.size(), 16);
+    headers[Text].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    place(RelaText, SHT_RELA, relocations.data(), relocations.size() * sizeof(Elf64_Rela), 8);
+    headers[RelaText].sh_flags = SHF_INFO_LINK;
+    headers[RelaText].sh_link = Symtab;
+    headers[RelaText].sh_info = Text;
+    headers[RelaText].sh_entsize = sizeof(Elf64_Rela);
+    place(Symtab, SHT_SYMTAB, symbols.data(), symbols.size() * sizeof(Elf64_Sym), 8);
+    headers[Symtab].sh_link = Strtab;
+    headers[Symtab].sh_info = firstGlobal;
+    headers[Symtab].sh_entsize = sizeof(Elf64_Sym);
+    place(Strtab, SHT_STRTAB, strtab.data().data(), strtab.data().size(), 1);
+    place(Shstrtab, SHT_STRTAB, shstrtab.data().data(), shstrtab.data().size(), 1);
+    // Empty marker section: the code does not need an executable stack
+    headers[NoteGnuStack].sh_type = SHT_PROGBITS;
+    headers[NoteGnuStack].sh_offset = out.size();
+    headers[NoteGnuStack].sh_addralign = 1;
+
+    align(out, 8);
+    size_t sectionHeaders = out.size();
+    for (const auto& h : headers) append(out, h);
+
+    Elf64_Ehdr ehdr{};
+    std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    ehdr.e_type = ET_REL;
+    ehdr.e_machine = EM_X86_64;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_shoff = sectionHeaders;
+    ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+    ehdr.e_shentsize = sizeof(Elf64_Shdr);
+    ehdr.e_shnum = NumSections;
+    ehdr.e_shstrndx = Shstrtab;
+    std::memcpy(out.data(), &ehdr, sizeof(ehdr));
+    return out;
+}
+
+void writeElfObjectFile(const MachineCode& code, const std::string& path) {
+    std::vector<uint8_t> bytes = writeElfObject(code);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Could not open " + path + " for writing");
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file) throw std::runtime_error("Could not write " + path);
+}
+
+} // namespace kotlin_lite
@@ -0,0 +1,18 @@
+#pragma once
+#include "baseline_codegen.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+
+// ELF64 relocatable object (x86-64 SysV) holding the baseline backend's code:
+// .text, a symbol per function (local for internal ones), undefined symbols
+// for the runtime functions and R_X86_64_PLT32 relocations for their calls.
+// Link it together with src/runtime/runtime.c.
+std::vector<uint8_t> writeElfObject(const MachineCode& code);
+
+// Throws std::runtime_error if the file cannot be written.
+void writeElfObjectFile(const MachineCode& code, const std::string& path);
+
+} // namespace kotlin_lite
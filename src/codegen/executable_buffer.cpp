@@ -0,0 +1,97 @@
+#include "executable_buffer.hpp"
+#include "ir/builtins.hpp"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <sys/mman.h>
+
+namespace kotlin_lite {
+
+namespace {
+
+void printI32(int32_t value) { std::printf("%d\n", value); }
+void printU32(uint32_t value) { std::printf("%u\n", value); }
+void printBool(int8_t value) { std::fputs(value ? "true\n" : "false\n", stdout); }
+
+// The arguments of the running program
+const std::vector<std::string>* arguments = nullptr;
+
+int32_t argCount() { return arguments ? static_cast<int32_t>(arguments->size()) : 0; }
+int32_t argInt(int32_t index, int32_t fallback) {
+    return arguments ? ir::builtinArgInt(*arguments, index, fallback) : fallback;
+}
+
+const void* runtimeFunction(const std::string& name) {
+    if (name == "print_i32") return reinterpret_cast<const void*>(&printI32);
+    if (name == "print_u32") return reinterpret_cast<const void*>(&printU32);
+    if (name == "print_bool") return reinterpret_cast<const void*>(&printBool);
+    if (name == "argCount") return reinterpret_cast<const void*>(&argCount);
+    if (name == "argInt") return reinterpret_cast<const void*>(&argInt);
+    return nullptr;
+}
+
+// jmp qword ptr [rip + 0] followed by the absolute target, padded to 16 bytes
+const size_t kStubSize = 16;
+
+} // namespace
+
+ExecutableBuffer::ExecutableBuffer(const MachineCode& code) : functions_(code.functions) {
+    std::map<std::string, size_t> stubs;
+    size_t textSize = (code.text.size() + kStubSize - 1) / kStubSize * kStubSize;
+    for (const auto& reloc : code.relocations) {
+        if (!stubs.count(reloc.symbol)) stubs.emplace(reloc.symbol, textSize + stubs.size() * kStubSize);
+    }
+    size_ = textSize + stubs.size() * kStubSize;
+    if (size_ == 0) size_ = kStubSize;
+
+    void* memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) throw std::runtime_error("Could not map memory for the generated code");
+    memory_ = static_cast<uint8_t*>(memory);
+    std::memcpy(memory_, code.text.data(), code.text.size());
+
+    for (const auto& [symbol, offset] : stubs) {
+        const void* target = runtimeFunction(symbol);
+        if (!target) {
+            munmap(memory_, size_);
+            throw std::runtime_error("Generated code calls unknown external function '" + symbol + "'");
+        }
+        uint8_t* stub = memory_ + offset;
+        const uint8_t jmp[] = {0xFF, 0x25, 0x00, 0x00, 0x00, 0x00};
+        std::memcpy(stub, jmp, sizeof(jmp));
+        uint64_t address = reinterpret_cast<uint64_t>(target);
+        std::memcpy(stub + sizeof(jmp), &address, sizeof(address));
+    }
+    for (const auto& reloc : code.relocations) {
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(stubs.at(reloc.symbol)) -
+                                           static_cast<int64_t>(reloc.offset + 4));
+        std::memcpy(memory_ + reloc.offset, &rel, sizeof(rel));
+    }
+
+    if (mprotect(memory_, size_, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory_, size_);
+        throw std::runtime_error("Could not make the generated code executable");
+    }
+}
+
+ExecutableBuffer::~ExecutableBuffer() {
+    if (memory_) munmap(memory_, size_);
+}
+
+const void* ExecutableBuffer::address(const std::string& function) const {
+    for (const auto& sym : functions_) {
+        if (sym.name == function) return memory_ + sym.offset;
+    }
+    throw std::runtime_error("No function '" + function + "' in the generated code");
+}
+
+int32_t ExecutableBuffer::run(const std::string& entry, const std::vector<std::string>& args) const {
+    auto fn = reinterpret_cast<int32_t (*)()>(const_cast<void*>(address(entry)));
+    arguments = &args;
+    int32_t result = fn();
+    arguments = nullptr;
+    std::fflush(stdout);
+    return result;
+}
+
+} // namespace kotlin_lite
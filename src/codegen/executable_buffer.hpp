@@ -0,0 +1,36 @@
+#pragma once
+#include "baseline_codegen.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+
+// Baseline machine code mapped into the compiler's own address space, for
+// `--backend=baseline --run` without an object file or a linker. Calls to
+// the runtime go through stubs to in-process implementations that behave
+// like src/runtime/runtime.c.
+class ExecutableBuffer {
+public:
+    // Throws std::runtime_error if the mapping fails or the code calls an
+    // external function other than the runtime's.
+    explicit ExecutableBuffer(const MachineCode& code);
+    ~ExecutableBuffer();
+    ExecutableBuffer(const ExecutableBuffer&) = delete;
+    ExecutableBuffer& operator=(const ExecutableBuffer&) = delete;
+
+    const void* address(const std::string& function) const;
+
+    // Calls `entry` (no arguments) and returns its 32-bit result, which is
+    // meaningless for Unit functions. `args` are what argCount and argInt
+    // see. stdout is flushed afterwards.
+    int32_t run(const std::string& entry = "main", const std::vector<std::string>& args = {}) const;
+
+private:
+    std::vector<MachineCode::Symbol> functions_;
+    uint8_t* memory_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace kotlin_lite
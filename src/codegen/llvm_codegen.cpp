@@ -1,184 +1,1009 @@
 #include "llvm_codegen.hpp"
+#include "ir/builtins.hpp"
+#include "ir/cfg.hpp"
+#include "ir/profile.hpp"
+#include "ir/statistics.hpp"
+#include <algorithm>
+#include <cstring>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/ProfileSummary.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Support/raw_ostream.h>
 
 namespace kotlin_lite {
 
+KL_STATISTIC(FunctionsEmitted, "llvm-codegen", "Functions emitted");
+KL_STATISTIC(BlocksEmitted, "llvm-codegen", "Basic blocks emitted");
+KL_STATISTIC(InstructionsLowered, "llvm-codegen", "IR instructions lowered");
+KL_STATISTIC(LLVMInstructions, "llvm-codegen", "LLVM instructions in the finished module");
+KL_STATISTIC(DebugValues, "llvm-codegen", "llvm.dbg.value calls emitted for -g");
+KL_STATISTIC(ParallelCalls, "llvm-codegen", "Parallel loops handed to the runtime");
+KL_STATISTIC(MultiversionedFunctions, "llvm-codegen", "Functions compiled for several x86-64 levels");
+KL_STATISTIC(MemoizedFunctions, "llvm-codegen", "@Memoize functions given a result cache");
+KL_STATISTIC(HintedLoops, "llvm-codegen", "Loops given unroll and vectorize hints, from annotations or a tuning");
+KL_STATISTIC(InstrumentedFunctions, "llvm-codegen", "Functions instrumented for --instrument");
+KL_STATISTIC(InstrumentedLoops, "llvm-codegen", "Loops instrumented for --instrument");
+
 LLVMCodegen::LLVMCodegen() : builder_(context_) {}
 
+LLVMCodegen::LLVMCodegen(CodegenOptions options) : options_(std::move(options)), builder_(context_) {}
+
 std::unique_ptr<llvm::Module> LLVMCodegen::generate(const ir::Module& irModule) {
-    llvmModule_ = std::make_unique<llvm::Module>("kotlin_lite", context_);
-    valueMap_.clear();
-    bbMap_.clear();
+    beginModule();
+    ir::FunctionAttrs attrs(irModule);
 
     // 1. Declare all functions first
     for (const auto& irFunc : irModule.functions) {
-        std::vector<llvm::Type*> paramTypes;
-        for (const auto& arg : irFunc->args) {
-            paramTypes.push_back(getLLVMType(arg.type));
-        }
-        llvm::FunctionType* funcType = llvm::FunctionType::get(getLLVMType(irFunc->returnType), paramTypes, false);
-        llvm::Function* llvmFunc = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, irFunc->name, llvmModule_.get());
-        
-        // Map IR function to LLVM function
-        valueMap_[irFunc.get()] = llvmFunc;
-
-        // Name the arguments and map them
-        unsigned i = 0;
-        for (auto& llvmArg : llvmFunc->args()) {
-            llvmArg.setName(irFunc->args[i].name);
-            if (irFunc->args[i].ssaValue) {
-                valueMap_[irFunc->args[i].ssaValue] = &llvmArg;
-            }
-            i++;
-        }
+        declareFunction(*irFunc);
     }
 
     // 2. Generate bodies
     for (const auto& irFunc : irModule.functions) {
-        llvm::Function* llvmFunc = llvmModule_->getFunction(irFunc->name);
-        
-        // Create all basic blocks first to handle forward references
-        for (const auto& irBB : irFunc->blocks) {
-            llvm::BasicBlock* llvmBB = llvm::BasicBlock::Create(context_, irBB->label, llvmFunc);
-            bbMap_[irBB.get()] = llvmBB;
-        }
-
-        // Fill in instructions
-        for (const auto& irBB : irFunc->blocks) {
-            llvm::BasicBlock* llvmBB = bbMap_[irBB.get()];
-            builder_.SetInsertPoint(llvmBB);
-
-            for (const auto& irInst : irBB->instructions) {
-                llvm::Value* val = nullptr;
-                switch (irInst->kind) {
-                    case ir::Instruction::OpKind::Add: {
-                        auto bin = static_cast<ir::BinaryInst*>(irInst.get());
-                        val = builder_.CreateAdd(resolveValue(bin->left), resolveValue(bin->right));
-                        break;
-                    }
-                    case ir::Instruction::OpKind::Sub: {
-                        auto bin = static_cast<ir::BinaryInst*>(irInst.get());
-                        val = builder_.CreateSub(resolveValue(bin->left), resolveValue(bin->right));
-                        break;
-                    }
-                    case ir::Instruction::OpKind::Mul: {
-                        auto bin = static_cast<ir::BinaryInst*>(irInst.get());
-                        val = builder_.CreateMul(resolveValue(bin->left), resolveValue(bin->right));
-                        break;
-                    }
-                    case ir::Instruction::OpKind::SDiv: {
-                        auto bin = static_cast<ir::BinaryInst*>(irInst.get());
-                        val = builder_.CreateSDiv(resolveValue(bin->left), resolveValue(bin->right));
-                        break;
-                    }
-                    case ir::Instruction::OpKind::SRem: {
-                        auto bin = static_cast<ir::BinaryInst*>(irInst.get());
-                        val = builder_.CreateSRem(resolveValue(bin->left), resolveValue(bin->right));
-                        break;
-                    }
-                    case ir::Instruction::OpKind::ICmpEq:
-                    case ir::Instruction::OpKind::ICmpNe:
-                    case ir::Instruction::OpKind::ICmpLt:
-                    case ir::Instruction::OpKind::ICmpLe:
-                    case ir::Instruction::OpKind::ICmpGt:
-                    case ir::Instruction::OpKind::ICmpGe: {
-                        auto bin = static_cast<ir::BinaryInst*>(irInst.get());
-                        llvm::CmpInst::Predicate pred;
-                        if (irInst->kind == ir::Instruction::OpKind::ICmpEq) pred = llvm::CmpInst::ICMP_EQ;
-                        else if (irInst->kind == ir::Instruction::OpKind::ICmpNe) pred = llvm::CmpInst::ICMP_NE;
-                        else if (irInst->kind == ir::Instruction::OpKind::ICmpLt) pred = llvm::CmpInst::ICMP_SLT;
-                        else if (irInst->kind == ir::Instruction::OpKind::ICmpLe) pred = llvm::CmpInst::ICMP_SLE;
-                        else if (irInst->kind == ir::Instruction::OpKind::ICmpGt) pred = llvm::CmpInst::ICMP_SGT;
-                        else pred = llvm::CmpInst::ICMP_SGE;
-                        val = builder_.CreateICmp(pred, resolveValue(bin->left), resolveValue(bin->right));
-                        break;
-                    }
-                    case ir::Instruction::OpKind::Not: {
-                        auto un = static_cast<ir::UnaryInst*>(irInst.get());
-                        val = builder_.CreateNot(resolveValue(un->operand));
-                        break;
-                    }
-                    case ir::Instruction::OpKind::Phi: {
-                        auto phi = static_cast<ir::PhiInst*>(irInst.get());
-                        llvm::PHINode* llvmPhi = builder_.CreatePHI(getLLVMType(phi->type), phi->incomings.size());
-                        val = llvmPhi;
+        emitFunction(*irFunc, attrs.get(irFunc->name));
+    }
+
+    return finishModule();
+}
+
+void LLVMCodegen::beginModule() {
+    llvmModule_ = std::make_unique<llvm::Module>("kotlin_lite", context_);
+    valueMap_.clear();
+    bbMap_.clear();
+    profileCounts_.clear();
+    maxEntryCount_ = 0;
+    profileCounters_ = nullptr;
+    instrumentBuffer_ = nullptr;
+    instrumentLayout_.clear();
+    instrumentedFunctions_ = instrumentedLoops_ = 0;
+    if (options_.instrument) {
+        instrumentBuffer_ = new llvm::GlobalVariable(*llvmModule_, builder_.getInt64Ty()->getPointerTo(), false,
+                                                     llvm::GlobalValue::ExternalLinkage, nullptr, "kl_inst_buffer",
+                                                     nullptr, llvm::GlobalValue::GeneralDynamicTLSModel);
+    }
+    if (options_.profileGenerate) {
+        auto type = llvm::ArrayType::get(builder_.getInt64Ty(), options_.profileGenerate->counters);
+        profileCounters_ = new llvm::GlobalVariable(*llvmModule_, type, false, llvm::GlobalValue::InternalLinkage,
+                                                    llvm::ConstantAggregateZero::get(type), "kl_prof_counters");
+    }
+    diBuilder_.reset();
+    compileUnit_ = nullptr;
+    if (options_.debugInfo) {
+        // DWARF has no language code for Kotlin; C matches its Int and Boolean
+        diBuilder_ = std::make_unique<llvm::DIBuilder>(*llvmModule_);
+        llvm::DIFile* file = diBuilder_->createFile(options_.debugInfo->file, options_.debugInfo->directory);
+        compileUnit_ = diBuilder_->createCompileUnit(llvm::dwarf::DW_LANG_C, file, "kotlin-lite", true, "", 0);
+        llvmModule_->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+        llvmModule_->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+    }
+}
+
+std::unique_ptr<llvm::Module> LLVMCodegen::finishModule() {
+    if (options_.target) {
+        for (llvm::Function& func : *llvmModule_) {
+            if (func.isDeclaration()) continue;
+            func.addFnAttr("target-cpu", options_.target->cpu);
+            if (!options_.target->features.empty()) func.addFnAttr("target-features", options_.target->features);
+        }
+    }
+    for (const std::string& name : options_.multiversion) multiversion(name);
+    if (options_.framePointers) {
+        for (llvm::Function& func : *llvmModule_) {
+            if (!func.isDeclaration()) func.addFnAttr("frame-pointer", "all");
+        }
+    }
+    if (!profileCounts_.empty()) attachProfileSummary();
+    if (instrumentBuffer_) emitInstrumentRegistration();
+    if (diBuilder_) diBuilder_->finalize();
+    if (ir::Statistic::enabled()) {
+        for (const llvm::Function& func : *llvmModule_) LLVMInstructions += func.getInstructionCount();
+    }
+    return std::move(llvmModule_);
+}
+
+void LLVMCodegen::declareFunction(const ir::Function& irFunc) {
+    std::vector<llvm::Type*> paramTypes;
+    for (const auto& arg : irFunc.args) {
+        paramTypes.push_back(getLLVMType(arg.type));
+    }
+    llvm::FunctionType* funcType = llvm::FunctionType::get(getLLVMType(irFunc.returnType), paramTypes, false);
+    llvm::Function* llvmFunc = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, irFunc.name, llvmModule_.get());
+    if (isInternal(irFunc.name)) {
+        llvmFunc->setLinkage(llvm::Function::InternalLinkage);
+        llvmFunc->setCallingConv(llvm::CallingConv::Fast);
+    }
+    valueMap_[&irFunc] = llvmFunc;
+    unsigned i = 0;
+    for (auto& llvmArg : llvmFunc->args()) {
+        llvmArg.setName(irFunc.args[i++].name);
+    }
+}
+
+void LLVMCodegen::emitFunction(const ir::Function& irFunc, const ir::FunctionEffects& effects) {
+    llvm::Function* llvmFunc = llvmModule_->getFunction(irFunc.name);
+    addFunctionAttributes(llvmFunc, effects);
+    addAnnotationAttributes(irFunc, llvmFunc);
+    if (diBuilder_) beginDebugInfo(irFunc, llvmFunc);
+    ++FunctionsEmitted;
+
+    // Map the arguments
+    unsigned i = 0;
+    for (auto& llvmArg : llvmFunc->args()) {
+        if (irFunc.args[i].ssaValue) {
+            valueMap_[irFunc.args[i].ssaValue] = &llvmArg;
+        }
+        i++;
+    }
+
+    // Create all basic blocks first to handle forward references
+    for (const auto& irBB : irFunc.blocks) {
+        llvm::BasicBlock* llvmBB = llvm::BasicBlock::Create(context_, irBB->label, llvmFunc);
+        bbMap_[irBB.get()] = llvmBB;
+        ++BlocksEmitted;
+    }
+
+    // Fill in instructions
+    for (const auto& irBB : irFunc.blocks) {
+        llvm::BasicBlock* llvmBB = bbMap_[irBB.get()];
+        builder_.SetInsertPoint(llvmBB);
+
+        for (const auto& irInst : irBB->instructions) {
+            ++InstructionsLowered;
+            llvm::Value* val = nullptr;
+            if (subprogram_) builder_.SetCurrentDebugLocation(llvm::DILocation::get(context_, irInst->line, irInst->column, subprogram_));
+            switch (irInst->kind) {
+                case ir::Instruction::OpKind::Add: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateAdd(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::Sub: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateSub(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::Mul: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateMul(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::SDiv: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateSDiv(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::SRem: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateSRem(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::Shl: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateShl(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::UDiv: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateUDiv(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::URem: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateURem(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::LShr: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    val = builder_.CreateLShr(resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::ICmpEq:
+                case ir::Instruction::OpKind::ICmpNe:
+                case ir::Instruction::OpKind::ICmpLt:
+                case ir::Instruction::OpKind::ICmpLe:
+                case ir::Instruction::OpKind::ICmpGt:
+                case ir::Instruction::OpKind::ICmpGe:
+                case ir::Instruction::OpKind::ICmpULt:
+                case ir::Instruction::OpKind::ICmpULe:
+                case ir::Instruction::OpKind::ICmpUGt:
+                case ir::Instruction::OpKind::ICmpUGe: {
+                    auto bin = static_cast<ir::BinaryInst*>(irInst.get());
+                    llvm::CmpInst::Predicate pred;
+                    if (irInst->kind == ir::Instruction::OpKind::ICmpEq) pred = llvm::CmpInst::ICMP_EQ;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpNe) pred = llvm::CmpInst::ICMP_NE;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpLt) pred = llvm::CmpInst::ICMP_SLT;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpLe) pred = llvm::CmpInst::ICMP_SLE;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpGt) pred = llvm::CmpInst::ICMP_SGT;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpGe) pred = llvm::CmpInst::ICMP_SGE;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpULt) pred = llvm::CmpInst::ICMP_ULT;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpULe) pred = llvm::CmpInst::ICMP_ULE;
+                    else if (irInst->kind == ir::Instruction::OpKind::ICmpUGt) pred = llvm::CmpInst::ICMP_UGT;
+                    else pred = llvm::CmpInst::ICMP_UGE;
+                    val = builder_.CreateICmp(pred, resolveValue(bin->left), resolveValue(bin->right));
+                    break;
+                }
+                case ir::Instruction::OpKind::Not: {
+                    auto un = static_cast<ir::UnaryInst*>(irInst.get());
+                    val = builder_.CreateNot(resolveValue(un->operand));
+                    break;
+                }
+                case ir::Instruction::OpKind::ZExt:
+                case ir::Instruction::OpKind::SExt:
+                case ir::Instruction::OpKind::Trunc: {
+                    auto un = static_cast<ir::UnaryInst*>(irInst.get());
+                    auto cast = irInst->kind == ir::Instruction::OpKind::ZExt ? llvm::Instruction::ZExt
+                              : irInst->kind == ir::Instruction::OpKind::SExt ? llvm::Instruction::SExt
+                                                                               : llvm::Instruction::Trunc;
+                    val = builder_.CreateCast(cast, resolveValue(un->operand), getLLVMType(irInst->type));
+                    break;
+                }
+                case ir::Instruction::OpKind::Phi: {
+                    auto phi = static_cast<ir::PhiInst*>(irInst.get());
+                    llvm::PHINode* llvmPhi = builder_.CreatePHI(getLLVMType(phi->type), phi->incomings.size());
+                    val = llvmPhi;
+                    break;
+                }
+                case ir::Instruction::OpKind::Call: {
+                    auto call = static_cast<ir::CallInst*>(irInst.get());
+                    if (profileCounters_ && call->callee == ir::kProfileCounterFunction) {
+                        emitCounterIncrement(*call);
                         break;
                     }
-                    case ir::Instruction::OpKind::Call: {
-                        auto call = static_cast<ir::CallInst*>(irInst.get());
-                        std::vector<llvm::Value*> args;
-                        for (auto irArg : call->args) args.push_back(resolveValue(irArg));
-                        
-                        llvm::Function* callee = llvmModule_->getFunction(call->callee);
-                        if (!callee) {
-                            std::vector<llvm::Type*> argTypes;
-                            for (auto a : args) argTypes.push_back(a->getType());
-                            llvm::FunctionType* ft = llvm::FunctionType::get(getLLVMType(call->type), argTypes, false);
-                            callee = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, call->callee, llvmModule_.get());
-                        }
-                        val = builder_.CreateCall(callee, args);
+                    std::vector<llvm::Value*> args;
+                    for (auto irArg : call->args) args.push_back(resolveValue(irArg));
+                    if (call->callee == "blackhole") {
+                        emitBlackhole(args.at(0));
                         break;
                     }
-                    case ir::Instruction::OpKind::Br: {
-                        auto br = static_cast<ir::BranchInst*>(irInst.get());
-                        builder_.CreateBr(bbMap_[br->target]);
-                        break;
+                    
+                    llvm::Function* callee = llvmModule_->getFunction(call->callee);
+                    if (!callee) {
+                        std::vector<llvm::Type*> argTypes;
+                        for (auto a : args) argTypes.push_back(a->getType());
+                        llvm::FunctionType* ft = llvm::FunctionType::get(getLLVMType(call->type), argTypes, false);
+                        callee = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, call->callee, llvmModule_.get());
+                        addBuiltinAttributes(callee);
                     }
-                    case ir::Instruction::OpKind::CondBr: {
-                        auto cbr = static_cast<ir::CondBranchInst*>(irInst.get());
-                        builder_.CreateCondBr(resolveValue(cbr->condition), bbMap_[cbr->thenBB], bbMap_[cbr->elseBB]);
+                    if (call->parallel) {
+                        val = emitParallelCall(*call, callee, args);
                         break;
                     }
-                    case ir::Instruction::OpKind::Ret: {
-                        auto ret = static_cast<ir::ReturnInst*>(irInst.get());
-                        if (ret->value) builder_.CreateRet(resolveValue(ret->value));
-                        else builder_.CreateRetVoid();
-                        break;
+
+                    auto llvmCall = builder_.CreateCall(callee, args);
+                    llvmCall->setCallingConv(callee->getCallingConv());
+                    val = llvmCall;
+                    break;
+                }
+                case ir::Instruction::OpKind::Br: {
+                    auto br = static_cast<ir::BranchInst*>(irInst.get());
+                    builder_.CreateBr(bbMap_[br->target]);
+                    break;
+                }
+                case ir::Instruction::OpKind::CondBr: {
+                    auto cbr = static_cast<ir::CondBranchInst*>(irInst.get());
+                    auto llvmBr = builder_.CreateCondBr(resolveValue(cbr->condition), bbMap_[cbr->thenBB], bbMap_[cbr->elseBB]);
+                    if (cbr->weights && (cbr->weights->thenCount || cbr->weights->elseCount)) {
+                        // Branch weights are 32-bit
+                        uint64_t larger = std::max(cbr->weights->thenCount, cbr->weights->elseCount);
+                        uint64_t scale = larger / UINT32_MAX + 1;
+                        llvmBr->setMetadata(llvm::LLVMContext::MD_prof, llvm::MDBuilder(context_).createBranchWeights(
+                            static_cast<uint32_t>(cbr->weights->thenCount / scale),
+                            static_cast<uint32_t>(cbr->weights->elseCount / scale)));
                     }
+                    break;
+                }
+                case ir::Instruction::OpKind::Ret: {
+                    auto ret = static_cast<ir::ReturnInst*>(irInst.get());
+                    if (ret->value) builder_.CreateRet(resolveValue(ret->value));
+                    else builder_.CreateRetVoid();
+                    break;
                 }
-                if (val) valueMap_[irInst.get()] = val;
             }
+            if (val) valueMap_[irInst.get()] = val;
         }
     }
 
-    // 3. Populate Phi nodes
-    for (const auto& irFunc : irModule.functions) {
-        for (const auto& irBB : irFunc->blocks) {
-            for (const auto& irInst : irBB->instructions) {
-                if (irInst->kind == ir::Instruction::OpKind::Phi) {
-                    auto irPhi = static_cast<ir::PhiInst*>(irInst.get());
-                    auto llvmPhi = llvm::cast<llvm::PHINode>(valueMap_[irInst.get()]);
-                    for (auto const& [bb, val] : irPhi->incomings) {
-                        llvmPhi->addIncoming(resolveValue(val), bbMap_[bb]);
-                    }
+    // Populate Phi nodes
+    for (const auto& irBB : irFunc.blocks) {
+        for (const auto& irInst : irBB->instructions) {
+            if (irInst->kind == ir::Instruction::OpKind::Phi) {
+                auto irPhi = static_cast<ir::PhiInst*>(irInst.get());
+                auto llvmPhi = llvm::cast<llvm::PHINode>(valueMap_[irInst.get()]);
+                for (auto const& [bb, val] : irPhi->incomings) {
+                    llvmPhi->addIncoming(resolveValue(val), bbMap_[bb]);
                 }
             }
         }
     }
 
-    return std::move(llvmModule_);
+    if (subprogram_) {
+        emitVariableLocations(irFunc, llvmFunc);
+        builder_.SetCurrentDebugLocation(llvm::DebugLoc());
+        diBuilder_->finalizeSubprogram(subprogram_);
+        subprogram_ = nullptr;
+    }
+
+    bool annotatedLoops = std::any_of(irFunc.blocks.begin(), irFunc.blocks.end(),
+                                      [](const auto& bb) { return !bb->loopHints.empty(); });
+    if (options_.loopHints || annotatedLoops) addLoopHints(irFunc);
+    if (irFunc.memoize && irFunc.returnType != ir::Type::Void) memoize(irFunc, llvmFunc);
+    if (profileCounters_ && irFunc.name == "main") emitProfileRegistration(llvmFunc);
+    if (instrumentBuffer_) instrumentFunction(irFunc, llvmFunc);
+    if (irFunc.entryCount) applyProfile(irFunc, llvmFunc);
+
+    // Local values are never referenced again; the IR may be freed after this
+    for (const auto& arg : irFunc.args) valueMap_.erase(arg.ssaValue);
+    for (const auto& irBB : irFunc.blocks) {
+        for (const auto& irInst : irBB->instructions) valueMap_.erase(irInst.get());
+        bbMap_.erase(irBB.get());
+    }
+}
+
+// llvm.loop hints on the branches of every latch: a loop's own `@Unroll` and
+// `@Vectorize`, else the tuning's hints, which are the same for every loop
+void LLVMCodegen::addLoopHints(const ir::Function& irFunc) {
+    CodegenOptions::LoopHints tuned = options_.loopHints.value_or(CodegenOptions::LoopHints{});
+    auto hint = [&](const char* name, llvm::Metadata* value = nullptr) -> llvm::Metadata* {
+        std::vector<llvm::Metadata*> operands = {llvm::MDString::get(context_, name)};
+        if (value) operands.push_back(value);
+        return llvm::MDNode::get(context_, operands);
+    };
+    auto count = [&](unsigned n) { return llvm::ConstantAsMetadata::get(builder_.getInt32(n)); };
+    auto enable = [&] { return llvm::ConstantAsMetadata::get(builder_.getTrue()); };
+
+    ir::CFG cfg(irFunc);
+    ir::LoopInfo loopInfo(irFunc, cfg);
+    for (const auto& loop : loopInfo.loops()) {
+        const ir::LoopHints& annotated = loop->header->loopHints;
+        std::vector<llvm::Metadata*> properties;
+        if (annotated.unroll) {
+            // Enabled unrolling is forced, so LLVM reports when it cannot unroll
+            if (*annotated.unroll == 0) properties.push_back(hint("llvm.loop.unroll.enable"));
+            else if (*annotated.unroll == 1) properties.push_back(hint("llvm.loop.unroll.disable"));
+            else properties.push_back(hint("llvm.loop.unroll.count", count(*annotated.unroll)));
+        } else if (tuned.unrollCount == 1) {
+            properties.push_back(hint("llvm.loop.unroll.disable"));
+        } else if (tuned.unrollCount > 1) {
+            properties.push_back(hint("llvm.loop.unroll.count", count(tuned.unrollCount)));
+        }
+        if (annotated.vectorize) {
+            // Likewise forced, unless it turns the vectorizer off
+            if (*annotated.vectorize != 1) properties.push_back(hint("llvm.loop.vectorize.enable", enable()));
+            if (*annotated.vectorize > 0) properties.push_back(hint("llvm.loop.vectorize.width", count(*annotated.vectorize)));
+        } else if (tuned.vectorWidth > 0) {
+            properties.push_back(hint("llvm.loop.vectorize.width", count(tuned.vectorWidth)));
+        }
+        if (tuned.interleaveCount > 0) properties.push_back(hint("llvm.loop.interleave.count", count(tuned.interleaveCount)));
+        if (properties.empty()) continue;
+
+        // The first operand of a loop ID refers to the node itself
+        std::vector<llvm::Metadata*> operands = {nullptr};
+        operands.insert(operands.end(), properties.begin(), properties.end());
+        llvm::MDNode* id = llvm::MDNode::getDistinct(context_, operands);
+        id->replaceOperandWith(0, id);
+        for (ir::BasicBlock* latch : loop->latches) {
+            bbMap_.at(latch)->getTerminator()->setMetadata(llvm::LLVMContext::MD_loop, id);
+        }
+        ++HintedLoops;
+    }
+}
+
+llvm::DIType* LLVMCodegen::getDIType(ir::Type type) {
+    switch (type) {
+        case ir::Type::I32: return diBuilder_->createBasicType("Int", 32, llvm::dwarf::DW_ATE_signed);
+        case ir::Type::I1: return diBuilder_->createBasicType("Boolean", 8, llvm::dwarf::DW_ATE_boolean);
+        // The IR does not know signedness; unsigned values show as their signed twins
+        case ir::Type::I8: return diBuilder_->createBasicType("Byte", 8, llvm::dwarf::DW_ATE_signed);
+        case ir::Type::I16: return diBuilder_->createBasicType("Short", 16, llvm::dwarf::DW_ATE_signed);
+        case ir::Type::I64: return diBuilder_->createBasicType("Long", 64, llvm::dwarf::DW_ATE_signed);
+        default: return nullptr;
+    }
+}
+
+// -g: every instruction gets the position of the source it came from (line
+// 0 for code the passes made up), within a subprogram for its function
+void LLVMCodegen::beginDebugInfo(const ir::Function& irFunc, llvm::Function* llvmFunc) {
+    llvm::DIFile* file = compileUnit_->getFile();
+    std::vector<llvm::Metadata*> signature = {getDIType(irFunc.returnType)};
+    for (const auto& arg : irFunc.args) signature.push_back(getDIType(arg.type));
+    auto flags = llvm::DISubprogram::SPFlagDefinition | llvm::DISubprogram::SPFlagOptimized;
+    if (llvmFunc->hasLocalLinkage()) flags |= llvm::DISubprogram::SPFlagLocalToUnit;
+    subprogram_ = diBuilder_->createFunction(file, irFunc.name, llvm::StringRef(), file, irFunc.line,
+                                             diBuilder_->createSubroutineType(diBuilder_->getOrCreateTypeArray(signature)),
+                                             irFunc.line, llvm::DINode::FlagPrototyped, flags);
+    llvmFunc->setSubprogram(subprogram_);
+    localVariables_.clear();
+}
+
+// Arguments, and every value a source variable was assigned, get an
+// llvm.dbg.value, which LLVM keeps up to date through its optimizations
+void LLVMCodegen::emitVariableLocations(const ir::Function& irFunc, llvm::Function* llvmFunc) {
+    llvm::DIFile* file = compileUnit_->getFile();
+    llvm::DIExpression* expression = diBuilder_->createExpression();
+    llvm::BasicBlock& entry = llvmFunc->getEntryBlock();
+    auto atEntry = llvm::DILocation::get(context_, irFunc.line, 0, subprogram_);
+    unsigned number = 1;
+    for (auto& llvmArg : llvmFunc->args()) {
+        const ir::Argument& arg = irFunc.args[number - 1];
+        auto variable = diBuilder_->createParameterVariable(subprogram_, arg.name, number++, file, irFunc.line,
+                                                            getDIType(arg.type), true);
+        localVariables_[arg.name] = variable;
+        diBuilder_->insertDbgValueIntrinsic(&llvmArg, variable, expression, atEntry, &*entry.getFirstInsertionPt());
+        ++DebugValues;
+    }
+
+    for (const auto& irBB : irFunc.blocks) {
+        for (const auto& irInst : irBB->instructions) {
+            if (irInst->variable.empty()) continue;
+            auto it = valueMap_.find(irInst.get());
+            auto value = it == valueMap_.end() ? nullptr : llvm::dyn_cast<llvm::Instruction>(it->second);
+            if (!value || !getDIType(irInst->type)) continue;
+            llvm::DILocalVariable*& variable = localVariables_[irInst->variable];
+            if (!variable) {
+                variable = diBuilder_->createAutoVariable(subprogram_, irInst->variable, file, irInst->line,
+                                                          getDIType(irInst->type), true);
+            }
+            llvm::Instruction* before = llvm::isa<llvm::PHINode>(value) ? &*value->getParent()->getFirstInsertionPt()
+                                                                        : value->getNextNode();
+            auto location = llvm::DILocation::get(context_, irInst->line, irInst->column, subprogram_);
+            diBuilder_->insertDbgValueIntrinsic(value, variable, expression, location, before);
+            ++DebugValues;
+        }
+    }
+}
+
+namespace {
+
+// Layout of the runtime's per-thread buffer (see runtime.c): the cycles spent
+// in callees of the running timed function, then per function its calls,
+// inclusive cycles, exclusive cycles and recursion depth
+constexpr uint64_t kChildCyclesSlot = 0;
+constexpr uint64_t kFunctionSlots = 4;
+enum { kCallsSlot, kInclusiveSlot, kExclusiveSlot, kDepthSlot };
+
+uint64_t functionSlot(size_t function, int slot) { return 1 + function * kFunctionSlots + slot; }
+
+} // namespace
+
+// --instrument. On entry a function bumps its call count and, if timed, reads
+// the cycle counter and starts a fresh callee total; before each return it
+// adds its inclusive and exclusive cycles (inclusive only at the outermost
+// activation of a recursion) and hands its inclusive cycles to the caller's
+// callee total. Loops count header executions in a local; each entry resets
+// it, and every way out (exit edges and returns) reports the iterations to
+// kl_inst_loop.
+void LLVMCodegen::instrumentFunction(const ir::Function& irFunc, llvm::Function* llvmFunc) {
+    ir::CFG cfg(irFunc);
+    ir::LoopInfo loopInfo(irFunc, cfg);
+    size_t function = instrumentedFunctions_++;
+    ++InstrumentedFunctions;
+
+    // Source loops: those whose header carries the line of a `while`. Loops
+    // made by the passes (tail recursion) are left alone
+    std::vector<std::pair<const ir::Loop*, int>> loops;
+    for (const auto& loop : loopInfo.loops()) {
+        for (const auto& inst : loop->header->instructions) {
+            if (inst->line) {
+                loops.push_back({loop.get(), inst->line});
+                break;
+            }
+        }
+    }
+    bool timed = !loops.empty() || irFunc.instructionCount() >= options_.instrument->minTimedInstructions;
+    instrumentLayout_ += "function " + irFunc.name + " " + std::to_string(irFunc.line) + (timed ? " timed\n" : " counted\n");
+
+    llvm::Type* i64 = builder_.getInt64Ty();
+    llvm::BasicBlock& entry = llvmFunc->getEntryBlock();
+    llvm::IRBuilder<> b(&entry, entry.getFirstInsertionPt());
+    llvm::Value* buffer = b.CreateLoad(i64->getPointerTo(), instrumentBuffer_, "inst.buffer");
+    auto slot = [&](llvm::IRBuilder<>& at, uint64_t index) { return at.CreateConstInBoundsGEP1_64(i64, buffer, index); };
+    auto bump = [&](llvm::IRBuilder<>& at, uint64_t index, llvm::Value* amount) {
+        llvm::Value* counter = slot(at, index);
+        llvm::Value* value = at.CreateAdd(at.CreateLoad(i64, counter), amount);
+        at.CreateStore(value, counter);
+        return value;
+    };
+    bump(b, functionSlot(function, kCallsSlot), b.getInt64(1));
+
+    std::vector<llvm::ReturnInst*> returns;
+    for (auto& bb : *llvmFunc) {
+        if (auto ret = llvm::dyn_cast<llvm::ReturnInst>(bb.getTerminator())) returns.push_back(ret);
+    }
+
+    std::map<const ir::Loop*, size_t> loopIds;
+    std::map<const ir::Loop*, llvm::Value*> trips;
+    for (const auto& [loop, line] : loops) {
+        loopIds[loop] = instrumentedLoops_++;
+        ++InstrumentedLoops;
+        instrumentLayout_ += "loop " + irFunc.name + " " + std::to_string(line) + "\n";
+        llvm::Value* counter = b.CreateAlloca(i64, nullptr, "inst.trips");
+        trips[loop] = counter;
+
+        llvm::BasicBlock* header = bbMap_.at(loop->header);
+        llvm::IRBuilder<> h(header, header->getFirstInsertionPt());
+        h.CreateStore(h.CreateAdd(h.CreateLoad(i64, counter), h.getInt64(1)), counter);
+        for (ir::BasicBlock* pred : cfg.predecessors(loop->header)) {
+            if (loop->contains(pred)) continue;
+            llvm::IRBuilder<> p(bbMap_.at(pred)->getTerminator());
+            p.CreateStore(p.getInt64(-1), counter);
+        }
+    }
+    llvm::FunctionCallee reportLoop = llvmModule_->getOrInsertFunction(
+        "kl_inst_loop", llvm::FunctionType::get(builder_.getVoidTy(), {builder_.getInt32Ty(), i64}, false));
+    // The reported loops left on the way from `from` to `to` (out of the function if null), innermost first
+    auto leftLoops = [&](ir::BasicBlock* from, ir::BasicBlock* to) {
+        std::vector<const ir::Loop*> left;
+        for (ir::Loop* loop = loopInfo.loopFor(from); loop && !(to && loop->contains(to)); loop = loop->parent) {
+            if (loopIds.count(loop)) left.push_back(loop);
+        }
+        return left;
+    };
+    auto report = [&](llvm::IRBuilder<>& at, const std::vector<const ir::Loop*>& left) {
+        for (const ir::Loop* loop : left) {
+            at.CreateCall(reportLoop, {at.getInt32(loopIds.at(loop)), at.CreateLoad(i64, trips.at(loop))});
+        }
+    };
+    for (const auto& irBB : irFunc.blocks) {
+        if (!loopInfo.loopFor(irBB.get())) continue;
+        llvm::BasicBlock* from = bbMap_.at(irBB.get());
+        for (ir::BasicBlock* succ : irBB->getSuccessors()) {
+            auto left = leftLoops(irBB.get(), succ);
+            if (left.empty()) continue;
+            // Report on a block of its own between the loop and the exit
+            llvm::BasicBlock* to = bbMap_.at(succ);
+            llvm::BasicBlock* split = llvm::BasicBlock::Create(context_, "inst.loop.exit", llvmFunc, to);
+            llvm::IRBuilder<> e(split);
+            report(e, left);
+            e.CreateBr(to);
+            from->getTerminator()->replaceSuccessorWith(to, split);
+            to->replacePhiUsesWith(from, split);
+        }
+        if (auto ret = llvm::dyn_cast<llvm::ReturnInst>(from->getTerminator())) {
+            llvm::IRBuilder<> r(ret);
+            report(r, leftLoops(irBB.get(), nullptr));
+        }
+    }
+
+    if (!timed) return;
+    llvm::Function* readCycles = llvm::Intrinsic::getDeclaration(llvmModule_.get(), llvm::Intrinsic::readcyclecounter);
+    llvm::Value* start = b.CreateCall(readCycles);
+    bump(b, functionSlot(function, kDepthSlot), b.getInt64(1));
+    llvm::Value* outerChildren = b.CreateLoad(i64, slot(b, kChildCyclesSlot));
+    b.CreateStore(b.getInt64(0), slot(b, kChildCyclesSlot));
+    for (llvm::ReturnInst* ret : returns) {
+        llvm::IRBuilder<> r(ret);
+        llvm::Value* inclusive = r.CreateSub(r.CreateCall(readCycles), start);
+        bump(r, functionSlot(function, kExclusiveSlot), r.CreateSub(inclusive, r.CreateLoad(i64, slot(r, kChildCyclesSlot))));
+        llvm::Value* depth = bump(r, functionSlot(function, kDepthSlot), r.getInt64(-1));
+        bump(r, functionSlot(function, kInclusiveSlot),
+             r.CreateSelect(r.CreateICmpEQ(depth, r.getInt64(0)), inclusive, r.getInt64(0)));
+        r.CreateStore(r.CreateAdd(outerChildren, inclusive), slot(r, kChildCyclesSlot));
+    }
+}
+
+// main registers the instrumented functions and loops with the runtime,
+// which allocates the counters and writes the report when the program exits
+void LLVMCodegen::emitInstrumentRegistration() {
+    llvm::Function* main = llvmModule_->getFunction("main");
+    if (!main || main->isDeclaration()) return;
+    llvm::IRBuilder<> b(&main->getEntryBlock(), main->getEntryBlock().getFirstInsertionPt());
+    llvm::Type* i64 = b.getInt64Ty();
+    llvm::Type* bytePtr = b.getInt8PtrTy();
+    llvm::FunctionCallee registerFn = llvmModule_->getOrInsertFunction(
+        "kl_inst_register", llvm::FunctionType::get(b.getVoidTy(), {i64, i64, bytePtr, bytePtr}, false));
+    b.CreateCall(registerFn, {b.getInt64(instrumentedFunctions_), b.getInt64(instrumentedLoops_),
+                              b.CreateGlobalStringPtr(instrumentLayout_, "kl_inst_layout"),
+                              b.CreateGlobalStringPtr(options_.instrument->file, "kl_inst_file")});
+}
+
+// main hands the counters and their layout to the runtime, which writes
+// the profile when the program exits
+void LLVMCodegen::emitProfileRegistration(llvm::Function* main) {
+    llvm::IRBuilder<> b(&main->getEntryBlock(), main->getEntryBlock().getFirstInsertionPt());
+    llvm::Type* i64 = b.getInt64Ty();
+    llvm::Type* bytePtr = b.getInt8PtrTy();
+    llvm::FunctionCallee registerFn = llvmModule_->getOrInsertFunction(
+        "kl_prof_register", llvm::FunctionType::get(b.getVoidTy(), {i64->getPointerTo(), i64, bytePtr, bytePtr}, false));
+    const CodegenOptions::ProfileGeneration& profile = *options_.profileGenerate;
+    b.CreateCall(registerFn, {b.CreateConstInBoundsGEP2_64(profileCounters_->getValueType(), profileCounters_, 0, 0),
+                              b.getInt64(profile.counters), b.CreateGlobalStringPtr(profile.layout, "kl_prof_layout"),
+                              b.CreateGlobalStringPtr(profile.file, "kl_prof_file")});
+}
+
+// kl_prof_count(i32 counter, i1 taken): counters[counter] += taken. Like
+// clang's default, the update is not atomic.
+void LLVMCodegen::emitCounterIncrement(const ir::CallInst& call) {
+    auto index = static_cast<ir::Constant*>(call.args.at(0));
+    llvm::Type* i64 = builder_.getInt64Ty();
+    llvm::Value* counter = builder_.CreateConstInBoundsGEP2_64(profileCounters_->getValueType(), profileCounters_, 0, index->value);
+    llvm::Value* value = builder_.CreateLoad(i64, counter);
+    builder_.CreateStore(builder_.CreateAdd(value, builder_.CreateZExt(resolveValue(call.args.at(1)), i64)), counter);
+}
+
+// Entry counts and never-executed code from --profile-use. LLVM's inliner
+// and block placement read the entry counts and branch weights through the
+// module's profile summary.
+void LLVMCodegen::applyProfile(const ir::Function& irFunc, llvm::Function* llvmFunc) {
+    llvmFunc->setEntryCount(*irFunc.entryCount);
+    maxEntryCount_ = std::max(maxEntryCount_, *irFunc.entryCount);
+    if (*irFunc.entryCount == 0) {
+        llvmFunc->addFnAttr(llvm::Attribute::Cold);
+    }
+
+    // Blocks that never ran move out of line, behind the ones that did
+    std::vector<llvm::BasicBlock*> cold;
+    for (const auto& irBB : irFunc.blocks) {
+        if (!irBB->profileCount) continue;
+        profileCounts_.push_back(*irBB->profileCount);
+        if (*irBB->profileCount == 0 && *irFunc.entryCount > 0) cold.push_back(bbMap_.at(irBB.get()));
+    }
+    for (llvm::BasicBlock* bb : cold) bb->moveAfter(&llvmFunc->back());
+}
+
+// The summary LLVM's own profile reader would compute: for each cutoff (in
+// millionths of all counts), the smallest count among the hottest blocks
+// that add up to it
+void LLVMCodegen::attachProfileSummary() {
+    static const uint32_t kCutoffs[] = {10000,  100000, 200000, 300000, 400000, 500000, 600000, 700000,
+                                        800000, 900000, 950000, 990000, 999000, 999900, 999990, 999999};
+    std::vector<uint64_t> counts = profileCounts_;
+    std::sort(counts.rbegin(), counts.rend());
+    unsigned __int128 total = 0;
+    for (uint64_t count : counts) total += count;
+
+    llvm::SummaryEntryVector detailed;
+    unsigned __int128 sum = 0;
+    size_t taken = 0;
+    for (uint32_t cutoff : kCutoffs) {
+        unsigned __int128 needed = total * cutoff / 1000000;
+        while (taken < counts.size() && (sum < needed || taken == 0)) sum += counts[taken++];
+        detailed.push_back({cutoff, counts[taken - 1], static_cast<uint64_t>(taken)});
+    }
+    uint64_t totalCount = total > UINT64_MAX ? UINT64_MAX : static_cast<uint64_t>(total);
+    llvm::ProfileSummary summary(llvm::ProfileSummary::PSK_Instr, detailed, totalCount, counts.front(), counts.front(),
+                                 maxEntryCount_, static_cast<uint32_t>(counts.size()),
+                                 static_cast<uint32_t>(llvmModule_->size()));
+    llvmModule_->setProfileSummary(summary.getMD(context_), llvm::ProfileSummary::PSK_Instr);
+}
+
+// An empty asm statement that takes the value in a register: the value must
+// be computed, but nothing is stored or called. Being volatile, it also stays
+// in order with the other side effects, such as the calls to nanoTime.
+void LLVMCodegen::emitBlackhole(llvm::Value* value) {
+    auto type = llvm::FunctionType::get(builder_.getVoidTy(), {value->getType()}, false);
+    builder_.CreateCall(llvm::InlineAsm::get(type, "", "r,~{dirflag},~{fpsr},~{flags}", true), {value});
+}
+
+// @Memoize: a cache of results, looked up in new blocks ahead of the body
+// and filled at each of its returns. A slot holds {used, result, arguments}.
+// A function of one Int keeps the results for 0..capacity-1 in a direct table
+// `name.memo`, indexed by the argument; one Byte or Short has fewer values, so
+// its table may cover them all. One of no arguments or one Boolean needs only
+// one or two slots. Other arguments go to the open-addressing
+// table `name.memo.hash`, of capacity rounded up to a power of two: FNV-1a of
+// the arguments picks the home slot, and up to kMemoProbes slots from there
+// are probed for the arguments or a free slot, failing which the home slot is
+// reused. A cached result is returned before the body runs; otherwise the
+// slot found is written when the body returns, even if a recursive call has
+// taken it in the meantime. The tables are plain globals, so the cache is not
+// thread-safe; auto-parallel leaves loops that call such functions alone.
+void LLVMCodegen::memoize(const ir::Function& irFunc, llvm::Function* llvmFunc) {
+    static constexpr unsigned kMemoProbes = 8;
+    ++MemoizedFunctions;
+    unsigned capacity = *irFunc.memoize ? *irFunc.memoize : options_.memoizeCapacity;
+    llvm::BasicBlock* body = &llvmFunc->getEntryBlock();
+    std::vector<llvm::ReturnInst*> returns;
+    for (auto& bb : *llvmFunc) {
+        if (auto ret = llvm::dyn_cast<llvm::ReturnInst>(bb.getTerminator())) returns.push_back(ret);
+    }
+
+    std::vector<llvm::Value*> keys;
+    std::vector<llvm::Type*> fields = {builder_.getInt1Ty(), llvmFunc->getReturnType()};
+    for (auto& arg : llvmFunc->args()) {
+        keys.push_back(&arg);
+        fields.push_back(arg.getType());
+    }
+    llvm::StructType* slotType = llvm::StructType::get(context_, fields);
+    auto table = [&](const std::string& name, uint64_t size) {
+        auto type = llvm::ArrayType::get(slotType, size);
+        return new llvm::GlobalVariable(*llvmModule_, type, false, llvm::GlobalValue::InternalLinkage,
+                                        llvm::ConstantAggregateZero::get(type), name);
+    };
+    auto block = [&](const char* name) { return llvm::BasicBlock::Create(context_, name, llvmFunc, body); };
+    llvm::BasicBlock* entry = block("memo.entry");
+    llvm::BasicBlock* hit = block("memo.hit");
+    llvm::BasicBlock* miss = block("memo.miss");
+    llvm::IRBuilder<> b(hit);
+    llvm::PHINode* hitSlot = b.CreatePHI(slotType->getPointerTo(), 2, "memo.slot");
+    b.CreateRet(b.CreateLoad(fields[1], b.CreateStructGEP(slotType, hitSlot, 1), "memo.value"));
+    b.SetInsertPoint(miss);
+    llvm::PHINode* missSlot = b.CreatePHI(slotType->getPointerTo(), 3, "memo.slot");
+    b.CreateBr(body);
+
+    // Branches to hit if `slot` holds the result for `keys`; `match` adds
+    // the key comparison for the hashed table
+    auto lookup = [&](llvm::IRBuilder<>& at, llvm::Value* slot, bool match, llvm::BasicBlock* otherwise) {
+        llvm::Value* found = at.CreateLoad(at.getInt1Ty(), at.CreateStructGEP(slotType, slot, 0), "memo.used");
+        for (size_t i = 0; match && i < keys.size(); ++i) {
+            llvm::Value* key = at.CreateLoad(fields[i + 2], at.CreateStructGEP(slotType, slot, static_cast<unsigned>(i + 2)));
+            found = at.CreateAnd(found, at.CreateICmpEQ(key, keys[i]));
+        }
+        hitSlot->addIncoming(slot, at.GetInsertBlock());
+        at.CreateCondBr(found, hit, otherwise);
+    };
+
+    b.SetInsertPoint(entry);
+    bool direct = keys.size() == 0 || (keys.size() == 1 && keys[0]->getType()->getIntegerBitWidth() <= 32);
+    if (direct) {
+        unsigned width = keys.empty() ? 0 : keys[0]->getType()->getIntegerBitWidth();
+        bool dense = width > 1;
+        // Indexed by the key as unsigned, which has 2^width values
+        uint64_t range = uint64_t(1) << width;
+        uint64_t size = dense ? std::min<uint64_t>(capacity, range) : range;
+        llvm::GlobalVariable* directTable = table(irFunc.name + ".memo", size);
+        llvm::BasicBlock* directBlock = entry;
+        llvm::BasicBlock* hashBlock = nullptr;
+        bool complete = size == range;
+        if (!complete) {
+            directBlock = block("memo.direct");
+            hashBlock = block("memo.hash");
+            // Negative arguments are out of range too, as unsigned
+            b.CreateCondBr(b.CreateICmpULT(keys[0], b.getIntN(width, size)), directBlock, hashBlock);
+            b.SetInsertPoint(directBlock);
+        }
+        llvm::Value* index = keys.empty() ? b.getInt64(0) : b.CreateZExt(keys[0], b.getInt64Ty());
+        llvm::Value* slot = b.CreateInBoundsGEP(directTable->getValueType(), directTable, {b.getInt64(0), index});
+        missSlot->addIncoming(slot, directBlock);
+        lookup(b, slot, false, miss);
+        if (complete) {
+            rewriteMemoReturns(returns, slotType, missSlot, keys);
+            return;
+        }
+        b.SetInsertPoint(hashBlock);
+    }
+
+    uint64_t size = llvm::PowerOf2Ceil(capacity);
+    llvm::GlobalVariable* hashTable = table(irFunc.name + ".memo.hash", size);
+    llvm::BasicBlock* hashBlock = b.GetInsertBlock();
+    llvm::Value* hash = b.getInt64(0xcbf29ce484222325ull);
+    for (llvm::Value* key : keys) {
+        hash = b.CreateMul(b.CreateXor(hash, b.CreateZExt(key, b.getInt64Ty())), b.getInt64(0x100000001b3ull));
+    }
+    hash = b.CreateXor(hash, b.CreateLShr(hash, 32));
+    llvm::Value* mask = b.getInt64(size - 1);
+    llvm::Value* home = b.CreateAnd(hash, mask, "memo.home");
+    llvm::BasicBlock* probe = block("memo.probe");
+    llvm::BasicBlock* next = block("memo.next");
+    llvm::BasicBlock* vacant = block("memo.vacant");
+    b.CreateBr(probe);
+
+    b.SetInsertPoint(probe);
+    llvm::PHINode* i = b.CreatePHI(b.getInt64Ty(), 2, "memo.i");
+    i->addIncoming(b.getInt64(0), hashBlock);
+    llvm::Value* slot = b.CreateInBoundsGEP(hashTable->getValueType(), hashTable,
+                                            {b.getInt64(0), b.CreateAnd(b.CreateAdd(home, i), mask)});
+    lookup(b, slot, true, vacant);
+
+    // An unused slot ends the probe; the home slot is reused after the last
+    b.SetInsertPoint(vacant);
+    llvm::Value* unused = b.CreateNot(b.CreateLoad(b.getInt1Ty(), b.CreateStructGEP(slotType, slot, 0)));
+    missSlot->addIncoming(slot, vacant);
+    b.CreateCondBr(unused, miss, next);
+    b.SetInsertPoint(next);
+    llvm::Value* step = b.CreateAdd(i, b.getInt64(1));
+    i->addIncoming(step, next);
+    llvm::Value* homeSlot = b.CreateInBoundsGEP(hashTable->getValueType(), hashTable, {b.getInt64(0), home});
+    missSlot->addIncoming(homeSlot, next);
+    b.CreateCondBr(b.CreateICmpULT(step, b.getInt64(kMemoProbes)), probe, miss);
+    rewriteMemoReturns(returns, slotType, missSlot, keys);
+}
+
+// Before each of the body's returns: the arguments, the result, then the
+// used flag into the slot the lookup found
+void LLVMCodegen::rewriteMemoReturns(const std::vector<llvm::ReturnInst*>& returns, llvm::StructType* slotType,
+                                     llvm::Value* slot, const std::vector<llvm::Value*>& keys) {
+    for (llvm::ReturnInst* ret : returns) {
+        llvm::IRBuilder<> b(ret);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            b.CreateStore(keys[i], b.CreateStructGEP(slotType, slot, static_cast<unsigned>(i + 2)));
+        }
+        b.CreateStore(ret->getReturnValue(), b.CreateStructGEP(slotType, slot, 1));
+        b.CreateStore(b.getTrue(), b.CreateStructGEP(slotType, slot, 0));
+    }
+}
+
+// --multiversion: `name` is compiled once more for each x86-64 level, and
+// everything that called or referenced it goes through an ifunc instead:
+//     name.default, name.v2, name.v3, name.v4   the versions, internal
+//     name.resolver                             picks one by kl_cpu_level()
+//     name                                      the ifunc
+// The dynamic loader calls the resolver once, when it relocates the
+// program. Recursive calls stay within a version. `main` must remain a
+// function for the C runtime, so it calls the ifunc main.ifunc instead.
+void LLVMCodegen::multiversion(const std::string& name) {
+    static const char* kLevels[] = {"x86-64-v2", "x86-64-v3", "x86-64-v4"};
+    llvm::Function* func = llvmModule_->getFunction(name);
+    if (!func || func->isDeclaration()) return;
+    ++MultiversionedFunctions;
+
+    std::vector<llvm::Function*> versions = {func};
+    auto inVersion = [&](llvm::Function* version) {
+        return [version](llvm::Use& use) {
+            auto inst = llvm::dyn_cast<llvm::Instruction>(use.getUser());
+            return inst && inst->getFunction() == version;
+        };
+    };
+    for (const char* level : kLevels) {
+        llvm::ValueToValueMapTy map;
+        llvm::Function* clone = llvm::CloneFunction(func, map);
+        clone->setName(name + "." + std::string(level).substr(std::strlen("x86-64-")));
+        clone->setLinkage(llvm::Function::InternalLinkage);
+        clone->addFnAttr("target-cpu", level);
+        clone->addFnAttr("target-features", "");
+        func->replaceUsesWithIf(clone, inVersion(clone));
+        versions.push_back(clone);
+    }
+
+    // Versions[i] needs level i + 1
+    auto resolverType = llvm::FunctionType::get(func->getType(), false);
+    auto resolver = llvm::Function::Create(resolverType, llvm::Function::InternalLinkage, name + ".resolver", llvmModule_.get());
+    llvm::IRBuilder<> b(llvm::BasicBlock::Create(context_, "entry", resolver));
+    llvm::FunctionCallee cpuLevel = llvmModule_->getOrInsertFunction("kl_cpu_level", b.getInt32Ty());
+    llvm::Value* level = b.CreateCall(cpuLevel);
+    llvm::Value* chosen = func;
+    for (size_t i = 1; i < versions.size(); ++i) {
+        chosen = b.CreateSelect(b.CreateICmpSGE(level, b.getInt32(static_cast<uint32_t>(i + 1))), versions[i], chosen);
+    }
+    b.CreateRet(chosen);
+
+    bool isMain = name == "main";
+    llvm::GlobalValue::LinkageTypes linkage = func->getLinkage();
+    func->setName(name + ".default");
+    func->setLinkage(llvm::Function::InternalLinkage);
+    auto ifunc = llvm::GlobalIFunc::create(func->getFunctionType(), func->getAddressSpace(),
+                                           isMain ? llvm::GlobalValue::InternalLinkage : linkage,
+                                           isMain ? "main.ifunc" : name, resolver, llvmModule_.get());
+    func->replaceUsesWithIf(ifunc, [&](llvm::Use& use) {
+        auto inst = llvm::dyn_cast<llvm::Instruction>(use.getUser());
+        return !inst || (inst->getFunction() != func && inst->getFunction() != resolver);
+    });
+    if (!isMain) return;
+
+    llvm::Function* main = llvm::Function::Create(func->getFunctionType(), linkage, name, llvmModule_.get());
+    main->setCallingConv(func->getCallingConv());
+    main->setAttributes(func->getAttributes());
+    b.SetInsertPoint(llvm::BasicBlock::Create(context_, "entry", main));
+    std::vector<llvm::Value*> args;
+    for (llvm::Argument& arg : main->args()) args.push_back(&arg);
+    llvm::CallInst* call = b.CreateCall(func->getFunctionType(), ifunc, args);
+    call->setCallingConv(func->getCallingConv());
+    if (call->getType()->isVoidTy()) b.CreateRetVoid();
+    else b.CreateRet(call);
+}
+
+// The runtime splits [init, bound) into chunks and calls
+//     i32 thunk(i32 start, i32 end, i8* env)
+// for each of them, possibly on several threads, combining the results with
+// the reduction. The thunk unpacks the remaining worker arguments from env.
+llvm::Value* LLVMCodegen::emitParallelCall(const ir::CallInst& call, llvm::Function* worker, const std::vector<llvm::Value*>& args) {
+    using Op = ir::Instruction::OpKind;
+    ++ParallelCalls;
+    llvm::Type* i32 = builder_.getInt32Ty();
+    llvm::Type* bytePtr = builder_.getInt8PtrTy();
+
+    std::vector<llvm::Type*> envTypes;
+    for (size_t i = 2; i < args.size(); ++i) envTypes.push_back(args[i]->getType());
+    llvm::StructType* envType = llvm::StructType::get(context_, envTypes);
+
+    std::string thunkName = worker->getName().str() + ".chunk";
+    llvm::Function* thunk = llvmModule_->getFunction(thunkName);
+    if (!thunk) {
+        auto thunkType = llvm::FunctionType::get(i32, {i32, i32, bytePtr}, false);
+        thunk = llvm::Function::Create(thunkType, llvm::Function::InternalLinkage, thunkName, llvmModule_.get());
+        llvm::IRBuilder<> b(llvm::BasicBlock::Create(context_, "entry", thunk));
+        auto argIt = thunk->arg_begin();
+        std::vector<llvm::Value*> workerArgs = {&*argIt, &*(argIt + 1)};
+        llvm::Value* env = b.CreateBitCast(&*(argIt + 2), envType->getPointerTo());
+        for (unsigned i = 0; i < envTypes.size(); ++i) {
+            workerArgs.push_back(b.CreateLoad(envTypes[i], b.CreateStructGEP(envType, env, i)));
+        }
+        auto workerCall = b.CreateCall(worker, workerArgs);
+        workerCall->setCallingConv(worker->getCallingConv());
+        b.CreateRet(workerCall);
+    }
+
+    // The environment lives in the caller's frame for the duration of the call
+    llvm::Function* caller = builder_.GetInsertBlock()->getParent();
+    llvm::IRBuilder<> entry(&caller->getEntryBlock(), caller->getEntryBlock().begin());
+    llvm::Value* env = entry.CreateAlloca(envType);
+    for (unsigned i = 0; i < envTypes.size(); ++i) {
+        builder_.CreateStore(args[i + 2], builder_.CreateStructGEP(envType, env, i));
+    }
+
+    const ir::CallInst::ParallelLoop& loop = *call.parallel;
+    int predicate = loop.predicate == Op::ICmpLt ? 0 : loop.predicate == Op::ICmpLe ? 1
+                  : loop.predicate == Op::ICmpGt ? 2 : loop.predicate == Op::ICmpGe ? 3 : 4;
+    int reduction = loop.reduction == Op::Mul ? 1 : 0;
+
+    llvm::FunctionCallee reduce = llvmModule_->getOrInsertFunction(
+        "kl_parallel_reduce", llvm::FunctionType::get(i32, {bytePtr, i32, i32, i32, i32, i32, bytePtr}, false));
+    return builder_.CreateCall(reduce, {builder_.CreateBitCast(thunk, bytePtr), args[0], args[1],
+                                        builder_.getInt32(loop.step), builder_.getInt32(predicate),
+                                        builder_.getInt32(reduction), builder_.CreateBitCast(env, bytePtr)});
 }
 
 void LLVMCodegen::dump(const llvm::Module& module) {
     module.print(llvm::errs(), nullptr);
 }
 
+bool LLVMCodegen::isInternal(const std::string& name) const {
+    return options_.isInternal(name);
+}
+
+void LLVMCodegen::addFunctionAttributes(llvm::Function* func, const ir::FunctionEffects& effects) {
+    if (effects.noUnwind) func->addFnAttr(llvm::Attribute::NoUnwind);
+    if (effects.noFree) func->addFnAttr(llvm::Attribute::NoFree);
+    if (effects.willReturn) func->addFnAttr(llvm::Attribute::WillReturn);
+    if (effects.noRecurse) func->addFnAttr(llvm::Attribute::NoRecurse);
+    // Profile counters and the --instrument buffer and registry are program memory
+    if (options_.profileGenerate || options_.instrument) return;
+    if (effects.readNone) {
+        func->addFnAttr(llvm::Attribute::ReadNone);
+        func->addFnAttr(llvm::Attribute::NoSync);
+    } else if (effects.hasIO && !effects.writesMemory) {
+        // Output only goes through the runtime, never through program memory
+        func->addFnAttr(llvm::Attribute::InaccessibleMemOnly);
+    }
+}
+
+void LLVMCodegen::addBuiltinAttributes(llvm::Function* func) {
+    auto builtin = ir::findBuiltin(func->getName().str());
+    if (!builtin) return;
+    func->addFnAttr(llvm::Attribute::NoUnwind);
+    func->addFnAttr(llvm::Attribute::NoFree);
+    func->addFnAttr(llvm::Attribute::WillReturn);
+    if (builtin->hasIOEffects) func->addFnAttr(llvm::Attribute::InaccessibleMemOnly);
+    else func->addFnAttr(llvm::Attribute::ReadNone);
+}
+
+// @AlwaysInline, @NoInline, @Hot and @Cold. Hot and cold functions also get
+// the section prefixes of profile-guided placement, so the hot ones share
+// .text.hot and the cold ones are kept out of the way in .text.unlikely; like
+// clang's `cold`, @Cold optimizes for size.
+void LLVMCodegen::addAnnotationAttributes(const ir::Function& irFunc, llvm::Function* func) {
+    if (irFunc.alwaysInline) func->addFnAttr(llvm::Attribute::AlwaysInline);
+    if (irFunc.noInline) func->addFnAttr(llvm::Attribute::NoInline);
+    if (irFunc.hot) {
+        func->addFnAttr(llvm::Attribute::Hot);
+        func->setSectionPrefix("hot");
+    }
+    if (irFunc.cold) {
+        func->addFnAttr(llvm::Attribute::Cold);
+        func->addFnAttr(llvm::Attribute::OptimizeForSize);
+        func->setSectionPrefix("unlikely");
+    }
+}
+
 llvm::Type* LLVMCodegen::getLLVMType(ir::Type type) {
     switch (type) {
         case ir::Type::I32: return llvm::Type::getInt32Ty(context_);
         case ir::Type::I1: return llvm::Type::getInt1Ty(context_);
         case ir::Type::Void: return llvm::Type::getVoidTy(context_);
+        case ir::Type::I8: return llvm::Type::getInt8Ty(context_);
+        case ir::Type::I16: return llvm::Type::getInt16Ty(context_);
+        case ir::Type::I64: return llvm::Type::getInt64Ty(context_);
         default: return nullptr;
     }
 }
 
 llvm::Value* LLVMCodegen::resolveValue(ir::Value* irVal) {
     if (auto constant = dynamic_cast<ir::Constant*>(irVal)) {
-        if (constant->type == ir::Type::I32) {
-            return llvm::ConstantInt::get(context_, llvm::APInt(32, constant->value, true));
-        } else if (constant->type == ir::Type::I1) {
+        if (constant->type == ir::Type::I1) {
             return llvm::ConstantInt::get(context_, llvm::APInt(1, constant->value));
+        } else if (constant->type != ir::Type::Void) {
+            return llvm::ConstantInt::get(context_, llvm::APInt(ir::bitWidth(constant->type), constant->value, true));
         }
     }
     auto it = valueMap_.find(irVal);
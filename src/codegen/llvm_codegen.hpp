@@ -1,5 +1,9 @@
 #pragma once
 #include "ir/ir.hpp"
+#include "ir/function_attrs.hpp"
+#include "codegen_options.hpp"
+#include <set>
+#include <llvm/IR/DIBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
@@ -9,19 +13,68 @@ namespace kotlin_lite {
 class LLVMCodegen {
 public:
     LLVMCodegen();
+    explicit LLVMCodegen(CodegenOptions options);
     std::unique_ptr<llvm::Module> generate(const ir::Module& irModule);
+
+    // generate() in steps, for streaming compilation: declare every function,
+    // then emit bodies one at a time. The IR of a function is not referenced
+    // after emitFunction returns; the declared signatures must stay alive.
+    void beginModule();
+    void declareFunction(const ir::Function& irFunc);
+    void emitFunction(const ir::Function& irFunc, const ir::FunctionEffects& effects);
+    std::unique_ptr<llvm::Module> finishModule();
     void dump(const llvm::Module& module);
 
 private:
+    CodegenOptions options_;
     llvm::LLVMContext context_;
     std::unique_ptr<llvm::Module> llvmModule_;
     llvm::IRBuilder<> builder_;
 
-    std::map<ir::Value*, llvm::Value*> valueMap_;
+    std::map<const ir::Value*, llvm::Value*> valueMap_;
     std::map<ir::BasicBlock*, llvm::BasicBlock*> bbMap_;
 
+    // --profile-generate counters
+    llvm::GlobalVariable* profileCounters_ = nullptr;
+    // --profile-use: every block count seen, for the module's profile summary
+    std::vector<uint64_t> profileCounts_;
+    uint64_t maxEntryCount_ = 0;
+
+    // --instrument: the runtime's per-thread counter buffer and a description
+    // of the instrumented functions and loops, in counter order
+    llvm::GlobalVariable* instrumentBuffer_ = nullptr;
+    std::string instrumentLayout_;
+    size_t instrumentedFunctions_ = 0;
+    size_t instrumentedLoops_ = 0;
+
+    // -g: the subprogram of the function being emitted and its variables
+    std::unique_ptr<llvm::DIBuilder> diBuilder_;
+    llvm::DICompileUnit* compileUnit_ = nullptr;
+    llvm::DISubprogram* subprogram_ = nullptr;
+    std::map<std::string, llvm::DILocalVariable*> localVariables_;
+
     llvm::Type* getLLVMType(ir::Type type);
     llvm::Value* resolveValue(ir::Value* irVal);
+    bool isInternal(const std::string& name) const;
+    void addFunctionAttributes(llvm::Function* func, const ir::FunctionEffects& effects);
+    void addBuiltinAttributes(llvm::Function* func);
+    void addAnnotationAttributes(const ir::Function& irFunc, llvm::Function* func);
+    void instrumentFunction(const ir::Function& irFunc, llvm::Function* llvmFunc);
+    void emitInstrumentRegistration();
+    void emitProfileRegistration(llvm::Function* main);
+    void emitCounterIncrement(const ir::CallInst& call);
+    void emitBlackhole(llvm::Value* value);
+    void addLoopHints(const ir::Function& irFunc);
+    void memoize(const ir::Function& irFunc, llvm::Function* llvmFunc);
+    void rewriteMemoReturns(const std::vector<llvm::ReturnInst*>& returns, llvm::StructType* slotType,
+                            llvm::Value* slot, const std::vector<llvm::Value*>& keys);
+    void multiversion(const std::string& name);
+    void applyProfile(const ir::Function& irFunc, llvm::Function* llvmFunc);
+    void attachProfileSummary();
+    llvm::DIType* getDIType(ir::Type type);
+    void beginDebugInfo(const ir::Function& irFunc, llvm::Function* llvmFunc);
+    void emitVariableLocations(const ir::Function& irFunc, llvm::Function* llvmFunc);
+    llvm::Value* emitParallelCall(const ir::CallInst& call, llvm::Function* worker, const std::vector<llvm::Value*>& args);
 };
 
 } // namespace kotlin_lite
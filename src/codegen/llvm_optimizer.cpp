@@ -0,0 +1,216 @@
+#include "llvm_optimizer.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+
+namespace kotlin_lite {
+
+namespace {
+
+// Turns the remarks LLVM passes emit into ir::Remarks, if asked to. The
+// warnings about loop hints LLVM could not follow (from @Unroll, @Vectorize or
+// a tuning) become Missed remarks of the transform-warning pass, and are
+// dropped otherwise: a tuned build's hints are suggestions, and a source
+// annotation reports through the remarks rather than failing the build.
+// Other diagnostics take LLVM's default route.
+class RemarkHandler : public llvm::DiagnosticHandler {
+public:
+    explicit RemarkHandler(ir::RemarkCollector* remarks) : remarks_(remarks) {}
+
+    bool isAnalysisRemarkEnabled(llvm::StringRef pass) const override { return remarks_ && remarks_->enabled(pass.str()); }
+    bool isMissedOptRemarkEnabled(llvm::StringRef pass) const override { return remarks_ && remarks_->enabled(pass.str()); }
+    bool isPassedOptRemarkEnabled(llvm::StringRef pass) const override { return remarks_ && remarks_->enabled(pass.str()); }
+    bool isAnyRemarkEnabled() const override { return remarks_ != nullptr; }
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo& info) override {
+        bool failure = info.getKind() == llvm::DK_OptimizationFailure;
+        auto optimization = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+        if (!optimization || !remarks_) return failure;
+        if (failure && !remarks_->enabled(optimization->getPassName().str())) return true;
+
+        ir::Remark remark;
+        if (failure) {
+            remark.kind = ir::Remark::Kind::Missed;
+        } else if (optimization->isPassed()) {
+            remark.kind = ir::Remark::Kind::Passed;
+        } else if (optimization->isMissed()) {
+            remark.kind = ir::Remark::Kind::Missed;
+        } else {
+            remark.kind = ir::Remark::Kind::Analysis;
+        }
+        remark.pass = optimization->getPassName();
+        remark.name = optimization->getRemarkName().str();
+        remark.function = optimization->getFunction().getName().str();
+        remark.message = optimization->getMsg();
+        if (optimization->isLocationAvailable()) {
+            llvm::StringRef file;
+            unsigned line = 0, column = 0;
+            optimization->getLocation(file, line, column);
+            remark.file = file.str();
+            remark.line = static_cast<int>(line);
+            remark.column = static_cast<int>(column);
+        }
+        remarks_->emit(std::move(remark));
+        return true;
+    }
+
+private:
+    ir::RemarkCollector* remarks_;
+};
+
+llvm::OptimizationLevel pipelineLevel(const std::string& name) {
+    if (name == "O1") return llvm::OptimizationLevel::O1;
+    if (name == "O2") return llvm::OptimizationLevel::O2;
+    if (name == "O3") return llvm::OptimizationLevel::O3;
+    if (name == "Os") return llvm::OptimizationLevel::Os;
+    throw std::runtime_error("unknown LLVM pipeline '" + name + "'");
+}
+
+const llvm::Target& hostTarget(const std::string& triple) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    std::string error;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (!target) throw std::runtime_error("no LLVM backend for " + triple + ": " + error);
+    return *target;
+}
+
+} // namespace
+
+LLVMOptimizer::LLVMOptimizer() : LLVMOptimizer(Options()) {}
+
+LLVMOptimizer::LLVMOptimizer(Options options) : options_(std::move(options)) {
+    pipelineLevel(options_.pipeline);
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    target_.reset(hostTarget(triple).createTargetMachine(triple, options_.target.cpu, options_.target.features,
+                                                         llvm::TargetOptions(), llvm::Reloc::PIC_, llvm::None,
+                                                         llvm::CodeGenOpt::Aggressive));
+}
+
+CodegenOptions::Target LLVMOptimizer::resolveTarget(const std::string& cpu, const std::string& features) {
+    CodegenOptions::Target result;
+    result.cpu = cpu.empty() ? "generic" : cpu;
+    std::vector<std::string> list;
+    if (result.cpu == "native") {
+        result.cpu = llvm::sys::getHostCPUName().str();
+        llvm::StringMap<bool> host;
+        if (llvm::sys::getHostCPUFeatures(host)) {
+            for (const auto& feature : host) list.push_back((feature.second ? "+" : "-") + feature.first().str());
+            std::sort(list.begin(), list.end());
+        }
+    }
+
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::unique_ptr<llvm::MCSubtargetInfo> info(hostTarget(triple).createMCSubtargetInfo(triple, "", ""));
+    if (!info->isCPUStringValid(result.cpu)) throw std::runtime_error("unknown target CPU '" + result.cpu + "'");
+    // LLVM itself warns about, and ignores, features it does not know
+    size_t start = 0;
+    while (start < features.size()) {
+        size_t end = std::min(features.find(',', start), features.size());
+        std::string feature = features.substr(start, end - start);
+        start = end + 1;
+        if (feature.size() < 2 || (feature[0] != '+' && feature[0] != '-')) {
+            throw std::runtime_error("invalid target feature '" + feature + "' (expected +<feature> or -<feature>)");
+        }
+        list.push_back(feature);
+    }
+    for (const std::string& feature : list) result.features += (result.features.empty() ? "" : ",") + feature;
+    return result;
+}
+
+LLVMOptimizer::~LLVMOptimizer() = default;
+
+void LLVMOptimizer::prepare(llvm::Module& module) {
+    module.setTargetTriple(target_->getTargetTriple().str());
+    module.setDataLayout(target_->createDataLayout());
+}
+
+void LLVMOptimizer::optimize(llvm::Module& module, ir::RemarkCollector* remarks) {
+    prepare(module);
+
+    llvm::LoopAnalysisManager loops;
+    llvm::FunctionAnalysisManager functions;
+    llvm::CGSCCAnalysisManager sccs;
+    llvm::ModuleAnalysisManager modules;
+    // clang turns both vectorizers on from -O2
+    llvm::OptimizationLevel level = pipelineLevel(options_.pipeline);
+    llvm::PipelineTuningOptions tuning;
+    tuning.LoopVectorization = level.getSpeedupLevel() >= 2;
+    tuning.SLPVectorization = level.getSpeedupLevel() >= 2 && options_.slpVectorization;
+    llvm::PassBuilder passes(target_.get(), tuning);
+    passes.registerModuleAnalyses(modules);
+    passes.registerCGSCCAnalyses(sccs);
+    passes.registerFunctionAnalyses(functions);
+    passes.registerLoopAnalyses(loops);
+    passes.crossRegisterProxies(loops, functions, sccs, modules);
+    // LLVM 14 has no tuning option for the inliner threshold, only the
+    // `-inline-threshold` flag, which getInlineParams() reads while the
+    // pipeline is built; set it for this build only
+    llvm::cl::Option* inlineFlag = llvm::cl::getRegisteredOptions().lookup("inline-threshold");
+    if (inlineFlag && options_.inlineThreshold > 0) {
+        inlineFlag->addOccurrence(0, "inline-threshold", std::to_string(options_.inlineThreshold));
+    }
+    llvm::ModulePassManager pipeline = passes.buildPerModuleDefaultPipeline(level);
+    if (inlineFlag && options_.inlineThreshold > 0) inlineFlag->reset();
+
+    llvm::LLVMContext& context = module.getContext();
+    std::unique_ptr<llvm::DiagnosticHandler> previous = context.getDiagnosticHandler();
+    context.setDiagnosticHandler(std::make_unique<RemarkHandler>(remarks));
+    pipeline.run(module, modules);
+    context.setDiagnosticHandler(std::move(previous));
+    if (remarks && remarks->enabled("always-inline")) reportCallsNotInlined(module, *remarks);
+}
+
+// @AlwaysInline cannot be honored for recursive calls, or for calls the
+// inliner finds unsafe; each call left standing is a Missed remark
+void LLVMOptimizer::reportCallsNotInlined(const llvm::Module& module, ir::RemarkCollector& remarks) {
+    for (const llvm::Function& func : module) {
+        if (!func.hasFnAttribute(llvm::Attribute::AlwaysInline)) continue;
+        for (const llvm::User* user : func.users()) {
+            auto call = llvm::dyn_cast<llvm::CallBase>(user);
+            if (!call || call->getCalledFunction() != &func) continue;
+            ir::Remark remark;
+            remark.kind = ir::Remark::Kind::Missed;
+            remark.pass = "always-inline";
+            remark.name = "NotInlined";
+            remark.function = call->getFunction()->getName().str();
+            remark.message = "'" + func.getName().str() + "' is annotated @AlwaysInline but was not inlined here";
+            if (const llvm::DebugLoc& loc = call->getDebugLoc()) {
+                remark.file = loc->getFilename().str();
+                remark.line = static_cast<int>(loc.getLine());
+                remark.column = static_cast<int>(loc.getCol());
+            }
+            remarks.emit(std::move(remark));
+        }
+    }
+}
+
+void LLVMOptimizer::writeObject(llvm::Module& module, const std::string& path) {
+    prepare(module);
+    std::error_code ec;
+    llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+    if (ec) throw std::runtime_error("cannot write " + path + ": " + ec.message());
+    llvm::legacy::PassManager codegen;
+    if (target_->addPassesToEmitFile(codegen, out, nullptr, llvm::CGFT_ObjectFile)) {
+        throw std::runtime_error("LLVM cannot emit object files for " + target_->getTargetTriple().str());
+    }
+    codegen.run(module);
+}
+
+} // namespace kotlin_lite
@@ -0,0 +1,60 @@
+#pragma once
+#include "codegen_options.hpp"
+#include "ir/remarks.hpp"
+#include <memory>
+#include <string>
+
+namespace llvm {
+class Module;
+class TargetMachine;
+} // namespace llvm
+
+namespace kotlin_lite {
+
+// LLVM's -O3 pipeline and object emission in-process, for the host target,
+// as `clang -O3` runs them on the .ll file. The compiler uses it when it
+// needs to see inside LLVM's optimizations (--remarks) or to change them (a
+// tuned build, --target-cpu); otherwise clang does both. Throws
+// std::runtime_error when LLVM has no backend for the host or the pipeline
+// or CPU is unknown.
+class LLVMOptimizer {
+public:
+    // The defaults are clang's -O3; --autotune varies them
+    struct Options {
+        // O1, O2, O3 or Os
+        std::string pipeline = "O3";
+        // Inliner threshold; 0 keeps the pipeline's own
+        int inlineThreshold = 0;
+        bool slpVectorization = true;
+        // The CPU and features code is generated for, as resolveTarget()
+        // returns them; functions may override both with their "target-cpu"
+        // and "target-features" attributes
+        CodegenOptions::Target target;
+    };
+
+    LLVMOptimizer();
+    explicit LLVMOptimizer(Options options);
+    ~LLVMOptimizer();
+
+    // With `remarks`, the optimization remarks of the LLVM passes it enables
+    // are added to it, positioned by the module's debug locations, and so
+    // are the annotations the passes could not honor
+    void optimize(llvm::Module& module, ir::RemarkCollector* remarks = nullptr);
+    // Throws std::runtime_error
+    void writeObject(llvm::Module& module, const std::string& path);
+
+    // --target-cpu and --target-features as LLVM names them: "native" becomes
+    // the host's CPU and features, to which `features` ("+avx2,-fma") are
+    // added. Throws std::runtime_error for a CPU LLVM does not know or a
+    // malformed feature.
+    static CodegenOptions::Target resolveTarget(const std::string& cpu, const std::string& features);
+
+private:
+    Options options_;
+    std::unique_ptr<llvm::TargetMachine> target_;
+
+    void prepare(llvm::Module& module);
+    void reportCallsNotInlined(const llvm::Module& module, ir::RemarkCollector& remarks);
+};
+
+} // namespace kotlin_lite
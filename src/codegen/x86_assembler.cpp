@@ -0,0 +1,214 @@
+#include "x86_assembler.hpp"
+#include <stdexcept>
+
+namespace kotlin_lite {
+namespace x86 {
+
+Assembler::Label Assembler::newLabel() {
+    label_offsets_.push_back(SIZE_MAX);
+    return static_cast<Label>(label_offsets_.size() - 1);
+}
+
+void Assembler::bind(Label label) {
+    label_offsets_.at(label) = code_.size();
+}
+
+void Assembler::imm32(int32_t v) {
+    uint32_t u = static_cast<uint32_t>(v);
+    for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(u >> (8 * i)));
+}
+
+void Assembler::rex(bool w, uint8_t reg, uint8_t rm, bool force) {
+    uint8_t prefix = 0x40 | (w ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((rm & 8) ? 0x01 : 0);
+    if (prefix != 0x40 || force) byte(prefix);
+}
+
+void Assembler::modrm(uint8_t reg, const Operand& rm) {
+    if (rm.isReg()) {
+        byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm.reg & 7)));
+    } else if (rm.value >= -128 && rm.value <= 127) {
+        byte(static_cast<uint8_t>(0x40 | ((reg & 7) << 3) | RBP)); // [rbp + disp8]
+        byte(static_cast<uint8_t>(rm.value));
+    } else {
+        byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | RBP)); // [rbp + disp32]
+        imm32(rm.value);
+    }
+}
+
+void Assembler::mov(Reg dst, const Operand& src) {
+    if (src.isImm()) {
+        if (src.value == 0) {
+            // xor r32, r32
+            rex(false, dst, dst);
+            byte(0x31);
+            modrm(dst, Operand::r(dst));
+            return;
+        }
+        rex(false, 0, dst);
+        byte(static_cast<uint8_t>(0xB8 + (dst & 7)));
+        imm32(src.value);
+        return;
+    }
+    if (src.isReg() && src.reg == dst) return;
+    rex(false, dst, src.isReg() ? src.reg : RBP);
+    byte(0x8B);
+    modrm(dst, src);
+}
+
+void Assembler::mov(const Operand& dst, Reg src) {
+    if (dst.isImm()) throw std::runtime_error("x86: cannot store to an immediate");
+    if (dst.isReg() && dst.reg == src) return;
+    rex(false, src, dst.isReg() ? dst.reg : RBP);
+    byte(0x89);
+    modrm(src, dst);
+}
+
+void Assembler::aluOp(uint8_t opRegRm, uint8_t immDigit, Reg dst, const Operand& src) {
+    if (src.isImm()) {
+        rex(false, 0, dst);
+        bool small = src.value >= -128 && src.value <= 127;
+        byte(small ? 0x83 : 0x81);
+        modrm(immDigit, Operand::r(dst));
+        if (small) byte(static_cast<uint8_t>(src.value));
+        else imm32(src.value);
+        return;
+    }
+    rex(false, dst, src.isReg() ? src.reg : RBP);
+    byte(opRegRm);
+    modrm(dst, src);
+}
+
+void Assembler::add(Reg dst, const Operand& src) { aluOp(0x03, 0, dst, src); }
+void Assembler::sub(Reg dst, const Operand& src) { aluOp(0x2B, 5, dst, src); }
+void Assembler::cmp(Reg lhs, const Operand& rhs) { aluOp(0x3B, 7, lhs, rhs); }
+void Assembler::xorImm(Reg dst, int32_t imm) { aluOp(0x33, 6, dst, Operand::imm(imm)); }
+
+void Assembler::imul(Reg dst, const Operand& src) {
+    if (src.isImm()) {
+        // imul r32, r/m32, imm32
+        rex(false, dst, dst);
+        byte(0x69);
+        modrm(dst, Operand::r(dst));
+        imm32(src.value);
+        return;
+    }
+    rex(false, dst, src.isReg() ? src.reg : RBP);
+    byte(0x0F);
+    byte(0xAF);
+    modrm(dst, src);
+}
+
+void Assembler::shl(Reg dst, uint8_t count) {
+    rex(false, 0, dst);
+    byte(0xC1);
+    modrm(4, Operand::r(dst));
+    byte(count);
+}
+
+void Assembler::shlCl(Reg dst) {
+    rex(false, 0, dst);
+    byte(0xD3);
+    modrm(4, Operand::r(dst));
+}
+
+void Assembler::test(Reg lhs, Reg rhs) {
+    rex(false, rhs, lhs);
+    byte(0x85);
+    modrm(rhs, Operand::r(lhs));
+}
+
+void Assembler::cdq() { byte(0x99); }
+
+void Assembler::idiv(Reg divisor) {
+    rex(false, 0, divisor);
+    byte(0xF7);
+    modrm(7, Operand::r(divisor));
+}
+
+void Assembler::setcc(Cond cond, Reg dst) {
+    if (dst > RBX) throw std::runtime_error("x86: setcc needs a legacy byte register");
+    byte(0x0F);
+    byte(static_cast<uint8_t>(0x90 + cond));
+    modrm(0, Operand::r(dst));
+}
+
+void Assembler::movzxByte(Reg dst, Reg src) {
+    rex(false, dst, src);
+    byte(0x0F);
+    byte(0xB6);
+    modrm(dst, Operand::r(src));
+}
+
+void Assembler::push(Reg reg) {
+    rex(false, 0, reg);
+    byte(static_cast<uint8_t>(0x50 + (reg & 7)));
+}
+
+void Assembler::pop(Reg reg) {
+    rex(false, 0, reg);
+    byte(static_cast<uint8_t>(0x58 + (reg & 7)));
+}
+
+void Assembler::movRbpRsp() {
+    byte(0x48); byte(0x89); byte(0xE5);
+}
+
+void Assembler::subRsp(int32_t bytes) {
+    if (bytes == 0) return;
+    byte(0x48); byte(0x81); byte(0xEC);
+    imm32(bytes);
+}
+
+void Assembler::addRsp(int32_t bytes) {
+    if (bytes == 0) return;
+    byte(0x48); byte(0x81); byte(0xC4);
+    imm32(bytes);
+}
+
+void Assembler::leaRspRbp(int32_t disp) {
+    byte(0x48); byte(0x8D);
+    modrm(RSP, Operand::stack(disp));
+}
+
+void Assembler::ret() { byte(0xC3); }
+
+void Assembler::rel32(Label target) {
+    fixups_.emplace_back(code_.size(), target);
+    imm32(0);
+}
+
+void Assembler::jmp(Label target) {
+    byte(0xE9);
+    rel32(target);
+}
+
+void Assembler::jcc(Cond cond, Label target) {
+    byte(0x0F);
+    byte(static_cast<uint8_t>(0x80 + cond));
+    rel32(target);
+}
+
+void Assembler::call(Label target) {
+    byte(0xE8);
+    rel32(target);
+}
+
+void Assembler::callExternal(const std::string& symbol) {
+    byte(0xE8);
+    external_calls_.push_back({code_.size(), symbol});
+    imm32(0);
+}
+
+std::vector<uint8_t> Assembler::finish() {
+    for (const auto& [at, label] : fixups_) {
+        size_t target = label_offsets_.at(label);
+        if (target == SIZE_MAX) throw std::runtime_error("x86: unbound label");
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        for (int i = 0; i < 4; ++i) code_[at + i] = static_cast<uint8_t>(static_cast<uint32_t>(rel) >> (8 * i));
+    }
+    fixups_.clear();
+    return code_;
+}
+
+} // namespace x86
+} // namespace kotlin_lite
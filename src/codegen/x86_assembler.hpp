@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace x86 {
+
+enum Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// Condition codes as encoded in Jcc / SETcc
+enum Cond : uint8_t {
+    CondE = 0x4, CondNE = 0x5,
+    CondL = 0xC, CondGE = 0xD, CondLE = 0xE, CondG = 0xF
+};
+
+// A 32-bit operand: register, `[rbp + disp]` stack slot, or immediate.
+struct Operand {
+    enum class Kind : uint8_t { Reg, Stack, Imm } kind;
+    Reg reg = RAX;
+    int32_t value = 0; // stack displacement or immediate
+
+    static Operand r(Reg reg) { return {Kind::Reg, reg, 0}; }
+    static Operand stack(int32_t disp) { return {Kind::Stack, RBP, disp}; }
+    static Operand imm(int32_t v) { return {Kind::Imm, RAX, v}; }
+
+    bool isReg() const { return kind == Kind::Reg; }
+    bool isStack() const { return kind == Kind::Stack; }
+    bool isImm() const { return kind == Kind::Imm; }
+    bool operator==(const Operand& o) const {
+        return kind == o.kind && (kind == Kind::Reg ? reg == o.reg : value == o.value);
+    }
+    bool operator!=(const Operand& o) const { return !(*this == o); }
+};
+
+// Minimal x86-64 encoder for the baseline backend. Arithmetic is 32-bit;
+// branches and calls always use rel32 so code never needs relaxing.
+class Assembler {
+public:
+    using Label = int;
+
+    struct ExternalCall {
+        size_t offset; // of the rel32 field
+        std::string symbol;
+    };
+
+    Label newLabel();
+    void bind(Label label);
+    size_t offset() const { return code_.size(); }
+
+    // --- 32-bit data movement and arithmetic ---
+    void mov(Reg dst, const Operand& src);
+    void mov(const Operand& dst, Reg src);
+    void add(Reg dst, const Operand& src);
+    void sub(Reg dst, const Operand& src);
+    void imul(Reg dst, const Operand& src);
+    void shl(Reg dst, uint8_t count);
+    void shlCl(Reg dst);
+    void cmp(Reg lhs, const Operand& rhs);
+    void xorImm(Reg dst, int32_t imm);
+    void test(Reg lhs, Reg rhs);
+    void cdq();
+    void idiv(Reg divisor);
+    void setcc(Cond cond, Reg dst); // dst must be RAX..RBX
+    void movzxByte(Reg dst, Reg src);
+
+    // --- 64-bit stack frame handling ---
+    void push(Reg reg);
+    void pop(Reg reg);
+    void movRbpRsp();
+    void subRsp(int32_t bytes);
+    void addRsp(int32_t bytes);
+    void leaRspRbp(int32_t disp);
+    void ret();
+
+    // --- Control flow ---
+    void jmp(Label target);
+    void jcc(Cond cond, Label target);
+    void call(Label target);
+    void callExternal(const std::string& symbol);
+
+    // Resolves label references; call once after all code is emitted.
+    std::vector<uint8_t> finish();
+    size_t labelOffset(Label label) const { return label_offsets_.at(label); }
+    const std::vector<ExternalCall>& externalCalls() const { return external_calls_; }
+
+private:
+    std::vector<uint8_t> code_;
+    std::vector<size_t> label_offsets_;
+    std::vector<std::pair<size_t, Label>> fixups_; // rel32 field offset -> label
+    std::vector<ExternalCall> external_calls_;
+
+    void byte(uint8_t b) { code_.push_back(b); }
+    void imm32(int32_t v);
+    void rex(bool w, uint8_t reg, uint8_t rm, bool force = false);
+    // ModRM (+ disp32) for `reg` against a register or [rbp + disp] operand
+    void modrm(uint8_t reg, const Operand& rm);
+    void aluOp(uint8_t opRegRm, uint8_t immDigit, Reg dst, const Operand& src);
+    void rel32(Label target);
+};
+
+} // namespace x86
+} // namespace kotlin_lite
@@ -2,15 +2,97 @@
 #include "lexer/lexer.hpp"
 #include "parser/parser.hpp"
 #include "semantic/semantic_analyzer.hpp"
+#include "semantic/reachability.hpp"
+#include "ir/cfg.hpp"
 #include "ir/ir_generator.hpp"
+#include "ir/ir_serializer.hpp"
+#include "ir/remarks.hpp"
+#include "ir/statistics.hpp"
+#include "transforms/tail_recursion.hpp"
+#include "transforms/ipcp.hpp"
+#include "transforms/const_eval.hpp"
+#include "transforms/peephole.hpp"
+#include "transforms/loop_fusion.hpp"
+#include "transforms/loop_interchange.hpp"
+#include "transforms/auto_parallel.hpp"
+#include "transforms/pgo.hpp"
 #include "codegen/llvm_codegen.hpp"
+#include "codegen/llvm_optimizer.hpp"
+#include "codegen/baseline_codegen.hpp"
+#include "codegen/elf_writer.hpp"
+#include "codegen/executable_buffer.hpp"
+#include "interp/interpreter.hpp"
+#include "pipeline/streaming_compiler.hpp"
+#include "pipeline/program_runner.hpp"
+#include <climits>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <llvm/IR/DebugInfo.h>
 #include <llvm/Support/raw_ostream.h>
+#include <unistd.h>
 
 namespace kotlin_lite {
+    // Options that need the whole program in memory, which --stream avoids
+    static std::string streamingConflict(const CompileOptions& options) {
+        if (options.interpret) return "--interp runs the whole module";
+        if (options.backend != "llvm") return "--backend=" + options.backend + " needs the whole module";
+        if (!options.emitIRFile.empty()) return "--emit-ir writes the whole module";
+        if (options.autoParallel) return "--auto-parallel needs the whole module";
+        if (options.reportDead) return "--report-dead needs the call graph of the whole file";
+        if (options.reportFolded || options.reportPeephole || options.remarks) return "pass reports need the whole module";
+        if (!options.profileGenerate.empty() || !options.profileUse.empty()) return "profiles cover the whole module";
+        if (!options.instrument.empty()) return "--instrument numbers the counters of the whole module";
+        if (options.tuning) return "a tuning configures the whole-module pipeline";
+        if (!options.targetCPU.empty() || !options.targetFeatures.empty()) return "--target-cpu configures the whole-module pipeline";
+        if (options.multiversion) return "--multiversion clones functions of the whole module";
+        return "";
+    }
+
+    // -g: the source file, as the debug info names it. --remarks needs its
+    // line table too, to place LLVM's remarks
+    static std::optional<CodegenOptions::DebugInfo> debugInfo(const CompileOptions& options) {
+        if (!options.debugInfo && !options.remarks) return std::nullopt;
+        std::filesystem::path path = std::filesystem::absolute(options.inputFile);
+        return CodegenOptions::DebugInfo{path.filename().string(), path.parent_path().string()};
+    }
+
+    // 'arg', safe to pass through the shell
+    static std::string shellQuote(const std::string& arg) {
+        std::string quoted = "'";
+        for (char c : arg) quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        return quoted + "'";
+    }
+
+    // Whether a tuning leaves the custom pass `name` in
+    static bool passEnabled(const CompileOptions& options, const char* name) {
+        return !options.tuning || options.tuning->passEnabled(name);
+    }
+
+    // --multiversion without a list: the functions with loops that take at
+    // least a tenth of all the block counts of the --profile-use profile
+    static std::vector<std::string> hotLoopFunctions(const ir::Module& module) {
+        std::map<std::string, uint64_t> weight;
+        unsigned __int128 total = 0;
+        for (const auto& func : module.functions) {
+            for (const auto& bb : func->blocks) {
+                weight[func->name] += bb->profileCount.value_or(0);
+                total += bb->profileCount.value_or(0);
+            }
+        }
+        std::vector<std::string> hot;
+        for (const auto& func : module.functions) {
+            ir::CFG cfg(*func);
+            ir::LoopInfo loops(*func, cfg);
+            if (total > 0 && !loops.loops().empty() && weight[func->name] * static_cast<unsigned __int128>(10) >= total) {
+                hot.push_back(func->name);
+            }
+        }
+        return hot;
+    }
+
     std::string Compiler::getRuntimePath() const {
         if (std::filesystem::exists("../src/runtime/runtime.c")) {
             return "../src/runtime/runtime.c";
@@ -18,7 +100,287 @@ namespace kotlin_lite {
         return "src/runtime/runtime.c";
     }
 
+    // Runs a compile or link command producing `binaryName`, removes `tempFile` and, for --run, runs the binary
+    int Compiler::build(const std::string& command, const std::string& tempFile, const std::string& binaryName,
+                        const CompileOptions& options) const {
+        int ret = system(command.c_str());
+        std::filesystem::remove(tempFile);
+        if (ret != 0) {
+            std::cerr << "Compilation failed during linking.\n";
+            return 1;
+        }
+        if (options.shouldRun) {
+            std::string run = binaryName;
+            for (const std::string& arg : options.programArgs) run += " " + shellQuote(arg);
+            system(run.c_str());
+        } else if (!options.quiet) {
+            std::cout << "Binary generated: " << binaryName << "\n";
+        }
+        return 0;
+    }
+
+    // Compiles the LLVM IR, links it with the runtime and, for --run, runs it
+    int Compiler::link(llvm::Module& llvmMod, const CompileOptions& options) const {
+        if (!options.outputFile.empty() || options.shouldRun) {
+            std::string binaryName = options.outputFile.empty() ? "./program" : options.outputFile;
+            std::string tempLL = binaryName + ".ll";
+
+            // Write LLVM IR to temporary file
+            std::error_code ec;
+            llvm::raw_fd_ostream dest(tempLL, ec);
+            if (ec) {
+                std::cerr << "Could not open " << tempLL << ": " << ec.message() << std::endl;
+                return 1;
+            }
+            llvmMod.print(dest, nullptr);
+            dest.flush();
+            dest.close();
+
+            std::string runtimePath = getRuntimePath();
+            std::string frames = options.framePointers ? "-fno-omit-frame-pointer " : "";
+            std::string debug = options.debugInfo ? "-g " : "";
+            std::string compileCmd = "clang -O3 -pthread -Wno-override-module " + frames + debug + tempLL + " " + runtimePath + " -o " + binaryName;
+            return build(compileCmd, tempLL, binaryName, options);
+        }
+        return 0;
+    }
+
+    // --remarks, tuned builds and --target-cpu: LLVM optimizes in-process,
+    // where its remarks can be collected and its pipeline and target changed,
+    // and clang only links the resulting object file
+    int Compiler::optimizeAndLink(llvm::Module& llvmMod, ir::RemarkCollector& remarks, const CompileOptions& options,
+                                  const CodegenOptions& codegenOptions) const {
+        LLVMOptimizer::Options optimizerOptions;
+        if (codegenOptions.target) optimizerOptions.target = *codegenOptions.target;
+        if (options.tuning) {
+            optimizerOptions.pipeline = options.tuning->pipeline;
+            optimizerOptions.inlineThreshold = options.tuning->inlineThreshold;
+            optimizerOptions.slpVectorization = options.tuning->slpVectorization;
+        }
+        LLVMOptimizer optimizer(optimizerOptions);
+        optimizer.optimize(llvmMod, options.remarks ? &remarks : nullptr);
+        if (!options.debugInfo) llvm::StripDebugInfo(llvmMod);
+        if (options.remarks && reportRemarks(remarks, options) != 0) return 1;
+
+        if (!options.outputFile.empty() || options.shouldRun) {
+            std::string binaryName = options.outputFile.empty() ? "./program" : options.outputFile;
+            std::string objectFile = binaryName + ".o";
+            optimizer.writeObject(llvmMod, objectFile);
+            std::string frames = options.framePointers ? "-fno-omit-frame-pointer " : "";
+            std::string debug = options.debugInfo ? "-g " : "";
+            std::string linkCmd = "clang -O3 -pthread " + frames + debug + objectFile + " " + getRuntimePath() + " -o " + binaryName;
+            return build(linkCmd, objectFile, binaryName, options);
+        }
+        return 0;
+    }
+
+    // Prints the remarks and their summary to stderr and writes the YAML to --remarks-file
+    int Compiler::reportRemarks(const ir::RemarkCollector& remarks, const CompileOptions& options) const {
+        std::cerr << remarks.format() << remarks.formatSummary();
+        if (options.remarksFile.empty()) return 0;
+        std::ofstream yaml(options.remarksFile);
+        if (!yaml) {
+            std::cerr << "Error: Could not write " << options.remarksFile << std::endl;
+            return 1;
+        }
+        yaml << remarks.formatYAML();
+        return 0;
+    }
+
     int Compiler::compile(const CompileOptions& options) {
+        bool stats = options.stats || !options.statsJson.empty();
+        if (stats) {
+            ir::resetStatistics();
+            ir::Statistic::enable();
+        }
+        int result;
+        if (options.autotune) {
+            result = autotune(options);
+        } else {
+            CompileOptions tuned = options;
+            result = loadTuning(tuned);
+            if (result == 0) result = compileFile(tuned);
+        }
+        if (!stats) return result;
+        ir::Statistic::enable(false);
+        if (options.stats) std::cerr << ir::formatStatistics();
+        if (!options.statsJson.empty()) {
+            std::ofstream json(options.statsJson);
+            if (!json) {
+                std::cerr << "Error: Could not write " << options.statsJson << std::endl;
+                return 1;
+            }
+            json << ir::formatStatisticsJSON();
+        }
+        return result;
+    }
+
+    // Picks up the tuning file of an earlier --autotune: --tune-file, or
+    // <source>.kltune if there is one
+    int Compiler::loadTuning(CompileOptions& options) const {
+        if (!options.useTuning || options.tuning) return 0;
+        bool llvmBackend = !options.interpret && options.backend == "llvm";
+        if (!options.tuneFile.empty() && !llvmBackend) {
+            std::cerr << "Error: --tune-file needs the LLVM backend" << std::endl;
+            return 1;
+        }
+        std::string path = options.tuneFile.empty() ? Tuning::defaultPath(options.inputFile) : options.tuneFile;
+        if (!llvmBackend || (options.tuneFile.empty() && !std::filesystem::exists(path))) return 0;
+        try {
+            options.tuning = Tuning::readFile(path);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::ifstream file(options.inputFile);
+        std::stringstream source;
+        source << file.rdbuf();
+        if (options.tuning->sourceHash && options.tuning->sourceHash != Tuning::hashSource(source.str())) {
+            std::cerr << "warning: " << path << " was tuned for an earlier version of " << options.inputFile
+                      << "; run --autotune again\n";
+        }
+        if (!options.quiet) std::cout << "Tuning: " << options.tuning->describe() << " (" << path << ")\n";
+        return 0;
+    }
+
+    // "" (20 builds), "<n>" builds or "<n>s" / "<n>m" of search time
+    static bool parseBudget(const std::string& budget, Autotuner::Options& options) {
+        if (budget.empty()) return true;
+        size_t used = 0;
+        long value = 0;
+        try {
+            value = std::stol(budget, &used);
+        } catch (const std::exception&) {
+            return false;
+        }
+        std::string unit = budget.substr(used);
+        if (value <= 0 || (unit != "" && unit != "s" && unit != "m")) return false;
+        if (unit.empty()) {
+            options.maxTrials = static_cast<int>(std::min(value, static_cast<long>(INT_MAX)));
+        } else {
+            options.maxTrials = INT_MAX;
+            options.maxSeconds = static_cast<double>(value) * (unit == "m" ? 60 : 1);
+        }
+        return true;
+    }
+
+    // --autotune: builds the program under one configuration after another
+    // (see Autotuner), runs each build once to check its output against the
+    // default build and then times it like kotlin-lite-bench, pinned to one
+    // core. The fastest configuration is saved as the tuning file and built.
+    int Compiler::autotune(const CompileOptions& options) {
+        const int kTimedRuns = 5;
+        if (options.interpret || options.backend != "llvm") {
+            std::cerr << "Error: --autotune needs the LLVM backend" << std::endl;
+            return 1;
+        }
+        Autotuner::Options tunerOptions;
+        if (!parseBudget(*options.autotune, tunerOptions)) {
+            std::cerr << "Error: Invalid --autotune budget '" << *options.autotune
+                      << "' (expected a number of builds or a time such as 120s or 5m)" << std::endl;
+            return 1;
+        }
+        std::ifstream file(options.inputFile);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file " << options.inputFile << std::endl;
+            return 1;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+
+        std::filesystem::path tmp = std::filesystem::temp_directory_path() / ("kotlin-lite-autotune." + std::to_string(getpid()));
+        std::filesystem::create_directories(tmp);
+        std::string binary = (tmp / "candidate").string();
+        int cpu = lastAllowedCpu();
+        std::optional<std::string> expected;
+
+        Autotuner tuner(tunerOptions, [&](const Tuning& tuning) -> std::optional<Summary> {
+            CompileOptions candidate = options;
+            candidate.autotune.reset();
+            candidate.tuning = tuning;
+            candidate.outputFile = binary;
+            candidate.shouldRun = false;
+            candidate.quiet = true;
+            candidate.dumpIR = candidate.dumpLLVM = candidate.remarks = false;
+            candidate.reportDead = candidate.reportFolded = candidate.reportPeephole = false;
+            candidate.emitIRFile.clear();
+            if (compileFile(candidate) != 0) return std::nullopt;
+
+            // The checked run doubles as the warmup
+            Run checked;
+            std::string error;
+            if (!runProgram(binary, options.programArgs, cpu, false, true, checked, error)) {
+                std::cerr << "  " << error << "\n";
+                return std::nullopt;
+            }
+            if (!expected) {
+                expected = checked.output;
+            } else if (checked.output != *expected) {
+                std::cerr << "  prints something other than the default build; rejected\n";
+                return std::nullopt;
+            }
+            std::vector<double> seconds;
+            for (int i = 0; i < kTimedRuns; ++i) {
+                Run run;
+                if (!runProgram(binary, options.programArgs, cpu, false, false, run, error)) {
+                    std::cerr << "  " << error << "\n";
+                    return std::nullopt;
+                }
+                seconds.push_back(run.seconds);
+            }
+            return summarize(seconds);
+        });
+        auto seconds = [](double value) {
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(4) << value << " s";
+            return ss.str();
+        };
+        tuner.onTrial([&](const Autotuner::Trial& trial, const Autotuner::Trial& best) {
+            std::cerr << "[autotune " << tuner.getTrials().size();
+            if (tunerOptions.maxSeconds <= 0) std::cerr << "/" << tunerOptions.maxTrials;
+            std::cerr << "] " << trial.tuning.describe() << ": ";
+            if (trial.time) std::cerr << seconds(trial.time->median);
+            else std::cerr << "failed";
+            std::cerr << (trial.best ? "  (best)" : "  (best " + seconds(best.time->median) + ")") << "\n";
+        });
+
+        std::optional<Tuning> best = tuner.run();
+        std::filesystem::remove_all(tmp);
+        if (!best) {
+            std::cerr << "Error: the default build of " << options.inputFile << " failed; nothing to tune" << std::endl;
+            return 1;
+        }
+
+        const auto& trials = tuner.getTrials();
+        double defaults = trials.front().time->median;
+        double fastest = defaults;
+        for (const auto& trial : trials) {
+            if (trial.best) fastest = trial.time->median;
+        }
+        std::stringstream note;
+        note << std::filesystem::path(options.inputFile).filename().string() << ": " << seconds(fastest) << ", "
+             << std::fixed << std::setprecision(1) << 100 * (1 - fastest / defaults) << "% faster than the defaults ("
+             << seconds(defaults) << "); " << trials.size() << " configurations tried";
+        best->note = note.str();
+        best->sourceHash = Tuning::hashSource(source.str());
+        std::string path = options.tuneFile.empty() ? Tuning::defaultPath(options.inputFile) : options.tuneFile;
+        try {
+            best->writeFile(path);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cerr << "autotune: " << best->describe() << "; " << best->note.substr(best->note.find(": ") + 2)
+                  << "\nSaved to " << path << "\n";
+
+        CompileOptions tuned = options;
+        tuned.autotune.reset();
+        tuned.tuning = best;
+        ir::resetStatistics();
+        return compileFile(tuned);
+    }
+
+    int Compiler::compileFile(const CompileOptions& options) {
         // Validate input file
         std::ifstream file(options.inputFile);
         if (!file.is_open()) {
@@ -29,7 +391,74 @@ namespace kotlin_lite {
         buffer << file.rdbuf();
         std::string source = buffer.str();
 
+        if (!options.profileGenerate.empty() && (options.interpret || options.backend != "llvm")) {
+            std::cerr << "Error: --profile-generate needs the LLVM backend" << std::endl;
+            return 1;
+        }
+        if (options.debugInfo && (options.interpret || options.backend != "llvm")) {
+            std::cerr << "Error: -g needs the LLVM backend" << std::endl;
+            return 1;
+        }
+        if (!options.instrument.empty() && (options.interpret || options.backend != "llvm")) {
+            std::cerr << "Error: --instrument needs the LLVM backend" << std::endl;
+            return 1;
+        }
+        std::optional<CodegenOptions::Target> target;
+        if (!options.targetCPU.empty() || !options.targetFeatures.empty()) {
+            if (options.interpret || options.backend != "llvm") {
+                std::cerr << "Error: --target-cpu and --target-features need the LLVM backend" << std::endl;
+                return 1;
+            }
+            try {
+                target = LLVMOptimizer::resolveTarget(options.targetCPU, options.targetFeatures);
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        if (options.multiversion && (options.interpret || options.backend != "llvm")) {
+            std::cerr << "Error: --multiversion needs the LLVM backend" << std::endl;
+            return 1;
+        }
+        if (options.multiversion && options.multiversion->empty() && options.profileUse.empty()) {
+            std::cerr << "Error: --multiversion needs a list of functions or a --profile-use profile" << std::endl;
+            return 1;
+        }
+
         try {
+            // Streaming: one function at a time through parse, lowering and codegen
+            if (options.stream) {
+                std::string why = streamingConflict(options);
+                if (why.empty()) {
+                    StreamingCompiler::Options streamOptions;
+                    streamOptions.optimizeIR = options.optimizeIR;
+                    streamOptions.codegen.wholeProgram = options.wholeProgram;
+                    streamOptions.codegen.exported.insert(options.exportedFunctions.begin(), options.exportedFunctions.end());
+                    streamOptions.codegen.framePointers = options.framePointers;
+                    streamOptions.codegen.debugInfo = debugInfo(options);
+                    streamOptions.codegen.memoizeCapacity = options.memoizeCapacity;
+                    if (options.dumpIR) streamOptions.dumpIR = &std::cout;
+                    StreamingCompiler streaming(streamOptions);
+                    auto llvmMod = streaming.compile(source);
+                    if (!streaming.getErrors().empty()) {
+                        std::cerr << "Semantic Errors:\n";
+                        for (const auto& err : streaming.getErrors()) {
+                            std::cerr << "  " << err << "\n";
+                        }
+                        return 1;
+                    }
+                    if (llvmMod) {
+                        if (options.dumpLLVM) {
+                            std::cout << "--- LLVM IR ---\n";
+                            llvmMod->print(llvm::outs(), nullptr);
+                        }
+                        return link(*llvmMod, options);
+                    }
+                    why = streaming.getUnsupported();
+                }
+                std::cerr << "note: compiling the whole file at once: " << why << "\n";
+            }
+
             // 1. Lexing
             Lexer lexer(source);
             auto tokens = lexer.tokenize();
@@ -49,15 +478,170 @@ namespace kotlin_lite {
                 return 1;
             }
 
+            // 3b. Reachability: only functions reachable from the roots are compiled
+            std::vector<std::string> roots = {"main"};
+            roots.insert(roots.end(), options.exportedFunctions.begin(), options.exportedFunctions.end());
+            ReachabilityAnalysis reachability;
+            reachability.analyze(*ast, roots);
+            if (options.reportDead) {
+                const auto& dead = reachability.getDeadFunctions();
+                std::cerr << "Skipped " << dead.size() << " unreachable function(s)" << (dead.empty() ? "" : ":") << "\n";
+                for (const auto* func : dead) {
+                    std::cerr << "  " << func->name.value << " (line " << func->name.line << ")\n";
+                }
+            }
+
             // 4. IR Generation
             ir::IRGenerator irGen;
-            auto irMod = irGen.generate(*ast);
+            auto irMod = irGen.generate(*ast, &reachability.getLiveFunctions());
+            ir::recordIRSize(*irMod, false);
+            if (!options.emitIRFile.empty()) {
+                ir::writeBinaryFile(*irMod, options.emitIRFile);
+            }
+
+            // 4b. Compile-time evaluation; `const val` initializers are folded even without optimizations
+            ir::CompileTimeEvaluation::Options evalOptions;
+            evalOptions.foldCalls = options.optimizeIR && passEnabled(options, "consteval");
+            ir::CompileTimeEvaluation constEval(evalOptions);
+            constEval.run(*irMod);
+            if (!constEval.getUnfoldedConstants().empty()) {
+                std::cerr << "Semantic Errors:\n";
+                for (const auto& [name, reason] : constEval.getUnfoldedConstants()) {
+                    std::cerr << "  Initializer of const val '" << name << "' is not a compile-time constant: it " << reason << ".\n";
+                }
+                return 1;
+            }
+            if (options.reportFolded) {
+                const auto& stats = constEval.getStatistics();
+                std::cerr << "Folded " << stats.foldedCalls << " call(s) at compile time (" << stats.foldedConstants
+                          << " const val use(s)), " << stats.rejectedByBudget << " over budget\n";
+            }
+
+            // 4c. Profiles refer to the IR at this point, which both builds see alike
+            std::optional<CodegenOptions::ProfileGeneration> profileGeneration;
+            if (!options.profileGenerate.empty()) {
+                ir::ProfileInstrumentation instrumentation;
+                instrumentation.run(*irMod);
+                profileGeneration = CodegenOptions::ProfileGeneration{
+                    options.profileGenerate, instrumentation.getLayout(), instrumentation.getCounterCount()};
+            }
+            if (!options.profileUse.empty()) {
+                ir::Profile profile = ir::Profile::readFile(options.profileUse);
+                ir::ProfileAnnotation annotation(profile);
+                annotation.run(*irMod);
+                for (const auto& warning : annotation.getWarnings()) {
+                    std::cerr << "warning: " << warning << "\n";
+                }
+            }
+
+            // 4d. Custom IR optimizations
+            ir::RemarkCollector remarks(options.remarksFilter);
+            remarks.setFile(std::filesystem::path(options.inputFile).filename().string());
+            ir::RemarkCollector* remarkSink = options.remarks ? &remarks : nullptr;
+            if (options.optimizeIR) {
+                ir::InterproceduralConstantPropagation::Options ipcpOptions;
+                ipcpOptions.wholeProgram = options.wholeProgram;
+                ipcpOptions.preserveSignatures.insert(options.exportedFunctions.begin(), options.exportedFunctions.end());
+                ir::InterproceduralConstantPropagation ipcp(ipcpOptions);
+                if (passEnabled(options, "ipcp")) ipcp.run(*irMod);
+                ir::TailRecursionElimination tre;
+                if (passEnabled(options, "tailrec")) tre.run(*irMod);
+                else tre.runOnTailrecFunctions(*irMod);
+                ir::PeepholeOptimizer peephole;
+                if (passEnabled(options, "peephole")) peephole.run(*irMod);
+                if (options.reportPeephole) {
+                    std::cerr << "Peephole: " << peephole.getTotalRewrites() << " rewrite(s)\n";
+                    for (const auto& [rule, count] : peephole.getRuleCounts()) {
+                        if (count) std::cerr << "  " << rule << ": " << count << "\n";
+                    }
+                }
+                ir::LoopFusion fusion(remarkSink);
+                if (passEnabled(options, "loop-fusion")) fusion.run(*irMod);
+                ir::LoopInterchange interchange(remarkSink);
+                if (passEnabled(options, "loop-interchange")) interchange.run(*irMod);
+                if (options.autoParallel) {
+                    ir::AutoParallelization parallel(remarkSink);
+                    parallel.run(*irMod);
+                }
+            } else {
+                // `tailrec` is a guarantee, not an optimization
+                ir::TailRecursionElimination().runOnTailrecFunctions(*irMod);
+            }
+            ir::recordIRSize(*irMod, true);
             if (options.dumpIR) {
                 std::cout << "--- Custom IR ---\n" << irMod->dump() << "\n";
             }
 
+            // 4e. Fast start: interpret the IR and skip LLVM entirely
+            if (options.interpret && options.shouldRun) {
+                if (options.remarks && reportRemarks(remarks, options) != 0) return 1;
+                interp::Interpreter interpreter(interp::lowerToBytecode(*irMod));
+                interpreter.setArguments(options.programArgs);
+                try {
+                    interpreter.run();
+                } catch (const std::runtime_error& e) {
+                    std::fflush(stdout);
+                    std::cerr << "Runtime error: " << e.what() << std::endl;
+                    return 1;
+                }
+                return 0;
+            }
+
+            CodegenOptions codegenOptions;
+            codegenOptions.wholeProgram = options.wholeProgram;
+            codegenOptions.exported.insert(options.exportedFunctions.begin(), options.exportedFunctions.end());
+            codegenOptions.framePointers = options.framePointers;
+            codegenOptions.debugInfo = debugInfo(options);
+            codegenOptions.profileGenerate = profileGeneration;
+            if (!options.instrument.empty()) codegenOptions.instrument = CodegenOptions::Instrumentation{options.instrument};
+            codegenOptions.target = target;
+            codegenOptions.memoizeCapacity = options.memoizeCapacity;
+            if (options.multiversion) {
+                std::vector<std::string> names = *options.multiversion;
+                if (names.empty()) {
+                    names = hotLoopFunctions(*irMod);
+                    std::cerr << "--multiversion: " << names.size() << " hot function(s) in the profile";
+                    for (const std::string& name : names) std::cerr << (name == names.front() ? ": " : ", ") << name;
+                    std::cerr << "\n";
+                }
+                for (const std::string& name : names) {
+                    if (irMod->getFunction(name)) {
+                        codegenOptions.multiversion.insert(name);
+                    } else {
+                        std::cerr << "warning: --multiversion: no function '" << name << "' is compiled\n";
+                    }
+                }
+            }
+            if (options.tuning) {
+                codegenOptions.loopHints = CodegenOptions::LoopHints{
+                    options.tuning->unrollCount, options.tuning->vectorWidth, options.tuning->interleaveCount};
+            }
+
+            // 5a. Baseline backend: x86-64 straight from the custom IR, without LLVM
+            if (options.backend == "baseline") {
+                if (options.remarks && reportRemarks(remarks, options) != 0) return 1;
+                BaselineCodegen baseline(codegenOptions);
+                MachineCode code = baseline.generate(*irMod);
+                if (options.outputFile.empty()) {
+                    if (options.shouldRun) ExecutableBuffer(code).run("main", options.programArgs);
+                    return 0;
+                }
+
+                // `-o x.o` stops at the object file; otherwise link it with the runtime
+                const std::string& out = options.outputFile;
+                bool objectOnly = out.size() > 2 && out.compare(out.size() - 2, 2, ".o") == 0;
+                std::string objectFile = objectOnly ? out : out + ".o";
+                writeElfObjectFile(code, objectFile);
+                if (objectOnly) {
+                    std::cout << "Object file generated: " << objectFile << "\n";
+                    return 0;
+                }
+                std::string linkCmd = "clang -pthread -fno-omit-frame-pointer " + objectFile + " " + getRuntimePath() + " -o " + out;
+                return build(linkCmd, objectFile, out, options);
+            }
+
             // 5. LLVM Codegen
-            LLVMCodegen llvmCodegen;
+            LLVMCodegen llvmCodegen(codegenOptions);
             auto llvmMod = llvmCodegen.generate(*irMod);
             if (options.dumpLLVM) {
                 std::cout << "--- LLVM IR ---\n";
@@ -65,42 +649,10 @@ namespace kotlin_lite {
             }
 
             // 6. Compilation
-            if (!options.outputFile.empty() || options.shouldRun) {
-                std::string binaryName = options.outputFile.empty() ? "./program" : options.outputFile;
-                std::string tempLL = binaryName + ".ll";
-
-                // Write LLVM IR to temporary file
-                std::error_code ec;
-                llvm::raw_fd_ostream dest(tempLL, ec);
-                if (ec) {
-                    std::cerr << "Could not open " << tempLL << ": " << ec.message() << std::endl;
-                    return 1;
-                }
-                llvmMod->print(dest, nullptr);
-                dest.flush();
-                dest.close();
-
-                std::string runtimePath = getRuntimePath();
-                std::string compileCmd = "clang -O3 -Wno-override-module " + tempLL + " " + runtimePath + " -o " + binaryName;
-                
-                int compileRet = system(compileCmd.c_str());
-                
-                // Cleanup temporary LLVM IR file
-                std::filesystem::remove(tempLL);
-
-                if (compileRet != 0) {
-                    std::cerr << "Compilation failed during linking.\n";
-                    return 1;
-                }
-
-                if (options.shouldRun) {
-                    system(binaryName.c_str());
-                } else {
-                    std::cout << "Binary generated: " << binaryName << "\n";
-                }
+            if (options.remarks || options.tuning || codegenOptions.target || options.multiversion) {
+                return optimizeAndLink(*llvmMod, remarks, options, codegenOptions);
             }
-
-            return 0;
+            return link(*llvmMod, options);
         } catch (const std::exception& e) {
             std::cerr << "Compilation failed: " << e.what() << std::endl;
             return 1;
@@ -1,8 +1,19 @@
 #pragma once
+#include "codegen/codegen_options.hpp"
+#include "pipeline/autotuner.hpp"
+#include <optional>
 #include <string>
 #include <vector>
 #include <memory>
 
+namespace llvm {
+    class Module;
+}
+
+namespace kotlin_lite::ir {
+    class RemarkCollector;
+}
+
 namespace kotlin_lite {
     struct CompileOptions {
         std::string inputFile;
@@ -10,6 +21,68 @@ namespace kotlin_lite {
         bool dumpIR = false;
         bool dumpLLVM = false;
         bool shouldRun = false;
+        // Everything after `--`: the program's own arguments under --run
+        std::vector<std::string> programArgs;
+        // Run through the bytecode interpreter instead of LLVM + clang
+        bool interpret = false;
+        // "llvm", or "baseline" for the direct x86-64 backend (fast debug builds)
+        std::string backend = "llvm";
+        bool optimizeIR = true;
+        // Executables see the whole program: only `main` is visible outside
+        bool wholeProgram = true;
+        // Extra roots kept alive and visible besides `main`
+        std::vector<std::string> exportedFunctions;
+        // Keep frame pointers for the runtime's sampling profiler
+        bool framePointers = true;
+        // -g: DWARF debug info, also for optimized code
+        bool debugInfo = false;
+        bool reportDead = false;
+        // Print how many calls were evaluated at compile time
+        bool reportFolded = false;
+        // Print how often each peephole rule fired
+        bool reportPeephole = false;
+        // Print optimization remarks of the custom and LLVM passes matching `remarksFilter` (all if empty);
+        // LLVM then optimizes in-process instead of in clang
+        bool remarks = false;
+        std::string remarksFilter;
+        // Also write them as YAML to this file
+        std::string remarksFile;
+        // Outline independent reduction loops and run them on a thread pool
+        bool autoParallel = false;
+        // Parse, check, lower and emit one function at a time (bounded memory)
+        bool stream = false;
+        // Instrument the program to write an execution profile to this file at exit
+        std::string profileGenerate;
+        // Profile from such a run to optimize with
+        std::string profileUse;
+        // Count calls, cycles and loop trips; the report is written to <instrument>.txt/.json at exit
+        std::string instrument;
+        // -stats: print the counters of every pass (ir/statistics.hpp) to stderr
+        bool stats = false;
+        // -stats-json: write them, zeros included, to this file as JSON
+        std::string statsJson;
+        // Binary IR ("KLIR") of the front end's output, before custom passes
+        std::string emitIRFile;
+        // --autotune[=<budget>]: time builds under different optimization settings and keep the
+        // fastest; the budget is a number of builds, or seconds with an `s` suffix ("120s")
+        std::optional<std::string> autotune;
+        // The tuning file --autotune writes and builds use; empty: <source>.kltune
+        std::string tuneFile;
+        // --no-tune: ignore <source>.kltune
+        bool useTuning = true;
+        // The tuning a build applies, read from the tuning file; LLVM then optimizes in-process
+        std::optional<Tuning> tuning;
+        // --target-cpu / --target-features: generate code for this CPU ("native": the host's) and these
+        // features ("+avx2,-fma") instead of generic x86-64; LLVM then optimizes in-process
+        std::string targetCPU;
+        std::string targetFeatures;
+        // --multiversion[=<functions>]: also compile these functions (if empty, the hot ones of the
+        // --profile-use profile) for each x86-64 level, and pick a version when the program loads
+        std::optional<std::vector<std::string>> multiversion;
+        // --memoize-capacity: entries in the result cache of a @Memoize function that sets none
+        unsigned memoizeCapacity = 65536;
+        // No "Binary generated" message (autotuning candidates)
+        bool quiet = false;
     };
 
     class Compiler {
@@ -21,6 +94,15 @@ namespace kotlin_lite {
         int compile(const CompileOptions& options);
         
     private:
+        int compileFile(const CompileOptions& options);
+        int autotune(const CompileOptions& options);
+        int loadTuning(CompileOptions& options) const;
         std::string getRuntimePath() const;
+        int link(llvm::Module& llvmMod, const CompileOptions& options) const;
+        int optimizeAndLink(llvm::Module& llvmMod, ir::RemarkCollector& remarks, const CompileOptions& options,
+                            const CodegenOptions& codegenOptions) const;
+        int reportRemarks(const ir::RemarkCollector& remarks, const CompileOptions& options) const;
+        int build(const std::string& command, const std::string& tempFile, const std::string& binaryName,
+                  const CompileOptions& options) const;
     };
 }
@@ -0,0 +1,426 @@
+#include "bytecode.hpp"
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace kotlin_lite {
+namespace interp {
+
+const char* to_string(Opcode op) {
+    switch (op) {
+        case Opcode::Mov: return "mov";
+        case Opcode::Add: return "add";
+        case Opcode::Sub: return "sub";
+        case Opcode::Mul: return "mul";
+        case Opcode::SDiv: return "sdiv";
+        case Opcode::SRem: return "srem";
+        case Opcode::Shl: return "shl";
+        case Opcode::Add64: return "add.64";
+        case Opcode::Sub64: return "sub.64";
+        case Opcode::Mul64: return "mul.64";
+        case Opcode::SDiv64: return "sdiv.64";
+        case Opcode::SRem64: return "srem.64";
+        case Opcode::Shl64: return "shl.64";
+        case Opcode::UDiv: return "udiv";
+        case Opcode::URem: return "urem";
+        case Opcode::LShr: return "lshr";
+        case Opcode::CmpEq: return "cmp.eq";
+        case Opcode::CmpNe: return "cmp.ne";
+        case Opcode::CmpLt: return "cmp.lt";
+        case Opcode::CmpLe: return "cmp.le";
+        case Opcode::CmpGt: return "cmp.gt";
+        case Opcode::CmpGe: return "cmp.ge";
+        case Opcode::CmpULt: return "cmp.ult";
+        case Opcode::CmpULe: return "cmp.ule";
+        case Opcode::CmpUGt: return "cmp.ugt";
+        case Opcode::CmpUGe: return "cmp.uge";
+        case Opcode::Not: return "not";
+        case Opcode::ZExt: return "zext";
+        case Opcode::Trunc: return "trunc";
+        case Opcode::Jmp: return "jmp";
+        case Opcode::Br: return "br";
+        case Opcode::BrEq: return "br.eq";
+        case Opcode::BrNe: return "br.ne";
+        case Opcode::BrLt: return "br.lt";
+        case Opcode::BrLe: return "br.le";
+        case Opcode::BrGt: return "br.gt";
+        case Opcode::BrGe: return "br.ge";
+        case Opcode::BrULt: return "br.ult";
+        case Opcode::BrULe: return "br.ule";
+        case Opcode::BrUGt: return "br.ugt";
+        case Opcode::BrUGe: return "br.uge";
+        case Opcode::Call: return "call";
+        case Opcode::Ret: return "ret";
+        case Opcode::RetVoid: return "ret.void";
+        case Opcode::PrintI32: return "print_i32";
+        case Opcode::PrintBool: return "print_bool";
+        case Opcode::PrintI64: return "print_i64";
+        case Opcode::PrintU32: return "print_u32";
+        case Opcode::PrintU64: return "print_u64";
+        case Opcode::NanoTime: return "nano_time";
+        case Opcode::ArgCount: return "arg_count";
+        case Opcode::ArgInt: return "arg_int";
+        default: return "unknown";
+    }
+}
+
+int32_t BytecodeModule::findFunction(const std::string& name) const {
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (functions[i].name == name) return static_cast<int32_t>(i);
+    }
+    return -1;
+}
+
+std::string BytecodeModule::disassemble() const {
+    std::stringstream ss;
+    for (const auto& func : functions) {
+        ss << func.name << ": args=" << func.numArgs << " regs=" << func.numRegs << " consts=[";
+        for (size_t i = 0; i < func.constants.size(); ++i) ss << (i ? ", " : "") << func.constants[i];
+        ss << "]\n";
+        for (size_t pc = 0; pc < func.code.size(); ++pc) {
+            const Inst& inst = func.code[pc];
+            ss << "  " << pc << ": " << to_string(inst.op);
+            switch (inst.op) {
+                case Opcode::Jmp: ss << " @" << inst.c; break;
+                case Opcode::Br: ss << " r" << inst.a << ", @" << inst.c << ", @" << inst.d; break;
+                case Opcode::Call:
+                    ss << " r" << inst.a << ", " << functions[inst.b].name << "(";
+                    for (int32_t i = 0; i < inst.d; ++i) ss << (i ? ", " : "") << "r" << func.callArgs[inst.c + i];
+                    ss << ")";
+                    break;
+                case Opcode::RetVoid: break;
+                case Opcode::Ret: case Opcode::PrintI32: case Opcode::PrintBool:
+                case Opcode::PrintI64: case Opcode::PrintU32: case Opcode::PrintU64:
+                case Opcode::NanoTime: case Opcode::ArgCount:
+                    ss << " r" << inst.a;
+                    break;
+                case Opcode::Mov: case Opcode::Not: ss << " r" << inst.a << ", r" << inst.b; break;
+                case Opcode::ZExt: case Opcode::Trunc: ss << " r" << inst.a << ", r" << inst.b << ", i" << inst.d; break;
+                case Opcode::UDiv: case Opcode::URem: case Opcode::LShr:
+                    ss << " r" << inst.a << ", r" << inst.b << ", r" << inst.c << ", i" << inst.d;
+                    break;
+                default:
+                    if (inst.op >= Opcode::BrEq && inst.op <= Opcode::BrUGe) {
+                        ss << " r" << inst.a << ", r" << inst.b << ", @" << inst.c << ", @" << inst.d;
+                    } else {
+                        ss << " r" << inst.a << ", r" << inst.b << ", r" << inst.c;
+                    }
+                    break;
+            }
+            ss << "\n";
+        }
+    }
+    return ss.str();
+}
+
+namespace {
+
+// `wide` picks the 64-bit form of the arithmetic; comparisons work at any width
+Opcode binaryOpcode(ir::Instruction::OpKind kind, bool wide = false) {
+    switch (kind) {
+        case ir::Instruction::OpKind::Add: return wide ? Opcode::Add64 : Opcode::Add;
+        case ir::Instruction::OpKind::Sub: return wide ? Opcode::Sub64 : Opcode::Sub;
+        case ir::Instruction::OpKind::Mul: return wide ? Opcode::Mul64 : Opcode::Mul;
+        case ir::Instruction::OpKind::SDiv: return wide ? Opcode::SDiv64 : Opcode::SDiv;
+        case ir::Instruction::OpKind::SRem: return wide ? Opcode::SRem64 : Opcode::SRem;
+        case ir::Instruction::OpKind::Shl: return wide ? Opcode::Shl64 : Opcode::Shl;
+        case ir::Instruction::OpKind::UDiv: return Opcode::UDiv;
+        case ir::Instruction::OpKind::URem: return Opcode::URem;
+        case ir::Instruction::OpKind::LShr: return Opcode::LShr;
+        case ir::Instruction::OpKind::ICmpEq: return Opcode::CmpEq;
+        case ir::Instruction::OpKind::ICmpNe: return Opcode::CmpNe;
+        case ir::Instruction::OpKind::ICmpLt: return Opcode::CmpLt;
+        case ir::Instruction::OpKind::ICmpLe: return Opcode::CmpLe;
+        case ir::Instruction::OpKind::ICmpGt: return Opcode::CmpGt;
+        case ir::Instruction::OpKind::ICmpGe: return Opcode::CmpGe;
+        case ir::Instruction::OpKind::ICmpULt: return Opcode::CmpULt;
+        case ir::Instruction::OpKind::ICmpULe: return Opcode::CmpULe;
+        case ir::Instruction::OpKind::ICmpUGt: return Opcode::CmpUGt;
+        case ir::Instruction::OpKind::ICmpUGe: return Opcode::CmpUGe;
+        default: throw std::runtime_error("Bytecode: not a binary instruction");
+    }
+}
+
+bool isCompare(ir::Instruction::OpKind kind) {
+    return kind >= ir::Instruction::OpKind::ICmpEq && kind <= ir::Instruction::OpKind::ICmpUGe;
+}
+
+// Lowers one function. Block targets are recorded as fixups and patched once
+// every block has an address.
+class FunctionLowering {
+public:
+    FunctionLowering(const ir::Function& func, const std::map<std::string, int32_t>& functionIndex)
+        : func_(func), function_index_(functionIndex) {}
+
+    BytecodeFunction lower() {
+        out_.name = func_.name;
+        out_.numArgs = static_cast<int32_t>(func_.args.size());
+        allocateRegisters();
+
+        std::vector<const ir::BasicBlock*> order;
+        for (const auto& bb : func_.blocks) order.push_back(bb.get());
+
+        for (size_t i = 0; i < order.size(); ++i) {
+            const ir::BasicBlock* next = i + 1 < order.size() ? order[i + 1] : nullptr;
+            lowerBlock(*order[i], next);
+        }
+        for (const auto& [index, bb] : fixups_) {
+            int32_t target = block_start_.at(bb);
+            Inst& inst = out_.code[index.first];
+            (index.second ? inst.d : inst.c) = target;
+        }
+        return std::move(out_);
+    }
+
+private:
+    const ir::Function& func_;
+    const std::map<std::string, int32_t>& function_index_;
+    BytecodeFunction out_;
+    std::map<const ir::Value*, int32_t> regs_;
+    std::map<std::pair<ir::Type, int64_t>, int32_t> const_regs_;
+    std::map<const ir::Value*, int> uses_;
+    int32_t scratch_ = 0;
+    std::map<const ir::BasicBlock*, int32_t> block_start_;
+    // (instruction index, false = field c / true = field d) -> block
+    std::vector<std::pair<std::pair<size_t, bool>, const ir::BasicBlock*>> fixups_;
+
+    void allocateRegisters() {
+        int32_t next = out_.numArgs;
+        for (size_t i = 0; i < func_.args.size(); ++i) {
+            if (func_.args[i].ssaValue) regs_[func_.args[i].ssaValue] = static_cast<int32_t>(i);
+        }
+        // Constants first so that they form one contiguous block to copy on entry
+        for (const auto& bb : func_.blocks) {
+            for (const auto& inst : bb->instructions) {
+                for (ir::Value* op : inst->getOperands()) {
+                    if (auto c = dynamic_cast<ir::Constant*>(op)) {
+                        auto key = std::make_pair(c->type, c->value);
+                        if (!const_regs_.count(key)) {
+                            const_regs_[key] = next++;
+                            out_.constants.push_back(c->value);
+                        }
+                    }
+                    uses_[op]++;
+                }
+            }
+        }
+        for (const auto& bb : func_.blocks) {
+            for (const auto& inst : bb->instructions) {
+                if (inst->type != ir::Type::Void && inst->kind != ir::Instruction::OpKind::Br &&
+                    inst->kind != ir::Instruction::OpKind::CondBr && inst->kind != ir::Instruction::OpKind::Ret) {
+                    regs_[inst.get()] = next++;
+                }
+            }
+        }
+        scratch_ = next++;
+        out_.numRegs = next;
+    }
+
+    int32_t reg(const ir::Value* v) const {
+        if (auto c = dynamic_cast<const ir::Constant*>(v)) return const_regs_.at({c->type, c->value});
+        auto it = regs_.find(v);
+        if (it == regs_.end()) {
+            throw std::runtime_error("Bytecode: unsupported operand " + v->getName() + " in @" + func_.name);
+        }
+        return it->second;
+    }
+
+    size_t emit(Inst inst) {
+        out_.code.push_back(inst);
+        return out_.code.size() - 1;
+    }
+
+    void branchTo(size_t index, bool fieldD, const ir::BasicBlock* target) {
+        fixups_.push_back({{index, fieldD}, target});
+    }
+
+    // Sequentializes the parallel copies for the phis of `succ` on the edge from `pred`.
+    void emitEdgeMoves(const ir::BasicBlock& pred, const ir::BasicBlock& succ) {
+        std::vector<std::pair<int32_t, int32_t>> moves; // (dst, src)
+        for (const auto& inst : succ.instructions) {
+            if (inst->kind != ir::Instruction::OpKind::Phi) break;
+            auto phi = static_cast<const ir::PhiInst*>(inst.get());
+            auto it = phi->incomings.find(const_cast<ir::BasicBlock*>(&pred));
+            if (it == phi->incomings.end()) continue;
+            int32_t dst = reg(phi);
+            int32_t src = reg(it->second);
+            if (dst != src) moves.emplace_back(dst, src);
+        }
+
+        while (!moves.empty()) {
+            // A move is safe once no pending move still reads its destination
+            auto ready = std::find_if(moves.begin(), moves.end(), [&](const auto& m) {
+                return std::none_of(moves.begin(), moves.end(), [&](const auto& other) { return other.second == m.first; });
+            });
+            if (ready != moves.end()) {
+                emit(Inst(Opcode::Mov, ready->first, ready->second));
+                moves.erase(ready);
+                continue;
+            }
+            // Only cycles remain: park one destination's old value in scratch
+            int32_t parked = moves.front().first;
+            emit(Inst(Opcode::Mov, scratch_, parked));
+            for (auto& m : moves) {
+                if (m.second == parked) m.second = scratch_;
+            }
+        }
+    }
+
+    bool hasEdgeMoves(const ir::BasicBlock& pred, const ir::BasicBlock& succ) const {
+        for (const auto& inst : succ.instructions) {
+            if (inst->kind != ir::Instruction::OpKind::Phi) break;
+            auto phi = static_cast<const ir::PhiInst*>(inst.get());
+            auto it = phi->incomings.find(const_cast<ir::BasicBlock*>(&pred));
+            if (it != phi->incomings.end() && reg(phi) != reg(it->second)) return true;
+        }
+        return false;
+    }
+
+    void lowerBlock(const ir::BasicBlock& bb, const ir::BasicBlock* next) {
+        block_start_[&bb] = static_cast<int32_t>(out_.code.size());
+        const ir::Instruction* term = bb.getTerminator();
+        if (!term) throw std::runtime_error("Bytecode: block %" + bb.label + " in @" + func_.name + " has no terminator");
+
+        // A compare feeding only the block's conditional branch fuses into it
+        const ir::Instruction* fused = nullptr;
+        if (term->kind == ir::Instruction::OpKind::CondBr && bb.instructions.size() >= 2) {
+            auto cond = static_cast<const ir::CondBranchInst*>(term)->condition;
+            const ir::Instruction* beforeTerm = std::prev(bb.instructions.end(), 2)->get();
+            if (beforeTerm == cond && isCompare(beforeTerm->kind) && uses_.at(cond) == 1) fused = beforeTerm;
+        }
+
+        for (const auto& inst : bb.instructions) {
+            if (inst.get() == term) break;
+            if (inst.get() == fused || inst->kind == ir::Instruction::OpKind::Phi) continue;
+            lowerInstruction(*inst);
+        }
+
+        switch (term->kind) {
+            case ir::Instruction::OpKind::Br: {
+                const ir::BasicBlock* target = static_cast<const ir::BranchInst*>(term)->target;
+                emitEdgeMoves(bb, *target);
+                if (target != next) branchTo(emit(Inst(Opcode::Jmp)), false, target);
+                break;
+            }
+            case ir::Instruction::OpKind::CondBr: {
+                auto cbr = static_cast<const ir::CondBranchInst*>(term);
+                size_t index;
+                if (fused) {
+                    auto cmp = static_cast<const ir::BinaryInst*>(fused);
+                    auto op = static_cast<Opcode>(static_cast<int>(Opcode::BrEq) +
+                                                  (static_cast<int>(binaryOpcode(cmp->kind)) - static_cast<int>(Opcode::CmpEq)));
+                    index = emit(Inst(op, reg(cmp->left), reg(cmp->right)));
+                } else {
+                    index = emit(Inst(Opcode::Br, reg(cbr->condition)));
+                }
+                // Edges that need phi moves go through a stub placed after the block
+                std::vector<std::pair<bool, const ir::BasicBlock*>> stubs;
+                for (bool isElse : {false, true}) {
+                    const ir::BasicBlock* target = isElse ? cbr->elseBB : cbr->thenBB;
+                    if (hasEdgeMoves(bb, *target)) stubs.emplace_back(isElse, target);
+                    else branchTo(index, isElse, target);
+                }
+                for (const auto& [isElse, target] : stubs) {
+                    Inst& br = out_.code[index];
+                    (isElse ? br.d : br.c) = static_cast<int32_t>(out_.code.size());
+                    emitEdgeMoves(bb, *target);
+                    branchTo(emit(Inst(Opcode::Jmp)), false, target);
+                }
+                break;
+            }
+            case ir::Instruction::OpKind::Ret: {
+                auto ret = static_cast<const ir::ReturnInst*>(term);
+                if (ret->value) emit(Inst(Opcode::Ret, reg(ret->value)));
+                else emit(Inst(Opcode::RetVoid));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void lowerInstruction(const ir::Instruction& inst) {
+        switch (inst.kind) {
+            case ir::Instruction::OpKind::Not:
+                emit(Inst(Opcode::Not, reg(&inst), reg(static_cast<const ir::UnaryInst&>(inst).operand)));
+                break;
+            case ir::Instruction::OpKind::SExt:
+                // Registers are sign-extended already
+                emit(Inst(Opcode::Mov, reg(&inst), reg(static_cast<const ir::UnaryInst&>(inst).operand)));
+                break;
+            case ir::Instruction::OpKind::ZExt: {
+                const ir::Value* operand = static_cast<const ir::UnaryInst&>(inst).operand;
+                emit(Inst(Opcode::ZExt, reg(&inst), reg(operand), 0, static_cast<int32_t>(ir::bitWidth(operand->getType()))));
+                break;
+            }
+            case ir::Instruction::OpKind::Trunc:
+                emit(Inst(Opcode::Trunc, reg(&inst), reg(static_cast<const ir::UnaryInst&>(inst).operand), 0,
+                          static_cast<int32_t>(ir::bitWidth(inst.type))));
+                break;
+            case ir::Instruction::OpKind::Call: {
+                auto& call = static_cast<const ir::CallInst&>(inst);
+                static const std::map<std::string, Opcode> prints = {
+                    {"print_i32", Opcode::PrintI32}, {"print_bool", Opcode::PrintBool}, {"print_i64", Opcode::PrintI64},
+                    {"print_u32", Opcode::PrintU32}, {"print_u64", Opcode::PrintU64},
+                };
+                auto print = prints.find(call.callee);
+                if (print != prints.end()) {
+                    emit(Inst(print->second, reg(call.args.at(0))));
+                    break;
+                }
+                // Nothing is optimized away here, so blackhole has nothing to prevent
+                if (call.callee == "blackhole") break;
+                if (call.callee == "nanoTime" || call.callee == "argCount") {
+                    emit(Inst(call.callee == "nanoTime" ? Opcode::NanoTime : Opcode::ArgCount, reg(&inst)));
+                    break;
+                }
+                if (call.callee == "argInt") {
+                    emit(Inst(Opcode::ArgInt, reg(&inst), reg(call.args.at(0)), reg(call.args.at(1))));
+                    break;
+                }
+                auto it = function_index_.find(call.callee);
+                if (it == function_index_.end()) {
+                    throw std::runtime_error("Interpreter: call to unknown function '" + call.callee + "'");
+                }
+                int32_t first = static_cast<int32_t>(out_.callArgs.size());
+                for (ir::Value* arg : call.args) out_.callArgs.push_back(reg(arg));
+                int32_t dst = call.type == ir::Type::Void ? scratch_ : reg(&inst);
+                emit(Inst(Opcode::Call, dst, it->second, first, static_cast<int32_t>(call.args.size())));
+                break;
+            }
+            default: {
+                auto& bin = static_cast<const ir::BinaryInst&>(inst);
+                unsigned width = ir::bitWidth(bin.left->getType());
+                Opcode op = binaryOpcode(inst.kind, width == 64);
+                int32_t dst = reg(&inst);
+                emit(Inst(op, dst, reg(bin.left), reg(bin.right), static_cast<int32_t>(width)));
+                // Narrow arithmetic wraps at its own width
+                bool narrow = width < 32 && !isCompare(inst.kind) && op != Opcode::UDiv && op != Opcode::URem && op != Opcode::LShr;
+                if (narrow) emit(Inst(Opcode::Trunc, dst, dst, 0, static_cast<int32_t>(width)));
+                break;
+            }
+        }
+    }
+};
+
+} // namespace
+
+BytecodeModule lowerToBytecode(const ir::Module& module, const std::string& entry) {
+    std::map<std::string, int32_t> functionIndex;
+    for (const auto& func : module.functions) {
+        functionIndex[func->name] = static_cast<int32_t>(functionIndex.size());
+    }
+
+    BytecodeModule out;
+    for (const auto& func : module.functions) {
+        if (func->blocks.empty()) throw std::runtime_error("Interpreter: function '" + func->name + "' has no body");
+        out.functions.push_back(FunctionLowering(*func, functionIndex).lower());
+    }
+    out.entry = out.findFunction(entry);
+    if (out.entry < 0) throw std::runtime_error("Interpreter: no '" + entry + "' function");
+    return out;
+}
+
+} // namespace interp
+} // namespace kotlin_lite
@@ -0,0 +1,81 @@
+#pragma once
+#include "ir/ir.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace interp {
+
+// Register bytecode executed by `Interpreter`.
+//
+// Every function owns a frame of `numRegs` 64-bit registers laid out as
+// [arguments | constants | values | scratch]. Constants are copied into their
+// registers when the frame is entered, so every operand is a register index.
+// Phis do not exist at this level: each CFG edge carries the parallel moves
+// that set the successor's phi registers.
+//
+// A register holds its IR value sign-extended from the value's width (an i1
+// is 0 or 1), so signed and unsigned comparisons and sext need no width.
+// i8 and i16 arithmetic runs as 32-bit arithmetic followed by a Trunc.
+enum class Opcode : uint8_t {
+    Mov,                                     // r[a] = r[b]
+    Add, Sub, Mul, SDiv, SRem, Shl,          // r[a] = r[b] op r[c], 32-bit
+    Add64, Sub64, Mul64, SDiv64, SRem64, Shl64,
+    UDiv, URem, LShr,                        // r[a] = r[b] op r[c] on the low d bits
+    CmpEq, CmpNe, CmpLt, CmpLe, CmpGt, CmpGe,
+    CmpULt, CmpULe, CmpUGt, CmpUGe,
+    Not,                                     // r[a] = !r[b]
+    ZExt, Trunc,                             // r[a] = low d bits of r[b], zero- or sign-extended
+    Jmp,                                     // pc = c
+    Br,                                      // pc = r[a] ? c : d
+    BrEq, BrNe, BrLt, BrLe, BrGt, BrGe,      // pc = (r[a] cmp r[b]) ? c : d
+    BrULt, BrULe, BrUGt, BrUGe,
+    Call,                                    // r[a] = functions[b](callArgs[c .. c+d))
+    Ret,                                     // return r[a]
+    RetVoid,
+    PrintI32, PrintBool,                     // builtins, argument r[a]
+    PrintI64, PrintU32, PrintU64,
+    NanoTime, ArgCount,                      // r[a] = builtin()
+    ArgInt,                                  // r[a] = argInt(r[b], r[c])
+    Count
+};
+
+const char* to_string(Opcode op);
+
+struct Inst {
+    // Dispatch target, filled in by the interpreter before the first run
+    const void* handler = nullptr;
+    Opcode op;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t c = 0;
+    int32_t d = 0;
+
+    Inst(Opcode o, int32_t a_ = 0, int32_t b_ = 0, int32_t c_ = 0, int32_t d_ = 0)
+        : op(o), a(a_), b(b_), c(c_), d(d_) {}
+};
+
+struct BytecodeFunction {
+    std::string name;
+    int32_t numArgs = 0;
+    int32_t numRegs = 0;
+    std::vector<int64_t> constants;  // loaded into registers numArgs .. numArgs + constants.size()
+    std::vector<Inst> code;
+    std::vector<int32_t> callArgs;   // argument registers of all calls, sliced by Inst::c / Inst::d
+};
+
+struct BytecodeModule {
+    std::vector<BytecodeFunction> functions;
+    int32_t entry = -1;
+
+    int32_t findFunction(const std::string& name) const;
+    std::string disassemble() const;
+};
+
+// Lowers a module to bytecode. Calls to functions that are neither defined in
+// the module nor builtins throw std::runtime_error, as does a missing entry.
+BytecodeModule lowerToBytecode(const ir::Module& module, const std::string& entry = "main");
+
+} // namespace interp
+} // namespace kotlin_lite
@@ -0,0 +1,224 @@
+#include "interpreter.hpp"
+#include "ir/builtins.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define KL_INTERP_THREADED 1
+#endif
+
+namespace kotlin_lite {
+namespace interp {
+
+Interpreter::Interpreter(BytecodeModule module, std::FILE* out, size_t stackRegisters)
+    : module_(std::move(module)), out_(out), stack_size_(stackRegisters),
+      stack_(new int64_t[stackRegisters]) {}
+
+int32_t Interpreter::run() {
+    struct Frame {
+        const BytecodeFunction* func;
+        const Inst* returnPc;
+        int64_t* regs;
+        int32_t dst;
+    };
+
+#ifdef KL_INTERP_THREADED
+    // Indexed by Opcode
+    static const void* const handlers[] = {
+        &&op_Mov,
+        &&op_Add, &&op_Sub, &&op_Mul, &&op_SDiv, &&op_SRem, &&op_Shl,
+        &&op_Add64, &&op_Sub64, &&op_Mul64, &&op_SDiv64, &&op_SRem64, &&op_Shl64,
+        &&op_UDiv, &&op_URem, &&op_LShr,
+        &&op_CmpEq, &&op_CmpNe, &&op_CmpLt, &&op_CmpLe, &&op_CmpGt, &&op_CmpGe,
+        &&op_CmpULt, &&op_CmpULe, &&op_CmpUGt, &&op_CmpUGe,
+        &&op_Not,
+        &&op_ZExt, &&op_Trunc,
+        &&op_Jmp,
+        &&op_Br,
+        &&op_BrEq, &&op_BrNe, &&op_BrLt, &&op_BrLe, &&op_BrGt, &&op_BrGe,
+        &&op_BrULt, &&op_BrULe, &&op_BrUGt, &&op_BrUGe,
+        &&op_Call,
+        &&op_Ret,
+        &&op_RetVoid,
+        &&op_PrintI32, &&op_PrintBool,
+        &&op_PrintI64, &&op_PrintU32, &&op_PrintU64,
+        &&op_NanoTime, &&op_ArgCount,
+        &&op_ArgInt,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(Opcode::Count), "handler table");
+    if (!threaded_) {
+        for (auto& func : module_.functions) {
+            for (auto& inst : func.code) inst.handler = handlers[static_cast<int>(inst.op)];
+        }
+        threaded_ = true;
+    }
+#define TARGET(name) op_##name:
+#define DISPATCH() goto *pc->handler
+#else
+#define TARGET(name) case Opcode::name:
+#define DISPATCH() goto dispatch
+#endif
+
+    std::vector<Frame> frames;
+    frames.reserve(256);
+    int64_t* const stackEnd = stack_.get() + stack_size_;
+
+    const BytecodeFunction* func = &module_.functions[module_.entry];
+    int64_t* r = stack_.get();
+    if (func->numRegs > static_cast<int32_t>(stack_size_)) throw std::runtime_error("Interpreter: stack overflow");
+    std::memset(r, 0, sizeof(int64_t) * func->numArgs);
+    std::memcpy(r + func->numArgs, func->constants.data(), sizeof(int64_t) * func->constants.size());
+    const Inst* code = func->code.data();
+    const Inst* pc = code;
+
+    // Wrapping arithmetic, as in the LLVM lowering
+    auto wrap = [](int64_t v) { return static_cast<int32_t>(static_cast<uint32_t>(v)); };
+    auto wrap64 = [](uint64_t v) { return static_cast<int64_t>(v); };
+    auto checkDivision = [](int64_t l, int64_t rhs, int64_t min) {
+        if (rhs == 0) throw std::runtime_error("Interpreter: division by zero");
+        if (l == min && rhs == -1) throw std::runtime_error("Interpreter: integer overflow in division");
+    };
+    // The low `width` bits, zero- or sign-extended; an i1 is its low bit
+    auto low = [](int64_t v, int32_t width) {
+        return width >= 64 ? static_cast<uint64_t>(v) : static_cast<uint64_t>(v) & ((uint64_t(1) << width) - 1);
+    };
+    auto signExtend = [&](uint64_t v, int32_t width) {
+        if (width <= 1 || width >= 64) return width == 1 ? static_cast<int64_t>(v & 1) : static_cast<int64_t>(v);
+        return static_cast<int64_t>(v << (64 - width)) >> (64 - width);
+    };
+    auto checkUnsignedDivision = [&](int64_t rhs, int32_t width) {
+        if (low(rhs, width) == 0) throw std::runtime_error("Interpreter: division by zero");
+    };
+
+#ifdef KL_INTERP_THREADED
+    DISPATCH();
+#else
+dispatch:
+    switch (pc->op) {
+#endif
+
+    TARGET(Mov) { r[pc->a] = r[pc->b]; ++pc; DISPATCH(); }
+    TARGET(Add) { r[pc->a] = wrap(int64_t(r[pc->b]) + r[pc->c]); ++pc; DISPATCH(); }
+    TARGET(Sub) { r[pc->a] = wrap(int64_t(r[pc->b]) - r[pc->c]); ++pc; DISPATCH(); }
+    TARGET(Mul) { r[pc->a] = wrap(int64_t(r[pc->b]) * r[pc->c]); ++pc; DISPATCH(); }
+    TARGET(SDiv) { checkDivision(r[pc->b], r[pc->c], INT32_MIN); r[pc->a] = r[pc->b] / r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(SRem) { checkDivision(r[pc->b], r[pc->c], INT32_MIN); r[pc->a] = r[pc->b] % r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(Shl) { r[pc->a] = static_cast<int32_t>(static_cast<uint32_t>(r[pc->b]) << (r[pc->c] & 31)); ++pc; DISPATCH(); }
+    TARGET(Add64) { r[pc->a] = wrap64(uint64_t(r[pc->b]) + uint64_t(r[pc->c])); ++pc; DISPATCH(); }
+    TARGET(Sub64) { r[pc->a] = wrap64(uint64_t(r[pc->b]) - uint64_t(r[pc->c])); ++pc; DISPATCH(); }
+    TARGET(Mul64) { r[pc->a] = wrap64(uint64_t(r[pc->b]) * uint64_t(r[pc->c])); ++pc; DISPATCH(); }
+    TARGET(SDiv64) { checkDivision(r[pc->b], r[pc->c], INT64_MIN); r[pc->a] = r[pc->b] / r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(SRem64) { checkDivision(r[pc->b], r[pc->c], INT64_MIN); r[pc->a] = r[pc->b] % r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(Shl64) { r[pc->a] = wrap64(uint64_t(r[pc->b]) << (r[pc->c] & 63)); ++pc; DISPATCH(); }
+    TARGET(UDiv) {
+        checkUnsignedDivision(r[pc->c], pc->d);
+        r[pc->a] = signExtend(low(r[pc->b], pc->d) / low(r[pc->c], pc->d), pc->d);
+        ++pc;
+        DISPATCH();
+    }
+    TARGET(URem) {
+        checkUnsignedDivision(r[pc->c], pc->d);
+        r[pc->a] = signExtend(low(r[pc->b], pc->d) % low(r[pc->c], pc->d), pc->d);
+        ++pc;
+        DISPATCH();
+    }
+    TARGET(LShr) {
+        r[pc->a] = signExtend(low(r[pc->b], pc->d) >> (low(r[pc->c], pc->d) % pc->d), pc->d);
+        ++pc;
+        DISPATCH();
+    }
+    TARGET(CmpEq) { r[pc->a] = r[pc->b] == r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(CmpNe) { r[pc->a] = r[pc->b] != r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(CmpLt) { r[pc->a] = r[pc->b] < r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(CmpLe) { r[pc->a] = r[pc->b] <= r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(CmpGt) { r[pc->a] = r[pc->b] > r[pc->c]; ++pc; DISPATCH(); }
+    TARGET(CmpGe) { r[pc->a] = r[pc->b] >= r[pc->c]; ++pc; DISPATCH(); }
+    // Sign extension keeps the unsigned order, so one compare serves every width
+    TARGET(CmpULt) { r[pc->a] = uint64_t(r[pc->b]) < uint64_t(r[pc->c]); ++pc; DISPATCH(); }
+    TARGET(CmpULe) { r[pc->a] = uint64_t(r[pc->b]) <= uint64_t(r[pc->c]); ++pc; DISPATCH(); }
+    TARGET(CmpUGt) { r[pc->a] = uint64_t(r[pc->b]) > uint64_t(r[pc->c]); ++pc; DISPATCH(); }
+    TARGET(CmpUGe) { r[pc->a] = uint64_t(r[pc->b]) >= uint64_t(r[pc->c]); ++pc; DISPATCH(); }
+    TARGET(Not) { r[pc->a] = !r[pc->b]; ++pc; DISPATCH(); }
+    TARGET(ZExt) { r[pc->a] = static_cast<int64_t>(low(r[pc->b], pc->d)); ++pc; DISPATCH(); }
+    TARGET(Trunc) { r[pc->a] = signExtend(static_cast<uint64_t>(r[pc->b]), pc->d); ++pc; DISPATCH(); }
+    TARGET(Jmp) { pc = code + pc->c; DISPATCH(); }
+    TARGET(Br) { pc = code + (r[pc->a] ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrEq) { pc = code + (r[pc->a] == r[pc->b] ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrNe) { pc = code + (r[pc->a] != r[pc->b] ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrLt) { pc = code + (r[pc->a] < r[pc->b] ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrLe) { pc = code + (r[pc->a] <= r[pc->b] ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrGt) { pc = code + (r[pc->a] > r[pc->b] ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrGe) { pc = code + (r[pc->a] >= r[pc->b] ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrULt) { pc = code + (uint64_t(r[pc->a]) < uint64_t(r[pc->b]) ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrULe) { pc = code + (uint64_t(r[pc->a]) <= uint64_t(r[pc->b]) ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrUGt) { pc = code + (uint64_t(r[pc->a]) > uint64_t(r[pc->b]) ? pc->c : pc->d); DISPATCH(); }
+    TARGET(BrUGe) { pc = code + (uint64_t(r[pc->a]) >= uint64_t(r[pc->b]) ? pc->c : pc->d); DISPATCH(); }
+
+    TARGET(Call) {
+        const BytecodeFunction* callee = &module_.functions[pc->b];
+        int64_t* calleeRegs = r + func->numRegs;
+        if (calleeRegs + callee->numRegs > stackEnd) throw std::runtime_error("Interpreter: stack overflow");
+        const int32_t* argRegs = func->callArgs.data() + pc->c;
+        for (int32_t i = 0; i < pc->d; ++i) calleeRegs[i] = r[argRegs[i]];
+        std::memcpy(calleeRegs + callee->numArgs, callee->constants.data(), sizeof(int64_t) * callee->constants.size());
+        frames.push_back({func, pc + 1, r, pc->a});
+        func = callee;
+        r = calleeRegs;
+        code = pc = callee->code.data();
+        DISPATCH();
+    }
+
+    TARGET(Ret) {
+        int64_t result = r[pc->a];
+        if (frames.empty()) {
+            std::fflush(out_);
+            return static_cast<int32_t>(result);
+        }
+        const Frame& frame = frames.back();
+        func = frame.func;
+        r = frame.regs;
+        r[frame.dst] = result;
+        pc = frame.returnPc;
+        code = func->code.data();
+        frames.pop_back();
+        DISPATCH();
+    }
+
+    TARGET(RetVoid) {
+        if (frames.empty()) {
+            std::fflush(out_);
+            return 0;
+        }
+        const Frame& frame = frames.back();
+        func = frame.func;
+        r = frame.regs;
+        pc = frame.returnPc;
+        code = func->code.data();
+        frames.pop_back();
+        DISPATCH();
+    }
+
+    // Same output format as src/runtime/runtime.c
+    TARGET(PrintI32) { std::fprintf(out_, "%d\n", static_cast<int32_t>(r[pc->a])); ++pc; DISPATCH(); }
+    TARGET(PrintBool) { std::fputs(r[pc->a] ? "true\n" : "false\n", out_); ++pc; DISPATCH(); }
+    TARGET(PrintI64) { std::fprintf(out_, "%lld\n", static_cast<long long>(r[pc->a])); ++pc; DISPATCH(); }
+    TARGET(PrintU32) { std::fprintf(out_, "%u\n", static_cast<uint32_t>(r[pc->a])); ++pc; DISPATCH(); }
+    TARGET(PrintU64) { std::fprintf(out_, "%llu\n", static_cast<unsigned long long>(r[pc->a])); ++pc; DISPATCH(); }
+    TARGET(NanoTime) { r[pc->a] = ir::builtinNanoTime(); ++pc; DISPATCH(); }
+    TARGET(ArgCount) { r[pc->a] = static_cast<int32_t>(arguments_.size()); ++pc; DISPATCH(); }
+    TARGET(ArgInt) { r[pc->a] = ir::builtinArgInt(arguments_, r[pc->b], r[pc->c]); ++pc; DISPATCH(); }
+
+#ifndef KL_INTERP_THREADED
+        default:
+            break;
+    }
+#endif
+    throw std::runtime_error("Interpreter: invalid opcode");
+
+#undef TARGET
+#undef DISPATCH
+}
+
+} // namespace interp
+} // namespace kotlin_lite
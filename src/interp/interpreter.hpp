@@ -0,0 +1,40 @@
+#pragma once
+#include "bytecode.hpp"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace interp {
+
+// Executes a `BytecodeModule` without going through LLVM, for `--run --interp`.
+//
+// Dispatch is direct-threaded: each `Inst` holds the address of its handler
+// (GCC/Clang computed goto), so an instruction ends by jumping straight to
+// the next one's handler. Other compilers fall back to a switch loop. Calls
+// stay inside the dispatch loop; frames are carved from one register stack.
+class Interpreter {
+public:
+    explicit Interpreter(BytecodeModule module, std::FILE* out = stdout, size_t stackRegisters = size_t(1) << 23);
+
+    // Runs the entry function and returns its result (0 for Unit). Division
+    // traps and stack overflow throw std::runtime_error.
+    int32_t run();
+
+    const BytecodeModule& getModule() const { return module_; }
+
+    // What argCount and argInt see
+    void setArguments(std::vector<std::string> args) { arguments_ = std::move(args); }
+
+private:
+    BytecodeModule module_;
+    std::FILE* out_;
+    size_t stack_size_;
+    std::unique_ptr<int64_t[]> stack_;
+    bool threaded_ = false;
+    std::vector<std::string> arguments_;
+};
+
+} // namespace interp
+} // namespace kotlin_lite
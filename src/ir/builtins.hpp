@@ -0,0 +1,71 @@
+#pragma once
+#include "ir.hpp"
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Runtime functions callable from Kotlin code without a declaration.
+struct BuiltinInfo {
+    const char* name;
+    Type returnType;
+    std::vector<Type> params;
+    // Writes to stdout or otherwise talks to the outside world
+    bool hasIOEffects;
+};
+
+inline const std::vector<BuiltinInfo>& builtins() {
+    static const std::vector<BuiltinInfo> table = {
+        {"print_i32", Type::Void, {Type::I32}, true},
+        {"print_bool", Type::Void, {Type::I1}, true},
+        {"print_i64", Type::Void, {Type::I64}, true},
+        {"print_u32", Type::Void, {Type::I32}, true},
+        {"print_u64", Type::Void, {Type::I64}, true},
+        // Micro-benchmarking: a monotonic clock, a sink the optimizers cannot
+        // see through, and the program's command-line arguments. They count as
+        // I/O so that no pass folds, removes or reorders them. blackhole takes
+        // one integer of any width, which is passed on unconverted.
+        {"nanoTime", Type::I64, {}, true},
+        {"blackhole", Type::Void, {}, true},
+        {"argCount", Type::I32, {}, true},
+        {"argInt", Type::I32, {Type::I32, Type::I32}, true},
+    };
+    return table;
+}
+
+inline const BuiltinInfo* findBuiltin(const std::string& name) {
+    for (const auto& builtin : builtins()) {
+        if (name == builtin.name) return &builtin;
+    }
+    return nullptr;
+}
+
+// In-process versions of the runtime's nanoTime and argInt, for the
+// interpreter and (argInt only, as it has no Long) the baseline JIT, which run
+// inside the compiler. Both must agree with src/runtime/runtime.c.
+
+// Nanoseconds of the monotonic clock
+inline int64_t builtinNanoTime() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+// Argument `index` (0 is the first after the program name) as a decimal Int,
+// or `fallback` if it is missing or not an Int
+inline int32_t builtinArgInt(const std::vector<std::string>& args, int32_t index, int32_t fallback) {
+    if (index < 0 || static_cast<size_t>(index) >= args.size()) return fallback;
+    const char* text = args[index].c_str();
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || value < INT32_MIN || value > INT32_MAX) return fallback;
+    return static_cast<int32_t>(value);
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,81 @@
+#include "call_graph.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace kotlin_lite {
+namespace ir {
+
+CallGraph::CallGraph(const Module& module) {
+    for (const auto& func : module.functions) {
+        callees_[func->name];
+        for (const auto& bb : func->blocks) {
+            for (const auto& inst : bb->instructions) {
+                for (Value* op : inst->getOperands()) {
+                    if (auto ref = dynamic_cast<Function*>(op)) address_taken_.insert(ref->name);
+                }
+                if (inst->kind != Instruction::OpKind::Call) continue;
+                auto call = static_cast<CallInst*>(inst.get());
+                call_sites_[call->callee].push_back({func.get(), call});
+                callees_[func->name].insert(call->callee);
+            }
+        }
+    }
+    computeSCCs(module);
+}
+
+const std::vector<CallGraph::CallSite>& CallGraph::callSites(const std::string& callee) const {
+    static const std::vector<CallSite> none;
+    auto it = call_sites_.find(callee);
+    return it != call_sites_.end() ? it->second : none;
+}
+
+const std::set<std::string>& CallGraph::callees(const std::string& caller) const {
+    static const std::set<std::string> none;
+    auto it = callees_.find(caller);
+    return it != callees_.end() ? it->second : none;
+}
+
+void CallGraph::computeSCCs(const Module& module) {
+    // Tarjan's algorithm; components are emitted callees-first.
+    std::map<std::string, int> index, lowlink;
+    std::set<std::string> onStack;
+    std::vector<Function*> stack;
+    int counter = 0;
+
+    std::function<void(Function*)> visit = [&](Function* func) {
+        index[func->name] = lowlink[func->name] = counter++;
+        stack.push_back(func);
+        onStack.insert(func->name);
+        for (const auto& calleeName : callees(func->name)) {
+            Function* callee = module.getFunction(calleeName);
+            if (!callee) continue;
+            if (!index.count(calleeName)) {
+                visit(callee);
+                lowlink[func->name] = std::min(lowlink[func->name], lowlink[calleeName]);
+            } else if (onStack.count(calleeName)) {
+                lowlink[func->name] = std::min(lowlink[func->name], index[calleeName]);
+            }
+        }
+        if (lowlink[func->name] == index[func->name]) {
+            std::vector<Function*> scc;
+            Function* member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack.erase(member->name);
+                scc.push_back(member);
+            } while (member != func);
+            if (scc.size() > 1 || callees(func->name).count(func->name)) {
+                for (Function* f : scc) recursive_.insert(f->name);
+            }
+            sccs_.push_back(std::move(scc));
+        }
+    };
+
+    for (const auto& func : module.functions) {
+        if (!index.count(func->name)) visit(func.get());
+    }
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,44 @@
+#pragma once
+#include "ir.hpp"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Whole-module call graph built from `CallInst`s. Callees without a
+// definition in the module (the runtime builtins) appear only by name.
+class CallGraph {
+public:
+    struct CallSite {
+        Function* caller;
+        CallInst* call;
+    };
+
+    explicit CallGraph(const Module& module);
+
+    const std::vector<CallSite>& callSites(const std::string& callee) const;
+    const std::set<std::string>& callees(const std::string& caller) const;
+    // Functions referenced as values (e.g. passed to the runtime) may be called
+    // from outside, so their signatures must stay intact.
+    bool isAddressTaken(const std::string& name) const { return address_taken_.count(name) > 0; }
+
+    // Strongly connected components in bottom-up order: callees before callers.
+    const std::vector<std::vector<Function*>>& sccs() const { return sccs_; }
+    // True if `name` can reach itself through calls.
+    bool isRecursive(const std::string& name) const { return recursive_.count(name) > 0; }
+
+private:
+    std::map<std::string, std::vector<CallSite>> call_sites_;
+    std::map<std::string, std::set<std::string>> callees_;
+    std::set<std::string> address_taken_;
+    std::vector<std::vector<Function*>> sccs_;
+    std::set<std::string> recursive_;
+
+    void computeSCCs(const Module& module);
+};
+
+} // namespace ir
+} // namespace kotlin_lite
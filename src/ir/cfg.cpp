@@ -0,0 +1,169 @@
+#include "cfg.hpp"
+#include <algorithm>
+
+namespace kotlin_lite {
+namespace ir {
+
+CFG::CFG(const Function& func) {
+    if (func.blocks.empty()) return;
+
+    for (const auto& bb : func.blocks) {
+        preds_[bb.get()];
+        for (BasicBlock* succ : bb->getSuccessors()) preds_[succ].push_back(bb.get());
+    }
+
+    // Iterative DFS for the post-order
+    std::vector<BasicBlock*> postOrder;
+    std::set<BasicBlock*> visited;
+    std::vector<std::pair<BasicBlock*, size_t>> stack;
+    BasicBlock* entry = func.blocks.front().get();
+    stack.push_back({entry, 0});
+    visited.insert(entry);
+    while (!stack.empty()) {
+        auto& [bb, next] = stack.back();
+        auto succs = bb->getSuccessors();
+        if (next < succs.size()) {
+            BasicBlock* succ = succs[next++];
+            if (visited.insert(succ).second) stack.push_back({succ, 0});
+        } else {
+            postOrder.push_back(bb);
+            stack.pop_back();
+        }
+    }
+    rpo_.assign(postOrder.rbegin(), postOrder.rend());
+    for (size_t i = 0; i < rpo_.size(); ++i) order_[rpo_[i]] = i;
+
+    // Cooper, Harvey & Kennedy: iterate to a fixed point over the RPO
+    idom_[entry] = entry;
+    auto intersect = [&](BasicBlock* a, BasicBlock* b) {
+        while (a != b) {
+            while (order_[a] > order_[b]) a = idom_[a];
+            while (order_[b] > order_[a]) b = idom_[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo_.size(); ++i) {
+            BasicBlock* bb = rpo_[i];
+            BasicBlock* newIdom = nullptr;
+            for (BasicBlock* pred : preds_[bb]) {
+                if (!idom_.count(pred)) continue;
+                newIdom = newIdom ? intersect(pred, newIdom) : pred;
+            }
+            if (newIdom && idom_[bb] != newIdom) {
+                idom_[bb] = newIdom;
+                changed = true;
+            }
+        }
+    }
+}
+
+const std::vector<BasicBlock*>& CFG::predecessors(BasicBlock* bb) const {
+    static const std::vector<BasicBlock*> none;
+    auto it = preds_.find(bb);
+    return it != preds_.end() ? it->second : none;
+}
+
+BasicBlock* CFG::idom(BasicBlock* bb) const {
+    auto it = idom_.find(bb);
+    if (it == idom_.end() || it->second == bb) return nullptr;
+    return it->second;
+}
+
+bool CFG::dominates(BasicBlock* a, BasicBlock* b) const {
+    if (!isReachable(a) || !isReachable(b)) return false;
+    while (b) {
+        if (a == b) return true;
+        b = idom(b);
+    }
+    return false;
+}
+
+std::vector<BasicBlock*> Loop::exitBlocks() const {
+    std::vector<BasicBlock*> exits;
+    for (BasicBlock* bb : blocks) {
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            if (!contains(succ) && std::find(exits.begin(), exits.end(), succ) == exits.end()) exits.push_back(succ);
+        }
+    }
+    return exits;
+}
+
+BasicBlock* Loop::preheader(const CFG& cfg) const {
+    BasicBlock* result = nullptr;
+    for (BasicBlock* pred : cfg.predecessors(header)) {
+        if (contains(pred)) continue;
+        if (result) return nullptr;
+        result = pred;
+    }
+    return result;
+}
+
+LoopInfo::LoopInfo(const Function&, const CFG& cfg) {
+    // Back edges are edges into a block that dominates their source
+    std::map<BasicBlock*, Loop*> byHeader;
+    for (BasicBlock* bb : cfg.reversePostOrder()) {
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            if (!cfg.dominates(succ, bb)) continue;
+            Loop*& loop = byHeader[succ];
+            if (!loop) {
+                loops_.push_back(std::make_unique<Loop>());
+                loop = loops_.back().get();
+                loop->header = succ;
+                loop->blocks.insert(succ);
+            }
+            loop->latches.push_back(bb);
+            std::vector<BasicBlock*> work = {bb};
+            while (!work.empty()) {
+                BasicBlock* cur = work.back();
+                work.pop_back();
+                if (!loop->blocks.insert(cur).second) continue;
+                for (BasicBlock* pred : cfg.predecessors(cur)) {
+                    if (cfg.isReachable(pred)) work.push_back(pred);
+                }
+            }
+        }
+    }
+
+    // Nest loops: the parent is the smallest other loop containing the header
+    for (auto& loop : loops_) {
+        for (auto& other : loops_) {
+            if (other.get() == loop.get() || !other->contains(loop->header)) continue;
+            if (other->blocks.size() <= loop->blocks.size()) continue;
+            if (!loop->parent || other->blocks.size() < loop->parent->blocks.size()) loop->parent = other.get();
+        }
+    }
+    for (auto& loop : loops_) {
+        if (loop->parent) loop->parent->children.push_back(loop.get());
+        for (Loop* p = loop->parent; p; p = p->parent) loop->depth++;
+    }
+    for (auto& loop : loops_) {
+        for (BasicBlock* bb : loop->blocks) {
+            Loop*& inner = innermost_[bb];
+            if (!inner || inner->depth < loop->depth) inner = loop.get();
+        }
+    }
+}
+
+std::vector<Loop*> LoopInfo::topLevelLoops() const {
+    std::vector<Loop*> result;
+    for (const auto& loop : loops_) {
+        if (!loop->parent) result.push_back(loop.get());
+    }
+    return result;
+}
+
+Loop* LoopInfo::loopFor(BasicBlock* bb) const {
+    auto it = innermost_.find(bb);
+    return it != innermost_.end() ? it->second : nullptr;
+}
+
+int LoopInfo::loopDepth(BasicBlock* bb) const {
+    Loop* loop = loopFor(bb);
+    return loop ? loop->depth : 0;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,62 @@
+#pragma once
+#include "ir.hpp"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Predecessors, reverse post-order and dominators of one function.
+// Blocks unreachable from the entry have no dominator information.
+class CFG {
+public:
+    explicit CFG(const Function& func);
+
+    const std::vector<BasicBlock*>& reversePostOrder() const { return rpo_; }
+    const std::vector<BasicBlock*>& predecessors(BasicBlock* bb) const;
+    bool isReachable(BasicBlock* bb) const { return order_.count(bb) > 0; }
+
+    BasicBlock* idom(BasicBlock* bb) const;
+    bool dominates(BasicBlock* a, BasicBlock* b) const;
+
+private:
+    std::vector<BasicBlock*> rpo_;
+    std::map<BasicBlock*, size_t> order_;
+    std::map<BasicBlock*, std::vector<BasicBlock*>> preds_;
+    std::map<BasicBlock*, BasicBlock*> idom_;
+};
+
+// A natural loop: the header plus every block that reaches a back edge to it
+// without passing through the header.
+struct Loop {
+    BasicBlock* header = nullptr;
+    std::set<BasicBlock*> blocks;
+    std::vector<BasicBlock*> latches;
+    Loop* parent = nullptr;
+    std::vector<Loop*> children;
+    int depth = 1;
+
+    bool contains(BasicBlock* bb) const { return blocks.count(bb) > 0; }
+    // Blocks outside the loop that are targets of edges leaving it
+    std::vector<BasicBlock*> exitBlocks() const;
+    // The unique block outside the loop branching to the header, if any
+    BasicBlock* preheader(const CFG& cfg) const;
+};
+
+class LoopInfo {
+public:
+    LoopInfo(const Function& func, const CFG& cfg);
+
+    const std::vector<std::unique_ptr<Loop>>& loops() const { return loops_; }
+    std::vector<Loop*> topLevelLoops() const;
+    Loop* loopFor(BasicBlock* bb) const;
+    int loopDepth(BasicBlock* bb) const;
+
+private:
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::map<BasicBlock*, Loop*> innermost_;
+};
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,75 @@
+#include "function_attrs.hpp"
+#include "builtins.hpp"
+#include "cfg.hpp"
+#include <set>
+
+namespace kotlin_lite {
+namespace ir {
+
+FunctionAttrs::FunctionAttrs(const Module& module) {
+    CallGraph cg(module);
+
+    // Bottom-up over SCCs so callee facts are known before their callers
+    for (const auto& scc : cg.sccs()) {
+        std::set<std::string> members;
+        for (Function* func : scc) members.insert(func->name);
+
+        FunctionEffects sccEffects;
+        sccEffects.willReturn = true;
+        for (Function* func : scc) {
+            CFG cfg(*func);
+            LoopInfo loops(*func, cfg);
+            if (!loops.loops().empty()) sccEffects.willReturn = false;
+            if (cg.isRecursive(func->name)) sccEffects.willReturn = false;
+            if (func->memoize) sccEffects.writesMemory = true;
+            for (const auto& bb : func->blocks) {
+                for (const auto& inst : bb->instructions) {
+                    auto call = dynamic_cast<const CallInst*>(inst.get());
+                    if (call && call->parallel) {
+                        sccEffects.writesMemory = true;
+                        sccEffects.noFree = false;
+                    }
+                }
+            }
+
+            for (const auto& callee : cg.callees(func->name)) {
+                if (members.count(callee)) continue;
+                if (auto builtin = findBuiltin(callee)) {
+                    if (builtin->hasIOEffects) sccEffects.hasIO = true;
+                    continue;
+                }
+                auto it = effects_.find(callee);
+                if (it == effects_.end()) {
+                    // Unknown external code: assume the worst
+                    sccEffects.hasIO = true;
+                    sccEffects.noUnwind = false;
+                    sccEffects.noFree = false;
+                    sccEffects.willReturn = false;
+                    sccEffects.writesMemory = true;
+                    continue;
+                }
+                sccEffects.hasIO |= it->second.hasIO;
+                sccEffects.noUnwind &= it->second.noUnwind;
+                sccEffects.noFree &= it->second.noFree;
+                sccEffects.willReturn &= it->second.willReturn;
+                sccEffects.writesMemory |= it->second.writesMemory;
+            }
+        }
+        sccEffects.readNone = !sccEffects.hasIO && !sccEffects.writesMemory;
+
+        for (Function* func : scc) {
+            FunctionEffects effects = sccEffects;
+            effects.noRecurse = !cg.isRecursive(func->name);
+            effects_[func->name] = effects;
+        }
+    }
+}
+
+const FunctionEffects& FunctionAttrs::get(const std::string& name) const {
+    static const FunctionEffects unknown{true, false, false, false, false, false, true};
+    auto it = effects_.find(name);
+    return it != effects_.end() ? it->second : unknown;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,35 @@
+#pragma once
+#include "ir.hpp"
+#include "call_graph.hpp"
+#include <map>
+#include <string>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Facts about a function derived from the call graph, used to annotate the
+// generated LLVM functions.
+struct FunctionEffects {
+    bool hasIO = false;       // calls a print_* builtin, directly or transitively
+    bool readNone = false;    // no memory or I/O effects at all
+    bool noUnwind = true;
+    bool willReturn = false;  // no loops, no recursion, only returning callees
+    bool noRecurse = false;
+    bool noFree = true;
+    // Updates a @Memoize cache or runs a parallel loop (the runtime locks,
+    // allocates and writes its own globals), directly or transitively
+    bool writesMemory = false;
+};
+
+class FunctionAttrs {
+public:
+    explicit FunctionAttrs(const Module& module);
+
+    const FunctionEffects& get(const std::string& name) const;
+
+private:
+    std::map<std::string, FunctionEffects> effects_;
+};
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -1,10 +1,35 @@
 #include "ir.hpp"
+#include "statistics.hpp"
 #include <sstream>
+#include <algorithm>
 
 namespace kotlin_lite {
 namespace ir {
 
-std::string BinaryInst::dump() const {
+KL_STATISTIC(ConstantsAllocated, "ir", "Constants allocated");
+// Counted by IRBuilder, whose code is all in its header
+Statistic BuilderInstructions("ir", "BuilderInstructions", "Instructions created through IRBuilder");
+
+Constant::Constant(Type t, int64_t v) : type(t), value(normalize(t, v)) {
+    ++ConstantsAllocated;
+}
+
+int64_t Constant::normalize(Type t, int64_t v) {
+    unsigned width = bitWidth(t);
+    if (width == 1) return v != 0;
+    if (width == 0 || width == 64) return v;
+    uint64_t bits = static_cast<uint64_t>(v) & ((uint64_t(1) << width) - 1);
+    uint64_t sign = uint64_t(1) << (width - 1);
+    return static_cast<int64_t>((bits ^ sign) - sign);
+}
+
+uint64_t Constant::unsignedValue() const {
+    unsigned width = bitWidth(type);
+    if (width == 0 || width == 64) return static_cast<uint64_t>(value);
+    return static_cast<uint64_t>(value) & ((uint64_t(1) << width) - 1);
+}
+
+std::string BinaryInst::opName(OpKind kind) {
     std::string op;
     switch (kind) {
         case OpKind::Add: op = "add"; break;
@@ -12,28 +37,59 @@ std::string BinaryInst::dump() const {
         case OpKind::Mul: op = "mul"; break;
         case OpKind::SDiv: op = "sdiv"; break;
         case OpKind::SRem: op = "srem"; break;
+        case OpKind::Shl: op = "shl"; break;
+        case OpKind::UDiv: op = "udiv"; break;
+        case OpKind::URem: op = "urem"; break;
+        case OpKind::LShr: op = "lshr"; break;
         case OpKind::ICmpEq: op = "icmp eq"; break;
         case OpKind::ICmpNe: op = "icmp ne"; break;
         case OpKind::ICmpLt: op = "icmp lt"; break;
         case OpKind::ICmpLe: op = "icmp le"; break;
         case OpKind::ICmpGt: op = "icmp gt"; break;
         case OpKind::ICmpGe: op = "icmp ge"; break;
+        case OpKind::ICmpULt: op = "icmp ult"; break;
+        case OpKind::ICmpULe: op = "icmp ule"; break;
+        case OpKind::ICmpUGt: op = "icmp ugt"; break;
+        case OpKind::ICmpUGe: op = "icmp uge"; break;
         default: op = "unknown"; break;
     }
-    return getName() + " = " + op + " " + to_string(left->getType()) + " " + left->getName() + ", " + right->getName();
+    return op;
+}
+
+std::string BinaryInst::dump() const {
+    return getName() + " = " + opName(kind) + " " + to_string(left->getType()) + " " + left->getName() + ", " + right->getName();
 }
 
 std::string UnaryInst::dump() const {
-    std::string op = (kind == OpKind::Not) ? "not" : "unknown";
-    return getName() + " = " + op + " " + to_string(operand->getType()) + " " + operand->getName();
+    std::string op;
+    switch (kind) {
+        case OpKind::Not: op = "not"; break;
+        case OpKind::ZExt: op = "zext"; break;
+        case OpKind::SExt: op = "sext"; break;
+        case OpKind::Trunc: op = "trunc"; break;
+        default: op = "unknown"; break;
+    }
+    std::string result = getName() + " = " + op + " " + to_string(operand->getType()) + " " + operand->getName();
+    if (kind != OpKind::Not) result += " to " + to_string(type);
+    return result;
 }
 
 std::string PhiInst::dump() const {
     std::string result = getName() + " = phi " + to_string(type) + " ";
-    bool first = true;
+    // Print incomings in block order so the output does not depend on pointer values
+    std::vector<BasicBlock*> order;
+    if (parent && parent->parent) {
+        for (const auto& bb : parent->parent->blocks) {
+            if (incomings.count(bb.get())) order.push_back(bb.get());
+        }
+    }
     for (auto const& [bb, val] : incomings) {
+        if (std::find(order.begin(), order.end(), bb) == order.end()) order.push_back(bb);
+    }
+    bool first = true;
+    for (BasicBlock* bb : order) {
         if (!first) result += ", ";
-        result += "[ " + val->getName() + ", %" + bb->label + " ]";
+        result += "[ " + incomings.at(bb)->getName() + ", %" + bb->label + " ]";
         first = false;
     }
     return result;
@@ -50,6 +106,11 @@ std::string CallInst::dump() const {
         result += to_string(args[i]->getType()) + " " + args[i]->getName();
     }
     result += ")";
+    if (parallel) {
+        // "icmp lt" -> "lt"
+        std::string predicate = BinaryInst::opName(parallel->predicate).substr(5);
+        result += " parallel(" + BinaryInst::opName(parallel->reduction) + ", " + predicate + ", " + std::to_string(parallel->step) + ")";
+    }
     return result;
 }
 
@@ -58,7 +119,11 @@ std::string BranchInst::dump() const {
 }
 
 std::string CondBranchInst::dump() const {
-    return "condbr i1 " + condition->getName() + ", label %" + thenBB->label + ", label %" + elseBB->label;
+    std::string result = "condbr i1 " + condition->getName() + ", label %" + thenBB->label + ", label %" + elseBB->label;
+    if (weights) {
+        result += " weights(" + std::to_string(weights->thenCount) + ", " + std::to_string(weights->elseCount) + ")";
+    }
+    return result;
 }
 
 std::string ReturnInst::dump() const {
@@ -68,6 +133,116 @@ std::string ReturnInst::dump() const {
     return "ret void";
 }
 
+std::vector<BasicBlock*> BasicBlock::getSuccessors() const {
+    Instruction* term = getTerminator();
+    if (!term) return {};
+    if (term->kind == Instruction::OpKind::Br) {
+        return {static_cast<BranchInst*>(term)->target};
+    }
+    if (term->kind == Instruction::OpKind::CondBr) {
+        auto cbr = static_cast<CondBranchInst*>(term);
+        if (cbr->thenBB == cbr->elseBB) return {cbr->thenBB};
+        return {cbr->thenBB, cbr->elseBB};
+    }
+    return {};
+}
+
+void BasicBlock::replaceSuccessor(BasicBlock* from, BasicBlock* to) {
+    Instruction* term = getTerminator();
+    if (!term) return;
+    if (term->kind == Instruction::OpKind::Br) {
+        auto br = static_cast<BranchInst*>(term);
+        if (br->target == from) br->target = to;
+    } else if (term->kind == Instruction::OpKind::CondBr) {
+        auto cbr = static_cast<CondBranchInst*>(term);
+        if (cbr->thenBB == from) cbr->thenBB = to;
+        if (cbr->elseBB == from) cbr->elseBB = to;
+    }
+}
+
+void Function::replaceAllUsesWith(Value* from, Value* to) {
+    for (auto& bb : blocks) {
+        for (auto& inst : bb->instructions) {
+            inst->replaceUsesOfWith(from, to);
+        }
+    }
+}
+
+int Function::nextFreeId() const {
+    int next = 0;
+    for (const auto& bb : blocks) {
+        for (const auto& inst : bb->instructions) {
+            if (inst->id.empty()) continue;
+            bool numeric = true;
+            for (char c : inst->id) {
+                if (c < '0' || c > '9') { numeric = false; break; }
+            }
+            if (numeric) next = std::max(next, std::stoi(inst->id) + 1);
+        }
+    }
+    return next;
+}
+
+size_t Function::instructionCount() const {
+    size_t count = 0;
+    for (const auto& bb : blocks) count += bb->instructions.size();
+    return count;
+}
+
+std::unique_ptr<Function> Function::clone(std::string newName) const {
+    auto copy = std::make_unique<Function>(std::move(newName), returnType, args);
+    copy->line = line;
+    copy->entryCount = entryCount;
+    copy->alwaysInline = alwaysInline;
+    copy->noInline = noInline;
+    copy->hot = hot;
+    copy->cold = cold;
+    copy->memoize = memoize;
+    copy->tailrec = tailrec;
+    std::map<const Value*, Value*> valueMap;
+    std::map<BasicBlock*, BasicBlock*> blockMap;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (!args[i].ssaValue) continue;
+        auto argVal = new ArgumentValue(args[i].name, args[i].type);
+        copy->args[i].ssaValue = argVal;
+        valueMap[args[i].ssaValue] = argVal;
+    }
+    for (const auto& bb : blocks) {
+        blockMap[bb.get()] = copy->createBlock(bb->label);
+        blockMap[bb.get()]->profileCount = bb->profileCount;
+        blockMap[bb.get()]->loopHints = bb->loopHints;
+    }
+    for (const auto& bb : blocks) {
+        BasicBlock* newBB = blockMap[bb.get()];
+        for (const auto& inst : bb->instructions) {
+            auto newInst = inst->clone();
+            valueMap[inst.get()] = newInst.get();
+            newBB->addInstruction(std::move(newInst));
+        }
+    }
+
+    // Remap operands and block references onto the copy
+    for (const auto& [oldBB, newBB] : blockMap) {
+        for (auto& inst : newBB->instructions) {
+            for (Value* op : inst->getOperands()) {
+                auto it = valueMap.find(op);
+                if (it != valueMap.end()) inst->replaceUsesOfWith(op, it->second);
+            }
+            if (inst->kind == Instruction::OpKind::Phi) {
+                auto phi = static_cast<PhiInst*>(inst.get());
+                std::map<BasicBlock*, Value*> remapped;
+                for (auto const& [pred, val] : phi->incomings) remapped[blockMap.count(pred) ? blockMap[pred] : pred] = val;
+                phi->incomings = std::move(remapped);
+            }
+        }
+        for (BasicBlock* succ : newBB->getSuccessors()) {
+            if (blockMap.count(succ)) newBB->replaceSuccessor(succ, blockMap[succ]);
+        }
+    }
+    return copy;
+}
+
 std::string Module::dump() const {
     std::stringstream ss;
     for (const auto& func : functions) {
@@ -76,10 +251,28 @@ std::string Module::dump() const {
             if (i > 0) ss << ", ";
             ss << to_string(func->args[i].type) << " %" << func->args[i].name;
         }
-        ss << ") {\n";
+        ss << ")";
+        if (func->alwaysInline) ss << " alwaysinline";
+        if (func->noInline) ss << " noinline";
+        if (func->hot) ss << " hot";
+        if (func->cold) ss << " cold";
+        if (func->memoize) {
+            ss << " memoize";
+            if (*func->memoize) ss << "(" << *func->memoize << ")";
+        }
+        if (func->tailrec) ss << " tailrec";
+        ss << " {\n";
 
         for (const auto& bb : func->blocks) {
-            ss << bb->label << ":\n";
+            ss << bb->label << ":";
+            auto hint = [&](const char* name, const std::optional<unsigned>& value) {
+                if (!value) return;
+                ss << " " << name;
+                if (*value) ss << "(" << *value << ")";
+            };
+            hint("unroll", bb->loopHints.unroll);
+            hint("vectorize", bb->loopHints.vectorize);
+            ss << "\n";
             for (const auto& inst : bb->instructions) {
                 ss << "  " << inst->dump() << "\n";
             }
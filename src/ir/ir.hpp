@@ -4,14 +4,22 @@
 #include <memory>
 #include <list>
 #include <map>
+#include <set>
+#include <optional>
 
 namespace kotlin_lite {
 namespace ir {
 
+// Integer types carry no sign, as in LLVM: whether a value is signed is up
+// to the instructions that use it (sdiv or udiv, icmp lt or icmp ult, sext
+// or zext).
 enum class Type {
     I32,
     I1,
-    Void
+    Void,
+    I8,
+    I16,
+    I64
 };
 
 inline std::string to_string(Type type) {
@@ -19,10 +27,25 @@ inline std::string to_string(Type type) {
         case Type::I32: return "i32";
         case Type::I1: return "i1";
         case Type::Void: return "void";
+        case Type::I8: return "i8";
+        case Type::I16: return "i16";
+        case Type::I64: return "i64";
         default: return "unknown";
     }
 }
 
+// Width in bits; 0 for void
+inline unsigned bitWidth(Type type) {
+    switch (type) {
+        case Type::I1: return 1;
+        case Type::I8: return 8;
+        case Type::I16: return 16;
+        case Type::I32: return 32;
+        case Type::I64: return 64;
+        default: return 0;
+    }
+}
+
 class BasicBlock;
 class Function;
 
@@ -38,11 +61,18 @@ public:
 class Constant : public Value {
 public:
     Type type;
-    int32_t value;
+    // Truncated to the type's width and sign-extended back, so each bit
+    // pattern has one value; an i1 is 0 or 1
+    int64_t value;
 
-    Constant(Type t, int32_t v) : type(t), value(v) {}
+    Constant(Type t, int64_t v);
     std::string getName() const override { return std::to_string(value); }
     Type getType() const override { return type; }
+
+    // The same bits read as an unsigned number of the type's width
+    uint64_t unsignedValue() const;
+    // `v` as a constant of type `t` would hold it
+    static int64_t normalize(Type t, int64_t v);
 };
 
 class ArgumentValue : public Value {
@@ -60,9 +90,11 @@ class Instruction : public Value {
 public:
     enum class OpKind {
         // Value producing
-        Add, Sub, Mul, SDiv, SRem,
-        ICmpEq, ICmpNe, ICmpLt, ICmpLe, ICmpGt, ICmpGe,
+        Add, Sub, Mul, SDiv, SRem, Shl, UDiv, URem, LShr,
+        ICmpEq, ICmpNe, ICmpLt, ICmpLe, ICmpGt, ICmpGe, ICmpULt, ICmpULe, ICmpUGt, ICmpUGe,
         Not,
+        // Integer casts to the instruction's type
+        ZExt, SExt, Trunc,
         Phi,
         Call,
         // Terminators
@@ -75,6 +107,11 @@ public:
     Type type;
     std::string id;
     BasicBlock* parent;
+    // Source position the instruction was lowered from; 0 if unknown
+    int line = 0;
+    int column = 0;
+    // Source variable this value was assigned to, for debug info; empty if none
+    std::string variable;
 
     Instruction(OpKind k, Type t, std::string i, BasicBlock* p = nullptr)
         : kind(k), type(t), id(std::move(i)), parent(p) {}
@@ -82,6 +119,21 @@ public:
     std::string getName() const override { return "%" + id; }
     Type getType() const override { return type; }
     virtual std::string dump() const = 0;
+
+    // Operand access used by analyses and transforms
+    virtual std::vector<Value*> getOperands() const { return {}; }
+    virtual void replaceUsesOfWith(Value*, Value*) {}
+    // Copy with the same id, operands and source position; the caller remaps the operands
+    std::unique_ptr<Instruction> clone() const {
+        auto copy = cloneInstruction();
+        copy->line = line;
+        copy->column = column;
+        copy->variable = variable;
+        return copy;
+    }
+
+protected:
+    virtual std::unique_ptr<Instruction> cloneInstruction() const = 0;
 };
 
 // --- Specific Instructions ---
@@ -94,7 +146,15 @@ public:
     BinaryInst(OpKind k, Type t, std::string id, Value* l, Value* r)
         : Instruction(k, t, std::move(id)), left(l), right(r) {}
 
+    // "add", "icmp lt", ...
+    static std::string opName(OpKind kind);
     std::string dump() const override;
+    std::unique_ptr<Instruction> cloneInstruction() const override { return std::make_unique<BinaryInst>(kind, type, id, left, right); }
+    std::vector<Value*> getOperands() const override { return {left, right}; }
+    void replaceUsesOfWith(Value* from, Value* to) override {
+        if (left == from) left = to;
+        if (right == from) right = to;
+    }
 };
 
 class UnaryInst : public Instruction {
@@ -105,6 +165,11 @@ public:
         : Instruction(k, t, std::move(id)), operand(op) {}
 
     std::string dump() const override;
+    std::unique_ptr<Instruction> cloneInstruction() const override { return std::make_unique<UnaryInst>(kind, type, id, operand); }
+    std::vector<Value*> getOperands() const override { return {operand}; }
+    void replaceUsesOfWith(Value* from, Value* to) override {
+        if (operand == from) operand = to;
+    }
 };
 
 class PhiInst : public Instruction {
@@ -116,18 +181,64 @@ public:
         : Instruction(OpKind::Phi, t, std::move(id)) {}
 
     void addIncoming(BasicBlock* bb, Value* val) { incomings[bb] = val; }
+    void replaceIncomingBlock(BasicBlock* from, BasicBlock* to) {
+        auto it = incomings.find(from);
+        if (it == incomings.end()) return;
+        Value* val = it->second;
+        incomings.erase(it);
+        incomings[to] = val;
+    }
     std::string dump() const override;
+    std::unique_ptr<Instruction> cloneInstruction() const override {
+        auto phi = std::make_unique<PhiInst>(type, id);
+        phi->incomings = incomings;
+        return phi;
+    }
+    std::vector<Value*> getOperands() const override {
+        std::vector<Value*> ops;
+        for (auto const& [bb, val] : incomings) ops.push_back(val);
+        return ops;
+    }
+    void replaceUsesOfWith(Value* from, Value* to) override {
+        for (auto& [bb, val] : incomings) {
+            if (val == from) val = to;
+        }
+    }
 };
 
 class CallInst : public Instruction {
 public:
+    // Marks a call that replaced a loop (see AutoParallelization). The callee
+    // runs the loop for an induction variable going from args[0] by `step`
+    // while `iv predicate args[1]` holds, and returns the loop's reduction
+    // combined with `reduction` (add or mul) from its identity. A backend may
+    // split that range into chunks run on several threads and combine their
+    // results; calling the function once over the whole range is equivalent.
+    struct ParallelLoop {
+        OpKind reduction;
+        OpKind predicate;
+        int32_t step;
+    };
+
     std::string callee;
     std::vector<Value*> args;
+    std::optional<ParallelLoop> parallel;
 
     CallInst(Type t, std::string id, std::string name, std::vector<Value*> a)
         : Instruction(OpKind::Call, t, std::move(id)), callee(std::move(name)), args(std::move(a)) {}
 
     std::string dump() const override;
+    std::unique_ptr<Instruction> cloneInstruction() const override {
+        auto call = std::make_unique<CallInst>(type, id, callee, args);
+        call->parallel = parallel;
+        return call;
+    }
+    std::vector<Value*> getOperands() const override { return args; }
+    void replaceUsesOfWith(Value* from, Value* to) override {
+        for (auto& arg : args) {
+            if (arg == from) arg = to;
+        }
+    }
 };
 
 class BranchInst : public Instruction {
@@ -138,18 +249,37 @@ public:
         : Instruction(OpKind::Br, Type::Void, ""), target(t) {}
 
     std::string dump() const override;
+    std::unique_ptr<Instruction> cloneInstruction() const override { return std::make_unique<BranchInst>(target); }
 };
 
 class CondBranchInst : public Instruction {
 public:
+    // How often each edge was taken in the --profile-use profile, or
+    // kLikelyWeight to 1 for an `@Likely` / `@Unlikely` condition
+    static constexpr uint64_t kLikelyWeight = 2000;
+    struct BranchWeights {
+        uint64_t thenCount;
+        uint64_t elseCount;
+    };
+
     Value* condition;
     BasicBlock* thenBB;
     BasicBlock* elseBB;
+    std::optional<BranchWeights> weights;
 
     CondBranchInst(Value* cond, BasicBlock* t, BasicBlock* e)
         : Instruction(OpKind::CondBr, Type::Void, ""), condition(cond), thenBB(t), elseBB(e) {}
 
     std::string dump() const override;
+    std::unique_ptr<Instruction> cloneInstruction() const override {
+        auto cbr = std::make_unique<CondBranchInst>(condition, thenBB, elseBB);
+        cbr->weights = weights;
+        return cbr;
+    }
+    std::vector<Value*> getOperands() const override { return {condition}; }
+    void replaceUsesOfWith(Value* from, Value* to) override {
+        if (condition == from) condition = to;
+    }
 };
 
 class ReturnInst : public Instruction {
@@ -160,15 +290,36 @@ public:
         : Instruction(OpKind::Ret, Type::Void, ""), value(val) {}
 
     std::string dump() const override;
+    std::unique_ptr<Instruction> cloneInstruction() const override { return std::make_unique<ReturnInst>(value); }
+    std::vector<Value*> getOperands() const override {
+        if (value) return {value};
+        return {};
+    }
+    void replaceUsesOfWith(Value* from, Value* to) override {
+        if (value == from) value = to;
+    }
 };
 
 // --- Containers ---
 
+// `@Unroll` / `@Vectorize` on the loop a block heads. A value of 0 enables the
+// transform and leaves the count or width to LLVM; 1 disables it.
+struct LoopHints {
+    std::optional<unsigned> unroll;
+    std::optional<unsigned> vectorize;
+
+    bool empty() const { return !unroll && !vectorize; }
+};
+
 class BasicBlock {
 public:
     std::string label;
     Function* parent;
     std::list<std::unique_ptr<Instruction>> instructions;
+    // Executions in the --profile-use profile; unset without a profile
+    std::optional<uint64_t> profileCount;
+    // Set on loop headers only
+    LoopHints loopHints;
 
     explicit BasicBlock(std::string l, Function* p = nullptr)
         : label(std::move(l)), parent(p) {}
@@ -178,6 +329,23 @@ public:
         instructions.push_back(std::move(inst));
     }
 
+    void insertInstruction(std::list<std::unique_ptr<Instruction>>::iterator pos, std::unique_ptr<Instruction> inst) {
+        inst->parent = this;
+        instructions.insert(pos, std::move(inst));
+    }
+
+    std::list<std::unique_ptr<Instruction>>::iterator find(const Instruction* inst) {
+        for (auto it = instructions.begin(); it != instructions.end(); ++it) {
+            if (it->get() == inst) return it;
+        }
+        return instructions.end();
+    }
+
+    void eraseInstruction(const Instruction* inst) {
+        auto it = find(inst);
+        if (it != instructions.end()) instructions.erase(it);
+    }
+
     Instruction* getTerminator() const {
         if (instructions.empty()) return nullptr;
         Instruction* last = instructions.back().get();
@@ -188,6 +356,10 @@ public:
         }
         return nullptr;
     }
+
+    std::vector<BasicBlock*> getSuccessors() const;
+    // Retargets the terminator's edges from `from` to `to`
+    void replaceSuccessor(BasicBlock* from, BasicBlock* to);
 };
 
 struct Argument {
@@ -202,6 +374,20 @@ public:
     Type returnType;
     std::vector<Argument> args;
     std::list<std::unique_ptr<BasicBlock>> blocks;
+    // Source line of the declaration; 0 if unknown
+    int line = 0;
+    // Calls in the --profile-use profile; unset without a profile
+    std::optional<uint64_t> entryCount;
+    // From `@AlwaysInline`, `@NoInline`, `@Hot` and `@Cold`
+    bool alwaysInline = false;
+    bool noInline = false;
+    bool hot = false;
+    bool cold = false;
+    // From `@Memoize`: the result cache's capacity, 0 for the compiler's default
+    std::optional<unsigned> memoize;
+    // From the `tailrec` modifier: its tail calls are eliminated even when the
+    // custom passes are off
+    bool tailrec = false;
 
     Function(std::string n, Type ret, std::vector<Argument> a)
         : name(std::move(n)), returnType(ret), args(std::move(a)) {}
@@ -209,10 +395,30 @@ public:
     std::string getName() const override { return "@" + name; }
     Type getType() const override { return returnType; }
 
+    // Labels are made unique within the function: if.then, if.then1, ...
     BasicBlock* createBlock(std::string label) {
-        blocks.push_back(std::make_unique<BasicBlock>(std::move(label), this));
+        std::string unique = label;
+        int& suffix = label_suffix_[label];
+        while (!labels_.insert(unique).second) unique = label + std::to_string(++suffix);
+        blocks.push_back(std::make_unique<BasicBlock>(std::move(unique), this));
         return blocks.back().get();
     }
+
+    // Rewrites every operand equal to `from` into `to` across all blocks.
+    void replaceAllUsesWith(Value* from, Value* to);
+
+    // First numeric instruction id not yet used in this function; transforms
+    // seed an IRBuilder with it so that new values get unique names.
+    int nextFreeId() const;
+
+    size_t instructionCount() const;
+
+    // Deep copy under a new name, with fresh arguments, blocks and instructions.
+    std::unique_ptr<Function> clone(std::string newName) const;
+
+private:
+    std::set<std::string> labels_;
+    std::map<std::string, int> label_suffix_;
 };
 
 class Module {
@@ -223,6 +429,19 @@ public:
         functions.push_back(std::move(func));
     }
 
+    Function* getFunction(const std::string& name) const {
+        for (const auto& func : functions) {
+            if (func->name == name) return func.get();
+        }
+        return nullptr;
+    }
+
+    size_t instructionCount() const {
+        size_t count = 0;
+        for (const auto& func : functions) count += func->instructionCount();
+        return count;
+    }
+
     std::string dump() const;
 };
 
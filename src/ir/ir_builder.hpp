@@ -1,79 +1,164 @@
 #pragma once
 #include "ir.hpp"
+#include "statistics.hpp"
 #include <map>
 
 namespace kotlin_lite {
 namespace ir {
 
+extern Statistic BuilderInstructions;
+
 class IRBuilder {
 public:
     IRBuilder() : next_id_(0) {}
+    explicit IRBuilder(int firstId) : next_id_(firstId) {}
 
     void setInsertPoint(BasicBlock* bb) {
         current_bb_ = bb;
+        insert_before_ = nullptr;
+    }
+
+    // New instructions go in front of `inst` instead of at the end of its
+    // block, and take over its source position.
+    void setInsertPointBefore(Instruction* inst) {
+        current_bb_ = inst->parent;
+        insert_before_ = inst;
+        line_ = inst->line;
+        column_ = inst->column;
     }
 
     BasicBlock* getInsertPoint() const {
         return current_bb_;
     }
 
+    // Source position given to the instructions created from now on
+    void setLocation(int line, int column) {
+        line_ = line;
+        column_ = column;
+    }
+    int getLine() const { return line_; }
+    int getColumn() const { return column_; }
+
     std::string nextId() {
         return std::to_string(next_id_++);
     }
 
     Value* createAdd(Value* l, Value* r) {
-        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::Add, Type::I32, nextId(), l, r);
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::Add, l->getType(), nextId(), l, r);
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
     Value* createSub(Value* l, Value* r) {
-        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::Sub, Type::I32, nextId(), l, r);
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::Sub, l->getType(), nextId(), l, r);
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
     Value* createMul(Value* l, Value* r) {
-        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::Mul, Type::I32, nextId(), l, r);
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::Mul, l->getType(), nextId(), l, r);
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
     Value* createSDiv(Value* l, Value* r) {
-        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::SDiv, Type::I32, nextId(), l, r);
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::SDiv, l->getType(), nextId(), l, r);
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
     Value* createSRem(Value* l, Value* r) {
-        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::SRem, Type::I32, nextId(), l, r);
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::SRem, l->getType(), nextId(), l, r);
+        auto ptr = inst.get();
+        insert(std::move(inst));
+        return ptr;
+    }
+
+    Value* createShl(Value* l, Value* r) {
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::Shl, l->getType(), nextId(), l, r);
+        auto ptr = inst.get();
+        insert(std::move(inst));
+        return ptr;
+    }
+
+    Value* createUDiv(Value* l, Value* r) {
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::UDiv, l->getType(), nextId(), l, r);
+        auto ptr = inst.get();
+        insert(std::move(inst));
+        return ptr;
+    }
+
+    Value* createURem(Value* l, Value* r) {
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::URem, l->getType(), nextId(), l, r);
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
+        return ptr;
+    }
+
+    Value* createLShr(Value* l, Value* r) {
+        auto inst = std::make_unique<BinaryInst>(Instruction::OpKind::LShr, l->getType(), nextId(), l, r);
+        auto ptr = inst.get();
+        insert(std::move(inst));
+        return ptr;
+    }
+
+    // Arithmetic results have the type of their operands
+    Value* createBinary(Instruction::OpKind kind, Value* l, Value* r) {
+        if (kind >= Instruction::OpKind::ICmpEq && kind <= Instruction::OpKind::ICmpUGe) return createICmp(kind, l, r);
+        auto inst = std::make_unique<BinaryInst>(kind, l->getType(), nextId(), l, r);
+        auto ptr = inst.get();
+        insert(std::move(inst));
         return ptr;
     }
 
     Value* createICmp(Instruction::OpKind kind, Value* l, Value* r) {
         auto inst = std::make_unique<BinaryInst>(kind, Type::I1, nextId(), l, r);
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
     Value* createNot(Value* op) {
         auto inst = std::make_unique<UnaryInst>(Instruction::OpKind::Not, Type::I1, nextId(), op);
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
+    // ZExt, SExt or Trunc of `op` to `type`
+    Value* createCast(Instruction::OpKind kind, Value* op, Type type) {
+        auto inst = std::make_unique<UnaryInst>(kind, type, nextId(), op);
+        auto ptr = inst.get();
+        insert(std::move(inst));
+        return ptr;
+    }
+
+    Value* createZExt(Value* op, Type type) { return createCast(Instruction::OpKind::ZExt, op, type); }
+    Value* createSExt(Value* op, Type type) { return createCast(Instruction::OpKind::SExt, op, type); }
+    Value* createTrunc(Value* op, Type type) { return createCast(Instruction::OpKind::Trunc, op, type); }
+
+    // `op` converted to `type`: widened by sign or zero extension, narrowed
+    // by truncation. A constant is converted in place of a cast, and a value
+    // that already has the type is returned as is.
+    Value* createIntCast(Value* op, Type type, bool isSigned) {
+        Type from = op->getType();
+        if (from == type) return op;
+        bool widen = bitWidth(type) > bitWidth(from);
+        if (auto c = dynamic_cast<Constant*>(op)) {
+            return new Constant(type, widen && !isSigned ? static_cast<int64_t>(c->unsignedValue()) : c->value);
+        }
+        if (!widen) return createTrunc(op, type);
+        return isSigned ? createSExt(op, type) : createZExt(op, type);
+    }
+
     PhiInst* createPhi(Type type) {
         auto inst = std::make_unique<PhiInst>(type, nextId());
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
@@ -81,25 +166,42 @@ public:
         std::string id = (retType == Type::Void) ? "" : nextId();
         auto inst = std::make_unique<CallInst>(retType, id, std::move(callee), std::move(args));
         auto ptr = inst.get();
-        current_bb_->addInstruction(std::move(inst));
+        insert(std::move(inst));
         return ptr;
     }
 
     void createBr(BasicBlock* target) {
-        current_bb_->addInstruction(std::make_unique<BranchInst>(target));
+        insert(std::make_unique<BranchInst>(target));
     }
 
-    void createCondBr(Value* cond, BasicBlock* thenBB, BasicBlock* elseBB) {
-        current_bb_->addInstruction(std::make_unique<CondBranchInst>(cond, thenBB, elseBB));
+    CondBranchInst* createCondBr(Value* cond, BasicBlock* thenBB, BasicBlock* elseBB) {
+        auto inst = std::make_unique<CondBranchInst>(cond, thenBB, elseBB);
+        auto ptr = inst.get();
+        insert(std::move(inst));
+        return ptr;
     }
 
     void createRet(Value* val = nullptr) {
-        current_bb_->addInstruction(std::make_unique<ReturnInst>(val));
+        insert(std::make_unique<ReturnInst>(val));
     }
 
 private:
     BasicBlock* current_bb_ = nullptr;
+    Instruction* insert_before_ = nullptr;
     int next_id_;
+    int line_ = 0;
+    int column_ = 0;
+
+    void insert(std::unique_ptr<Instruction> inst) {
+        ++BuilderInstructions;
+        inst->line = line_;
+        inst->column = column_;
+        if (insert_before_) {
+            current_bb_->insertInstruction(current_bb_->find(insert_before_), std::move(inst));
+        } else {
+            current_bb_->addInstruction(std::move(inst));
+        }
+    }
 };
 
 } // namespace ir
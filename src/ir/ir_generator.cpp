@@ -1,38 +1,111 @@
 #include "ir_generator.hpp"
+#include "builtins.hpp"
+#include "statistics.hpp"
+#include <climits>
 #include <stdexcept>
 #include <set>
 
 namespace kotlin_lite {
 namespace ir {
 
+KL_STATISTIC(FunctionsLowered, "irgen", "Functions lowered");
+KL_STATISTIC(IfBlocks, "irgen", "Blocks created for if statements");
+KL_STATISTIC(WhileBlocks, "irgen", "Blocks created for while loops");
+KL_STATISTIC(ShortCircuitBlocks, "irgen", "Blocks created for && and ||");
+KL_STATISTIC(LoopPhis, "irgen", "Phis created in loop headers");
+KL_STATISTIC(MergePhis, "irgen", "Phis created by phiMerge");
+KL_STATISTIC(MergesWithoutPhi, "irgen", "Variables phiMerge found unchanged on every path");
+
 IRGenerator::IRGenerator() {}
 
-std::unique_ptr<Module> IRGenerator::generate(KotlinFile& file) {
-    module_ = std::make_unique<Module>();
+std::unique_ptr<Module> IRGenerator::generate(KotlinFile& file, const std::set<std::string>* liveFunctions) {
+    auto module = std::make_unique<Module>();
+    function_return_types_.clear();
+    function_param_types_.clear();
+    unsigned_functions_.clear();
     for (const auto& func : file.functions) {
-        visitFunction(*func);
+        declareFunction(*func);
+    }
+    // Constants first, in source order, so every use knows the initializer's type
+    constant_types_.clear();
+    unsigned_constants_.clear();
+    for (const auto& constant : file.constants) {
+        if (liveFunctions && !liveFunctions->count("const." + constant->name.value)) continue;
+        module->addFunction(lowerConstant(*constant));
     }
-    return std::move(module_);
+    for (const auto& func : file.functions) {
+        if (liveFunctions && !liveFunctions->count(func->name.value)) continue;
+        module->addFunction(lowerFunction(*func));
+    }
+    return module;
 }
 
-void IRGenerator::visitFunction(FunctionDecl& node) {
+std::unique_ptr<Function> IRGenerator::declareFunction(const FunctionDecl& node) {
     std::vector<Argument> args;
     for (const auto& p : node.parameters) {
         args.push_back({p.name.value, getIRType(p.type)});
     }
-    
+    function_return_types_[node.name.value] = getIRType(node.return_type);
+    auto& params = function_param_types_[node.name.value];
+    params.clear();
+    for (const auto& arg : args) params.push_back(arg.type);
+    if (isUnsigned(node.return_type)) unsigned_functions_.insert(node.name.value);
     auto func = std::make_unique<Function>(node.name.value, getIRType(node.return_type), args);
+    func->line = node.name.line;
+    func->tailrec = node.is_tailrec;
+    for (const auto& annotation : node.annotations) {
+        if (annotation.name.value == "AlwaysInline") func->alwaysInline = true;
+        if (annotation.name.value == "NoInline") func->noInline = true;
+        if (annotation.name.value == "Hot") func->hot = true;
+        if (annotation.name.value == "Cold") func->cold = true;
+        if (annotation.name.value == "Memoize") {
+            func->memoize = annotation.arguments.empty() ? 0 : std::stoul(annotation.arguments.front().value);
+        }
+    }
+    return func;
+}
+
+// The initializer becomes a nullary function; CompileTimeEvaluation folds
+// every call to it and then deletes it.
+std::unique_ptr<Function> IRGenerator::lowerConstant(ConstDecl& node) {
+    auto func = std::make_unique<Function>("const." + node.name.value, Type::Void, std::vector<Argument>{});
+    auto func_ptr = func.get();
+
+    builder_.setInsertPoint(func_ptr->createBlock("entry"));
+    locate(node.name);
+    current_env_.clear();
+    unsigned_variables_.clear();
+    Value* value = visitExpr(*node.initializer);
+    bool isUnsignedValue = unsigned_;
+    if (!node.type.empty()) {
+        value = convert(value, getIRType(node.type), unsigned_);
+        isUnsignedValue = isUnsigned(node.type);
+    }
+    if (isUnsignedValue) unsigned_constants_.insert(node.name.value);
+    func_ptr->returnType = value->getType();
+    constant_types_[node.name.value] = value->getType();
+    builder_.createRet(value);
+    return func;
+}
+
+std::unique_ptr<Function> IRGenerator::lowerFunction(FunctionDecl& node) {
+    auto func = declareFunction(node);
+    ++FunctionsLowered;
     auto func_ptr = func.get();
-    module_->addFunction(std::move(func));
 
     BasicBlock* entry = func_ptr->createBlock("entry");
     builder_.setInsertPoint(entry);
+    locate(node.name);
     
     current_env_.clear();
-    for (auto& arg : func_ptr->args) {
+    unsigned_variables_.clear();
+    return_type_ = func_ptr->returnType;
+    for (size_t i = 0; i < func_ptr->args.size(); ++i) {
+        auto& arg = func_ptr->args[i];
         auto argVal = new ArgumentValue(arg.name, arg.type);
         arg.ssaValue = argVal;
         current_env_[arg.name] = argVal;
+        if (isUnsigned(node.parameters[i].type)) unsigned_variables_.insert(arg.name);
     }
 
     visitBlock(*node.body);
@@ -44,24 +117,41 @@ void IRGenerator::visitFunction(FunctionDecl& node) {
             builder_.createRet(new Constant(func_ptr->returnType, 0));
         }
     }
+    return func;
 }
 
 void IRGenerator::visitStmt(Stmt& node) {
     if (auto* block = dynamic_cast<BlockStmt*>(&node)) {
         visitBlock(*block);
     } else if (auto* varDecl = dynamic_cast<VarDeclStmt*>(&node)) {
-        Value* init = visitExpr(*varDecl->initializer);
-        current_env_[varDecl->name.value] = init;
+        Value* value = visitExpr(*varDecl->initializer);
+        bool isUnsignedValue = unsigned_;
+        if (!varDecl->type.empty()) {
+            value = convert(value, getIRType(varDecl->type), unsigned_);
+            isUnsignedValue = isUnsigned(varDecl->type);
+        }
+        if (isUnsignedValue) unsigned_variables_.insert(varDecl->name.value);
+        else unsigned_variables_.erase(varDecl->name.value);
+        bind(varDecl->name.value, value);
     } else if (auto* assign = dynamic_cast<AssignStmt*>(&node)) {
-        Value* val = visitExpr(*assign->value);
-        current_env_[assign->name.value] = val;
+        Value* value = visitExpr(*assign->value);
+        auto it = current_env_.find(assign->name.value);
+        if (it != current_env_.end()) value = convert(value, it->second->getType(), unsigned_);
+        bind(assign->name.value, value);
     } else if (auto* ifStmt = dynamic_cast<IfStmt*>(&node)) {
         Value* cond = visitExpr(*ifStmt->condition);
+        locate(ifStmt->keyword);
         Function* func = builder_.getInsertPoint()->parent;
         BasicBlock* thenBB = func->createBlock("if.then");
         BasicBlock* elseBB = func->createBlock("if.else");
         BasicBlock* mergeBB = func->createBlock("if.merge");
-        builder_.createCondBr(cond, thenBB, elseBB);
+        IfBlocks += 3;
+        CondBranchInst* branch = builder_.createCondBr(cond, thenBB, elseBB);
+        for (const auto& annotation : ifStmt->annotations) {
+            constexpr uint64_t likely = CondBranchInst::kLikelyWeight;
+            if (annotation.name.value == "Likely") branch->weights = CondBranchInst::BranchWeights{likely, 1};
+            if (annotation.name.value == "Unlikely") branch->weights = CondBranchInst::BranchWeights{1, likely};
+        }
         
         BasicBlock* startBB = builder_.getInsertPoint();
         Environment env_before = current_env_;
@@ -80,6 +170,7 @@ void IRGenerator::visitStmt(Stmt& node) {
         if (!elseOutBB->getTerminator()) builder_.createBr(mergeBB);
         
         builder_.setInsertPoint(mergeBB);
+        locate(ifStmt->keyword);
         phiMerge(mergeBB, {{thenOutBB, env_then}, {elseOutBB, env_else}});
         
     } else if (auto* whileStmt = dynamic_cast<WhileStmt*>(&node)) {
@@ -88,7 +179,16 @@ void IRGenerator::visitStmt(Stmt& node) {
         BasicBlock* headerBB = func->createBlock("while.header");
         BasicBlock* bodyBB = func->createBlock("while.body");
         BasicBlock* exitBB = func->createBlock("while.exit");
+        WhileBlocks += 3;
+        for (const auto& annotation : whileStmt->annotations) {
+            // Without an argument, LLVM picks the count or width
+            unsigned value = annotation.arguments.empty() ? 0 : std::stoul(annotation.arguments[0].value);
+            if (annotation.name.value == "Unroll") headerBB->loopHints.unroll = value;
+            if (annotation.name.value == "Vectorize") headerBB->loopHints.vectorize = value;
+        }
         
+        // The loop edges and phis carry the position of the `while`
+        locate(whileStmt->keyword);
         builder_.createBr(headerBB);
         builder_.setInsertPoint(headerBB);
         
@@ -97,16 +197,20 @@ void IRGenerator::visitStmt(Stmt& node) {
         for (auto const& [name, val] : current_env_) {
             auto phi = builder_.createPhi(val->getType());
             phi->addIncoming(preheaderBB, val);
+            phi->variable = name;
+            ++LoopPhis;
             header_phis[name] = phi;
             current_env_[name] = phi;
         }
         
         Value* cond = visitExpr(*whileStmt->condition);
+        locate(whileStmt->keyword);
         builder_.createCondBr(cond, bodyBB, exitBB);
         
         builder_.setInsertPoint(bodyBB);
         visitStmt(*whileStmt->body);
         BasicBlock* bodyOutBB = builder_.getInsertPoint();
+        locate(whileStmt->keyword);
         if (!bodyOutBB->getTerminator()) builder_.createBr(headerBB);
         
         // Backfill header phis
@@ -124,6 +228,8 @@ void IRGenerator::visitStmt(Stmt& node) {
         
     } else if (auto* retStmt = dynamic_cast<ReturnStmt*>(&node)) {
         Value* val = retStmt->value ? visitExpr(*retStmt->value) : nullptr;
+        locate(retStmt->keyword);
+        if (val) val = convert(val, return_type_, unsigned_);
         builder_.createRet(val);
     } else if (auto* exprStmt = dynamic_cast<ExprStmt*>(&node)) {
         visitExpr(*exprStmt->expression);
@@ -143,6 +249,7 @@ Value* IRGenerator::visitExpr(Expr& node) {
     if (auto* var = dynamic_cast<VariableExpr*>(&node)) return visitVariableExpr(*var);
     if (auto* call = dynamic_cast<CallExpr*>(&node)) return visitCallExpr(*call);
     if (auto* grouping = dynamic_cast<GroupingExpr*>(&node)) return visitGroupingExpr(*grouping);
+    if (auto* conversion = dynamic_cast<ConversionExpr*>(&node)) return visitConversionExpr(*conversion);
     return nullptr;
 }
 
@@ -153,17 +260,21 @@ Value* IRGenerator::visitBinaryExpr(BinaryExpr& node) {
         Function* func = startBB->parent;
         BasicBlock* evalR = func->createBlock("and.rhs");
         BasicBlock* merge = func->createBlock("and.merge");
+        ShortCircuitBlocks += 2;
+        locate(node.op);
         builder_.createCondBr(l, evalR, merge);
         
         builder_.setInsertPoint(evalR);
         Value* r = visitExpr(*node.right);
         BasicBlock* rOutBB = builder_.getInsertPoint();
+        locate(node.op);
         builder_.createBr(merge);
         
         builder_.setInsertPoint(merge);
         auto phi = builder_.createPhi(Type::I1);
         phi->addIncoming(startBB, new Constant(Type::I1, 0));
         phi->addIncoming(rOutBB, r);
+        unsigned_ = false;
         return phi;
     }
     
@@ -173,48 +284,83 @@ Value* IRGenerator::visitBinaryExpr(BinaryExpr& node) {
         Function* func = startBB->parent;
         BasicBlock* evalR = func->createBlock("or.rhs");
         BasicBlock* merge = func->createBlock("or.merge");
+        ShortCircuitBlocks += 2;
+        locate(node.op);
         builder_.createCondBr(l, merge, evalR);
         
         builder_.setInsertPoint(evalR);
         Value* r = visitExpr(*node.right);
         BasicBlock* rOutBB = builder_.getInsertPoint();
+        locate(node.op);
         builder_.createBr(merge);
         
         builder_.setInsertPoint(merge);
         auto phi = builder_.createPhi(Type::I1);
         phi->addIncoming(startBB, new Constant(Type::I1, 1));
         phi->addIncoming(rOutBB, r);
+        unsigned_ = false;
         return phi;
     }
 
     Value* l = visitExpr(*node.left);
+    bool leftUnsigned = unsigned_;
     Value* r = visitExpr(*node.right);
-    
+    bool rightUnsigned = unsigned_;
+    locate(node.op);
+
+    // Both sides go to the wider type, at least Int: Byte + Byte is an Int,
+    // Int + Long a Long, UInt + ULong a ULong
+    bool isUnsignedOp = leftUnsigned || rightUnsigned;
+    if (l->getType() != Type::I1 || r->getType() != Type::I1) {
+        Type type = bitWidth(l->getType()) == 64 || bitWidth(r->getType()) == 64 ? Type::I64 : Type::I32;
+        l = convert(l, type, leftUnsigned);
+        r = convert(r, type, rightUnsigned);
+    }
+    using Op = Instruction::OpKind;
+    unsigned_ = false;
+    switch (node.op.type) {
+        case TokenType::EQUAL: return builder_.createICmp(Op::ICmpEq, l, r);
+        case TokenType::NOT_EQUAL: return builder_.createICmp(Op::ICmpNe, l, r);
+        case TokenType::LESS: return builder_.createICmp(isUnsignedOp ? Op::ICmpULt : Op::ICmpLt, l, r);
+        case TokenType::LESS_EQUAL: return builder_.createICmp(isUnsignedOp ? Op::ICmpULe : Op::ICmpLe, l, r);
+        case TokenType::GREATER: return builder_.createICmp(isUnsignedOp ? Op::ICmpUGt : Op::ICmpGt, l, r);
+        case TokenType::GREATER_EQUAL: return builder_.createICmp(isUnsignedOp ? Op::ICmpUGe : Op::ICmpGe, l, r);
+        default: break;
+    }
+    unsigned_ = isUnsignedOp;
     switch (node.op.type) {
         case TokenType::PLUS: return builder_.createAdd(l, r);
         case TokenType::MINUS: return builder_.createSub(l, r);
         case TokenType::STAR: return builder_.createMul(l, r);
-        case TokenType::SLASH: return builder_.createSDiv(l, r);
-        case TokenType::PERCENT: return builder_.createSRem(l, r);
-        case TokenType::EQUAL: return builder_.createICmp(Instruction::OpKind::ICmpEq, l, r);
-        case TokenType::NOT_EQUAL: return builder_.createICmp(Instruction::OpKind::ICmpNe, l, r);
-        case TokenType::LESS: return builder_.createICmp(Instruction::OpKind::ICmpLt, l, r);
-        case TokenType::LESS_EQUAL: return builder_.createICmp(Instruction::OpKind::ICmpLe, l, r);
-        case TokenType::GREATER: return builder_.createICmp(Instruction::OpKind::ICmpGt, l, r);
-        case TokenType::GREATER_EQUAL: return builder_.createICmp(Instruction::OpKind::ICmpGe, l, r);
+        case TokenType::SLASH: return isUnsignedOp ? builder_.createUDiv(l, r) : builder_.createSDiv(l, r);
+        case TokenType::PERCENT: return isUnsignedOp ? builder_.createURem(l, r) : builder_.createSRem(l, r);
         default: return nullptr;
     }
 }
 
 Value* IRGenerator::visitUnaryExpr(UnaryExpr& node) {
     Value* op = visitExpr(*node.right);
+    locate(node.op);
     if (node.op.type == TokenType::NOT) return builder_.createNot(op);
-    if (node.op.type == TokenType::MINUS) return builder_.createSub(new Constant(Type::I32, 0), op);
+    if (node.op.type == TokenType::MINUS) {
+        // -Byte and -Short are Ints; a negated literal is a constant
+        op = convert(op, op->getType() == Type::I64 ? Type::I64 : Type::I32, unsigned_);
+        if (auto c = dynamic_cast<Constant*>(op)) return new Constant(c->type, -c->value);
+        return builder_.createSub(new Constant(op->getType(), 0), op);
+    }
     return nullptr;
 }
 
 Value* IRGenerator::visitLiteralExpr(LiteralExpr& node) {
-    if (node.token.type == TokenType::INTEGER) return new Constant(Type::I32, std::stoi(node.token.value));
+    unsigned_ = false;
+    if (node.token.type == TokenType::INTEGER) {
+        // An Int unless it needs 64 bits or has an L suffix; likewise UInt and ULong
+        IntegerLiteral literal = parseIntegerLiteral(node.token.value);
+        uint64_t limit = literal.isUnsigned ? UINT32_MAX : INT32_MAX;
+        unsigned_ = literal.isUnsigned;
+        Type type = literal.isLong || literal.value > limit ? Type::I64 : Type::I32;
+        return new Constant(type, static_cast<int64_t>(literal.value));
+    }
     if (node.token.type == TokenType::TRUE) return new Constant(Type::I1, 1);
     if (node.token.type == TokenType::FALSE) return new Constant(Type::I1, 0);
     return nullptr;
@@ -222,14 +368,36 @@ Value* IRGenerator::visitLiteralExpr(LiteralExpr& node) {
 
 Value* IRGenerator::visitVariableExpr(VariableExpr& node) {
     auto it = current_env_.find(node.name.value);
+    unsigned_ = unsigned_variables_.count(node.name.value) > 0;
     if (it != current_env_.end()) return it->second;
+    auto constant = constant_types_.find(node.name.value);
+    if (constant != constant_types_.end()) {
+        unsigned_ = unsigned_constants_.count(node.name.value) > 0;
+        locate(node.name);
+        return builder_.createCall(constant->second, "const." + node.name.value, {});
+    }
     throw std::runtime_error("Undefined variable in IR generation: " + node.name.value);
 }
 
 Value* IRGenerator::visitCallExpr(CallExpr& node) {
+    const std::vector<Type>* params = nullptr;
+    auto declared = function_param_types_.find(node.callee.value);
+    if (declared != function_param_types_.end()) params = &declared->second;
+    else if (auto builtin = findBuiltin(node.callee.value)) params = &builtin->params;
+
     std::vector<Value*> args;
-    for (auto const& argExpr : node.arguments) args.push_back(visitExpr(*argExpr));
-    Type retType = (node.callee.value == "print_i32" || node.callee.value == "print_bool") ? Type::Void : Type::I32;
+    for (size_t i = 0; i < node.arguments.size(); ++i) {
+        Value* arg = visitExpr(*node.arguments[i]);
+        // An integer literal takes the parameter's type
+        if (params && i < params->size()) arg = convert(arg, (*params)[i], unsigned_);
+        args.push_back(arg);
+    }
+    Type retType = Type::I32;
+    auto it = function_return_types_.find(node.callee.value);
+    if (it != function_return_types_.end()) retType = it->second;
+    else if (auto builtin = findBuiltin(node.callee.value)) retType = builtin->returnType;
+    locate(node.callee);
+    unsigned_ = unsigned_functions_.count(node.callee.value) > 0;
     return builder_.createCall(retType, node.callee.value, args);
 }
 
@@ -237,12 +405,37 @@ Value* IRGenerator::visitGroupingExpr(GroupingExpr& node) {
     return visitExpr(*node.expression);
 }
 
+Value* IRGenerator::visitConversionExpr(ConversionExpr& node) {
+    Value* value = visitExpr(*node.operand);
+    locate(node.name);
+    // "toULong" -> "ULong"
+    std::string target = node.name.value.substr(2);
+    value = convert(value, getIRType(target), unsigned_);
+    unsigned_ = isUnsigned(target);
+    return value;
+}
+
 Type IRGenerator::getIRType(const std::string& kotlinType) {
-    if (kotlinType == "Int") return Type::I32;
+    if (kotlinType == "Int" || kotlinType == "UInt") return Type::I32;
+    if (kotlinType == "Long" || kotlinType == "ULong") return Type::I64;
+    if (kotlinType == "Short") return Type::I16;
+    if (kotlinType == "Byte") return Type::I8;
     if (kotlinType == "Boolean") return Type::I1;
     return Type::Void;
 }
 
+Value* IRGenerator::convert(Value* value, Type type, bool fromUnsigned) {
+    Type from = value->getType();
+    if (from == type || bitWidth(from) <= 1 || bitWidth(type) <= 1) return value;
+    return builder_.createIntCast(value, type, !fromUnsigned);
+}
+
+void IRGenerator::bind(const std::string& name, Value* value) {
+    auto inst = dynamic_cast<Instruction*>(value);
+    if (inst && inst->variable.empty()) inst->variable = name;
+    current_env_[name] = value;
+}
+
 void IRGenerator::phiMerge(BasicBlock* mergeBB, const std::vector<std::pair<BasicBlock*, Environment>>& predecessors) {
     std::set<std::string> all_vars;
     for (auto const& [bb, env] : predecessors) {
@@ -264,10 +457,14 @@ void IRGenerator::phiMerge(BasicBlock* mergeBB, const std::vector<std::pair<Basi
                 else if (val != first_val) all_same = false;
             }
         }
-        if (all_same && first_val && incomings.size() >= 1) current_env_[var] = first_val;
-        else if (!incomings.empty()) {
+        if (all_same && first_val && incomings.size() >= 1) {
+            current_env_[var] = first_val;
+            ++MergesWithoutPhi;
+        } else if (!incomings.empty()) {
+            ++MergePhis;
             auto phi = builder_.createPhi(first_val->getType());
             for (auto const& [bb, val] : incomings) phi->addIncoming(bb, val);
+            phi->variable = var;
             current_env_[var] = phi;
         }
     }
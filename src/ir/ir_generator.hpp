@@ -3,6 +3,7 @@
 #include "ir.hpp"
 #include "ir_builder.hpp"
 #include <map>
+#include <set>
 #include <string>
 
 namespace kotlin_lite {
@@ -11,11 +12,19 @@ namespace ir {
 class IRGenerator {
 public:
     IRGenerator();
-    std::unique_ptr<Module> generate(KotlinFile& file);
+    // Lowers every function, or only those in `liveFunctions` when given
+    std::unique_ptr<Module> generate(KotlinFile& file, const std::set<std::string>* liveFunctions = nullptr);
+
+    // Streaming compilation lowers one declaration at a time: every function
+    // is declared before any body that calls it, and every constant lowered
+    // before its first use. declareFunction returns the bare signature, a
+    // function without blocks.
+    std::unique_ptr<Function> declareFunction(const FunctionDecl& node);
+    std::unique_ptr<Function> lowerConstant(ConstDecl& node);
+    std::unique_ptr<Function> lowerFunction(FunctionDecl& node);
 
 private:
     IRBuilder builder_;
-    std::unique_ptr<Module> module_;
     
     // Environment: tracks the current SSA value for each variable
     using Environment = std::map<std::string, Value*>;
@@ -29,8 +38,25 @@ private:
     };
     std::vector<LoopInfo> loop_stack_;
 
+    // Declared return types, so calls are typed before their callee is lowered
+    std::map<std::string, Type> function_return_types_;
+    // `const val` types; a use lowers to a call of the initializer function `const.NAME`
+    std::map<std::string, Type> constant_types_;
+    // Parameter types, so arguments can be converted to them
+    std::map<std::string, std::vector<Type>> function_param_types_;
+    // Return type of the function being lowered
+    Type return_type_ = Type::Void;
+
+    // UInt and ULong share the IR types of Int and Long; signedness is in the
+    // instructions (udiv, icmp ult, zext). The generator tracks which values
+    // are unsigned: variables, functions and constants by name, and the
+    // expression lowered last.
+    std::set<std::string> unsigned_variables_;
+    std::set<std::string> unsigned_functions_;
+    std::set<std::string> unsigned_constants_;
+    bool unsigned_ = false;
+
     // --- Generation Methods ---
-    void visitFunction(FunctionDecl& node);
     void visitStmt(Stmt& node);
     void visitBlock(BlockStmt& node);
     
@@ -41,9 +67,18 @@ private:
     Value* visitVariableExpr(VariableExpr& node);
     Value* visitCallExpr(CallExpr& node);
     Value* visitGroupingExpr(GroupingExpr& node);
+    Value* visitConversionExpr(ConversionExpr& node);
 
     // --- SSA Helpers ---
     Type getIRType(const std::string& kotlinType);
+    static bool isUnsigned(const std::string& kotlinType) { return kotlinType == "UInt" || kotlinType == "ULong"; }
+    // `value` as `type`, extended by the sign of `fromUnsigned`; only
+    // integers change
+    Value* convert(Value* value, Type type, bool fromUnsigned);
+    // Instructions created from now on come from `token`
+    void locate(const Token& token) { builder_.setLocation(token.line, token.column); }
+    // Assigns a variable, and names the value after it for debug info
+    void bind(const std::string& name, Value* value);
     void phiMerge(BasicBlock* mergeBB, const std::vector<std::pair<BasicBlock*, Environment>>& predecessors);
 };
 
@@ -0,0 +1,481 @@
+#include "ir_parser.hpp"
+#include <cctype>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+
+namespace kotlin_lite {
+namespace ir {
+
+namespace {
+
+// Stands in for a value used before its definition; replaced once the
+// enclosing function has been read completely.
+class ForwardRef : public Value {
+public:
+    std::string name;
+    Type type;
+
+    ForwardRef(std::string n, Type t) : name(std::move(n)), type(t) {}
+    std::string getName() const override { return "%" + name; }
+    Type getType() const override { return type; }
+};
+
+bool isIdentChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$';
+}
+
+std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+// `name:`, possibly followed by loop hints
+bool isLabelLine(const std::string& text) {
+    std::string t = trim(text);
+    size_t colon = t.find(':');
+    if (colon == 0 || colon == std::string::npos) return false;
+    for (size_t i = 0; i < colon; ++i) {
+        if (!isIdentChar(t[i])) return false;
+    }
+    return true;
+}
+
+std::string labelName(const std::string& text) {
+    std::string t = trim(text);
+    return t.substr(0, t.find(':'));
+}
+
+const std::map<std::string, Instruction::OpKind> kBinaryOps = {
+    {"add", Instruction::OpKind::Add},
+    {"sub", Instruction::OpKind::Sub},
+    {"mul", Instruction::OpKind::Mul},
+    {"sdiv", Instruction::OpKind::SDiv},
+    {"srem", Instruction::OpKind::SRem},
+    {"shl", Instruction::OpKind::Shl},
+    {"udiv", Instruction::OpKind::UDiv},
+    {"urem", Instruction::OpKind::URem},
+    {"lshr", Instruction::OpKind::LShr},
+};
+
+const std::map<std::string, Instruction::OpKind> kCastOps = {
+    {"zext", Instruction::OpKind::ZExt},
+    {"sext", Instruction::OpKind::SExt},
+    {"trunc", Instruction::OpKind::Trunc},
+};
+
+const std::map<std::string, Instruction::OpKind> kCompareOps = {
+    {"eq", Instruction::OpKind::ICmpEq},
+    {"ne", Instruction::OpKind::ICmpNe},
+    {"lt", Instruction::OpKind::ICmpLt},
+    {"le", Instruction::OpKind::ICmpLe},
+    {"gt", Instruction::OpKind::ICmpGt},
+    {"ge", Instruction::OpKind::ICmpGe},
+    {"ult", Instruction::OpKind::ICmpULt},
+    {"ule", Instruction::OpKind::ICmpULe},
+    {"ugt", Instruction::OpKind::ICmpUGt},
+    {"uge", Instruction::OpKind::ICmpUGe},
+};
+
+} // namespace
+
+IRParser::IRParser(std::string text) {
+    std::istringstream in(text);
+    std::string raw;
+    int number = 0;
+    while (std::getline(in, raw)) {
+        ++number;
+        size_t comment = raw.find(';');
+        if (comment != std::string::npos) raw.erase(comment);
+        if (trim(raw).empty()) continue;
+        lines_.push_back({number, raw});
+    }
+}
+
+std::unique_ptr<Module> IRParser::parse() {
+    module_ = std::make_unique<Module>();
+
+    // Declare every function first so calls and `@fn` operands can refer forward.
+    std::vector<size_t> bodies;
+    for (size_t i = 0; i < lines_.size(); ++i) {
+        if (trim(lines_[i].text).compare(0, 7, "define ") == 0) {
+            declareFunction(lines_[i]);
+            bodies.push_back(i + 1);
+        }
+    }
+
+    size_t next = 0;
+    for (size_t f = 0; f < bodies.size(); ++f) {
+        if (bodies[f] - 1 != next) {
+            startLine(lines_[next]);
+            error("expected 'define'");
+        }
+        func_ = module_->functions[f].get();
+        line_index_ = bodies[f];
+        parseFunctionBody();
+        next = line_index_;
+    }
+    if (next < lines_.size()) {
+        startLine(lines_[next]);
+        error("expected 'define'");
+    }
+    return std::move(module_);
+}
+
+void IRParser::declareFunction(const Line& line) {
+    startLine(line);
+    expect("define");
+    Type ret = type();
+    expect("@");
+    std::string name = identifier();
+    if (module_->getFunction(name)) error("redefinition of function @" + name);
+
+    std::vector<Argument> args;
+    expect("(");
+    if (!accept(")")) {
+        do {
+            Type argType = type();
+            expect("%");
+            std::string argName = identifier();
+            args.push_back({argName, argType, new ArgumentValue(argName, argType)});
+        } while (accept(","));
+        expect(")");
+    }
+    auto func = std::make_unique<Function>(name, ret, std::move(args));
+    while (!accept("{")) {
+        if (accept("alwaysinline")) func->alwaysInline = true;
+        else if (accept("noinline")) func->noInline = true;
+        else if (accept("hot")) func->hot = true;
+        else if (accept("cold")) func->cold = true;
+        else if (accept("tailrec")) func->tailrec = true;
+        else if (accept("memoize")) {
+            func->memoize = 0;
+            if (accept("(")) {
+                uint64_t capacity = count();
+                if (capacity == 0 || capacity > (1u << 24)) error("memoize capacity must be between 1 and 16777216");
+                func->memoize = static_cast<unsigned>(capacity);
+                expect(")");
+            }
+        }
+        else error("expected '{'");
+    }
+    if (func->alwaysInline && func->noInline) error("alwaysinline conflicts with noinline");
+    if (func->hot && func->cold) error("hot conflicts with cold");
+    if (!atEnd()) error("unexpected text after '{'");
+
+    module_->addFunction(std::move(func));
+}
+
+void IRParser::parseFunctionBody() {
+    blocks_.clear();
+    values_.clear();
+    forward_refs_.clear();
+    for (const auto& arg : func_->args) values_[arg.name] = arg.ssaValue;
+
+    // Create all blocks up front so branches and phis can name later ones.
+    size_t end = line_index_;
+    for (; end < lines_.size() && trim(lines_[end].text) != "}"; ++end) {
+        if (!isLabelLine(lines_[end].text)) continue;
+        std::string label = labelName(lines_[end].text);
+        if (blocks_.count(label)) {
+            startLine(lines_[end]);
+            error("duplicate block label '" + label + "'");
+        }
+        blocks_[label] = func_->createBlock(label);
+    }
+    if (end == lines_.size()) {
+        startLine(lines_[line_index_ - 1]);
+        error("missing '}' for function @" + func_->name);
+    }
+
+    BasicBlock* current = nullptr;
+    for (; line_index_ < end; ++line_index_) {
+        const Line& line = lines_[line_index_];
+        if (isLabelLine(line.text)) {
+            current = blocks_[labelName(line.text)];
+            parseLoopHints(line, current->loopHints);
+            continue;
+        }
+        startLine(line);
+        if (!current) error("instruction outside of a block");
+        parseInstruction(current);
+    }
+    line_index_ = end + 1;
+
+    for (const auto& [name, ref] : forward_refs_) {
+        auto it = values_.find(name);
+        if (it == values_.end()) {
+            startLine(lines_[end]);
+            error("use of undefined value %" + name + " in @" + func_->name);
+        }
+        func_->replaceAllUsesWith(ref, it->second);
+        delete ref;
+    }
+}
+
+// After the label: `unroll`, `unroll(4)`, `vectorize`, `vectorize(8)`
+void IRParser::parseLoopHints(const Line& line, LoopHints& hints) {
+    startLine(line);
+    identifier();
+    expect(":");
+    while (!atEnd()) {
+        std::optional<unsigned>* hint = nullptr;
+        if (accept("unroll")) hint = &hints.unroll;
+        else if (accept("vectorize")) hint = &hints.vectorize;
+        else error("expected a loop hint");
+        uint64_t value = 0;
+        if (accept("(")) {
+            value = count();
+            if (value == 0 || value > 1024) error("loop hint must be between 1 and 1024");
+            expect(")");
+        }
+        *hint = static_cast<unsigned>(value);
+    }
+}
+
+void IRParser::parseInstruction(BasicBlock* bb) {
+    std::string id;
+    if (accept("%")) {
+        id = identifier();
+        expect("=");
+    }
+
+    std::string op = identifier();
+    std::unique_ptr<Instruction> inst;
+
+    if (kBinaryOps.count(op) || op == "icmp") {
+        Instruction::OpKind kind;
+        bool compare = op == "icmp";
+        if (compare) {
+            std::string cond = identifier();
+            auto it = kCompareOps.find(cond);
+            if (it == kCompareOps.end()) error("unknown comparison '" + cond + "'");
+            kind = it->second;
+        } else {
+            kind = kBinaryOps.at(op);
+        }
+        Type operandType = type();
+        if (operandType == Type::Void) error("'" + op + "' operands cannot be void");
+        Value* left = operand(operandType);
+        expect(",");
+        Value* right = operand(operandType);
+        inst = std::make_unique<BinaryInst>(kind, compare ? Type::I1 : operandType, id, left, right);
+    } else if (op == "not") {
+        Type operandType = type();
+        inst = std::make_unique<UnaryInst>(Instruction::OpKind::Not, Type::I1, id, operand(operandType));
+    } else if (kCastOps.count(op)) {
+        // %2 = sext i32 %1 to i64
+        Instruction::OpKind kind = kCastOps.at(op);
+        Type from = type();
+        Value* value = operand(from);
+        expect("to");
+        Type to = type();
+        if (from == Type::Void || to == Type::Void) error("'" + op + "' cannot convert void");
+        bool narrows = bitWidth(to) < bitWidth(from);
+        if (kind == Instruction::OpKind::Trunc ? !narrows : bitWidth(to) <= bitWidth(from)) {
+            error("'" + op + "' from " + to_string(from) + " to " + to_string(to) + (narrows ? " narrows" : " does not narrow"));
+        }
+        inst = std::make_unique<UnaryInst>(kind, to, id, value);
+    } else if (op == "phi") {
+        auto phi = std::make_unique<PhiInst>(type(), id);
+        do {
+            expect("[");
+            Value* val = operand(phi->type);
+            expect(",");
+            BasicBlock* pred = blockName();
+            expect("]");
+            phi->addIncoming(pred, val);
+        } while (accept(","));
+        inst = std::move(phi);
+    } else if (op == "call") {
+        Type ret = type();
+        expect("@");
+        std::string callee = identifier();
+        std::vector<Value*> args;
+        expect("(");
+        if (!accept(")")) {
+            do {
+                Type argType = type();
+                args.push_back(operand(argType));
+            } while (accept(","));
+            expect(")");
+        }
+        if (ret == Type::Void && !id.empty()) error("void call cannot define a value");
+        auto call = std::make_unique<CallInst>(ret, id, callee, std::move(args));
+        if (accept("parallel")) {
+            // parallel(add, lt, 1)
+            expect("(");
+            std::string reduction = identifier();
+            if (reduction != "add" && reduction != "mul") error("parallel reduction must be add or mul");
+            expect(",");
+            std::string cond = identifier();
+            auto pred = kCompareOps.find(cond);
+            if (pred == kCompareOps.end()) error("unknown comparison '" + cond + "'");
+            expect(",");
+            auto step = dynamic_cast<Constant*>(operand(Type::I32));
+            if (!step || step->value == 0) error("parallel step must be a non-zero constant");
+            expect(")");
+            call->parallel = CallInst::ParallelLoop{kBinaryOps.at(reduction), pred->second, static_cast<int32_t>(step->value)};
+        }
+        inst = std::move(call);
+    } else if (op == "br") {
+        inst = std::make_unique<BranchInst>(blockRef());
+    } else if (op == "condbr") {
+        if (type() != Type::I1) error("condbr condition must be i1");
+        Value* cond = operand(Type::I1);
+        expect(",");
+        BasicBlock* thenBB = blockRef();
+        expect(",");
+        BasicBlock* elseBB = blockRef();
+        auto cbr = std::make_unique<CondBranchInst>(cond, thenBB, elseBB);
+        if (accept("weights")) {
+            // weights(90, 10)
+            expect("(");
+            uint64_t thenCount = count();
+            expect(",");
+            uint64_t elseCount = count();
+            expect(")");
+            cbr->weights = CondBranchInst::BranchWeights{thenCount, elseCount};
+        }
+        inst = std::move(cbr);
+    } else if (op == "ret") {
+        Type retType = type();
+        inst = std::make_unique<ReturnInst>(retType == Type::Void ? nullptr : operand(retType));
+    } else {
+        error("unknown instruction '" + op + "'");
+    }
+
+    if (!atEnd()) error("unexpected text after instruction");
+    bool producesValue = inst->kind != Instruction::OpKind::Br && inst->kind != Instruction::OpKind::CondBr &&
+                         inst->kind != Instruction::OpKind::Ret && inst->type != Type::Void;
+    if (producesValue && id.empty()) error("'" + op + "' must define a value");
+    if (!producesValue && !id.empty()) error("'" + op + "' does not produce a value");
+
+    if (!id.empty()) define(id, inst.get());
+    bb->addInstruction(std::move(inst));
+}
+
+Value* IRParser::operand(Type type) {
+    skipSpaces();
+    if (accept("%")) {
+        std::string name = identifier();
+        auto it = values_.find(name);
+        if (it != values_.end()) return it->second;
+        auto& ref = forward_refs_[name];
+        if (!ref) ref = new ForwardRef(name, type);
+        return ref;
+    }
+    if (accept("@")) {
+        std::string name = identifier();
+        Function* func = module_->getFunction(name);
+        if (!func) error("unknown function @" + name);
+        return func;
+    }
+    if (accept("true")) return new Constant(type, 1);
+    if (accept("false")) return new Constant(type, 0);
+
+    size_t start = pos_;
+    if (pos_ < line_->text.size() && line_->text[pos_] == '-') ++pos_;
+    while (pos_ < line_->text.size() && std::isdigit(static_cast<unsigned char>(line_->text[pos_]))) ++pos_;
+    std::string digits = line_->text.substr(start, pos_ - start);
+    if (digits.empty() || digits == "-") error("expected operand");
+    // Either the signed or the unsigned reading of the type's bits
+    unsigned width = bitWidth(type);
+    long long value = 0;
+    try {
+        value = std::stoll(digits);
+    } catch (const std::out_of_range&) {
+        error("constant " + digits + " does not fit in " + to_string(type));
+    }
+    if (width > 0 && width < 64) {
+        long long low = -(1LL << (width - 1)), high = (1LL << width) - 1;
+        if (value < low || value > high) error("constant " + digits + " does not fit in " + to_string(type));
+    }
+    return new Constant(type, value);
+}
+
+BasicBlock* IRParser::blockRef() {
+    expect("label");
+    return blockName();
+}
+
+BasicBlock* IRParser::blockName() {
+    expect("%");
+    std::string label = identifier();
+    auto it = blocks_.find(label);
+    if (it == blocks_.end()) error("unknown block %" + label);
+    return it->second;
+}
+
+void IRParser::define(const std::string& id, Value* value) {
+    if (values_.count(id)) error("redefinition of %" + id);
+    values_[id] = value;
+}
+
+void IRParser::startLine(const Line& line) {
+    line_ = &line;
+    pos_ = 0;
+}
+
+void IRParser::skipSpaces() {
+    while (pos_ < line_->text.size() && std::isspace(static_cast<unsigned char>(line_->text[pos_]))) ++pos_;
+}
+
+bool IRParser::atEnd() {
+    skipSpaces();
+    return pos_ >= line_->text.size();
+}
+
+bool IRParser::accept(const std::string& text) {
+    skipSpaces();
+    if (line_->text.compare(pos_, text.size(), text) != 0) return false;
+    // Keywords must not swallow the start of a longer identifier
+    size_t after = pos_ + text.size();
+    if (isIdentChar(text.back()) && after < line_->text.size() && isIdentChar(line_->text[after])) return false;
+    pos_ = after;
+    return true;
+}
+
+void IRParser::expect(const std::string& text) {
+    if (!accept(text)) error("expected '" + text + "'");
+}
+
+std::string IRParser::identifier() {
+    skipSpaces();
+    size_t start = pos_;
+    while (pos_ < line_->text.size() && isIdentChar(line_->text[pos_])) ++pos_;
+    if (start == pos_) error("expected identifier");
+    return line_->text.substr(start, pos_ - start);
+}
+
+uint64_t IRParser::count() {
+    std::string digits = identifier();
+    for (char c : digits) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) error("expected a count, got '" + digits + "'");
+    }
+    try {
+        return std::stoull(digits);
+    } catch (const std::out_of_range&) {
+        error("count " + digits + " does not fit in 64 bits");
+    }
+}
+
+Type IRParser::type() {
+    if (accept("i32")) return Type::I32;
+    if (accept("i64")) return Type::I64;
+    if (accept("i16")) return Type::I16;
+    if (accept("i8")) return Type::I8;
+    if (accept("i1")) return Type::I1;
+    if (accept("void")) return Type::Void;
+    error("expected type");
+}
+
+void IRParser::error(const std::string& message) const {
+    int number = line_ ? line_->number : 0;
+    throw std::runtime_error("IR parse error at line " + std::to_string(number) + ": " + message);
+}
+
+} // namespace ir
+} // namespace kotlin_lite
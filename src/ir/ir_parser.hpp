@@ -0,0 +1,63 @@
+#pragma once
+#include "ir.hpp"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Reads back the textual form printed by `Module::dump()`.
+//
+// Blocks and values may be referenced before they are defined (loop phis,
+// branches to later blocks, calls to later functions). Malformed input throws
+// std::runtime_error naming the offending line.
+class IRParser {
+public:
+    explicit IRParser(std::string text);
+    std::unique_ptr<Module> parse();
+
+private:
+    struct Line {
+        int number;
+        std::string text;
+    };
+
+    std::vector<Line> lines_;
+    size_t line_index_ = 0;
+
+    // Cursor into the line being parsed
+    const Line* line_ = nullptr;
+    size_t pos_ = 0;
+
+    std::unique_ptr<Module> module_;
+    Function* func_ = nullptr;
+    std::map<std::string, BasicBlock*> blocks_;
+    std::map<std::string, Value*> values_;
+    std::map<std::string, Value*> forward_refs_;
+
+    void declareFunction(const Line& line);
+    void parseFunctionBody();
+    void parseLoopHints(const Line& line, LoopHints& hints);
+    void parseInstruction(BasicBlock* bb);
+
+    Value* operand(Type type);
+    BasicBlock* blockRef();   // `label %name`
+    BasicBlock* blockName();  // `%name`
+    void define(const std::string& id, Value* value);
+
+    // --- Line cursor helpers ---
+    void startLine(const Line& line);
+    void skipSpaces();
+    bool atEnd();
+    bool accept(const std::string& text);
+    void expect(const std::string& text);
+    std::string identifier();
+    uint64_t count();
+    Type type();
+    [[noreturn]] void error(const std::string& message) const;
+};
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,561 @@
+#include "ir_serializer.hpp"
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kotlin_lite {
+namespace ir {
+
+namespace {
+
+// --- On-disk layout (all little-endian, every section 8-byte aligned) ---
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numFunctions;
+    uint32_t numArgs;
+    uint32_t numBlocks;
+    uint32_t numInsts;
+    uint32_t numOperands;
+    uint32_t stringsSize;
+};
+
+struct FunctionRecord {
+    uint32_t name;        // string table offset
+    uint32_t firstArg;
+    uint32_t firstBlock;
+    uint16_t numArgs;
+    uint8_t returnType;
+    uint8_t flags;        // FunctionFlag bits
+    uint32_t numBlocks;
+    uint32_t memoizeCapacity;  // with kMemoize; 0 for the default
+};
+
+struct ArgRecord {
+    uint32_t name;
+    uint8_t type;
+    uint8_t hasValue;     // false for arguments the function never reads
+    uint16_t reserved;
+};
+
+struct BlockRecord {
+    uint32_t label;
+    uint32_t firstInst;
+    uint32_t numInsts;
+    uint16_t unroll;      // loop hints, plus one; 0 if unset
+    uint16_t vectorize;
+};
+
+enum FunctionFlag : uint8_t {
+    kAlwaysInline = 1,
+    kNoInline = 2,
+    kHot = 4,
+    kCold = 8,
+    kMemoize = 16,
+    kTailrec = 32,
+};
+
+struct InstRecord {
+    uint8_t kind;
+    uint8_t type;
+    uint8_t parallelReduction;  // parallel calls: reduction opcode + 1; 0 for any other instruction
+    uint8_t parallelPredicate;
+    uint32_t id;          // string table offset; the empty string for unnamed instructions
+    uint32_t callee;      // string table offset, calls only
+    uint32_t firstOperand;
+    uint32_t numOperands;
+    int32_t parallelStep;
+};
+
+// Operand order per instruction kind:
+//   binary: left, right        not: operand         call: args...
+//   phi: (block, value) pairs  br: block            condbr: cond, then, else, [then count, else count]
+//   ret: [value]
+enum class OperandTag : uint8_t { Constant, Argument, Instruction, Block, Function, Count };
+
+struct OperandRecord {
+    uint8_t tag;
+    uint8_t type;         // constants only
+    uint16_t reserved;
+    uint32_t reserved2;
+    int64_t payload;      // constant value, or a function-local arg/inst/block index, or a function index,
+                          // or a profile count
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader layout");
+static_assert(sizeof(FunctionRecord) == 24, "FunctionRecord layout");
+static_assert(sizeof(ArgRecord) == 8, "ArgRecord layout");
+static_assert(sizeof(BlockRecord) == 16, "BlockRecord layout");
+static_assert(sizeof(InstRecord) == 24, "InstRecord layout");
+static_assert(sizeof(OperandRecord) == 16, "OperandRecord layout");
+
+size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+class StringTable {
+public:
+    StringTable() { intern(""); }
+
+    uint32_t intern(const std::string& s) {
+        auto it = offsets_.find(s);
+        if (it != offsets_.end()) return it->second;
+        uint32_t offset = static_cast<uint32_t>(data_.size());
+        data_.insert(data_.end(), s.begin(), s.end());
+        data_.push_back('\0');
+        offsets_[s] = offset;
+        return offset;
+    }
+
+    const std::vector<char>& data() const { return data_; }
+
+private:
+    std::vector<char> data_;
+    std::map<std::string, uint32_t> offsets_;
+};
+
+template <typename T>
+void appendSection(std::vector<uint8_t>& out, const std::vector<T>& records) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(records.data());
+    out.insert(out.end(), bytes, bytes + records.size() * sizeof(T));
+    out.resize(align8(out.size()), 0);
+}
+
+} // namespace
+
+std::vector<uint8_t> writeBinary(const Module& module) {
+    StringTable strings;
+    std::vector<FunctionRecord> functions;
+    std::vector<ArgRecord> args;
+    std::vector<BlockRecord> blocks;
+    std::vector<InstRecord> insts;
+    std::vector<OperandRecord> operands;
+
+    std::map<const Function*, uint32_t> functionIndex;
+    for (const auto& func : module.functions) {
+        functionIndex[func.get()] = static_cast<uint32_t>(functionIndex.size());
+    }
+
+    for (const auto& func : module.functions) {
+        // Operands use indices local to the function, so records can be decoded
+        // one function at a time.
+        std::map<const Value*, uint32_t> argIndex;
+        std::map<const Value*, uint32_t> instIndex;
+        std::map<const BasicBlock*, uint32_t> blockIndex;
+        for (size_t i = 0; i < func->args.size(); ++i) {
+            if (func->args[i].ssaValue) argIndex[func->args[i].ssaValue] = static_cast<uint32_t>(i);
+        }
+        for (const auto& bb : func->blocks) {
+            blockIndex[bb.get()] = static_cast<uint32_t>(blockIndex.size());
+            for (const auto& inst : bb->instructions) {
+                instIndex[inst.get()] = static_cast<uint32_t>(instIndex.size());
+            }
+        }
+
+        auto value = [&](const Value* v) {
+            OperandRecord op{};
+            if (auto c = dynamic_cast<const Constant*>(v)) {
+                op.tag = static_cast<uint8_t>(OperandTag::Constant);
+                op.type = static_cast<uint8_t>(c->type);
+                op.payload = c->value;
+            } else if (argIndex.count(v)) {
+                op.tag = static_cast<uint8_t>(OperandTag::Argument);
+                op.payload = argIndex[v];
+            } else if (instIndex.count(v)) {
+                op.tag = static_cast<uint8_t>(OperandTag::Instruction);
+                op.payload = instIndex[v];
+            } else if (auto f = dynamic_cast<const Function*>(v); f && functionIndex.count(f)) {
+                op.tag = static_cast<uint8_t>(OperandTag::Function);
+                op.payload = functionIndex[f];
+            } else {
+                throw std::runtime_error("IR serializer: operand " + v->getName() + " in @" + func->name +
+                                         " is not defined in the module");
+            }
+            operands.push_back(op);
+        };
+        auto block = [&](const BasicBlock* bb) {
+            OperandRecord op{};
+            op.tag = static_cast<uint8_t>(OperandTag::Block);
+            op.payload = blockIndex.at(bb);
+            operands.push_back(op);
+        };
+        auto count = [&](uint64_t n) {
+            OperandRecord op{};
+            op.tag = static_cast<uint8_t>(OperandTag::Count);
+            op.payload = static_cast<int64_t>(n);
+            operands.push_back(op);
+        };
+
+        FunctionRecord fr{};
+        fr.name = strings.intern(func->name);
+        fr.returnType = static_cast<uint8_t>(func->returnType);
+        fr.firstArg = static_cast<uint32_t>(args.size());
+        fr.numArgs = static_cast<uint16_t>(func->args.size());
+        fr.firstBlock = static_cast<uint32_t>(blocks.size());
+        fr.numBlocks = static_cast<uint32_t>(func->blocks.size());
+        fr.flags = (func->alwaysInline ? kAlwaysInline : 0) | (func->noInline ? kNoInline : 0) |
+                   (func->hot ? kHot : 0) | (func->cold ? kCold : 0) | (func->memoize ? kMemoize : 0) |
+                   (func->tailrec ? kTailrec : 0);
+        fr.memoizeCapacity = func->memoize.value_or(0);
+        functions.push_back(fr);
+
+        for (const auto& arg : func->args) {
+            ArgRecord ar{};
+            ar.name = strings.intern(arg.name);
+            ar.type = static_cast<uint8_t>(arg.type);
+            ar.hasValue = arg.ssaValue != nullptr;
+            args.push_back(ar);
+        }
+
+        for (const auto& bb : func->blocks) {
+            BlockRecord br{};
+            br.label = strings.intern(bb->label);
+            br.firstInst = static_cast<uint32_t>(insts.size());
+            br.numInsts = static_cast<uint32_t>(bb->instructions.size());
+            auto hint = [](const std::optional<unsigned>& value) {
+                return static_cast<uint16_t>(value ? *value + 1 : 0);
+            };
+            br.unroll = hint(bb->loopHints.unroll);
+            br.vectorize = hint(bb->loopHints.vectorize);
+            blocks.push_back(br);
+
+            for (const auto& inst : bb->instructions) {
+                InstRecord ir{};
+                ir.kind = static_cast<uint8_t>(inst->kind);
+                ir.type = static_cast<uint8_t>(inst->type);
+                ir.id = strings.intern(inst->id);
+                ir.firstOperand = static_cast<uint32_t>(operands.size());
+
+                switch (inst->kind) {
+                    case Instruction::OpKind::Phi:
+                        // Block order keeps the output independent of pointer values
+                        for (const auto& pred : func->blocks) {
+                            auto& incomings = static_cast<PhiInst*>(inst.get())->incomings;
+                            auto it = incomings.find(pred.get());
+                            if (it == incomings.end()) continue;
+                            block(pred.get());
+                            value(it->second);
+                        }
+                        break;
+                    case Instruction::OpKind::Call:
+                    {
+                        auto call = static_cast<CallInst*>(inst.get());
+                        ir.callee = strings.intern(call->callee);
+                        if (call->parallel) {
+                            ir.parallelReduction = static_cast<uint8_t>(call->parallel->reduction) + 1;
+                            ir.parallelPredicate = static_cast<uint8_t>(call->parallel->predicate);
+                            ir.parallelStep = call->parallel->step;
+                        }
+                        for (Value* arg : inst->getOperands()) value(arg);
+                        break;
+                    }
+                    case Instruction::OpKind::Br:
+                        block(static_cast<BranchInst*>(inst.get())->target);
+                        break;
+                    case Instruction::OpKind::CondBr: {
+                        auto cbr = static_cast<CondBranchInst*>(inst.get());
+                        value(cbr->condition);
+                        block(cbr->thenBB);
+                        block(cbr->elseBB);
+                        if (cbr->weights) {
+                            count(cbr->weights->thenCount);
+                            count(cbr->weights->elseCount);
+                        }
+                        break;
+                    }
+                    default:
+                        for (Value* op : inst->getOperands()) value(op);
+                        break;
+                }
+                ir.numOperands = static_cast<uint32_t>(operands.size()) - ir.firstOperand;
+                insts.push_back(ir);
+            }
+        }
+    }
+
+    FileHeader header{};
+    header.magic = kBinaryMagic;
+    header.version = kBinaryVersion;
+    header.numFunctions = static_cast<uint32_t>(functions.size());
+    header.numArgs = static_cast<uint32_t>(args.size());
+    header.numBlocks = static_cast<uint32_t>(blocks.size());
+    header.numInsts = static_cast<uint32_t>(insts.size());
+    header.numOperands = static_cast<uint32_t>(operands.size());
+    header.stringsSize = static_cast<uint32_t>(strings.data().size());
+
+    std::vector<uint8_t> out(sizeof(FileHeader));
+    std::memcpy(out.data(), &header, sizeof(FileHeader));
+    appendSection(out, functions);
+    appendSection(out, args);
+    appendSection(out, blocks);
+    appendSection(out, insts);
+    appendSection(out, operands);
+    appendSection(out, strings.data());
+    return out;
+}
+
+void writeBinaryFile(const Module& module, const std::string& path) {
+    std::vector<uint8_t> bytes = writeBinary(module);
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("Could not open file for writing: " + path);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+bool isBinaryIR(const uint8_t* data, size_t size) {
+    uint32_t magic;
+    if (size < sizeof(magic)) return false;
+    std::memcpy(&magic, data, sizeof(magic));
+    return magic == kBinaryMagic;
+}
+
+std::unique_ptr<Module> readBinary(const uint8_t* data, size_t size) {
+    auto fail = [](const std::string& message) -> std::runtime_error {
+        return std::runtime_error("IR binary: " + message);
+    };
+
+    if (size < sizeof(FileHeader) || !isBinaryIR(data, size)) throw fail("not a KLIR file");
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(FileHeader));
+    if (header.version != kBinaryVersion) {
+        throw fail("unsupported version " + std::to_string(header.version) + " (expected " +
+                   std::to_string(kBinaryVersion) + ")");
+    }
+
+    // Locate each section and bounds-check it once; records are then read in place.
+    size_t offset = sizeof(FileHeader);
+    auto section = [&](size_t count, size_t recordSize) {
+        const uint8_t* start = data + offset;
+        offset = align8(offset + count * recordSize);
+        if (offset > size) throw fail("truncated file");
+        return start;
+    };
+    auto functions = reinterpret_cast<const FunctionRecord*>(section(header.numFunctions, sizeof(FunctionRecord)));
+    auto args = reinterpret_cast<const ArgRecord*>(section(header.numArgs, sizeof(ArgRecord)));
+    auto blocks = reinterpret_cast<const BlockRecord*>(section(header.numBlocks, sizeof(BlockRecord)));
+    auto insts = reinterpret_cast<const InstRecord*>(section(header.numInsts, sizeof(InstRecord)));
+    auto operands = reinterpret_cast<const OperandRecord*>(section(header.numOperands, sizeof(OperandRecord)));
+    auto strings = reinterpret_cast<const char*>(section(header.stringsSize, 1));
+    if (header.stringsSize == 0 || strings[header.stringsSize - 1] != '\0') throw fail("corrupt string table");
+
+    auto str = [&](uint32_t off) -> std::string {
+        if (off >= header.stringsSize) throw fail("string offset out of range");
+        return std::string(strings + off);
+    };
+    auto typeOf = [&](uint8_t t) {
+        if (t > static_cast<uint8_t>(Type::I64)) throw fail("invalid type tag");
+        return static_cast<Type>(t);
+    };
+
+    auto module = std::make_unique<Module>();
+    for (uint32_t f = 0; f < header.numFunctions; ++f) {
+        const FunctionRecord& fr = functions[f];
+        if (fr.firstArg + uint64_t(fr.numArgs) > header.numArgs) throw fail("argument range out of bounds");
+        std::vector<Argument> funcArgs;
+        for (uint32_t i = 0; i < fr.numArgs; ++i) {
+            const ArgRecord& ar = args[fr.firstArg + i];
+            Argument arg{str(ar.name), typeOf(ar.type)};
+            if (ar.hasValue) arg.ssaValue = new ArgumentValue(arg.name, arg.type);
+            funcArgs.push_back(arg);
+        }
+        auto func = std::make_unique<Function>(str(fr.name), typeOf(fr.returnType), std::move(funcArgs));
+        func->alwaysInline = fr.flags & kAlwaysInline;
+        func->noInline = fr.flags & kNoInline;
+        func->hot = fr.flags & kHot;
+        func->cold = fr.flags & kCold;
+        if (fr.flags & kMemoize) func->memoize = fr.memoizeCapacity;
+        func->tailrec = fr.flags & kTailrec;
+        module->addFunction(std::move(func));
+    }
+
+    for (uint32_t f = 0; f < header.numFunctions; ++f) {
+        const FunctionRecord& fr = functions[f];
+        Function* func = module->functions[f].get();
+        if (fr.firstBlock + uint64_t(fr.numBlocks) > header.numBlocks) throw fail("block range out of bounds");
+
+        std::vector<BasicBlock*> funcBlocks;
+        uint32_t firstInst = fr.numBlocks ? blocks[fr.firstBlock].firstInst : 0;
+        uint32_t numInsts = 0;
+        for (uint32_t b = 0; b < fr.numBlocks; ++b) {
+            const BlockRecord& br = blocks[fr.firstBlock + b];
+            if (br.firstInst != firstInst + numInsts) throw fail("instructions are not contiguous");
+            numInsts += br.numInsts;
+            funcBlocks.push_back(func->createBlock(str(br.label)));
+            if (br.unroll) funcBlocks.back()->loopHints.unroll = br.unroll - 1u;
+            if (br.vectorize) funcBlocks.back()->loopHints.vectorize = br.vectorize - 1u;
+        }
+        if (firstInst + uint64_t(numInsts) > header.numInsts) throw fail("instruction range out of bounds");
+
+        // Instructions are created before any operand is resolved, so forward
+        // references (loop phis) are plain index lookups.
+        std::vector<Instruction*> funcInsts;
+        for (uint32_t b = 0; b < fr.numBlocks; ++b) {
+            const BlockRecord& br = blocks[fr.firstBlock + b];
+            for (uint32_t i = 0; i < br.numInsts; ++i) {
+                const InstRecord& ir = insts[br.firstInst + i];
+                if (ir.firstOperand + uint64_t(ir.numOperands) > header.numOperands) throw fail("operand range out of bounds");
+                Type type = typeOf(ir.type);
+                std::string id = str(ir.id);
+                std::unique_ptr<Instruction> inst;
+                switch (static_cast<Instruction::OpKind>(ir.kind)) {
+                    case Instruction::OpKind::Add: case Instruction::OpKind::Sub: case Instruction::OpKind::Mul:
+                    case Instruction::OpKind::SDiv: case Instruction::OpKind::SRem: case Instruction::OpKind::Shl:
+                    case Instruction::OpKind::UDiv: case Instruction::OpKind::URem: case Instruction::OpKind::LShr:
+                    case Instruction::OpKind::ICmpEq: case Instruction::OpKind::ICmpNe: case Instruction::OpKind::ICmpLt:
+                    case Instruction::OpKind::ICmpLe: case Instruction::OpKind::ICmpGt: case Instruction::OpKind::ICmpGe:
+                    case Instruction::OpKind::ICmpULt: case Instruction::OpKind::ICmpULe:
+                    case Instruction::OpKind::ICmpUGt: case Instruction::OpKind::ICmpUGe:
+                        if (ir.numOperands != 2) throw fail("binary instruction needs two operands");
+                        inst = std::make_unique<BinaryInst>(static_cast<Instruction::OpKind>(ir.kind), type, id, nullptr, nullptr);
+                        break;
+                    case Instruction::OpKind::Not:
+                        if (ir.numOperands != 1) throw fail("not needs one operand");
+                        inst = std::make_unique<UnaryInst>(Instruction::OpKind::Not, type, id, nullptr);
+                        break;
+                    case Instruction::OpKind::ZExt: case Instruction::OpKind::SExt: case Instruction::OpKind::Trunc:
+                        if (ir.numOperands != 1) throw fail("cast needs one operand");
+                        inst = std::make_unique<UnaryInst>(static_cast<Instruction::OpKind>(ir.kind), type, id, nullptr);
+                        break;
+                    case Instruction::OpKind::Phi:
+                        if (ir.numOperands % 2 != 0) throw fail("phi needs (block, value) pairs");
+                        inst = std::make_unique<PhiInst>(type, id);
+                        break;
+                    case Instruction::OpKind::Call: {
+                        auto call = std::make_unique<CallInst>(type, id, str(ir.callee), std::vector<Value*>(ir.numOperands));
+                        if (ir.parallelReduction) {
+                            auto reduction = static_cast<Instruction::OpKind>(ir.parallelReduction - 1);
+                            auto predicate = static_cast<Instruction::OpKind>(ir.parallelPredicate);
+                            bool valid = (reduction == Instruction::OpKind::Add || reduction == Instruction::OpKind::Mul) &&
+                                         predicate >= Instruction::OpKind::ICmpEq && predicate <= Instruction::OpKind::ICmpUGe &&
+                                         ir.parallelStep != 0;
+                            if (!valid) throw fail("malformed parallel call");
+                            call->parallel = CallInst::ParallelLoop{reduction, predicate, ir.parallelStep};
+                        }
+                        inst = std::move(call);
+                        break;
+                    }
+                    case Instruction::OpKind::Br:
+                        if (ir.numOperands != 1) throw fail("br needs one target");
+                        inst = std::make_unique<BranchInst>(nullptr);
+                        break;
+                    case Instruction::OpKind::CondBr:
+                        if (ir.numOperands != 3 && ir.numOperands != 5) throw fail("condbr needs a condition and two targets");
+                        inst = std::make_unique<CondBranchInst>(nullptr, nullptr, nullptr);
+                        break;
+                    case Instruction::OpKind::Ret:
+                        if (ir.numOperands > 1) throw fail("ret takes at most one value");
+                        inst = std::make_unique<ReturnInst>(nullptr);
+                        break;
+                    default:
+                        throw fail("invalid instruction kind " + std::to_string(ir.kind));
+                }
+                funcInsts.push_back(inst.get());
+                funcBlocks[b]->addInstruction(std::move(inst));
+            }
+        }
+
+        auto value = [&](const OperandRecord& op) -> Value* {
+            switch (static_cast<OperandTag>(op.tag)) {
+                case OperandTag::Constant:
+                    return new Constant(typeOf(op.type), op.payload);
+                case OperandTag::Argument:
+                    if (op.payload < 0 || op.payload >= static_cast<int64_t>(func->args.size()) ||
+                        !func->args[op.payload].ssaValue) {
+                        throw fail("invalid argument reference");
+                    }
+                    return func->args[op.payload].ssaValue;
+                case OperandTag::Instruction:
+                    if (op.payload < 0 || op.payload >= static_cast<int64_t>(funcInsts.size())) throw fail("invalid instruction reference");
+                    return funcInsts[op.payload];
+                case OperandTag::Function:
+                    if (op.payload < 0 || op.payload >= static_cast<int64_t>(module->functions.size())) throw fail("invalid function reference");
+                    return module->functions[op.payload].get();
+                default:
+                    throw fail("expected a value operand");
+            }
+        };
+        auto block = [&](const OperandRecord& op) -> BasicBlock* {
+            if (static_cast<OperandTag>(op.tag) != OperandTag::Block || op.payload < 0 ||
+                op.payload >= static_cast<int64_t>(funcBlocks.size())) {
+                throw fail("invalid block reference");
+            }
+            return funcBlocks[op.payload];
+        };
+        auto count = [&](const OperandRecord& op) -> uint64_t {
+            if (static_cast<OperandTag>(op.tag) != OperandTag::Count) throw fail("expected a profile count");
+            return static_cast<uint64_t>(op.payload);
+        };
+
+        for (size_t i = 0; i < funcInsts.size(); ++i) {
+            const InstRecord& ir = insts[firstInst + i];
+            const OperandRecord* ops = operands + ir.firstOperand;
+            Instruction* inst = funcInsts[i];
+            switch (inst->kind) {
+                case Instruction::OpKind::Not:
+                case Instruction::OpKind::ZExt:
+                case Instruction::OpKind::SExt:
+                case Instruction::OpKind::Trunc:
+                    static_cast<UnaryInst*>(inst)->operand = value(ops[0]);
+                    break;
+                case Instruction::OpKind::Phi:
+                    for (uint32_t k = 0; k < ir.numOperands; k += 2) {
+                        static_cast<PhiInst*>(inst)->addIncoming(block(ops[k]), value(ops[k + 1]));
+                    }
+                    break;
+                case Instruction::OpKind::Call:
+                    for (uint32_t k = 0; k < ir.numOperands; ++k) static_cast<CallInst*>(inst)->args[k] = value(ops[k]);
+                    break;
+                case Instruction::OpKind::Br:
+                    static_cast<BranchInst*>(inst)->target = block(ops[0]);
+                    break;
+                case Instruction::OpKind::CondBr: {
+                    auto cbr = static_cast<CondBranchInst*>(inst);
+                    cbr->condition = value(ops[0]);
+                    cbr->thenBB = block(ops[1]);
+                    cbr->elseBB = block(ops[2]);
+                    if (ir.numOperands == 5) cbr->weights = CondBranchInst::BranchWeights{count(ops[3]), count(ops[4])};
+                    break;
+                }
+                case Instruction::OpKind::Ret:
+                    if (ir.numOperands) static_cast<ReturnInst*>(inst)->value = value(ops[0]);
+                    break;
+                default: {
+                    auto bin = static_cast<BinaryInst*>(inst);
+                    bin->left = value(ops[0]);
+                    bin->right = value(ops[1]);
+                    break;
+                }
+            }
+        }
+    }
+    return module;
+}
+
+std::unique_ptr<Module> readBinaryFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Could not open file: " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("IR binary: empty or unreadable file: " + path);
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) throw std::runtime_error("Could not map file: " + path);
+
+    try {
+        auto module = readBinary(static_cast<const uint8_t*>(mapped), size);
+        ::munmap(mapped, size);
+        return module;
+    } catch (...) {
+        ::munmap(mapped, size);
+        throw;
+    }
+}
+
+} // namespace ir
+} // namespace kotlin_lite
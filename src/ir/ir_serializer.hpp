@@ -0,0 +1,30 @@
+#pragma once
+#include "ir.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Compact binary form of a `Module` ("KLIR" files).
+//
+// The file is a fixed header followed by flat arrays of fixed-size records
+// (functions, arguments, blocks, instructions, operands) and a string table.
+// Every record refers to others by index, so loading is a single linear pass
+// over mmap'd memory with no tokenizing. Bump `kBinaryVersion` whenever a
+// record layout or enum encoding changes; readers reject other versions.
+constexpr uint32_t kBinaryMagic = 0x52494c4b; // "KLIR" as little-endian bytes
+constexpr uint32_t kBinaryVersion = 7;
+
+std::vector<uint8_t> writeBinary(const Module& module);
+void writeBinaryFile(const Module& module, const std::string& path);
+
+bool isBinaryIR(const uint8_t* data, size_t size);
+std::unique_ptr<Module> readBinary(const uint8_t* data, size_t size);
+// Maps the file read-only and decodes it in place.
+std::unique_ptr<Module> readBinaryFile(const std::string& path);
+
+} // namespace ir
+} // namespace kotlin_lite
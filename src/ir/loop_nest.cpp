@@ -0,0 +1,243 @@
+#include "loop_nest.hpp"
+#include "builtins.hpp"
+#include <cstdint>
+#include <limits>
+
+namespace kotlin_lite {
+namespace ir {
+
+namespace {
+
+using Op = Instruction::OpKind;
+
+// Predicate that holds for (b, a) when `pred` holds for (a, b)
+Op swapped(Op pred) {
+    switch (pred) {
+        case Op::ICmpLt: return Op::ICmpGt;
+        case Op::ICmpLe: return Op::ICmpGe;
+        case Op::ICmpGt: return Op::ICmpLt;
+        case Op::ICmpGe: return Op::ICmpLe;
+        default: return pred;
+    }
+}
+
+bool isCompare(Op kind) { return kind >= Op::ICmpEq && kind <= Op::ICmpUGe; }
+
+bool sameValue(const Value* a, const Value* b) {
+    if (a == b) return true;
+    auto ca = dynamic_cast<const Constant*>(a);
+    auto cb = dynamic_cast<const Constant*>(b);
+    return ca && cb && ca->value == cb->value;
+}
+
+} // namespace
+
+std::optional<int64_t> CountedLoop::tripCount() const {
+    auto c0 = dynamic_cast<Constant*>(init);
+    auto c1 = dynamic_cast<Constant*>(bound);
+    if (!c0 || !c1) return std::nullopt;
+    int64_t from = c0->value, to = c1->value, s = step;
+
+    int64_t n = 0;
+    switch (predicate) {
+        case Op::ICmpLt: n = from < to ? (to - from + s - 1) / s : 0; break;
+        case Op::ICmpLe: n = from <= to ? (to - from) / s + 1 : 0; break;
+        case Op::ICmpGt: n = from > to ? (from - to - s - 1) / -s : 0; break;
+        case Op::ICmpGe: n = from >= to ? (from - to) / -s + 1 : 0; break;
+        case Op::ICmpNe:
+            if ((to - from) % s != 0 || (to - from) / s < 0) return std::nullopt;
+            n = (to - from) / s;
+            break;
+        default: return std::nullopt;
+    }
+    // The final increment must not wrap around, or the loop would not stop there
+    int64_t last = from + n * s;
+    if (last < std::numeric_limits<int32_t>::min() || last > std::numeric_limits<int32_t>::max()) return std::nullopt;
+    return n;
+}
+
+bool CountedLoop::sameTripCount(const CountedLoop& other) const {
+    auto mine = tripCount();
+    auto theirs = other.tripCount();
+    if (mine && theirs) return *mine == *theirs;
+    return predicate == other.predicate && step == other.step && sameValue(init, other.init) && sameValue(bound, other.bound);
+}
+
+LoopNestAnalysis::LoopNestAnalysis(Function& func) : cfg_(func), loops_(func, cfg_) {
+    for (const auto& bb : func.blocks) {
+        for (const auto& inst : bb->instructions) {
+            for (Value* op : inst->getOperands()) users_[op].push_back(inst.get());
+        }
+    }
+    for (const auto& loop : loops_.loops()) analyze(loop.get());
+}
+
+bool LoopNestAnalysis::definedInside(const Loop* loop, const Value* value) const {
+    auto inst = dynamic_cast<const Instruction*>(value);
+    return inst && loop->contains(inst->parent);
+}
+
+const std::vector<Instruction*>& LoopNestAnalysis::users(const Value* value) const {
+    static const std::vector<Instruction*> none;
+    auto it = users_.find(value);
+    return it != users_.end() ? it->second : none;
+}
+
+const CountedLoop* LoopNestAnalysis::counted(const Loop* loop) const {
+    auto it = counted_.find(loop);
+    return it != counted_.end() ? &it->second : nullptr;
+}
+
+const std::string& LoopNestAnalysis::whyNot(const Loop* loop) const {
+    static const std::string none;
+    auto it = rejected_.find(loop);
+    return it != rejected_.end() ? it->second : none;
+}
+
+void LoopNestAnalysis::analyze(Loop* loop) {
+    auto reject = [&](std::string reason) { rejected_[loop] = std::move(reason); };
+
+    CountedLoop cl;
+    cl.loop = loop;
+    cl.header = loop->header;
+    cl.preheader = loop->preheader(cfg_);
+    if (!cl.preheader) return reject("it has no preheader");
+    if (loop->latches.size() != 1) return reject("it has more than one back edge");
+    cl.latch = loop->latches.front();
+    if (cl.latch == cl.header) return reject("its header branches to itself");
+
+    for (BasicBlock* bb : loop->blocks) {
+        if (bb == cl.header) continue;
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            if (!loop->contains(succ)) return reject("it is left from the middle of its body");
+        }
+    }
+
+    Instruction* term = cl.header->getTerminator();
+    if (!term || term->kind != Op::CondBr) return reject("its header does not test a condition");
+    auto br = static_cast<CondBranchInst*>(term);
+    if (!loop->contains(br->thenBB) || loop->contains(br->elseBB)) return reject("its condition does not guard the body");
+    cl.body = br->thenBB;
+    cl.exit = br->elseBB;
+
+    auto cond = dynamic_cast<Instruction*>(br->condition);
+    if (!cond || cond->parent != cl.header || !isCompare(cond->kind)) return reject("its condition is not a comparison");
+    if (cond->kind >= Op::ICmpULt) return reject("its condition is an unsigned comparison");
+    cl.compare = static_cast<BinaryInst*>(cond);
+    cl.predicate = cond->kind;
+
+    auto isHeaderPhi = [&](Value* v) {
+        auto phi = dynamic_cast<PhiInst*>(v);
+        return phi && phi->parent == cl.header;
+    };
+    if (isHeaderPhi(cl.compare->left)) {
+        cl.iv = static_cast<PhiInst*>(cl.compare->left);
+        cl.bound = cl.compare->right;
+    } else if (isHeaderPhi(cl.compare->right)) {
+        cl.iv = static_cast<PhiInst*>(cl.compare->right);
+        cl.bound = cl.compare->left;
+        cl.predicate = swapped(cl.predicate);
+    } else {
+        return reject("its condition does not test an induction variable");
+    }
+    if (cl.iv->type != Type::I32) return reject("its induction variable is not an Int");
+    if (definedInside(loop, cl.bound)) return reject("its bound changes inside the loop");
+
+    auto initIt = cl.iv->incomings.find(cl.preheader);
+    auto nextIt = cl.iv->incomings.find(cl.latch);
+    if (cl.iv->incomings.size() != 2 || initIt == cl.iv->incomings.end() || nextIt == cl.iv->incomings.end()) {
+        return reject("its induction variable has an unexpected phi");
+    }
+    cl.init = initIt->second;
+
+    // `iv + c`, `c + iv` or `iv - c`
+    auto next = dynamic_cast<Instruction*>(nextIt->second);
+    bool isStep = next && loop->contains(next->parent) && (next->kind == Op::Add || next->kind == Op::Sub);
+    if (!isStep) return reject("its induction variable does not step by a constant");
+    cl.increment = static_cast<BinaryInst*>(next);
+    Value* stepValue = cl.increment->left == cl.iv ? cl.increment->right
+                     : cl.increment->right == cl.iv && next->kind == Op::Add ? cl.increment->left : nullptr;
+    auto stepConst = dynamic_cast<Constant*>(stepValue);
+    if (!stepConst || stepConst->value == 0 || stepConst->value == std::numeric_limits<int32_t>::min()) {
+        return reject("its induction variable does not step by a constant");
+    }
+    cl.step = next->kind == Op::Sub ? -stepConst->value : stepConst->value;
+
+    bool upward = cl.predicate == Op::ICmpLt || cl.predicate == Op::ICmpLe;
+    bool downward = cl.predicate == Op::ICmpGt || cl.predicate == Op::ICmpGe;
+    if ((upward && cl.step < 0) || (downward && cl.step > 0) || cl.predicate == Op::ICmpEq) {
+        return reject("its induction variable moves away from the bound");
+    }
+    counted_[loop] = cl;
+}
+
+LoopEffects loopEffects(const Loop& loop, const FunctionAttrs& attrs) {
+    LoopEffects effects;
+    for (BasicBlock* bb : loop.blocks) {
+        for (const auto& inst : bb->instructions) {
+            if (inst->kind == Op::SDiv || inst->kind == Op::SRem) {
+                auto divisor = dynamic_cast<Constant*>(static_cast<BinaryInst*>(inst.get())->right);
+                if (!divisor || divisor->value == 0 || divisor->value == -1) effects.mayTrap = true;
+            }
+            if (inst->kind == Op::UDiv || inst->kind == Op::URem) {
+                auto divisor = dynamic_cast<Constant*>(static_cast<BinaryInst*>(inst.get())->right);
+                if (!divisor || divisor->value == 0) effects.mayTrap = true;
+            }
+            if (inst->kind != Op::Call) continue;
+            const std::string& callee = static_cast<CallInst*>(inst.get())->callee;
+            if (auto builtin = findBuiltin(callee)) {
+                effects.observable |= builtin->hasIOEffects;
+                continue;
+            }
+            const FunctionEffects& fx = attrs.get(callee);
+            effects.observable |= fx.hasIO;
+            effects.mayDiverge |= !fx.willReturn;
+            effects.sharesState |= fx.writesMemory;
+            // FunctionEffects does not track division; any callee may trap
+            effects.mayTrap = true;
+        }
+    }
+    return effects;
+}
+
+int foldTrivialPhis(Function& func) {
+    int folded = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& bb : func.blocks) {
+            for (auto it = bb->instructions.begin(); it != bb->instructions.end();) {
+                auto phi = dynamic_cast<PhiInst*>(it->get());
+                if (!phi) break;
+                Value* same = nullptr;
+                bool trivial = true;
+                for (const auto& [pred, value] : phi->incomings) {
+                    if (value == phi || value == same) continue;
+                    if (same) { trivial = false; break; }
+                    same = value;
+                }
+                if (!trivial || !same) { ++it; continue; }
+                func.replaceAllUsesWith(phi, same);
+                it = bb->instructions.erase(it);
+                ++folded;
+                changed = true;
+            }
+        }
+    }
+    return folded;
+}
+
+void moveBeforeTerminator(Instruction* inst, BasicBlock* bb) {
+    BasicBlock* from = inst->parent;
+    auto it = from->find(inst);
+    std::unique_ptr<Instruction> owned = std::move(*it);
+    from->instructions.erase(it);
+    bb->insertInstruction(std::prev(bb->instructions.end()), std::move(owned));
+}
+
+std::string describeLoop(const Loop* loop) {
+    return "loop %" + loop->header->label;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
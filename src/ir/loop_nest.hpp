@@ -0,0 +1,97 @@
+#pragma once
+#include "ir.hpp"
+#include "cfg.hpp"
+#include "function_attrs.hpp"
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// A `while` loop that runs a fixed number of times:
+//
+//     header:  %iv = phi [ init, %preheader ], [ %next, %latch ]
+//              %c = icmp <pred> %iv, bound
+//              condbr %c, label %body, label %exit
+//     ...
+//     latch:   %next = add %iv, step
+//              br label %header
+//
+// `init` and `bound` are defined outside the loop and the step is a non-zero
+// constant. The header is the only block leaving the loop.
+struct CountedLoop {
+    Loop* loop = nullptr;
+    BasicBlock* preheader = nullptr;
+    BasicBlock* header = nullptr;
+    BasicBlock* latch = nullptr;
+    BasicBlock* body = nullptr;  // the header's successor inside the loop
+    BasicBlock* exit = nullptr;
+    PhiInst* iv = nullptr;
+    BinaryInst* compare = nullptr;
+    BinaryInst* increment = nullptr;
+    Value* init = nullptr;
+    Value* bound = nullptr;
+    int32_t step = 0;
+    Instruction::OpKind predicate = Instruction::OpKind::ICmpLt;
+
+    // Iterations when `init` and `bound` are constants
+    std::optional<int64_t> tripCount() const;
+    // Both loops provably run the same number of iterations
+    bool sameTripCount(const CountedLoop& other) const;
+};
+
+// Counted-loop recognition over a function's loop nest. The CFG and loop info
+// describe the function as it was when the analysis ran; transforms rebuild
+// the analysis after changing the control flow.
+class LoopNestAnalysis {
+public:
+    explicit LoopNestAnalysis(Function& func);
+
+    const CFG& cfg() const { return cfg_; }
+    const LoopInfo& loopInfo() const { return loops_; }
+
+    // nullptr when `loop` is not counted; `whyNot` then says which condition failed
+    const CountedLoop* counted(const Loop* loop) const;
+    const std::string& whyNot(const Loop* loop) const;
+
+    bool definedInside(const Loop* loop, const Value* value) const;
+    // Instructions using `value`, once per operand slot
+    const std::vector<Instruction*>& users(const Value* value) const;
+
+private:
+    CFG cfg_;
+    LoopInfo loops_;
+    std::map<const Value*, std::vector<Instruction*>> users_;
+    std::map<const Loop*, CountedLoop> counted_;
+    std::map<const Loop*, std::string> rejected_;
+
+    void analyze(Loop* loop);
+};
+
+// What running a loop's code in a different order could change
+struct LoopEffects {
+    bool observable = false;  // prints, directly or through a callee
+    bool mayTrap = false;     // divides by a value that may be 0 or -1, or calls code that might
+    bool mayDiverge = false;  // calls a function that is not known to return
+    bool sharesState = false; // calls a function that updates a @Memoize cache
+};
+
+LoopEffects loopEffects(const Loop& loop, const FunctionAttrs& attrs);
+
+// Replaces phis whose incomings are all the same value (or the phi itself) by
+// that value. The IR generator threads every variable in scope through each
+// loop header, so most header phis of a nest are trivial. Returns how many
+// phis were removed.
+int foldTrivialPhis(Function& func);
+
+// Moves `inst` from its block to just before `bb`'s terminator
+void moveBeforeTerminator(Instruction* inst, BasicBlock* bb);
+
+// Names a loop in remarks by its header: "loop %while.header1"
+std::string describeLoop(const Loop* loop);
+
+} // namespace ir
+} // namespace kotlin_lite
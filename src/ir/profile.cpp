@@ -0,0 +1,116 @@
+#include "profile.hpp"
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace kotlin_lite {
+namespace ir {
+
+namespace {
+
+const char* kHeader = "kotlin-lite profile 1";
+
+// FNV-1a
+class Hasher {
+public:
+    void add(uint64_t value) {
+        for (int i = 0; i < 8; ++i) byte(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    uint64_t value() const { return hash_; }
+
+private:
+    uint64_t hash_ = 0xcbf29ce484222325ull;
+    void byte(uint8_t b) {
+        hash_ ^= b;
+        hash_ *= 0x100000001b3ull;
+    }
+};
+
+} // namespace
+
+uint64_t profileHash(const Function& func) {
+    std::map<const BasicBlock*, uint64_t> index;
+    for (const auto& bb : func.blocks) index[bb.get()] = index.size();
+
+    Hasher hash;
+    hash.add(func.args.size());
+    hash.add(index.size());
+    for (const auto& bb : func.blocks) {
+        hash.add(bb->instructions.size());
+        for (const auto& inst : bb->instructions) {
+            hash.add(static_cast<uint64_t>(inst->kind));
+            if (auto call = dynamic_cast<CallInst*>(inst.get())) hash.add(call->args.size());
+        }
+        for (BasicBlock* succ : bb->getSuccessors()) hash.add(index.at(succ));
+    }
+    return hash.value();
+}
+
+size_t profileCounterCount(const Function& func) {
+    size_t count = func.blocks.size();
+    for (const auto& bb : func.blocks) {
+        Instruction* term = bb->getTerminator();
+        if (term && term->kind == Instruction::OpKind::CondBr) count++;
+    }
+    return count;
+}
+
+Profile Profile::parse(const std::string& text) {
+    std::istringstream in(text);
+    std::string line;
+    int number = 1;
+    auto fail = [&](const std::string& message) {
+        return std::runtime_error("profile line " + std::to_string(number) + ": " + message);
+    };
+    if (!std::getline(in, line) || line != kHeader) throw fail("expected '" + std::string(kHeader) + "'");
+
+    Profile profile;
+    while (std::getline(in, line)) {
+        ++number;
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        std::string name, hash;
+        size_t size = 0;
+        if (!(fields >> name >> hash >> size)) throw fail("expected '<function> <hash> <counters>'");
+        FunctionProfile func;
+        try {
+            func.hash = std::stoull(hash, nullptr, 16);
+        } catch (const std::exception&) {
+            throw fail("invalid hash '" + hash + "'");
+        }
+
+        ++number;
+        if (!std::getline(in, line)) throw fail("missing counters of " + name);
+        std::istringstream counts(line);
+        uint64_t count;
+        while (counts >> count) func.counts.push_back(count);
+        if (!counts.eof() || func.counts.size() != size) {
+            throw fail("expected " + std::to_string(size) + " counters for " + name);
+        }
+        if (!profile.functions.emplace(name, std::move(func)).second) throw fail("duplicate function " + name);
+    }
+    return profile;
+}
+
+Profile Profile::readFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("cannot read profile " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str());
+}
+
+std::string Profile::format() const {
+    std::stringstream ss;
+    ss << kHeader << "\n";
+    for (const auto& [name, func] : functions) {
+        ss << name << " " << std::hex << func.hash << std::dec << " " << func.counts.size() << "\n";
+        for (size_t i = 0; i < func.counts.size(); ++i) ss << (i ? " " : "") << func.counts[i];
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+} // namespace ir
+} // namespace kotlin_lite
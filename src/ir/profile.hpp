@@ -0,0 +1,55 @@
+#pragma once
+#include "ir.hpp"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Execution counts recorded by a `--profile-generate` binary.
+//
+// The counters of a function, in order, are one per block (in block order)
+// followed by one per `condbr` (in block order) counting how often its then
+// edge was taken. They refer to the IR right after compile-time evaluation,
+// before the custom optimizations, which both builds see alike.
+//
+// Each function is stored with a hash of its shape (blocks, instruction
+// kinds and edges) but not of its constants or callee names, so a profile
+// survives edits to other functions, to literals and renames; a function
+// whose shape changed gets a different hash and its counts are dropped.
+//
+// On disk the profile is text:
+//
+//     kotlin-lite profile 1
+//     fib 5f0c2b1a9e3d4c77 6
+//     1 1 0 832039 ...
+//
+// a function's name, hash (hex) and counter count, then its counters.
+struct FunctionProfile {
+    uint64_t hash = 0;
+    std::vector<uint64_t> counts;
+};
+
+class Profile {
+public:
+    std::map<std::string, FunctionProfile> functions;
+
+    // Both throw std::runtime_error on malformed input
+    static Profile parse(const std::string& text);
+    static Profile readFile(const std::string& path);
+
+    std::string format() const;
+};
+
+// Instrumented code calls this with a counter index and whether to count
+// (see ProfileInstrumentation); backends lower it to an increment
+constexpr const char* kProfileCounterFunction = "kl_prof_count";
+
+uint64_t profileHash(const Function& func);
+// Blocks plus condbrs
+size_t profileCounterCount(const Function& func);
+
+} // namespace ir
+} // namespace kotlin_lite
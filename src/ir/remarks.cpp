@@ -0,0 +1,127 @@
+#include "remarks.hpp"
+#include "ir.hpp"
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+namespace kotlin_lite {
+namespace ir {
+
+const char* to_string(Remark::Kind kind) {
+    switch (kind) {
+        case Remark::Kind::Passed: return "passed";
+        case Remark::Kind::Missed: return "missed";
+        case Remark::Kind::Analysis: return "analysis";
+    }
+    return "unknown";
+}
+
+void locate(Remark& remark, const BasicBlock& bb) {
+    for (const auto& inst : bb.instructions) {
+        if (inst->line > 0) {
+            remark.line = inst->line;
+            remark.column = inst->column;
+            return;
+        }
+    }
+}
+
+RemarkCollector::RemarkCollector(const std::string& filter) : match_all_(filter.empty()) {
+    if (!match_all_) filter_ = std::regex(filter);
+}
+
+bool RemarkCollector::enabled(const std::string& pass) const {
+    return match_all_ || std::regex_search(pass, filter_);
+}
+
+void RemarkCollector::emit(Remark remark) {
+    if (!enabled(remark.pass)) return;
+    if (remark.line > 0 && remark.file.empty()) remark.file = file_;
+    remarks_.push_back(std::move(remark));
+}
+
+std::vector<const Remark*> RemarkCollector::sorted() const {
+    std::vector<const Remark*> result;
+    for (const auto& remark : remarks_) result.push_back(&remark);
+    auto key = [](const Remark* r) {
+        return std::tie(r->file, r->line, r->column, r->function, r->pass, r->kind, r->name, r->message);
+    };
+    std::stable_sort(result.begin(), result.end(), [&](const Remark* a, const Remark* b) { return key(a) < key(b); });
+    return result;
+}
+
+std::string RemarkCollector::format() const {
+    std::ostringstream out;
+    for (const Remark* remark : sorted()) {
+        if (remark->line > 0) out << remark->file << ":" << remark->line << ":" << remark->column << ": ";
+        out << remark->function << ": " << to_string(remark->kind) << ": " << remark->message << " [" << remark->pass << "]\n";
+    }
+    return out.str();
+}
+
+std::string RemarkCollector::formatSummary() const {
+    std::map<std::string, std::map<Remark::Kind, int>> counts;
+    for (const auto& remark : remarks_) counts[remark.pass][remark.kind]++;
+    std::ostringstream out;
+    out << remarks_.size() << " remark(s)" << (counts.empty() ? "" : ":") << "\n";
+    for (const auto& [pass, kinds] : counts) {
+        out << "  " << pass << ":";
+        const char* separator = " ";
+        for (const auto& [kind, count] : kinds) {
+            out << separator << count << " " << to_string(kind);
+            separator = ", ";
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+namespace {
+
+// Plain if YAML reads it back as the same string, single-quoted otherwise
+std::string yamlScalar(const std::string& text) {
+    bool plain = !text.empty() && (std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_');
+    for (char c : text) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.' && c != '/') plain = false;
+    }
+    if (plain) return text;
+    std::string quoted = "'";
+    for (char c : text) {
+        quoted += c;
+        if (c == '\'') quoted += '\'';
+    }
+    return quoted + "'";
+}
+
+const char* yamlTag(Remark::Kind kind) {
+    switch (kind) {
+        case Remark::Kind::Passed: return "!Passed";
+        case Remark::Kind::Missed: return "!Missed";
+        case Remark::Kind::Analysis: return "!Analysis";
+    }
+    return "!Unknown";
+}
+
+} // namespace
+
+std::string RemarkCollector::formatYAML() const {
+    std::ostringstream out;
+    for (const Remark* remark : sorted()) {
+        out << "--- " << yamlTag(remark->kind) << "\n";
+        out << "Pass:            " << yamlScalar(remark->pass) << "\n";
+        out << "Name:            " << yamlScalar(remark->name) << "\n";
+        if (remark->line > 0) {
+            out << "DebugLoc:        { File: " << yamlScalar(remark->file) << ", Line: " << remark->line
+                << ", Column: " << remark->column << " }\n";
+        }
+        out << "Function:        " << yamlScalar(remark->function) << "\n";
+        out << "Message:         " << yamlScalar(remark->message) << "\n";
+        out << "...\n";
+    }
+    return out.str();
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,78 @@
+#pragma once
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// An optimization remark: a transform explaining what it did (Passed), what
+// it looked at but left alone and why (Missed), or a fact it relied on
+// (Analysis). Custom passes report through a RemarkCollector they are given;
+// a pass without one stays silent.
+struct Remark {
+    enum class Kind { Passed, Missed, Analysis };
+
+    Kind kind;
+    std::string pass;      // "loop-fusion"
+    std::string name;      // short machine-readable tag: "Fused", "NotProfitable"
+    std::string function;
+    std::string message;
+    // Kotlin source position; line 0 when the remark has none
+    std::string file;
+    int line = 0;
+    int column = 0;
+};
+
+const char* to_string(Remark::Kind kind);
+
+struct BasicBlock;
+// Places `remark` at the first instruction of `bb` that has a source line
+void locate(Remark& remark, const BasicBlock& bb);
+
+class RemarkCollector {
+public:
+    // Keeps remarks of passes whose name matches `filter` (ECMAScript regex,
+    // searched anywhere in the name); an empty filter keeps everything.
+    explicit RemarkCollector(const std::string& filter = "");
+
+    // Positioned remarks that do not name a file are in this one
+    void setFile(std::string file) { file_ = std::move(file); }
+
+    bool enabled(const std::string& pass) const;
+    void emit(Remark remark);
+
+    // In the order they were emitted
+    const std::vector<Remark>& remarks() const { return remarks_; }
+
+    // The output below is ordered by position, function, pass and message,
+    // not by emission, so that two compilers' remarks can be diffed.
+
+    // One line per remark:
+    // "loops.kt:4:5: main: passed: fused loop %a with loop %b [loop-fusion]"
+    std::string format() const;
+    // How many remarks of each kind every pass made
+    std::string formatSummary() const;
+    // The YAML of LLVM's optimization records (-fsave-optimization-record),
+    // with the message as a single `Message` instead of `Args`:
+    //
+    //     --- !Missed
+    //     Pass:            loop-fusion
+    //     Name:            NotAdjacent
+    //     DebugLoc:        { File: loops.kt, Line: 4, Column: 5 }
+    //     Function:        main
+    //     Message:         'cannot fuse ...'
+    //     ...
+    std::string formatYAML() const;
+
+private:
+    bool match_all_;
+    std::string file_;
+    std::regex filter_;
+    std::vector<Remark> remarks_;
+
+    std::vector<const Remark*> sorted() const;
+};
+
+} // namespace ir
+} // namespace kotlin_lite
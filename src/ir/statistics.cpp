@@ -0,0 +1,96 @@
+#include "statistics.hpp"
+#include "ir.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace kotlin_lite {
+namespace ir {
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<Statistic*> statistics;
+};
+
+// Constructed on first use, as counters register from static initializers
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+} // namespace
+
+KL_STATISTIC(FunctionsBeforeOpt, "ir-size", "Functions before the custom passes");
+KL_STATISTIC(BlocksBeforeOpt, "ir-size", "Blocks before the custom passes");
+KL_STATISTIC(InstructionsBeforeOpt, "ir-size", "Instructions before the custom passes");
+KL_STATISTIC(FunctionsAfterOpt, "ir-size", "Functions after the custom passes");
+KL_STATISTIC(BlocksAfterOpt, "ir-size", "Blocks after the custom passes");
+KL_STATISTIC(InstructionsAfterOpt, "ir-size", "Instructions after the custom passes");
+
+Statistic::Statistic(const char* pass, const char* name, const char* description)
+    : pass_(pass), name_(name), description_(description) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.statistics.push_back(this);
+}
+
+void recordIRSize(const Module& module, bool optimized) {
+    if (!Statistic::enabled()) return;
+    size_t functions = 0, blocks = 0, instructions = 0;
+    for (const auto& func : module.functions) {
+        if (func->blocks.empty()) continue;
+        functions++;
+        blocks += func->blocks.size();
+        instructions += func->instructionCount();
+    }
+    (optimized ? FunctionsAfterOpt : FunctionsBeforeOpt) += functions;
+    (optimized ? BlocksAfterOpt : BlocksBeforeOpt) += blocks;
+    (optimized ? InstructionsAfterOpt : InstructionsBeforeOpt) += instructions;
+}
+
+std::vector<Statistic*> allStatistics() {
+    Registry& r = registry();
+    std::vector<Statistic*> result;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        result = r.statistics;
+    }
+    std::sort(result.begin(), result.end(), [](const Statistic* a, const Statistic* b) {
+        int byPass = std::strcmp(a->pass(), b->pass());
+        return byPass != 0 ? byPass < 0 : std::strcmp(a->name(), b->name()) < 0;
+    });
+    return result;
+}
+
+void resetStatistics() {
+    for (Statistic* statistic : allStatistics()) statistic->reset();
+}
+
+std::string formatStatistics() {
+    std::ostringstream out;
+    out << "--- Statistics ---\n";
+    for (const Statistic* statistic : allStatistics()) {
+        if (statistic->value() == 0) continue;
+        out << std::setw(8) << statistic->value() << " " << statistic->pass() << " - " << statistic->description() << "\n";
+    }
+    return out.str();
+}
+
+std::string formatStatisticsJSON() {
+    std::ostringstream out;
+    out << "{\n";
+    const char* separator = "";
+    for (const Statistic* statistic : allStatistics()) {
+        out << separator << "  \"" << statistic->pass() << "." << statistic->name() << "\": " << statistic->value();
+        separator = ",\n";
+    }
+    out << "\n}\n";
+    return out.str();
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// A named count of something the compiler did, reported by -stats. A pass
+// declares one per event at namespace scope in its .cpp file and bumps it:
+//
+//     KL_STATISTIC(PhisCreated, "irgen", "Phis created by phiMerge");
+//     ...
+//     ++PhisCreated;
+//
+// Counters register themselves during static initialization. Counting is a
+// relaxed atomic add, so passes may count from several threads; while
+// statistics are disabled (the default) it is a single well-predicted branch.
+class Statistic {
+public:
+    Statistic(const char* pass, const char* name, const char* description);
+    Statistic(const Statistic&) = delete;
+    Statistic& operator=(const Statistic&) = delete;
+
+    Statistic& operator++() { return *this += 1; }
+    Statistic& operator+=(uint64_t n) {
+        if (enabled_.load(std::memory_order_relaxed)) value_.fetch_add(n, std::memory_order_relaxed);
+        return *this;
+    }
+
+    const char* pass() const { return pass_; }
+    const char* name() const { return name_; }
+    const char* description() const { return description_; }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+    void reset() { value_.store(0, std::memory_order_relaxed); }
+
+    static void enable(bool on = true) { enabled_.store(on, std::memory_order_relaxed); }
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+private:
+    inline static std::atomic<bool> enabled_{false};
+    const char* pass_;
+    const char* name_;
+    const char* description_;
+    std::atomic<uint64_t> value_{0};
+};
+
+#define KL_STATISTIC(VAR, PASS, DESC) static ::kotlin_lite::ir::Statistic VAR(PASS, #VAR, DESC)
+
+class Module;
+// Adds the functions, blocks and instructions of `module` to the "ir-size"
+// counters of the IR before (`optimized` false) or after the custom passes
+void recordIRSize(const Module& module, bool optimized);
+
+// Every registered counter, ordered by pass and name
+std::vector<Statistic*> allStatistics();
+void resetStatistics();
+
+// The counters that moved, one per line: "   42 irgen - Phis created by phiMerge"
+std::string formatStatistics();
+// Every counter, zero or not, so that the keys stay the same from run to run:
+// {"irgen.PhisCreated": 42, ...}
+std::string formatStatisticsJSON();
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -16,6 +16,8 @@ const std::map<std::string, TokenType> Lexer::keywords_ = {
     {"true", TokenType::TRUE},
     {"false", TokenType::FALSE},
     {"null", TokenType::NULL_LITERAL},
+    {"tailrec", TokenType::TAILREC},
+    {"const", TokenType::CONST},
     {"package", TokenType::PACKAGE},
     {"import", TokenType::IMPORT},
     {"class", TokenType::CLASS},
@@ -33,74 +35,61 @@ Lexer::Lexer(std::string source) : source_(std::move(source)) {}
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
-    while (!isAtEnd()) {
-        skipWhitespaceAndComments();
-        if (isAtEnd()) break;
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().type != TokenType::EOF_TOKEN);
+    return tokens;
+}
 
-        char c = advance();
-        if (isAlpha(c)) {
-            cursor_--;
-            column_--;
-            tokens.push_back(identifier());
-        } else if (isDigit(c)) {
+Token Lexer::next() {
+    skipWhitespaceAndComments();
+    tokenLine_ = line_;
+    tokenColumn_ = column_;
+    if (isAtEnd()) return makeToken(TokenType::EOF_TOKEN);
+
+    char c = advance();
+    if (isAlpha(c)) {
+        cursor_--;
+        column_--;
+        return identifier();
+    }
+    if (isDigit(c)) {
+        cursor_--;
+        column_--;
+        return number();
+    }
+    switch (c) {
+        case '(': return makeToken(TokenType::LPAREN);
+        case ')': return makeToken(TokenType::RPAREN);
+        case '{': return makeToken(TokenType::LBRACE);
+        case '}': return makeToken(TokenType::RBRACE);
+        case ',': return makeToken(TokenType::COMMA);
+        case '.': return makeToken(TokenType::DOT);
+        case ':': return makeToken(TokenType::COLON);
+        case ';': return makeToken(TokenType::SEMICOLON);
+        case '@': return makeToken(TokenType::AT);
+        case '+': return makeToken(TokenType::PLUS);
+        case '-': return makeToken(match('>') ? TokenType::ARROW : TokenType::MINUS);
+        case '*': return makeToken(TokenType::STAR);
+        case '/': return makeToken(TokenType::SLASH);
+        case '%': return makeToken(TokenType::PERCENT);
+        case '!': return makeToken(match('=') ? TokenType::NOT_EQUAL : TokenType::NOT);
+        case '=': return makeToken(match('=') ? TokenType::EQUAL : TokenType::ASSIGN);
+        case '<': return makeToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS);
+        case '>': return makeToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER);
+        case '&':
+            if (match('&')) return makeToken(TokenType::AND);
+            return makeToken(TokenType::INVALID, "&");
+        case '|':
+            if (match('|')) return makeToken(TokenType::OR);
+            return makeToken(TokenType::INVALID, "|");
+        case '"':
             cursor_--;
             column_--;
-            tokens.push_back(number());
-        } else {
-            switch (c) {
-                case '(': tokens.push_back(makeToken(TokenType::LPAREN)); break;
-                case ')': tokens.push_back(makeToken(TokenType::RPAREN)); break;
-                case '{': tokens.push_back(makeToken(TokenType::LBRACE)); break;
-                case '}': tokens.push_back(makeToken(TokenType::RBRACE)); break;
-                case ',': tokens.push_back(makeToken(TokenType::COMMA)); break;
-                case '.': tokens.push_back(makeToken(TokenType::DOT)); break;
-                case ':': tokens.push_back(makeToken(TokenType::COLON)); break;
-                case ';': tokens.push_back(makeToken(TokenType::SEMICOLON)); break;
-                case '+': tokens.push_back(makeToken(TokenType::PLUS)); break;
-                case '-': 
-                    if (match('>')) tokens.push_back(makeToken(TokenType::ARROW));
-                    else tokens.push_back(makeToken(TokenType::MINUS));
-                    break;
-                case '*': tokens.push_back(makeToken(TokenType::STAR)); break;
-                case '/': tokens.push_back(makeToken(TokenType::SLASH)); break;
-                case '%': tokens.push_back(makeToken(TokenType::PERCENT)); break;
-                case '!':
-                    if (match('=')) tokens.push_back(makeToken(TokenType::NOT_EQUAL));
-                    else tokens.push_back(makeToken(TokenType::NOT));
-                    break;
-                case '=':
-                    if (match('=')) tokens.push_back(makeToken(TokenType::EQUAL));
-                    else tokens.push_back(makeToken(TokenType::ASSIGN));
-                    break;
-                case '<':
-                    if (match('=')) tokens.push_back(makeToken(TokenType::LESS_EQUAL));
-                    else tokens.push_back(makeToken(TokenType::LESS));
-                    break;
-                case '>':
-                    if (match('=')) tokens.push_back(makeToken(TokenType::GREATER_EQUAL));
-                    else tokens.push_back(makeToken(TokenType::GREATER));
-                    break;
-                case '&':
-                    if (match('&')) tokens.push_back(makeToken(TokenType::AND));
-                    else tokens.push_back(makeToken(TokenType::INVALID, "&"));
-                    break;
-                case '|':
-                    if (match('|')) tokens.push_back(makeToken(TokenType::OR));
-                    else tokens.push_back(makeToken(TokenType::INVALID, "|"));
-                    break;
-                case '"':
-                    cursor_--;
-                    column_--;
-                    tokens.push_back(string());
-                    break;
-                default:
-                    tokens.push_back(makeToken(TokenType::INVALID, std::string(1, c)));
-                    break;
-            }
-        }
+            return string();
+        default:
+            return makeToken(TokenType::INVALID, std::string(1, c));
     }
-    tokens.push_back(makeToken(TokenType::EOF_TOKEN));
-    return tokens;
 }
 
 char Lexer::peek() const {
@@ -168,7 +157,7 @@ void Lexer::skipWhitespaceAndComments() {
 }
 
 Token Lexer::makeToken(TokenType type, std::string value) {
-    return Token(type, std::move(value), line_, column_);
+    return Token(type, std::move(value), tokenLine_, tokenColumn_);
 }
 
 Token Lexer::identifier() {
@@ -193,6 +182,9 @@ Token Lexer::number() {
         return makeToken(TokenType::FLOAT, source_.substr(start, cursor_ - start));
     }
 
+    // Suffixes: L, u, uL (either case for u)
+    if (peek() == 'u' || peek() == 'U') advance();
+    if (peek() == 'L') advance();
     return makeToken(TokenType::INTEGER, source_.substr(start, cursor_ - start));
 }
 
@@ -228,6 +220,22 @@ bool Lexer::isAlphaNumeric(char c) const {
     return isAlpha(c) || isDigit(c);
 }
 
+IntegerLiteral parseIntegerLiteral(const std::string& text) {
+    IntegerLiteral literal;
+    size_t i = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+        uint64_t digit = static_cast<uint64_t>(text[i] - '0');
+        if (literal.value > (UINT64_MAX - digit) / 10) literal.overflow = true;
+        literal.value = literal.value * 10 + digit;
+    }
+    if (i < text.size() && (text[i] == 'u' || text[i] == 'U')) {
+        literal.isUnsigned = true;
+        ++i;
+    }
+    if (i < text.size() && text[i] == 'L') literal.isLong = true;
+    return literal;
+}
+
 std::string_view to_string(TokenType type) {
     switch (type) {
         case TokenType::FUN: return "FUN";
@@ -242,6 +250,8 @@ std::string_view to_string(TokenType type) {
         case TokenType::TRUE: return "TRUE";
         case TokenType::FALSE: return "FALSE";
         case TokenType::NULL_LITERAL: return "NULL";
+        case TokenType::TAILREC: return "TAILREC";
+        case TokenType::CONST: return "CONST";
         case TokenType::IDENTIFIER: return "IDENTIFIER";
         case TokenType::INTEGER: return "INTEGER";
         case TokenType::FLOAT: return "FLOAT";
@@ -270,6 +280,7 @@ std::string_view to_string(TokenType type) {
         case TokenType::COLON: return "COLON";
         case TokenType::SEMICOLON: return "SEMICOLON";
         case TokenType::ARROW: return "ARROW";
+        case TokenType::AT: return "AT";
         case TokenType::EOF_TOKEN: return "EOF";
         default: return "INVALID";
     }
@@ -10,12 +10,17 @@ class Lexer {
 public:
     explicit Lexer(std::string source);
     std::vector<Token> tokenize();
+    // The next token, or EOF_TOKEN (repeatedly) at the end of the source
+    Token next();
 
 private:
     std::string source_;
     size_t cursor_ = 0;
     int line_ = 1;
     int column_ = 1;
+    // Where the token being scanned starts
+    int tokenLine_ = 1;
+    int tokenColumn_ = 1;
 
     static const std::map<std::string, TokenType> keywords_;
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -8,6 +9,9 @@ namespace kotlin_lite {
 enum class TokenType {
     // Keywords
     FUN, VAL, VAR, IF, ELSE, WHILE, RETURN, BREAK, CONTINUE, TRUE, FALSE, NULL_LITERAL,
+
+    // Modifiers
+    TAILREC, CONST,
     
     // Reserved Keywords
     PACKAGE, IMPORT, CLASS, INTERFACE, WHEN, FOR, AS, IS, THIS, SUPER, IN,
@@ -21,7 +25,7 @@ enum class TokenType {
     LESS, GREATER, LESS_EQUAL, GREATER_EQUAL,
     AND, OR, NOT,
     LPAREN, RPAREN, LBRACE, RBRACE,
-    COMMA, DOT, COLON, SEMICOLON, ARROW,
+    COMMA, DOT, COLON, SEMICOLON, ARROW, AT,
 
     // Special
     EOF_TOKEN,
@@ -40,4 +44,16 @@ struct Token {
 
 std::string_view to_string(TokenType type);
 
+// The value of an INTEGER token: its digits and its suffix, `L` (Long), `u`
+// (UInt, or ULong if too large) or `uL` (ULong)
+struct IntegerLiteral {
+    uint64_t value = 0;
+    bool isLong = false;
+    bool isUnsigned = false;
+    // The digits do not fit in 64 bits
+    bool overflow = false;
+};
+
+IntegerLiteral parseIntegerLiteral(const std::string& text);
+
 } // namespace kotlin_lite
@@ -1,14 +1,57 @@
 #include <iostream>
 #include <string>
+#include <sstream>
 #include "compiler.hpp"
 
 void printUsage(const char* progName) {
-    std::cout << "Usage: " << progName << " <source_file> [options]\n"
+    std::cout << "Usage: " << progName << " <source_file> [options] [-- <program arguments>]\n"
               << "Options:\n"
               << "  -o <file>     Write output binary to <file>\n"
               << "  --dump-ir     Dump the custom SSA IR\n"
               << "  --dump-llvm   Dump the generated LLVM IR\n"
               << "  --run         Compile and run the program (default if no -o)\n"
+              << "  --interp      With --run: execute in the bytecode interpreter, skipping LLVM\n"
+              << "  --backend=<llvm|baseline>  Code generator; baseline emits x86-64 directly\n"
+              << "                for fast debug builds (-o x.o writes just the object)\n"
+              << "  --no-ir-opt   Skip the custom IR optimization passes\n"
+              << "  --no-whole-program  Keep every function externally visible\n"
+              << "  -g            Emit DWARF debug info (source lines and variables), also\n"
+              << "                for optimized code, for perf and gdb\n"
+              << "  --omit-frame-pointer  Free the frame pointer register; KL_SAMPLE_FILE\n"
+              << "                profiles of the binary lose their call stacks\n"
+              << "  --export=<fn>[,<fn>...]  Keep <fn> alive and externally visible\n"
+              << "  --report-dead List the unreachable functions that were skipped\n"
+              << "  --report-folded  Report calls evaluated at compile time\n"
+              << "  --report-peephole  Report how often each peephole rule fired\n"
+              << "  --remarks[=<regex>]  Print optimization remarks of the custom IR and LLVM\n"
+              << "                passes whose name matches <regex> (e.g. loop-vectorize|inline)\n"
+              << "  --remarks-file=<file>  With --remarks: also write them to <file> as YAML\n"
+              << "  --auto-parallel  Run independent reduction loops on several threads\n"
+              << "                (KL_NUM_THREADS sets the thread count at run time)\n"
+              << "  --stream      Compile one function at a time to bound memory on huge inputs\n"
+              << "  --profile-generate[=<file>]  Build a binary that writes an execution profile\n"
+              << "                to <file> (default.klprof) when it exits\n"
+              << "  --profile-use=<file>  Optimize for the profile written by such a binary\n"
+              << "  --instrument[=<base>]  Count calls, cycles and loop trips; the binary writes\n"
+              << "                a report to <base>.txt and <base>.json (kl_instrument) at exit\n"
+              << "  --emit-ir=<file>  Write the unoptimized custom IR in binary form\n"
+              << "  --autotune[=<budget>]  Time builds under different LLVM pipelines, loop\n"
+              << "                hints and custom passes, and keep the fastest in <source>.kltune;\n"
+              << "                <budget> is a number of builds (20) or a time, e.g. 120s or 5m\n"
+              << "  --tune-file=<file>  Tuning file to write and build with (default <source>.kltune,\n"
+              << "                which builds pick up automatically)\n"
+              << "  --no-tune     Ignore <source>.kltune\n"
+              << "  --target-cpu=<cpu>  Generate code for <cpu> (e.g. x86-64-v3, skylake) or\n"
+              << "                native, the host, instead of any x86-64\n"
+              << "  --target-features=<+f,-g...>  Enable or disable CPU features (e.g. +avx2)\n"
+              << "  --multiversion[=<fn>,...]  Also compile <fn> (default: the hot functions\n"
+              << "                of --profile-use) for x86-64-v2, v3 and v4, and use the best\n"
+              << "                version the CPU running the binary supports\n"
+              << "  --memoize-capacity=<n>  Cache up to <n> results (65536) of each @Memoize\n"
+              << "                function that sets no capacity of its own\n"
+              << "  -stats        Print what each pass did (counters) to stderr\n"
+              << "  -stats-json[=<file>]  Write the counters as JSON to <file> (kl_stats.json)\n"
+              << "  -- <args>     With --run: pass <args> to the program (see argInt)\n"
               << "  --help        Show this help message\n";
 }
 
@@ -22,12 +65,109 @@ int main(int argc, char** argv) {
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
-        if (arg == "--dump-ir") {
+        if (arg == "--") {
+            options.programArgs.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--dump-ir") {
             options.dumpIR = true;
         } else if (arg == "--dump-llvm") {
             options.dumpLLVM = true;
         } else if (arg == "--run") {
             options.shouldRun = true;
+        } else if (arg == "--interp") {
+            options.interpret = true;
+            options.shouldRun = true;
+        } else if (arg.rfind("--backend=", 0) == 0) {
+            options.backend = arg.substr(10);
+            if (options.backend != "llvm" && options.backend != "baseline") {
+                std::cerr << "Error: Unknown backend '" << options.backend << "' (expected llvm or baseline).\n";
+                return 1;
+            }
+        } else if (arg == "--no-ir-opt") {
+            options.optimizeIR = false;
+        } else if (arg == "-g") {
+            options.debugInfo = true;
+        } else if (arg == "--omit-frame-pointer") {
+            options.framePointers = false;
+        } else if (arg == "--no-whole-program") {
+            options.wholeProgram = false;
+        } else if (arg.rfind("--export=", 0) == 0) {
+            std::stringstream names(arg.substr(9));
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) options.exportedFunctions.push_back(name);
+            }
+        } else if (arg == "--report-dead") {
+            options.reportDead = true;
+        } else if (arg == "--report-folded") {
+            options.reportFolded = true;
+        } else if (arg == "--report-peephole") {
+            options.reportPeephole = true;
+        } else if (arg == "--remarks") {
+            options.remarks = true;
+        } else if (arg.rfind("--remarks=", 0) == 0) {
+            options.remarks = true;
+            options.remarksFilter = arg.substr(10);
+        } else if (arg.rfind("--remarks-file=", 0) == 0) {
+            options.remarks = true;
+            options.remarksFile = arg.substr(15);
+        } else if (arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--auto-parallel") {
+            options.autoParallel = true;
+        } else if (arg == "--profile-generate") {
+            options.profileGenerate = "default.klprof";
+        } else if (arg.rfind("--profile-generate=", 0) == 0) {
+            options.profileGenerate = arg.substr(19);
+        } else if (arg == "--instrument") {
+            options.instrument = "kl_instrument";
+        } else if (arg.rfind("--instrument=", 0) == 0) {
+            options.instrument = arg.substr(13);
+        } else if (arg.rfind("--profile-use=", 0) == 0) {
+            options.profileUse = arg.substr(14);
+        } else if (arg.rfind("--emit-ir=", 0) == 0) {
+            options.emitIRFile = arg.substr(10);
+        } else if (arg == "--autotune") {
+            options.autotune = "";
+        } else if (arg.rfind("--autotune=", 0) == 0) {
+            options.autotune = arg.substr(11);
+        } else if (arg.rfind("--tune-file=", 0) == 0) {
+            options.tuneFile = arg.substr(12);
+        } else if (arg == "--no-tune") {
+            options.useTuning = false;
+        } else if (arg.rfind("--target-cpu=", 0) == 0) {
+            options.targetCPU = arg.substr(13);
+        } else if (arg.rfind("--target-features=", 0) == 0) {
+            options.targetFeatures = arg.substr(18);
+        } else if (arg == "--multiversion") {
+            options.multiversion.emplace();
+        } else if (arg.rfind("--multiversion=", 0) == 0) {
+            options.multiversion.emplace();
+            std::stringstream names(arg.substr(15));
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) options.multiversion->push_back(name);
+            }
+        } else if (arg.rfind("--memoize-capacity=", 0) == 0) {
+            std::string value = arg.substr(19);
+            unsigned long capacity = 0;
+            try {
+                size_t used = 0;
+                capacity = std::stoul(value, &used);
+                if (used != value.size()) capacity = 0;
+            } catch (const std::exception&) {
+            }
+            if (capacity < 1 || capacity > (1u << 24)) {
+                std::cerr << "Error: --memoize-capacity must be between 1 and 16777216\n";
+                return 1;
+            }
+            options.memoizeCapacity = static_cast<unsigned>(capacity);
+        } else if (arg == "-stats") {
+            options.stats = true;
+        } else if (arg == "-stats-json") {
+            options.statsJson = "kl_stats.json";
+        } else if (arg.rfind("-stats-json=", 0) == 0) {
+            options.statsJson = arg.substr(12);
         } else if (arg == "-o" && i + 1 < argc) {
             options.outputFile = argv[++i];
         } else if (arg == "--help") {
@@ -45,7 +185,7 @@ int main(int argc, char** argv) {
     }
 
     // If no specific dump flag and no output file, default to run
-    if (!options.dumpIR && !options.dumpLLVM && options.outputFile.empty()) {
+    if (!options.dumpIR && !options.dumpLLVM && options.outputFile.empty() && options.emitIRFile.empty()) {
         options.shouldRun = true;
     }
 
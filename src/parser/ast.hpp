@@ -70,6 +70,24 @@ public:
     explicit GroupingExpr(std::unique_ptr<Expr> e) : expression(std::move(e)) {}
 };
 
+// `operand.toLong()` and the other integer conversions: toByte, toShort,
+// toInt, toLong, toUInt, toULong
+class ConversionExpr : public Expr {
+public:
+    std::unique_ptr<Expr> operand;
+    Token name;
+
+    ConversionExpr(std::unique_ptr<Expr> o, Token n)
+        : operand(std::move(o)), name(std::move(n)) {}
+};
+
+// `@Name` or `@Name(arg, ...)` before a function, `while` or `if`; the
+// arguments are integer literals
+struct Annotation {
+    Token name;
+    std::vector<Token> arguments;
+};
+
 // --- Statements ---
 class Stmt : public ASTNode {
 public:
@@ -106,21 +124,25 @@ public:
 
 class IfStmt : public Stmt {
 public:
+    Token keyword;
     std::unique_ptr<Expr> condition;
     std::unique_ptr<Stmt> then_branch;
     std::unique_ptr<Stmt> else_branch;
+    std::vector<Annotation> annotations;
 
-    IfStmt(std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> then_b, std::unique_ptr<Stmt> else_b)
-        : condition(std::move(cond)), then_branch(std::move(then_b)), else_branch(std::move(else_b)) {}
+    IfStmt(Token k, std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> then_b, std::unique_ptr<Stmt> else_b)
+        : keyword(std::move(k)), condition(std::move(cond)), then_branch(std::move(then_b)), else_branch(std::move(else_b)) {}
 };
 
 class WhileStmt : public Stmt {
 public:
+    Token keyword;
     std::unique_ptr<Expr> condition;
     std::unique_ptr<Stmt> body;
+    std::vector<Annotation> annotations;
 
-    WhileStmt(std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> b)
-        : condition(std::move(cond)), body(std::move(b)) {}
+    WhileStmt(Token k, std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> b)
+        : keyword(std::move(k)), condition(std::move(cond)), body(std::move(b)) {}
 };
 
 class ReturnStmt : public Stmt {
@@ -163,17 +185,32 @@ public:
     std::vector<Parameter> parameters;
     std::string return_type;
     std::unique_ptr<BlockStmt> body;
+    bool is_tailrec = false;
+    std::vector<Annotation> annotations;
 
     FunctionDecl(Token n, std::vector<Parameter> params, std::string ret_type, std::unique_ptr<BlockStmt> b)
         : name(std::move(n)), parameters(std::move(params)), return_type(std::move(ret_type)), body(std::move(b)) {}
 };
 
+// `const val NAME: Type = expr` at top level; the initializer is evaluated at compile time
+class ConstDecl : public ASTNode {
+public:
+    Token name;
+    std::string type; // Empty if inferred
+    std::unique_ptr<Expr> initializer;
+
+    ConstDecl(Token n, std::string t, std::unique_ptr<Expr> init)
+        : name(std::move(n)), type(std::move(t)), initializer(std::move(init)) {}
+};
+
 class KotlinFile : public ASTNode {
 public:
     std::vector<std::unique_ptr<FunctionDecl>> functions;
+    std::vector<std::unique_ptr<ConstDecl>> constants;
     
-    explicit KotlinFile(std::vector<std::unique_ptr<FunctionDecl>> funs)
-        : functions(std::move(funs)) {}
+    explicit KotlinFile(std::vector<std::unique_ptr<FunctionDecl>> funs,
+                        std::vector<std::unique_ptr<ConstDecl>> consts = {})
+        : functions(std::move(funs)), constants(std::move(consts)) {}
 };
 
 } // namespace kotlin_lite
@@ -0,0 +1,34 @@
+#include "declaration_stream.hpp"
+
+namespace kotlin_lite {
+
+namespace {
+
+bool startsDeclaration(TokenType type) {
+    return type == TokenType::FUN || type == TokenType::TAILREC || type == TokenType::CONST || type == TokenType::AT;
+}
+
+} // namespace
+
+std::optional<std::vector<Token>> DeclarationStream::next() {
+    if (lookahead_.type == TokenType::EOF_TOKEN) return std::nullopt;
+
+    std::vector<Token> tokens;
+    int depth = 0;
+    // Annotations and `tailrec` belong to the `fun` that follows them
+    bool sawHead = false;
+    do {
+        TokenType type = lookahead_.type;
+        if (type == TokenType::LPAREN || type == TokenType::LBRACE) depth++;
+        if ((type == TokenType::RPAREN || type == TokenType::RBRACE) && depth > 0) depth--;
+        if (type == TokenType::FUN || type == TokenType::CONST) sawHead = true;
+        tokens.push_back(std::move(lookahead_));
+        lookahead_ = lexer_.next();
+    } while (lookahead_.type != TokenType::EOF_TOKEN &&
+             !(sawHead && depth == 0 && startsDeclaration(lookahead_.type)));
+
+    tokens.push_back(Token(TokenType::EOF_TOKEN, "", lookahead_.line, lookahead_.column));
+    return tokens;
+}
+
+} // namespace kotlin_lite
@@ -0,0 +1,28 @@
+#pragma once
+#include "lexer/lexer.hpp"
+#include <optional>
+#include <vector>
+
+namespace kotlin_lite {
+
+// Cuts the token stream of a source file into top-level declarations without
+// building an AST, so a file can be parsed one declaration at a time.
+//
+// Each chunk holds the tokens of one `[tailrec] fun` or `const val`,
+// followed by EOF_TOKEN, and can be handed to a Parser on its own. A
+// declaration ends where a token that starts the next one (`fun`, `tailrec`,
+// `const`) appears outside any parentheses or braces. Malformed input still
+// yields chunks; the parser reports the error with the original line.
+class DeclarationStream {
+public:
+    explicit DeclarationStream(std::string source) : lexer_(std::move(source)), lookahead_(lexer_.next()) {}
+
+    // The next declaration, or nullopt at the end of the file
+    std::optional<std::vector<Token>> next();
+
+private:
+    Lexer lexer_;
+    Token lookahead_;
+};
+
+} // namespace kotlin_lite
@@ -7,13 +7,44 @@ Parser::Parser(std::vector<Token> tokens) : tokens_(std::move(tokens)) {}
 
 std::unique_ptr<KotlinFile> Parser::parse() {
     std::vector<std::unique_ptr<FunctionDecl>> functions;
+    std::vector<std::unique_ptr<ConstDecl>> constants;
     while (!isAtEnd()) {
-        functions.push_back(functionDecl());
+        if (match({TokenType::CONST})) {
+            constants.push_back(constDecl());
+        } else {
+            functions.push_back(functionDecl());
+        }
     }
-    return std::make_unique<KotlinFile>(std::move(functions));
+    return std::make_unique<KotlinFile>(std::move(functions), std::move(constants));
+}
+
+std::unique_ptr<ConstDecl> Parser::constDecl() {
+    consume(TokenType::VAL, "Expect 'val' after 'const'.");
+    Token name = consume(TokenType::IDENTIFIER, "Expect constant name.");
+
+    std::string type = "";
+    if (match({TokenType::COLON})) {
+        type = consume(TokenType::IDENTIFIER, "Expect type name.").value;
+    }
+
+    consume(TokenType::ASSIGN, "Expect '=' for constant initialization.");
+    std::unique_ptr<Expr> initializer = expression();
+    return std::make_unique<ConstDecl>(std::move(name), type, std::move(initializer));
+}
+
+std::unique_ptr<FunctionDecl> Parser::parseSignature() {
+    return functionSignature();
 }
 
 std::unique_ptr<FunctionDecl> Parser::functionDecl() {
+    auto decl = functionSignature();
+    decl->body = block();
+    return decl;
+}
+
+std::unique_ptr<FunctionDecl> Parser::functionSignature() {
+    std::vector<Annotation> annotations = annotationList();
+    bool isTailrec = match({TokenType::TAILREC});
     consume(TokenType::FUN, "Expect 'fun' for function declaration.");
     Token name = consume(TokenType::IDENTIFIER, "Expect function name.");
     
@@ -31,8 +62,27 @@ std::unique_ptr<FunctionDecl> Parser::functionDecl() {
         returnType = consume(TokenType::IDENTIFIER, "Expect return type.").value;
     }
 
-    std::unique_ptr<BlockStmt> body = block();
-    return std::make_unique<FunctionDecl>(std::move(name), std::move(parameters), returnType, std::move(body));
+    auto decl = std::make_unique<FunctionDecl>(std::move(name), std::move(parameters), returnType, nullptr);
+    decl->is_tailrec = isTailrec;
+    decl->annotations = std::move(annotations);
+    return decl;
+}
+
+std::vector<Annotation> Parser::annotationList() {
+    std::vector<Annotation> annotations;
+    while (match({TokenType::AT})) {
+        Annotation annotation{consume(TokenType::IDENTIFIER, "Expect annotation name after '@'."), {}};
+        if (match({TokenType::LPAREN})) {
+            if (!check(TokenType::RPAREN)) {
+                do {
+                    annotation.arguments.push_back(consume(TokenType::INTEGER, "Expect integer annotation argument."));
+                } while (match({TokenType::COMMA}));
+            }
+            consume(TokenType::RPAREN, "Expect ')' after annotation arguments.");
+        }
+        annotations.push_back(std::move(annotation));
+    }
+    return annotations;
 }
 
 Parameter Parser::parameter() {
@@ -53,6 +103,7 @@ std::unique_ptr<BlockStmt> Parser::block() {
 }
 
 std::unique_ptr<Stmt> Parser::statement() {
+    if (check(TokenType::AT)) return annotatedStatement();
     if (match({TokenType::VAL, TokenType::VAR})) return variableDecl();
     if (match({TokenType::IF})) return ifStatement();
     if (match({TokenType::WHILE})) return whileStatement();
@@ -69,6 +120,21 @@ std::unique_ptr<Stmt> Parser::statement() {
     return std::make_unique<ExprStmt>(expression());
 }
 
+std::unique_ptr<Stmt> Parser::annotatedStatement() {
+    std::vector<Annotation> annotations = annotationList();
+    if (match({TokenType::IF})) {
+        auto stmt = ifStatement();
+        static_cast<IfStmt&>(*stmt).annotations = std::move(annotations);
+        return stmt;
+    }
+    if (match({TokenType::WHILE})) {
+        auto stmt = whileStatement();
+        static_cast<WhileStmt&>(*stmt).annotations = std::move(annotations);
+        return stmt;
+    }
+    throw std::runtime_error("Expect 'if' or 'while' after annotation.");
+}
+
 std::unique_ptr<Stmt> Parser::variableDecl() {
     bool is_val = previous().type == TokenType::VAL;
     Token name = consume(TokenType::IDENTIFIER, "Expect variable name.");
@@ -92,6 +158,7 @@ std::unique_ptr<Stmt> Parser::assignment() {
 }
 
 std::unique_ptr<Stmt> Parser::ifStatement() {
+    Token keyword = previous();
     consume(TokenType::LPAREN, "Expect '(' after 'if'.");
     std::unique_ptr<Expr> condition = expression();
     consume(TokenType::RPAREN, "Expect ')' after condition.");
@@ -102,16 +169,17 @@ std::unique_ptr<Stmt> Parser::ifStatement() {
         elseBranch = statement();
     }
 
-    return std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+    return std::make_unique<IfStmt>(std::move(keyword), std::move(condition), std::move(thenBranch), std::move(elseBranch));
 }
 
 std::unique_ptr<Stmt> Parser::whileStatement() {
+    Token keyword = previous();
     consume(TokenType::LPAREN, "Expect '(' after 'while'.");
     std::unique_ptr<Expr> condition = expression();
     consume(TokenType::RPAREN, "Expect ')' after condition.");
     std::unique_ptr<Stmt> body = statement();
 
-    return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    return std::make_unique<WhileStmt>(std::move(keyword), std::move(condition), std::move(body));
 }
 
 std::unique_ptr<Stmt> Parser::returnStatement() {
@@ -193,7 +261,19 @@ std::unique_ptr<Expr> Parser::unary() {
         std::unique_ptr<Expr> right = unary();
         return std::make_unique<UnaryExpr>(std::move(op), std::move(right));
     }
-    return primary();
+    return postfix();
+}
+
+// Only conversions for now: `expr.toLong()`
+std::unique_ptr<Expr> Parser::postfix() {
+    std::unique_ptr<Expr> expr = primary();
+    while (match({TokenType::DOT})) {
+        Token name = consume(TokenType::IDENTIFIER, "Expect conversion name after '.'.");
+        consume(TokenType::LPAREN, "Expect '(' after conversion name.");
+        consume(TokenType::RPAREN, "Expect ')' after '(' of a conversion.");
+        expr = std::make_unique<ConversionExpr>(std::move(expr), std::move(name));
+    }
+    return expr;
 }
 
 std::unique_ptr<Expr> Parser::primary() {
@@ -10,6 +10,8 @@ class Parser {
 public:
     explicit Parser(std::vector<Token> tokens);
     std::unique_ptr<KotlinFile> parse();
+    // Just `[@Annotation...] [tailrec] fun name(params): Type`, leaving the body null
+    std::unique_ptr<FunctionDecl> parseSignature();
 
 private:
     std::vector<Token> tokens_;
@@ -17,9 +19,13 @@ private:
 
     // --- Grammar Rules ---
     std::unique_ptr<FunctionDecl> functionDecl();
+    std::unique_ptr<FunctionDecl> functionSignature();
+    std::unique_ptr<ConstDecl> constDecl();
+    std::vector<Annotation> annotationList();
     Parameter parameter();
     std::unique_ptr<BlockStmt> block();
     std::unique_ptr<Stmt> statement();
+    std::unique_ptr<Stmt> annotatedStatement();
     std::unique_ptr<Stmt> variableDecl();
     std::unique_ptr<Stmt> assignment();
     std::unique_ptr<Stmt> ifStatement();
@@ -34,6 +40,7 @@ private:
     std::unique_ptr<Expr> addition();
     std::unique_ptr<Expr> multiplication();
     std::unique_ptr<Expr> unary();
+    std::unique_ptr<Expr> postfix();
     std::unique_ptr<Expr> primary();
 
     // --- Helpers ---
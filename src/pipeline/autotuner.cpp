@@ -0,0 +1,232 @@
+#include "autotuner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace kotlin_lite {
+
+namespace {
+
+const char* kHeader = "kotlin-lite tuning 1";
+const char* kPipelines[] = {"O3", "O2", "Os", "O1"};
+
+bool isPipeline(const std::string& name) {
+    return std::find(std::begin(kPipelines), std::end(kPipelines), name) != std::end(kPipelines);
+}
+
+// The settings as "key value" lines, in file order
+std::vector<std::pair<std::string, std::string>> settings(const Tuning& tuning) {
+    std::vector<std::pair<std::string, std::string>> lines = {
+        {"pipeline", tuning.pipeline},
+        {"inline-threshold", std::to_string(tuning.inlineThreshold)},
+        {"unroll-count", std::to_string(tuning.unrollCount)},
+        {"vector-width", std::to_string(tuning.vectorWidth)},
+        {"interleave-count", std::to_string(tuning.interleaveCount)},
+        {"slp-vectorize", tuning.slpVectorization ? "1" : "0"},
+    };
+    for (const std::string& pass : tuning.disabledPasses) lines.push_back({"disable-pass", pass});
+    return lines;
+}
+
+// The configurations that differ from `base` in one setting only, one list per setting
+template <typename T>
+std::vector<Tuning> vary(const Tuning& base, T Tuning::*field, std::initializer_list<T> values) {
+    std::vector<Tuning> result;
+    for (const T& value : values) {
+        if (base.*field == value) continue;
+        result.push_back(base);
+        result.back().*field = value;
+    }
+    return result;
+}
+
+std::vector<std::vector<Tuning>> neighbours(const Tuning& base) {
+    // Roughly by how much each setting tends to matter, so that a small
+    // budget goes to the likely wins
+    std::vector<std::vector<Tuning>> result = {
+        vary<std::string>(base, &Tuning::pipeline, {kPipelines[0], kPipelines[1], kPipelines[2], kPipelines[3]}),
+        vary<unsigned>(base, &Tuning::vectorWidth, {0, 1, 2, 4, 8}),
+        vary<unsigned>(base, &Tuning::unrollCount, {0, 1, 2, 4, 8}),
+        vary<int>(base, &Tuning::inlineThreshold, {0, 100, 500, 1000}),
+        vary<unsigned>(base, &Tuning::interleaveCount, {0, 1, 2, 4}),
+        vary<bool>(base, &Tuning::slpVectorization, {true, false}),
+    };
+    for (const std::string& pass : tunablePasses()) {
+        Tuning flipped = base;
+        if (!flipped.disabledPasses.erase(pass)) flipped.disabledPasses.insert(pass);
+        result.push_back({flipped});
+    }
+    return result;
+}
+
+} // namespace
+
+// Not tailrec: a program may depend on it for its stack depth
+const std::vector<std::string>& tunablePasses() {
+    static const std::vector<std::string> passes = {"consteval", "ipcp", "peephole", "loop-fusion", "loop-interchange"};
+    return passes;
+}
+
+std::string Tuning::describe() const {
+    auto defaults = settings(Tuning());
+    std::string result;
+    for (const auto& [key, value] : settings(*this)) {
+        if (key != "disable-pass" && std::find(defaults.begin(), defaults.end(), std::make_pair(key, value)) != defaults.end()) {
+            continue;
+        }
+        result += (result.empty() ? "" : " ") + key + "=" + value;
+    }
+    return result.empty() ? "defaults" : result;
+}
+
+Tuning Tuning::parse(const std::string& text) {
+    std::istringstream in(text);
+    std::string line;
+    int number = 1;
+    auto fail = [&](const std::string& message) {
+        return std::runtime_error("tuning line " + std::to_string(number) + ": " + message);
+    };
+    if (!std::getline(in, line) || line != kHeader) throw fail("expected '" + std::string(kHeader) + "'");
+
+    Tuning tuning;
+    while (std::getline(in, line)) {
+        ++number;
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            size_t start = line.find_first_not_of("# ");
+            if (tuning.note.empty() && start != std::string::npos) tuning.note = line.substr(start);
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string key, value, extra;
+        if (!(fields >> key >> value) || fields >> extra) throw fail("expected '<setting> <value>'");
+        auto number32 = [&]() {
+            try {
+                size_t used = 0;
+                long parsed = std::stol(value, &used);
+                if (used == value.size() && parsed >= 0 && parsed <= 1000000) return static_cast<int>(parsed);
+            } catch (const std::exception&) {
+            }
+            throw fail("invalid " + key + " '" + value + "'");
+        };
+        if (key == "pipeline") {
+            if (!isPipeline(value)) throw fail("unknown pipeline '" + value + "'");
+            tuning.pipeline = value;
+        } else if (key == "inline-threshold") {
+            tuning.inlineThreshold = number32();
+        } else if (key == "unroll-count") {
+            tuning.unrollCount = static_cast<unsigned>(number32());
+        } else if (key == "vector-width") {
+            tuning.vectorWidth = static_cast<unsigned>(number32());
+        } else if (key == "interleave-count") {
+            tuning.interleaveCount = static_cast<unsigned>(number32());
+        } else if (key == "slp-vectorize") {
+            if (value != "0" && value != "1") throw fail("invalid slp-vectorize '" + value + "'");
+            tuning.slpVectorization = value == "1";
+        } else if (key == "disable-pass") {
+            const auto& passes = tunablePasses();
+            if (std::find(passes.begin(), passes.end(), value) == passes.end()) throw fail("unknown pass '" + value + "'");
+            tuning.disabledPasses.insert(value);
+        } else if (key == "source") {
+            try {
+                tuning.sourceHash = std::stoull(value, nullptr, 16);
+            } catch (const std::exception&) {
+                throw fail("invalid source hash '" + value + "'");
+            }
+        } else {
+            throw fail("unknown setting '" + key + "'");
+        }
+    }
+    return tuning;
+}
+
+Tuning Tuning::readFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("cannot read tuning file " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    try {
+        return parse(buffer.str());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+std::string Tuning::format() const {
+    std::stringstream ss;
+    ss << kHeader << "\n";
+    if (!note.empty()) ss << "# " << note << "\n";
+    if (sourceHash) ss << "source " << std::hex << sourceHash << std::dec << "\n";
+    for (const auto& [key, value] : settings(*this)) ss << key << " " << value << "\n";
+    return ss.str();
+}
+
+void Tuning::writeFile(const std::string& path) const {
+    std::ofstream file(path);
+    if (!(file << format())) throw std::runtime_error("cannot write tuning file " + path);
+}
+
+std::string Tuning::defaultPath(const std::string& source) {
+    return std::filesystem::path(source).replace_extension(".kltune").string();
+}
+
+// FNV-1a
+uint64_t Tuning::hashSource(const std::string& text) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::optional<Tuning> Autotuner::run() {
+    trials_.clear();
+    auto start = std::chrono::steady_clock::now();
+    auto budgetLeft = [&] {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<int>(trials_.size()) < options_.maxTrials &&
+               (options_.maxSeconds <= 0 || elapsed.count() < options_.maxSeconds);
+    };
+    auto faster = [&](const Summary& candidate, const Summary& best) {
+        double margin = std::max(options_.minGain * best.median, candidate.mad + best.mad);
+        return candidate.median < best.median - margin;
+    };
+
+    size_t best = 0;
+    std::set<std::string> tried;
+    auto attempt = [&](const Tuning& tuning) {
+        tried.insert(tuning.format());
+        trials_.push_back({tuning, evaluate_(tuning), false});
+        Trial& trial = trials_.back();
+        if (trials_.size() == 1) {
+            trial.best = trial.time.has_value();
+        } else if (trial.time && faster(*trial.time, *trials_[best].time)) {
+            trial.best = true;
+            best = trials_.size() - 1;
+        }
+        if (onTrial_) onTrial_(trial, trials_[best]);
+        return trial.best;
+    };
+
+    if (!attempt(Tuning())) return std::nullopt;
+    for (bool improved = true; improved && budgetLeft();) {
+        improved = false;
+        size_t settingCount = neighbours(Tuning()).size();
+        for (size_t setting = 0; setting < settingCount; ++setting) {
+            // Around the best configuration as it is now, which may have moved during this round
+            std::vector<Tuning> candidates = neighbours(trials_[best].tuning)[setting];
+            for (const Tuning& candidate : candidates) {
+                if (!budgetLeft()) return trials_[best].tuning;
+                if (tried.count(candidate.format())) continue;
+                improved |= attempt(candidate);
+            }
+        }
+    }
+    return trials_[best].tuning;
+}
+
+} // namespace kotlin_lite
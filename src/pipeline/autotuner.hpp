@@ -0,0 +1,112 @@
+#pragma once
+#include "program_runner.hpp"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+
+// How a program is optimized beyond the fixed defaults, as found by
+// `--autotune` and saved next to the source as `<name>.kltune`:
+//
+//     kotlin-lite tuning 1
+//     # prime.kt: 0.412 s, 4.2% faster than the defaults (0.430 s); 20 configurations tried
+//     source 5f0c2b1a9e3d4c77
+//     pipeline O3
+//     inline-threshold 500
+//     unroll-count 4
+//     vector-width 0
+//     interleave-count 0
+//     slp-vectorize 1
+//     disable-pass loop-fusion
+//
+// Every setting only changes how well the program runs, never what it does.
+struct Tuning {
+    // LLVM's default pipeline for this level: O1, O2, O3 or Os
+    std::string pipeline = "O3";
+    // Inliner threshold; 0 keeps the pipeline's own
+    int inlineThreshold = 0;
+    // Hints put on every loop. 0 leaves the choice to LLVM; an unroll count
+    // or vector width of 1 turns that transform off
+    unsigned unrollCount = 0;
+    unsigned vectorWidth = 0;
+    unsigned interleaveCount = 0;
+    bool slpVectorization = true;
+    // Custom IR passes to skip, by their kotlin-lite-opt names
+    std::set<std::string> disabledPasses;
+
+    // Hash of the source the tuning was found for, 0 if unknown
+    uint64_t sourceHash = 0;
+    // The first comment line, written by --autotune
+    std::string note;
+
+    bool passEnabled(const std::string& pass) const { return !disabledPasses.count(pass); }
+    // The settings that differ from the defaults, e.g. "O2 unroll-count=4", or "defaults"
+    std::string describe() const;
+
+    // Both throw std::runtime_error on malformed input
+    static Tuning parse(const std::string& text);
+    static Tuning readFile(const std::string& path);
+    std::string format() const;
+    // Throws std::runtime_error
+    void writeFile(const std::string& path) const;
+
+    // Where `--autotune` saves the tuning of `source`: prime.kt -> prime.kltune
+    static std::string defaultPath(const std::string& source);
+    static uint64_t hashSource(const std::string& text);
+};
+
+// The custom IR passes that a tuning may disable
+const std::vector<std::string>& tunablePasses();
+
+// Searches the tuning space for the fastest configuration of one program.
+//
+// `evaluate` builds the program with a configuration and times it; the
+// defaults are evaluated first. The search is coordinate descent: each
+// setting in turn is tried at its other values while the rest stay at the
+// best configuration so far, and a value that wins is kept. Rounds repeat
+// until one brings no gain or the budget runs out. A configuration only
+// replaces the best one when its median time is lower by more than
+// `minGain` and by more than the two median absolute deviations, so noise
+// does not move the search.
+class Autotuner {
+public:
+    struct Options {
+        // Stop after this many configurations, or once `maxSeconds` have
+        // passed (if positive), whichever comes first
+        int maxTrials = 20;
+        double maxSeconds = 0;
+        double minGain = 0.01;
+    };
+
+    // The time of a build, or nullopt if it failed to build, crashed or
+    // printed something other than the defaults
+    using Evaluate = std::function<std::optional<Summary>(const Tuning&)>;
+
+    struct Trial {
+        Tuning tuning;
+        std::optional<Summary> time;
+        bool best = false;  // became the best configuration when tried
+    };
+
+    Autotuner(Options options, Evaluate evaluate) : options_(options), evaluate_(std::move(evaluate)) {}
+
+    // Returns the best configuration; nullopt if even the defaults failed
+    std::optional<Tuning> run();
+
+    // In the order they were tried; the first is the defaults
+    const std::vector<Trial>& getTrials() const { return trials_; }
+    // Called after each trial, for progress output
+    void onTrial(std::function<void(const Trial&, const Trial& best)> callback) { onTrial_ = std::move(callback); }
+
+private:
+    Options options_;
+    Evaluate evaluate_;
+    std::vector<Trial> trials_;
+    std::function<void(const Trial&, const Trial& best)> onTrial_;
+};
+
+} // namespace kotlin_lite
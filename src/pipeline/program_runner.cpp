@@ -0,0 +1,196 @@
+#include "program_runner.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace kotlin_lite {
+
+// --- Statistics ---
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    if (n == 0) return 0;
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+Summary summarize(const std::vector<double>& samples) {
+    Summary s;
+    if (samples.empty()) return s;
+    s.median = median(samples);
+    std::vector<double> deviations;
+    for (double x : samples) deviations.push_back(std::fabs(x - s.median));
+    s.mad = median(deviations);
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    double n = static_cast<double>(sorted.size());
+    double spread = 1.96 * std::sqrt(n) / 2;
+    long lower = static_cast<long>(std::floor(n / 2 - spread));
+    long upper = static_cast<long>(std::ceil(n / 2 + spread));
+    lower = std::max(0L, lower);
+    upper = std::min(static_cast<long>(sorted.size()) - 1, upper);
+    s.low = sorted[lower];
+    s.high = sorted[upper];
+    return s;
+}
+
+// --- Hardware counters ---
+
+namespace {
+
+struct CounterSpec {
+    const char* name;
+    uint64_t config;
+};
+
+const CounterSpec kCounters[] = {
+    {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+    {"branch-misses", PERF_COUNT_HW_BRANCH_MISSES},
+    {"cache-misses", PERF_COUNT_HW_CACHE_MISSES},
+};
+
+int openCounter(uint64_t config, pid_t pid) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+// Scaled up when the kernel multiplexed the counter
+std::optional<double> readCounter(int fd) {
+    uint64_t values[3];
+    if (read(fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0) return std::nullopt;
+    return static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]);
+}
+
+double now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+} // namespace
+
+const std::vector<std::string>& hardwareCounterNames() {
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> result;
+        for (const auto& spec : kCounters) result.push_back(spec.name);
+        return result;
+    }();
+    return names;
+}
+
+bool hardwareCountersAvailable(std::string& why) {
+    int probe = openCounter(PERF_COUNT_HW_CPU_CYCLES, 0);
+    if (probe < 0) {
+        why = std::string("perf_event_open: ") + std::strerror(errno);
+        return false;
+    }
+    close(probe);
+    return true;
+}
+
+// --- Running a program ---
+
+bool runProgram(const std::string& path, const std::vector<std::string>& args, int cpu, bool counters,
+                bool captureOutput, Run& run, std::string& error) {
+    // Built before the fork: the child only calls async-signal-safe functions
+    std::vector<char*> argv = {const_cast<char*>(path.c_str())};
+    for (const std::string& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    int go[2], out[2] = {-1, -1};
+    if (pipe(go) != 0 || (captureOutput && pipe(out) != 0)) {
+        error = std::string("pipe: ") + std::strerror(errno);
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = std::string("fork: ") + std::strerror(errno);
+        return false;
+    }
+    if (pid == 0) {
+        close(go[1]);
+        char byte;
+        if (read(go[0], &byte, 1) != 1) _exit(127);
+        close(go[0]);
+        if (cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+        int target = captureOutput ? out[1] : open("/dev/null", O_WRONLY);
+        dup2(target, STDOUT_FILENO);
+        close(target);
+        if (captureOutput) close(out[0]);
+        execv(path.c_str(), argv.data());
+        _exit(127);
+    }
+
+    close(go[0]);
+    std::vector<std::pair<const char*, int>> fds;
+    if (counters) {
+        for (const auto& spec : kCounters) {
+            int fd = openCounter(spec.config, pid);
+            if (fd >= 0) fds.push_back({spec.name, fd});
+        }
+    }
+    if (captureOutput) close(out[1]);
+
+    double start = now();
+    ssize_t released = write(go[1], "x", 1);
+    close(go[1]);
+    if (captureOutput) {
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(out[0], buffer, sizeof(buffer))) > 0) run.output.append(buffer, static_cast<size_t>(n));
+        close(out[0]);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    run.seconds = now() - start;
+
+    for (const auto& [name, fd] : fds) {
+        if (auto value = readCounter(fd)) run.counters[name] = *value;
+        close(fd);
+    }
+    // kotlin-lite's `main` returns nothing, so its exit status means nothing
+    // either; only a crash or a failed exec counts
+    if (released != 1 || WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) == 127)) {
+        error = path + (WIFSIGNALED(status) ? " was killed by signal " + std::to_string(WTERMSIG(status))
+                                            : " could not be run");
+        return false;
+    }
+    return true;
+}
+
+int lastAllowedCpu() {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+    for (int cpu = CPU_SETSIZE - 1; cpu >= 0; --cpu) {
+        if (CPU_ISSET(cpu, &set)) return cpu;
+    }
+    return 0;
+}
+
+} // namespace kotlin_lite
@@ -0,0 +1,50 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+
+// Repeated timing of compiled programs, shared by kotlin-lite-bench and
+// --autotune: robust statistics of the samples, and a runner that pins the
+// program to one core and counts with the hardware counters.
+
+double median(std::vector<double> values);
+
+struct Summary {
+    double median = 0;
+    // Median absolute deviation from the median
+    double mad = 0;
+    // 95% confidence interval of the median, from order statistics, so it
+    // holds whatever the distribution; with fewer than 6 runs it is the range
+    double low = 0;
+    double high = 0;
+};
+
+Summary summarize(const std::vector<double>& samples);
+
+// The hardware counters counted per run, by name ("cycles", "instructions",
+// "branch-misses", "cache-misses")
+const std::vector<std::string>& hardwareCounterNames();
+// False, with the reason, when perf_event_open is not available
+bool hardwareCountersAvailable(std::string& why);
+
+struct Run {
+    double seconds = 0;
+    std::map<std::string, double> counters;
+    std::string output;
+};
+
+// Runs `path` with `args`, pinned to `cpu` (unless negative), optionally
+// counting with the available hardware counters and capturing stdout (else
+// discarded). The child waits on a pipe until the counters are attached to
+// it, and they start counting at exec. Fails, with `error`, if the program
+// cannot be started or is killed by a signal.
+bool runProgram(const std::string& path, const std::vector<std::string>& args, int cpu, bool counters,
+                bool captureOutput, Run& run, std::string& error);
+
+// The highest-numbered core this process may run on, usually the one least
+// disturbed by interrupts
+int lastAllowedCpu();
+
+} // namespace kotlin_lite
@@ -0,0 +1,185 @@
+#include "streaming_compiler.hpp"
+#include "bounded_queue.hpp"
+#include "parser/declaration_stream.hpp"
+#include "parser/parser.hpp"
+#include "semantic/semantic_analyzer.hpp"
+#include "ir/ir_builder.hpp"
+#include "ir/ir_generator.hpp"
+#include "ir/function_attrs.hpp"
+#include "ir/statistics.hpp"
+#include "transforms/const_eval.hpp"
+#include "transforms/tail_recursion.hpp"
+#include "transforms/peephole.hpp"
+#include <exception>
+#include <map>
+#include <thread>
+
+namespace kotlin_lite {
+
+namespace {
+
+// Replaces every `call @const.X()` with the constant's value
+void substituteConstants(ir::Function& func, const std::map<std::string, ir::Value*>& values) {
+    for (auto& bb : func.blocks) {
+        for (auto it = bb->instructions.begin(); it != bb->instructions.end();) {
+            auto call = dynamic_cast<ir::CallInst*>(it->get());
+            auto value = call ? values.find(call->callee) : values.end();
+            if (value == values.end()) {
+                ++it;
+                continue;
+            }
+            func.replaceAllUsesWith(call, value->second);
+            it = bb->instructions.erase(it);
+        }
+    }
+}
+
+} // namespace
+
+std::unique_ptr<llvm::Module> StreamingCompiler::compile(std::string source) {
+    errors_.clear();
+    unsupported_.clear();
+    stats_ = {};
+
+    // Pass 1: the signature table. Bodies are tokenized but not parsed.
+    SemanticAnalyzer analyzer;
+    ir::IRGenerator irGen;
+    std::vector<std::unique_ptr<FunctionDecl>> signatures;
+    std::vector<std::unique_ptr<ConstDecl>> constants;
+    {
+        DeclarationStream scan(source);
+        while (auto tokens = scan.next()) {
+            if (tokens->front().type == TokenType::CONST) {
+                auto file = Parser(std::move(*tokens)).parse();
+                for (auto& constant : file->constants) constants.push_back(std::move(constant));
+            } else {
+                signatures.push_back(Parser(std::move(*tokens)).parseSignature());
+            }
+        }
+    }
+    std::vector<std::unique_ptr<ir::Function>> declarations;
+    for (const auto& signature : signatures) {
+        analyzer.declareFunction(*signature);
+        declarations.push_back(irGen.declareFunction(*signature));
+    }
+    signatures.clear();
+    for (const auto& constant : constants) analyzer.declareConstant(*constant);
+    if (!analyzer.getErrors().empty()) {
+        errors_ = analyzer.getErrors();
+        return nullptr;
+    }
+
+    // Constants are evaluated on their own: each is read through a probe
+    // `ret call @const.X()` that evaluation folds to the value
+    std::map<std::string, ir::Value*> constantValues;
+    if (!constants.empty()) {
+        ir::Module constModule;
+        std::vector<std::pair<std::string, ir::Function*>> probes;
+        for (const auto& constant : constants) {
+            auto init = irGen.lowerConstant(*constant);
+            auto probe = std::make_unique<ir::Function>("probe." + constant->name.value, init->returnType, std::vector<ir::Argument>{});
+            ir::IRBuilder builder;
+            builder.setInsertPoint(probe->createBlock("entry"));
+            builder.createRet(builder.createCall(init->returnType, init->name, {}));
+            probes.push_back({init->name, probe.get()});
+            constModule.addFunction(std::move(init));
+            constModule.addFunction(std::move(probe));
+        }
+        ir::CompileTimeEvaluation::Options evalOptions;
+        evalOptions.foldCalls = options_.optimizeIR;
+        ir::CompileTimeEvaluation eval(evalOptions);
+        eval.run(constModule);
+        for (const auto& [name, reason] : eval.getUnfoldedConstants()) {
+            unsupported_ = "const val '" + name + "' cannot be evaluated on its own: it " + reason;
+            return nullptr;
+        }
+        for (const auto& [name, probe] : probes) {
+            auto ret = static_cast<ir::ReturnInst*>(probe->blocks.front()->getTerminator());
+            constantValues[name] = ret->value;
+        }
+    }
+
+    // Pass 2: parse -> check and lower -> emit
+    BoundedQueue<std::unique_ptr<FunctionDecl>> parsed(options_.queueCapacity);
+    BoundedQueue<std::unique_ptr<ir::Module>> lowered(options_.queueCapacity);
+    std::exception_ptr parseError, lowerError;
+
+    std::thread parser([&, source = std::move(source)]() mutable {
+        try {
+            DeclarationStream decls(std::move(source));
+            while (auto tokens = decls.next()) {
+                if (tokens->front().type == TokenType::CONST) continue;
+                auto file = Parser(std::move(*tokens)).parse();
+                for (auto& func : file->functions) {
+                    if (!parsed.push(std::move(func))) return;
+                }
+            }
+        } catch (...) {
+            parseError = std::current_exception();
+        }
+        parsed.close();
+    });
+
+    std::thread lowerer([&] {
+        try {
+            while (auto decl = parsed.pop()) {
+                // After the first error, bodies are still checked but no longer lowered
+                analyzer.analyzeFunction(**decl);
+                if (!analyzer.getErrors().empty()) continue;
+                auto module = std::make_unique<ir::Module>();
+                module->addFunction(irGen.lowerFunction(**decl));
+                decl->reset();
+                substituteConstants(*module->functions.front(), constantValues);
+                ir::recordIRSize(*module, false);
+                if (options_.optimizeIR) {
+                    ir::TailRecursionElimination().run(*module);
+                    ir::PeepholeOptimizer().run(*module);
+                } else {
+                    ir::TailRecursionElimination().runOnTailrecFunctions(*module);
+                }
+                ir::recordIRSize(*module, true);
+                if (options_.dumpIR) *options_.dumpIR << module->dump();
+                if (!lowered.push(std::move(module))) break;
+            }
+        } catch (...) {
+            lowerError = std::current_exception();
+        }
+        parsed.close();
+        lowered.close();
+    });
+
+    auto join = [&] {
+        parsed.close();
+        lowered.close();
+        parser.join();
+        lowerer.join();
+    };
+    std::unique_ptr<llvm::Module> result;
+    try {
+        codegen_.beginModule();
+        for (const auto& decl : declarations) codegen_.declareFunction(*decl);
+        while (auto module = lowered.pop()) {
+            const ir::Function& func = *(*module)->functions.front();
+            codegen_.emitFunction(func, ir::FunctionAttrs(**module).get(func.name));
+            stats_.functions++;
+        }
+        result = codegen_.finishModule();
+    } catch (...) {
+        join();
+        throw;
+    }
+    join();
+    if (parseError) std::rethrow_exception(parseError);
+    if (lowerError) std::rethrow_exception(lowerError);
+
+    stats_.maxQueuedDeclarations = parsed.highWater();
+    stats_.maxQueuedFunctions = lowered.highWater();
+    analyzer.checkMemoizedFunctions();
+    if (!analyzer.getErrors().empty()) {
+        errors_ = analyzer.getErrors();
+        return nullptr;
+    }
+    return result;
+}
+
+} // namespace kotlin_lite
@@ -0,0 +1,64 @@
+#pragma once
+#include "codegen/llvm_codegen.hpp"
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <llvm/IR/Module.h>
+
+namespace kotlin_lite {
+
+// Compiles a source file one function at a time, for inputs too large to hold
+// as a whole AST and IR (`--stream`).
+//
+// A first pass over the tokens builds the signature table: every function's
+// signature and every `const val`, whose values are evaluated up front. Then
+// three stages run on their own threads, connected by bounded queues:
+//
+//     parse  ->  check and lower to IR  ->  emit LLVM IR
+//
+// A function's AST is freed once it is lowered and its IR once it is
+// emitted, so apart from the LLVM module memory stays flat in the number of
+// functions. Passes that need the whole program (reachability, IPCP,
+// compile-time evaluation of calls, loop transforms) are skipped; tail
+// recursion elimination and the peephole rules run on each function, and
+// LLVM still optimizes the complete module.
+class StreamingCompiler {
+public:
+    struct Options {
+        bool optimizeIR = true;
+        // Declarations in flight between two stages
+        size_t queueCapacity = 16;
+        CodegenOptions codegen;
+        // Each function's custom IR is printed here once lowered
+        std::ostream* dumpIR = nullptr;
+    };
+
+    struct Statistics {
+        int functions = 0;
+        // Most items ever waiting between the stages
+        size_t maxQueuedDeclarations = 0;
+        size_t maxQueuedFunctions = 0;
+    };
+
+    explicit StreamingCompiler(Options options) : options_(std::move(options)), codegen_(options_.codegen) {}
+
+    // Null when the program has errors (getErrors) or needs the whole-file
+    // pipeline (getUnsupported). The module lives as long as this compiler.
+    std::unique_ptr<llvm::Module> compile(std::string source);
+
+    const std::vector<std::string>& getErrors() const { return errors_; }
+    // Why the program cannot be compiled one function at a time
+    const std::string& getUnsupported() const { return unsupported_; }
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    Options options_;
+    LLVMCodegen codegen_;
+    std::vector<std::string> errors_;
+    std::string unsupported_;
+    Statistics stats_;
+};
+
+} // namespace kotlin_lite
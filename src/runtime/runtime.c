@@ -1,3 +1,5 @@
+/* For the sampling profiler: REG_RIP, pthread_getattr_np, dladdr */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 
@@ -5,6 +7,18 @@ void print_i32(int32_t value) {
     printf("%d\n", value);
 }
 
+void print_i64(int64_t value) {
+    printf("%lld\n", (long long)value);
+}
+
+void print_u32(uint32_t value) {
+    printf("%u\n", value);
+}
+
+void print_u64(uint64_t value) {
+    printf("%llu\n", (unsigned long long)value);
+}
+
 void print_bool(int8_t value) {
     if (value) {
         printf("true\n");
@@ -13,3 +27,926 @@ void print_bool(int8_t value) {
     }
 }
 
+
+/* Micro-benchmarking builtins.
+ *
+ * nanoTime reads the monotonic clock in nanoseconds. blackhole has no
+ * definition: the LLVM backend lowers it to an empty asm statement and the
+ * baseline backend drops it. argCount and argInt give the program's
+ * command-line arguments, which glibc passes to constructors, as the Kotlin
+ * main has no parameters. */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int kl_argc;
+static char** kl_argv;
+
+__attribute__((constructor)) static void kl_save_arguments(int argc, char** argv, char** envp) {
+    (void)envp;
+    kl_argc = argc;
+    kl_argv = argv;
+}
+
+int64_t nanoTime(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+int32_t argCount(void) {
+    return kl_argc > 0 ? kl_argc - 1 : 0;
+}
+
+/* Argument `index` (0 is the first after the program name) as a decimal Int,
+ * or `fallback` if it is missing or not an Int */
+int32_t argInt(int32_t index, int32_t fallback) {
+    if (index < 0 || index >= argCount()) return fallback;
+    const char* text = kl_argv[index + 1];
+    char* end;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || value < INT32_MIN || value > INT32_MAX) return fallback;
+    return (int32_t)value;
+}
+
+/* Function multiversioning (--multiversion).
+ *
+ * The x86-64 level of this CPU as the psABI defines them: 1 for the
+ * baseline, then 2 (SSE4.2, POPCNT), 3 (AVX2, BMI2, FMA) and 4 (AVX-512).
+ * The ifunc resolvers of multiversioned functions call it while the dynamic
+ * loader relocates the program, before any constructor has run, so it
+ * initializes the CPU model itself. __builtin_cpu_supports also checks that
+ * the OS saves the AVX registers. */
+int32_t kl_cpu_level(void) {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (!(__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))) {
+        return 1;
+    }
+    if (!(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2") &&
+          __builtin_cpu_supports("fma"))) {
+        return 2;
+    }
+    if (!(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+          __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") &&
+          __builtin_cpu_supports("avx512vl"))) {
+        return 3;
+    }
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+/* Parallel reductions (see the auto-parallel pass).
+ *
+ * kl_parallel_reduce runs a counted loop `for (i = init; i <pred> bound; i += step)`
+ * whose body has been outlined into `chunk(start, end, env)`, which runs the
+ * iterations from start up to (but excluding) end and returns their partial
+ * reduction. The range is cut into a fixed number of chunks, which a small
+ * pool of threads picks up; the partials are combined in chunk order, so the
+ * result does not depend on the thread count or on scheduling.
+ *
+ * KL_NUM_THREADS sets the pool size (default: one per online CPU) and
+ * KL_PARALLEL_MIN_TRIPS the trip count below which the loop runs serially. */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef int32_t (*kl_chunk_fn)(int32_t start, int32_t end, void* env);
+
+enum { KL_LT, KL_LE, KL_GT, KL_GE, KL_NE };
+enum { KL_ADD, KL_MUL };
+enum { KL_CHUNKS_PER_THREAD = 8 };
+
+struct kl_job {
+    kl_chunk_fn fn;
+    void* env;
+    int64_t init;
+    int64_t step;
+    int64_t trips;
+    int64_t chunks;
+    int inclusive;       /* the loop test is <= or >= */
+    int32_t* partials;
+    int64_t next;        /* next chunk to run */
+    int64_t done;
+    unsigned generation;
+};
+
+static pthread_mutex_t kl_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t kl_pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t kl_pool_idle = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t kl_reduce_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t kl_pool_once = PTHREAD_ONCE_INIT;
+static struct kl_job kl_current;
+static int kl_threads = 0;
+static int64_t kl_min_trips = 10000;
+static _Thread_local int kl_in_parallel = 0;
+
+static int32_t kl_combine(int op, int32_t a, int32_t b) {
+    /* Wrapping, like the compiled loop */
+    return op == KL_MUL ? (int32_t)((uint32_t)a * (uint32_t)b) : (int32_t)((uint32_t)a + (uint32_t)b);
+}
+
+static void kl_run_chunk(struct kl_job* job, int64_t k) {
+    int64_t per = job->trips / job->chunks, extra = job->trips % job->chunks;
+    int64_t first = k * per + (k < extra ? k : extra);
+    int64_t count = per + (k < extra ? 1 : 0);
+    int32_t start = (int32_t)(job->init + first * job->step);
+    /* Exclusive tests stop at the first iteration of the next chunk,
+     * inclusive ones at the last iteration of this one */
+    int32_t end = (int32_t)(job->init + (first + count - job->inclusive) * job->step);
+    job->partials[k] = job->fn(start, end, job->env);
+}
+
+/* Runs chunks of the current job until none are left */
+static void kl_drain(void) {
+    pthread_mutex_lock(&kl_pool_lock);
+    while (kl_current.next < kl_current.chunks) {
+        int64_t k = kl_current.next++;
+        pthread_mutex_unlock(&kl_pool_lock);
+        kl_run_chunk(&kl_current, k);
+        pthread_mutex_lock(&kl_pool_lock);
+        if (++kl_current.done == kl_current.chunks) pthread_cond_broadcast(&kl_pool_idle);
+    }
+    pthread_mutex_unlock(&kl_pool_lock);
+}
+
+static void kl_inst_thread_start(void);
+static void kl_sample_thread_start(void);
+
+static void* kl_worker(void* arg) {
+    (void)arg;
+    kl_inst_thread_start();
+    kl_sample_thread_start();
+    kl_in_parallel = 1;
+    unsigned seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&kl_pool_lock);
+        while (kl_current.generation == seen) pthread_cond_wait(&kl_pool_work, &kl_pool_lock);
+        seen = kl_current.generation;
+        pthread_mutex_unlock(&kl_pool_lock);
+        kl_drain();
+    }
+    return NULL;
+}
+
+static void kl_start_pool(void) {
+    const char* env = getenv("KL_NUM_THREADS");
+    long n = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    env = getenv("KL_PARALLEL_MIN_TRIPS");
+    if (env) kl_min_trips = strtoll(env, NULL, 10);
+    kl_threads = n > 1 ? (int)n : 1;
+    /* The calling thread works too */
+    for (int i = 1; i < kl_threads; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, kl_worker, NULL) != 0) {
+            kl_threads = i;
+            break;
+        }
+        pthread_detach(thread);
+    }
+}
+
+/* Number of iterations, or -1 if the loop does not terminate the way the
+ * compiled code would (it wraps around or never reaches its bound). */
+static int64_t kl_trip_count(int64_t init, int64_t bound, int64_t step, int pred) {
+    int64_t trips;
+    switch (pred) {
+        case KL_LT: trips = init < bound ? (bound - init + step - 1) / step : 0; break;
+        case KL_LE: trips = init <= bound ? (bound - init) / step + 1 : 0; break;
+        case KL_GT: trips = init > bound ? (init - bound - step - 1) / -step : 0; break;
+        case KL_GE: trips = init >= bound ? (init - bound) / -step + 1 : 0; break;
+        default:
+            if ((bound - init) % step != 0 || (bound - init) / step < 0) return -1;
+            trips = (bound - init) / step;
+            break;
+    }
+    if (trips > 0) {
+        int64_t after = init + trips * step;
+        if (after > INT32_MAX || after < INT32_MIN) return -1;
+    }
+    return trips;
+}
+
+int32_t kl_parallel_reduce(kl_chunk_fn fn, int32_t init, int32_t bound, int32_t step, int32_t pred, int32_t op, void* env) {
+    /* Loops nested in a parallel chunk run serially on their thread */
+    if (kl_in_parallel) return fn(init, bound, env);
+    pthread_once(&kl_pool_once, kl_start_pool);
+
+    int64_t trips = kl_trip_count(init, bound, step, pred);
+    if (kl_threads == 1 || trips < kl_min_trips) return fn(init, bound, env);
+
+    int64_t chunks = (int64_t)kl_threads * KL_CHUNKS_PER_THREAD;
+    if (chunks > trips) chunks = trips;
+    int32_t* partials = malloc(sizeof(int32_t) * chunks);
+    if (!partials) return fn(init, bound, env);
+
+    /* One loop runs on the pool at a time */
+    pthread_mutex_lock(&kl_reduce_lock);
+    pthread_mutex_lock(&kl_pool_lock);
+    kl_current.fn = fn;
+    kl_current.env = env;
+    kl_current.init = init;
+    kl_current.step = step;
+    kl_current.trips = trips;
+    kl_current.chunks = chunks;
+    kl_current.inclusive = pred == KL_LE || pred == KL_GE;
+    kl_current.partials = partials;
+    kl_current.next = 0;
+    kl_current.done = 0;
+    kl_current.generation++;
+    pthread_cond_broadcast(&kl_pool_work);
+    pthread_mutex_unlock(&kl_pool_lock);
+
+    kl_in_parallel = 1;
+    kl_drain();
+    kl_in_parallel = 0;
+    pthread_mutex_lock(&kl_pool_lock);
+    while (kl_current.done < kl_current.chunks) pthread_cond_wait(&kl_pool_idle, &kl_pool_lock);
+    pthread_mutex_unlock(&kl_pool_lock);
+    pthread_mutex_unlock(&kl_reduce_lock);
+
+    int32_t result = op == KL_MUL ? 1 : 0;
+    for (int64_t k = 0; k < chunks; ++k) result = kl_combine(op, result, partials[k]);
+    free(partials);
+    return result;
+}
+
+
+/* Profiles (--profile-generate).
+ *
+ * An instrumented main registers its counter array together with a layout
+ * of one "name hash count" line per function. At exit the counters are
+ * written in the format ir::Profile reads: the header line, then each layout
+ * line followed by that function's counters. KL_PROFILE_FILE overrides the
+ * file name given at compile time. */
+
+#include <string.h>
+
+static const uint64_t* kl_prof_counters;
+static int64_t kl_prof_size;
+static const char* kl_prof_layout;
+static const char* kl_prof_file;
+
+static void kl_prof_write(void) {
+    const char* path = getenv("KL_PROFILE_FILE");
+    if (!path || !*path) path = kl_prof_file;
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "kotlin-lite: cannot write profile %s\n", path);
+        return;
+    }
+    fprintf(out, "kotlin-lite profile 1\n");
+    int64_t next = 0;
+    for (const char* line = kl_prof_layout; *line;) {
+        const char* end = strchr(line, '\n');
+        if (!end) end = line + strlen(line);
+        const char* last = end;
+        while (last > line && last[-1] != ' ') --last;
+        int64_t count = strtoll(last, NULL, 10);
+        fprintf(out, "%.*s\n", (int)(end - line), line);
+        for (int64_t i = 0; i < count && next < kl_prof_size; ++i, ++next) {
+            fprintf(out, i ? " %llu" : "%llu", (unsigned long long)kl_prof_counters[next]);
+        }
+        fputc('\n', out);
+        line = *end ? end + 1 : end;
+    }
+    fclose(out);
+}
+
+void kl_prof_register(const uint64_t* counters, int64_t size, const char* layout, const char* file) {
+    if (kl_prof_counters) return;
+    kl_prof_counters = counters;
+    kl_prof_size = size;
+    kl_prof_layout = layout;
+    kl_prof_file = file;
+    atexit(kl_prof_write);
+}
+
+
+/* Instrumentation (--instrument).
+ *
+ * Instrumented code counts into a per-thread buffer, kl_inst_buffer: slot 0
+ * holds the cycles spent in callees of the running timed function, then
+ * each function has four slots (calls, inclusive cycles, exclusive cycles,
+ * recursion depth), laid out by the compiler. Loops report each finished run
+ * through kl_inst_loop into the loop part of the same buffer. At exit the
+ * buffers of all threads are summed into a text report sorted by cost and a
+ * JSON file, `<file>.txt` and `<file>.json`; KL_INSTRUMENT_FILE overrides
+ * the file name given at compile time. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum { KL_INST_CALLS, KL_INST_INCLUSIVE, KL_INST_EXCLUSIVE, KL_INST_DEPTH, KL_INST_FUNCTION_SLOTS };
+/* Per loop: runs, iterations, most iterations, then a histogram where bucket
+ * 0 counts runs of no iterations and bucket k runs of [2^(k-1), 2^k) */
+enum { KL_INST_RUNS, KL_INST_ITERATIONS, KL_INST_MAX, KL_INST_HISTOGRAM, KL_INST_BUCKETS = 64,
+       KL_INST_LOOP_SLOTS = KL_INST_HISTOGRAM + KL_INST_BUCKETS };
+
+struct kl_inst_thread {
+    uint64_t* counters;
+    struct kl_inst_thread* next;
+};
+
+_Thread_local uint64_t* kl_inst_buffer;
+static pthread_mutex_t kl_inst_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct kl_inst_thread* kl_inst_threads;
+static int64_t kl_inst_functions = -1;
+static int64_t kl_inst_loops;
+static const char* kl_inst_layout;
+static const char* kl_inst_file;
+static uint64_t kl_inst_start;
+
+/* The counter instrumented code reads through llvm.readcyclecounter */
+static uint64_t kl_inst_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static size_t kl_inst_size(void) {
+    return 1 + (size_t)kl_inst_functions * KL_INST_FUNCTION_SLOTS + (size_t)kl_inst_loops * KL_INST_LOOP_SLOTS;
+}
+
+static void kl_inst_thread_start(void) {
+    if (kl_inst_functions < 0 || kl_inst_buffer) return;
+    struct kl_inst_thread* thread = calloc(1, sizeof(struct kl_inst_thread));
+    uint64_t* counters = calloc(kl_inst_size(), sizeof(uint64_t));
+    if (!thread || !counters) {
+        fprintf(stderr, "kotlin-lite: out of memory for instrumentation counters\n");
+        abort();
+    }
+    thread->counters = counters;
+    pthread_mutex_lock(&kl_inst_lock);
+    thread->next = kl_inst_threads;
+    kl_inst_threads = thread;
+    pthread_mutex_unlock(&kl_inst_lock);
+    kl_inst_buffer = counters;
+}
+
+void kl_inst_loop(int32_t loop, int64_t iterations) {
+    uint64_t* slots = kl_inst_buffer + 1 + kl_inst_functions * KL_INST_FUNCTION_SLOTS + (int64_t)loop * KL_INST_LOOP_SLOTS;
+    uint64_t n = iterations > 0 ? (uint64_t)iterations : 0;
+    slots[KL_INST_RUNS]++;
+    slots[KL_INST_ITERATIONS] += n;
+    if (n > slots[KL_INST_MAX]) slots[KL_INST_MAX] = n;
+    int bucket = n ? 64 - __builtin_clzll(n) : 0;
+    if (bucket >= KL_INST_BUCKETS) bucket = KL_INST_BUCKETS - 1;
+    slots[KL_INST_HISTOGRAM + bucket]++;
+}
+
+struct kl_inst_entry {
+    char name[128];
+    int line;
+    int timed;
+    const uint64_t* slots;
+};
+
+static const char* kl_inst_field(const char* p, char* out, size_t size) {
+    while (*p == ' ') ++p;
+    size_t n = 0;
+    while (*p && *p != ' ' && *p != '\n') {
+        if (n + 1 < size) out[n++] = *p;
+        ++p;
+    }
+    out[n] = 0;
+    return p;
+}
+
+static int kl_inst_by_exclusive(const void* a, const void* b) {
+    uint64_t x = ((const struct kl_inst_entry*)a)->slots[KL_INST_EXCLUSIVE];
+    uint64_t y = ((const struct kl_inst_entry*)b)->slots[KL_INST_EXCLUSIVE];
+    uint64_t cx = ((const struct kl_inst_entry*)a)->slots[KL_INST_CALLS];
+    uint64_t cy = ((const struct kl_inst_entry*)b)->slots[KL_INST_CALLS];
+    return x != y ? (x < y ? 1 : -1) : cx != cy ? (cx < cy ? 1 : -1) : 0;
+}
+
+static int kl_inst_by_iterations(const void* a, const void* b) {
+    uint64_t x = ((const struct kl_inst_entry*)a)->slots[KL_INST_ITERATIONS];
+    uint64_t y = ((const struct kl_inst_entry*)b)->slots[KL_INST_ITERATIONS];
+    return x != y ? (x < y ? 1 : -1) : 0;
+}
+
+static void kl_inst_json_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') fputc('\\', out);
+        fputc(*text, out);
+    }
+    fputc('"', out);
+}
+
+static FILE* kl_inst_open(const char* base, const char* extension) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%s", base, extension);
+    FILE* out = fopen(path, "w");
+    if (!out) fprintf(stderr, "kotlin-lite: cannot write instrumentation report %s\n", path);
+    return out;
+}
+
+static void kl_inst_write(void) {
+    uint64_t total = kl_inst_cycles() - kl_inst_start;
+    size_t size = kl_inst_size();
+    uint64_t* sum = calloc(size, sizeof(uint64_t));
+    struct kl_inst_entry* functions = calloc((size_t)kl_inst_functions + 1, sizeof(struct kl_inst_entry));
+    struct kl_inst_entry* loops = calloc((size_t)kl_inst_loops + 1, sizeof(struct kl_inst_entry));
+    if (!sum || !functions || !loops) return;
+
+    pthread_mutex_lock(&kl_inst_lock);
+    for (struct kl_inst_thread* t = kl_inst_threads; t; t = t->next) {
+        for (size_t i = 0; i < size; ++i) {
+            size_t loopSlot = i - 1 - (size_t)kl_inst_functions * KL_INST_FUNCTION_SLOTS;
+            int isMax = i > (size_t)kl_inst_functions * KL_INST_FUNCTION_SLOTS && loopSlot % KL_INST_LOOP_SLOTS == KL_INST_MAX;
+            if (isMax) sum[i] = t->counters[i] > sum[i] ? t->counters[i] : sum[i];
+            else sum[i] += t->counters[i];
+        }
+    }
+    pthread_mutex_unlock(&kl_inst_lock);
+
+    /* The layout: "function <name> <line> timed|counted" and "loop <function> <line>" lines */
+    int64_t f = 0, l = 0;
+    for (const char* p = kl_inst_layout; *p;) {
+        char kind[16], name[128], line[16], timed[16] = "";
+        p = kl_inst_field(p, kind, sizeof(kind));
+        p = kl_inst_field(p, name, sizeof(name));
+        p = kl_inst_field(p, line, sizeof(line));
+        int isFunction = strcmp(kind, "function") == 0;
+        if (isFunction) p = kl_inst_field(p, timed, sizeof(timed));
+        while (*p && *p != '\n') ++p;
+        if (*p) ++p;
+        struct kl_inst_entry* entry = isFunction ? &functions[f] : &loops[l];
+        if (isFunction ? f >= kl_inst_functions : l >= kl_inst_loops) break;
+        snprintf(entry->name, sizeof(entry->name), "%s", name);
+        entry->line = atoi(line);
+        entry->timed = strcmp(timed, "timed") == 0;
+        entry->slots = isFunction ? sum + 1 + f++ * KL_INST_FUNCTION_SLOTS
+                                  : sum + 1 + kl_inst_functions * KL_INST_FUNCTION_SLOTS + l++ * KL_INST_LOOP_SLOTS;
+    }
+    qsort(functions, (size_t)f, sizeof(*functions), kl_inst_by_exclusive);
+    qsort(loops, (size_t)l, sizeof(*loops), kl_inst_by_iterations);
+
+    const char* base = getenv("KL_INSTRUMENT_FILE");
+    if (!base || !*base) base = kl_inst_file;
+    FILE* out = kl_inst_open(base, ".txt");
+    if (out) {
+        fprintf(out, "%llu cycles in total\n\nFunctions by exclusive cycles:\n", (unsigned long long)total);
+        fprintf(out, "%20s %7s %20s %14s  %s\n", "exclusive", "%", "inclusive", "calls", "function");
+        for (int64_t i = 0; i < f; ++i) {
+            const uint64_t* s = functions[i].slots;
+            if (functions[i].timed) {
+                fprintf(out, "%20llu %6.2f%% %20llu %14llu  %s (line %d)\n", (unsigned long long)s[KL_INST_EXCLUSIVE],
+                        total ? 100.0 * (double)s[KL_INST_EXCLUSIVE] / (double)total : 0.0,
+                        (unsigned long long)s[KL_INST_INCLUSIVE], (unsigned long long)s[KL_INST_CALLS], functions[i].name,
+                        functions[i].line);
+            } else {
+                fprintf(out, "%20s %7s %20s %14llu  %s (line %d, not timed)\n", "-", "", "-",
+                        (unsigned long long)s[KL_INST_CALLS], functions[i].name, functions[i].line);
+            }
+        }
+        fprintf(out, "\nLoops by iterations:\n%20s %14s %14s %14s  %s\n", "iterations", "runs", "average", "most", "loop");
+        for (int64_t i = 0; i < l; ++i) {
+            const uint64_t* s = loops[i].slots;
+            fprintf(out, "%20llu %14llu %14.1f %14llu  %s (line %d)\n", (unsigned long long)s[KL_INST_ITERATIONS],
+                    (unsigned long long)s[KL_INST_RUNS],
+                    s[KL_INST_RUNS] ? (double)s[KL_INST_ITERATIONS] / (double)s[KL_INST_RUNS] : 0.0,
+                    (unsigned long long)s[KL_INST_MAX], loops[i].name, loops[i].line);
+            for (int k = 0; k < KL_INST_BUCKETS; ++k) {
+                uint64_t runs = s[KL_INST_HISTOGRAM + k];
+                if (!runs) continue;
+                if (k == 0) fprintf(out, "%58s0 iterations: %llu run(s)\n", "", (unsigned long long)runs);
+                else fprintf(out, "%58s%llu..%llu iterations: %llu run(s)\n", "", 1ull << (k - 1),
+                             (k < 64 ? (1ull << k) : 0ull) - 1, (unsigned long long)runs);
+            }
+        }
+        fclose(out);
+    }
+
+    out = kl_inst_open(base, ".json");
+    if (out) {
+        fprintf(out, "{\n  \"total_cycles\": %llu,\n  \"functions\": [", (unsigned long long)total);
+        for (int64_t i = 0; i < f; ++i) {
+            const uint64_t* s = functions[i].slots;
+            fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+            kl_inst_json_string(out, functions[i].name);
+            fprintf(out, ", \"line\": %d, \"calls\": %llu", functions[i].line, (unsigned long long)s[KL_INST_CALLS]);
+            if (functions[i].timed) {
+                fprintf(out, ", \"inclusive_cycles\": %llu, \"exclusive_cycles\": %llu",
+                        (unsigned long long)s[KL_INST_INCLUSIVE], (unsigned long long)s[KL_INST_EXCLUSIVE]);
+            }
+            fputc('}', out);
+        }
+        fprintf(out, "\n  ],\n  \"loops\": [");
+        for (int64_t i = 0; i < l; ++i) {
+            const uint64_t* s = loops[i].slots;
+            fprintf(out, "%s\n    {\"function\": ", i ? "," : "");
+            kl_inst_json_string(out, loops[i].name);
+            fprintf(out, ", \"line\": %d, \"runs\": %llu, \"iterations\": %llu, \"max_iterations\": %llu, \"histogram\": [",
+                    loops[i].line, (unsigned long long)s[KL_INST_RUNS], (unsigned long long)s[KL_INST_ITERATIONS],
+                    (unsigned long long)s[KL_INST_MAX]);
+            int first = 1;
+            for (int k = 0; k < KL_INST_BUCKETS; ++k) {
+                uint64_t runs = s[KL_INST_HISTOGRAM + k];
+                if (!runs) continue;
+                fprintf(out, "%s{\"min\": %llu, \"max\": %llu, \"runs\": %llu}", first ? "" : ", ",
+                        k ? 1ull << (k - 1) : 0ull, k ? (k < 64 ? (1ull << k) : 0ull) - 1 : 0ull, (unsigned long long)runs);
+                first = 0;
+            }
+            fprintf(out, "]}");
+        }
+        fprintf(out, "\n  ]\n}\n");
+        fclose(out);
+    }
+    free(sum);
+    free(functions);
+    free(loops);
+}
+
+void kl_inst_register(int64_t functions, int64_t loops, const char* layout, const char* file) {
+    if (kl_inst_functions >= 0) return;
+    kl_inst_functions = functions;
+    kl_inst_loops = loops;
+    kl_inst_layout = layout;
+    kl_inst_file = file;
+    kl_inst_thread_start();
+    atexit(kl_inst_write);
+    kl_inst_start = kl_inst_cycles();
+}
+
+
+/* Sampling profiler.
+ *
+ * Setting KL_SAMPLE_FILE profiles any kotlin-lite binary without rebuilding
+ * it. SIGPROF interrupts the running thread KL_SAMPLE_HZ times per second of
+ * CPU time (default 997). The handler walks the frame-pointer chain, which
+ * the compiler keeps unless --omit-frame-pointer is given, and pushes the
+ * stack into a ring buffer owned by that thread; it takes no locks and does
+ * not allocate. A collector thread drains the rings into a table of distinct
+ * stacks. At exit the stacks are symbolized from the executable's symbol
+ * table and written to KL_SAMPLE_FILE in the folded format flamegraph.pl
+ * reads: "main;outer;inner <samples>" per line. */
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+
+enum { KL_SAMPLE_DEPTH = 64, KL_SAMPLE_RING = 256, KL_SAMPLE_DRAIN_MS = 20 };
+
+struct kl_sample {
+    uint32_t depth;
+    uintptr_t pcs[KL_SAMPLE_DEPTH]; /* innermost first */
+};
+
+/* Single producer (the thread's signal handler), single consumer (the collector) */
+struct kl_sample_ring {
+    _Atomic uint64_t head;
+    _Atomic uint64_t tail;
+    uintptr_t stackLow, stackHigh;
+    struct kl_sample_ring* next;
+    struct kl_sample samples[KL_SAMPLE_RING];
+};
+
+struct kl_sample_stack {
+    uint64_t hash;
+    uint64_t count;
+    uint32_t depth;
+    uintptr_t* pcs;
+};
+
+static int kl_sample_enabled;
+static const char* kl_sample_file;
+static _Thread_local struct kl_sample_ring* kl_sample_ring;
+static _Atomic uint64_t kl_sample_dropped;
+static int kl_sample_stop;
+static pthread_t kl_sample_collector_thread;
+/* Guards the ring list, the stack table and kl_sample_stop */
+static pthread_mutex_t kl_sample_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t kl_sample_stopped = PTHREAD_COND_INITIALIZER;
+static struct kl_sample_ring* kl_sample_rings;
+static struct kl_sample_stack* kl_sample_table;
+static size_t kl_sample_capacity, kl_sample_stacks;
+
+static void kl_sample_signal(int sig, siginfo_t* info, void* context) {
+    (void)sig;
+    (void)info;
+    struct kl_sample_ring* ring = kl_sample_ring;
+    if (!ring) {
+        atomic_fetch_add_explicit(&kl_sample_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == KL_SAMPLE_RING) {
+        atomic_fetch_add_explicit(&kl_sample_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    struct kl_sample* sample = &ring->samples[head % KL_SAMPLE_RING];
+    const ucontext_t* uc = context;
+#if defined(__x86_64__)
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.pc;
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.regs[29];
+#endif
+    uint32_t depth = 0;
+    sample->pcs[depth++] = pc;
+    /* A frame is {saved frame pointer, return address}; only follow frames
+     * that lie on this thread's stack, further out than the last one */
+    while (depth < KL_SAMPLE_DEPTH && fp % sizeof(uintptr_t) == 0 && fp >= ring->stackLow &&
+           fp + 2 * sizeof(uintptr_t) <= ring->stackHigh) {
+        const uintptr_t* frame = (const uintptr_t*)fp;
+        if (!frame[1]) break;
+        sample->pcs[depth++] = frame[1] - 1; /* inside the call */
+        if (frame[0] <= fp) break;
+        fp = frame[0];
+    }
+    sample->depth = depth;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void kl_sample_thread_start(void) {
+    if (!kl_sample_enabled || kl_sample_ring) return;
+    struct kl_sample_ring* ring = calloc(1, sizeof(struct kl_sample_ring));
+    if (!ring) return;
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void* low;
+        size_t size;
+        if (pthread_attr_getstack(&attr, &low, &size) == 0) {
+            ring->stackLow = (uintptr_t)low;
+            ring->stackHigh = (uintptr_t)low + size;
+        }
+        pthread_attr_destroy(&attr);
+    }
+    pthread_mutex_lock(&kl_sample_lock);
+    ring->next = kl_sample_rings;
+    kl_sample_rings = ring;
+    pthread_mutex_unlock(&kl_sample_lock);
+    kl_sample_ring = ring;
+}
+
+static uint64_t kl_sample_hash(const struct kl_sample* sample) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t i = 0; i < sample->depth; ++i) hash = (hash ^ sample->pcs[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+/* Open addressing; the table is at most half full */
+static void kl_sample_insert(uint64_t hash, uint32_t depth, uintptr_t* pcs, uint64_t count) {
+    size_t i = hash & (kl_sample_capacity - 1);
+    while (kl_sample_table[i].pcs) {
+        struct kl_sample_stack* slot = &kl_sample_table[i];
+        if (slot->hash == hash && slot->depth == depth && memcmp(slot->pcs, pcs, depth * sizeof(uintptr_t)) == 0) {
+            slot->count += count;
+            free(pcs);
+            return;
+        }
+        i = (i + 1) & (kl_sample_capacity - 1);
+    }
+    kl_sample_table[i] = (struct kl_sample_stack){hash, count, depth, pcs};
+    kl_sample_stacks++;
+}
+
+static void kl_sample_add(const struct kl_sample* sample) {
+    if (2 * (kl_sample_stacks + 1) > kl_sample_capacity) {
+        struct kl_sample_stack* old = kl_sample_table;
+        size_t oldCapacity = kl_sample_capacity;
+        size_t capacity = oldCapacity ? 2 * oldCapacity : 256;
+        struct kl_sample_stack* table = calloc(capacity, sizeof(struct kl_sample_stack));
+        if (!table) return;
+        kl_sample_table = table;
+        kl_sample_capacity = capacity;
+        kl_sample_stacks = 0;
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (old[i].pcs) kl_sample_insert(old[i].hash, old[i].depth, old[i].pcs, old[i].count);
+        }
+        free(old);
+    }
+    uintptr_t* pcs = malloc(sample->depth * sizeof(uintptr_t));
+    if (!pcs) return;
+    memcpy(pcs, sample->pcs, sample->depth * sizeof(uintptr_t));
+    kl_sample_insert(kl_sample_hash(sample), sample->depth, pcs, 1);
+}
+
+/* Called with kl_sample_lock held */
+static void kl_sample_drain(void) {
+    for (struct kl_sample_ring* ring = kl_sample_rings; ring; ring = ring->next) {
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; ++tail) kl_sample_add(&ring->samples[tail % KL_SAMPLE_RING]);
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+}
+
+static void* kl_sample_collector(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&kl_sample_lock);
+    while (!kl_sample_stop) {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_nsec += KL_SAMPLE_DRAIN_MS * 1000000L;
+        if (wake.tv_nsec >= 1000000000L) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&kl_sample_stopped, &kl_sample_lock, &wake);
+        kl_sample_drain();
+    }
+    pthread_mutex_unlock(&kl_sample_lock);
+    return NULL;
+}
+
+struct kl_symbol {
+    uintptr_t start, end;
+    const char* name;
+};
+
+static struct kl_symbol* kl_symbols;
+static size_t kl_symbol_count;
+
+static int kl_symbol_order(const void* a, const void* b) {
+    uintptr_t x = ((const struct kl_symbol*)a)->start, y = ((const struct kl_symbol*)b)->start;
+    return x < y ? -1 : x > y;
+}
+
+/* The first object dl_iterate_phdr reports is the executable */
+static int kl_executable_base(struct dl_phdr_info* info, size_t size, void* base) {
+    (void)size;
+    *(uintptr_t*)base = info->dlpi_addr;
+    return 1;
+}
+
+/* Function symbols of the executable, including the internal ones dladdr
+ * cannot see; the mapping stays open for their names */
+static void kl_load_symbols(void) {
+    int fd = open("/proc/self/exe", O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    void* map = fstat(fd, &st) == 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) return;
+    const Elf64_Ehdr* header = map;
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != ELFCLASS64) return;
+
+    uintptr_t base = 0;
+    dl_iterate_phdr(kl_executable_base, &base);
+    const Elf64_Shdr* sections = (const Elf64_Shdr*)((const char*)map + header->e_shoff);
+    for (int i = 0; i < header->e_shnum; ++i) {
+        if (sections[i].sh_type != SHT_SYMTAB) continue;
+        const Elf64_Sym* symbols = (const Elf64_Sym*)((const char*)map + sections[i].sh_offset);
+        const char* names = (const char*)map + sections[sections[i].sh_link].sh_offset;
+        size_t count = sections[i].sh_size / sizeof(Elf64_Sym);
+        kl_symbols = calloc(count, sizeof(struct kl_symbol));
+        if (!kl_symbols) return;
+        for (size_t j = 0; j < count; ++j) {
+            if (ELF64_ST_TYPE(symbols[j].st_info) != STT_FUNC || !symbols[j].st_value) continue;
+            uintptr_t start = base + symbols[j].st_value;
+            kl_symbols[kl_symbol_count++] = (struct kl_symbol){start, start + symbols[j].st_size, names + symbols[j].st_name};
+        }
+        qsort(kl_symbols, kl_symbol_count, sizeof(struct kl_symbol), kl_symbol_order);
+        return;
+    }
+}
+
+static const char* kl_symbolize(uintptr_t pc) {
+    size_t low = 0, high = kl_symbol_count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (kl_symbols[mid].start <= pc) low = mid + 1;
+        else high = mid;
+    }
+    /* Symbols without a size (hand-written or baseline code) reach to the next one */
+    if (low && (pc < kl_symbols[low - 1].end || (kl_symbols[low - 1].end == kl_symbols[low - 1].start && low < kl_symbol_count))) {
+        return kl_symbols[low - 1].name;
+    }
+    Dl_info info;
+    if (dladdr((void*)pc, &info) && info.dli_sname) return info.dli_sname;
+    return "[unknown]";
+}
+
+struct kl_folded {
+    char* line;
+    uint64_t count;
+};
+
+static int kl_folded_order(const void* a, const void* b) {
+    return strcmp(((const struct kl_folded*)a)->line, ((const struct kl_folded*)b)->line);
+}
+
+static void kl_sample_write(void) {
+    struct itimerval off = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_PROF, &off, NULL);
+    pthread_mutex_lock(&kl_sample_lock);
+    kl_sample_stop = 1;
+    pthread_cond_signal(&kl_sample_stopped);
+    pthread_mutex_unlock(&kl_sample_lock);
+    pthread_join(kl_sample_collector_thread, NULL);
+    pthread_mutex_lock(&kl_sample_lock);
+    kl_sample_drain();
+
+    kl_load_symbols();
+    struct kl_folded* folded = calloc(kl_sample_stacks + 1, sizeof(struct kl_folded));
+    size_t lines = 0;
+    uint64_t samples = 0;
+    for (size_t i = 0; folded && i < kl_sample_capacity; ++i) {
+        const struct kl_sample_stack* stack = &kl_sample_table[i];
+        if (!stack->pcs) continue;
+        samples += stack->count;
+        /* Frames further out than main or a pool worker are the C library's */
+        const char* names[KL_SAMPLE_DEPTH];
+        uint32_t depth = 0;
+        size_t length = 1;
+        while (depth < stack->depth) {
+            const char* name = kl_symbolize(stack->pcs[depth]);
+            names[depth++] = name;
+            length += strlen(name) + 1;
+            if (strcmp(name, "main") == 0 || strcmp(name, "kl_worker") == 0) break;
+        }
+        char* line = malloc(length);
+        if (!line) continue;
+        char* end = line;
+        for (uint32_t j = depth; j-- > 0;) end += sprintf(end, j + 1 < depth ? ";%s" : "%s", names[j]);
+        folded[lines++] = (struct kl_folded){line, stack->count};
+    }
+    pthread_mutex_unlock(&kl_sample_lock);
+    if (!folded) return;
+
+    /* Different addresses in one function fold into the same line */
+    qsort(folded, lines, sizeof(struct kl_folded), kl_folded_order);
+    FILE* out = fopen(kl_sample_file, "w");
+    if (!out) {
+        fprintf(stderr, "kotlin-lite: cannot write samples to %s\n", kl_sample_file);
+    } else {
+        for (size_t i = 0; i < lines; ++i) {
+            uint64_t count = folded[i].count;
+            while (i + 1 < lines && strcmp(folded[i].line, folded[i + 1].line) == 0) count += folded[++i].count;
+            fprintf(out, "%s %llu\n", folded[i].line, (unsigned long long)count);
+        }
+        fclose(out);
+    }
+    uint64_t dropped = atomic_load(&kl_sample_dropped);
+    if (dropped) {
+        fprintf(stderr, "kotlin-lite: %llu of %llu samples dropped (lower KL_SAMPLE_HZ)\n", (unsigned long long)dropped,
+                (unsigned long long)(samples + dropped));
+    }
+    for (size_t i = 0; i < lines; ++i) free(folded[i].line);
+    free(folded);
+}
+
+__attribute__((constructor)) static void kl_sample_start(void) {
+    const char* file = getenv("KL_SAMPLE_FILE");
+    if (!file || !*file) return;
+#if defined(__x86_64__) || defined(__aarch64__)
+    const char* rate = getenv("KL_SAMPLE_HZ");
+    long hz = rate ? strtol(rate, NULL, 10) : 0;
+    if (hz <= 0) hz = 997;
+    if (hz > 1000000) hz = 1000000;
+    kl_sample_file = file;
+    kl_sample_enabled = 1;
+    kl_sample_thread_start();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = kl_sample_signal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    /* The collector never takes samples itself */
+    sigset_t profiling, previous;
+    sigemptyset(&profiling);
+    sigaddset(&profiling, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &profiling, &previous);
+    int created = pthread_create(&kl_sample_collector_thread, NULL, kl_sample_collector, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (created != 0) {
+        fprintf(stderr, "kotlin-lite: cannot start the sampling profiler\n");
+        return;
+    }
+    atexit(kl_sample_write);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / hz;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+#else
+    fprintf(stderr, "kotlin-lite: KL_SAMPLE_FILE is not supported on this architecture\n");
+#endif
+}
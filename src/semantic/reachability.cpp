@@ -0,0 +1,72 @@
+#include "reachability.hpp"
+
+namespace kotlin_lite {
+
+void ReachabilityAnalysis::analyze(const KotlinFile& file, const std::vector<std::string>& roots) {
+    calls_.clear();
+    live_.clear();
+    dead_.clear();
+    constants_.clear();
+
+    for (const auto& constant : file.constants) constants_.insert(constant->name.value);
+    for (const auto& constant : file.constants) {
+        collectCalls(*constant->initializer, calls_["const." + constant->name.value]);
+    }
+    for (const auto& func : file.functions) {
+        collectCalls(*func->body, calls_[func->name.value]);
+    }
+
+    std::vector<std::string> work(roots.begin(), roots.end());
+    while (!work.empty()) {
+        std::string name = work.back();
+        work.pop_back();
+        if (!calls_.count(name) || !live_.insert(name).second) continue;
+        for (const auto& callee : calls_[name]) work.push_back(callee);
+    }
+
+    for (const auto& func : file.functions) {
+        if (!live_.count(func->name.value)) dead_.push_back(func.get());
+    }
+}
+
+void ReachabilityAnalysis::collectCalls(const Stmt& node, std::set<std::string>& out) const {
+    if (auto* block = dynamic_cast<const BlockStmt*>(&node)) {
+        for (const auto& stmt : block->statements) collectCalls(*stmt, out);
+    } else if (auto* varDecl = dynamic_cast<const VarDeclStmt*>(&node)) {
+        collectCalls(*varDecl->initializer, out);
+    } else if (auto* assign = dynamic_cast<const AssignStmt*>(&node)) {
+        collectCalls(*assign->value, out);
+    } else if (auto* ifStmt = dynamic_cast<const IfStmt*>(&node)) {
+        collectCalls(*ifStmt->condition, out);
+        collectCalls(*ifStmt->then_branch, out);
+        if (ifStmt->else_branch) collectCalls(*ifStmt->else_branch, out);
+    } else if (auto* whileStmt = dynamic_cast<const WhileStmt*>(&node)) {
+        collectCalls(*whileStmt->condition, out);
+        collectCalls(*whileStmt->body, out);
+    } else if (auto* retStmt = dynamic_cast<const ReturnStmt*>(&node)) {
+        if (retStmt->value) collectCalls(*retStmt->value, out);
+    } else if (auto* exprStmt = dynamic_cast<const ExprStmt*>(&node)) {
+        collectCalls(*exprStmt->expression, out);
+    }
+}
+
+void ReachabilityAnalysis::collectCalls(const Expr& node, std::set<std::string>& out) const {
+    if (auto* binary = dynamic_cast<const BinaryExpr*>(&node)) {
+        collectCalls(*binary->left, out);
+        collectCalls(*binary->right, out);
+    } else if (auto* unary = dynamic_cast<const UnaryExpr*>(&node)) {
+        collectCalls(*unary->right, out);
+    } else if (auto* call = dynamic_cast<const CallExpr*>(&node)) {
+        out.insert(call->callee.value);
+        for (const auto& arg : call->arguments) collectCalls(*arg, out);
+    } else if (auto* grouping = dynamic_cast<const GroupingExpr*>(&node)) {
+        collectCalls(*grouping->expression, out);
+    } else if (auto* conversion = dynamic_cast<const ConversionExpr*>(&node)) {
+        collectCalls(*conversion->operand, out);
+    } else if (auto* var = dynamic_cast<const VariableExpr*>(&node)) {
+        // Conservative under shadowing: a local of the same name keeps the constant alive
+        if (constants_.count(var->name.value)) out.insert("const." + var->name.value);
+    }
+}
+
+} // namespace kotlin_lite
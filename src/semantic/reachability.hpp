@@ -0,0 +1,31 @@
+#pragma once
+#include "parser/ast.hpp"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+
+// Call graph over the checked AST. Functions that no root (the entry point or
+// an exported function) can reach are never lowered, optimized or emitted.
+// A use of `const val X` counts as a call to its initializer, `const.X`.
+class ReachabilityAnalysis {
+public:
+    void analyze(const KotlinFile& file, const std::vector<std::string>& roots);
+
+    const std::set<std::string>& getLiveFunctions() const { return live_; }
+    // Unreachable declarations, in source order
+    const std::vector<const FunctionDecl*>& getDeadFunctions() const { return dead_; }
+
+private:
+    std::map<std::string, std::set<std::string>> calls_;
+    std::set<std::string> live_;
+    std::vector<const FunctionDecl*> dead_;
+    std::set<std::string> constants_;
+
+    void collectCalls(const Stmt& node, std::set<std::string>& out) const;
+    void collectCalls(const Expr& node, std::set<std::string>& out) const;
+};
+
+} // namespace kotlin_lite
@@ -1,4 +1,8 @@
 #include "semantic_analyzer.hpp"
+#include "ir/builtins.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <iostream>
 
 namespace kotlin_lite {
@@ -7,24 +11,56 @@ SemanticAnalyzer::SemanticAnalyzer() {
     // Add built-in functions
     symbol_table_.declareFunction("print_i32", {SymbolType::INT}, SymbolType::UNIT, 0, 0);
     symbol_table_.declareFunction("print_bool", {SymbolType::BOOLEAN}, SymbolType::UNIT, 0, 0);
+    symbol_table_.declareFunction("print_i64", {SymbolType::LONG}, SymbolType::UNIT, 0, 0);
+    symbol_table_.declareFunction("print_u32", {SymbolType::UINT}, SymbolType::UNIT, 0, 0);
+    symbol_table_.declareFunction("print_u64", {SymbolType::ULONG}, SymbolType::UNIT, 0, 0);
+    symbol_table_.declareFunction("nanoTime", {}, SymbolType::LONG, 0, 0);
+    // Takes any integer type; checked in checkCallExpr
+    symbol_table_.declareFunction("blackhole", {SymbolType::INT}, SymbolType::UNIT, 0, 0);
+    symbol_table_.declareFunction("argCount", {}, SymbolType::INT, 0, 0);
+    symbol_table_.declareFunction("argInt", {SymbolType::INT, SymbolType::INT}, SymbolType::INT, 0, 0);
 }
 
 void SemanticAnalyzer::analyze(KotlinFile& file) {
     // Pass 1: Declare all functions
     for (const auto& func : file.functions) {
-        std::vector<SymbolType> params;
-        for (const auto& p : func->parameters) {
-            params.push_back(string_to_type(p.type));
-        }
-        if (!symbol_table_.declareFunction(func->name.value, params, string_to_type(func->return_type), func->name.line, func->name.column)) {
-            error(func->name.line, func->name.column, "Function '" + func->name.value + "' is already defined.");
-        }
+        declareFunction(*func);
+    }
+
+    // Pass 1b: Constants, in source order; an initializer sees earlier constants and all functions
+    for (const auto& constant : file.constants) {
+        declareConstant(*constant);
     }
 
     // Pass 2: Analyze function bodies
     for (const auto& func : file.functions) {
         analyzeFunction(*func);
     }
+
+    checkMemoizedFunctions();
+}
+
+void SemanticAnalyzer::declareFunction(const FunctionDecl& func) {
+    std::vector<SymbolType> params;
+    for (const auto& p : func.parameters) {
+        params.push_back(string_to_type(p.type));
+    }
+    if (!symbol_table_.declareFunction(func.name.value, params, string_to_type(func.return_type), func.name.line, func.name.column)) {
+        error(func.name.line, func.name.column, "Function '" + func.name.value + "' is already defined.");
+    }
+}
+
+void SemanticAnalyzer::declareConstant(ConstDecl& constant) {
+    SymbolType initType = checkExpr(*constant.initializer);
+    SymbolType declaredType = constant.type.empty() ? initType : string_to_type(constant.type);
+    if (!isIntegerType(declaredType) && declaredType != SymbolType::BOOLEAN) {
+        error(constant.name.line, constant.name.column, "Constant '" + constant.name.value + "' must be an integer or Boolean.");
+    } else if (!conforms(*constant.initializer, initType, declaredType)) {
+        error(constant.name.line, constant.name.column, "Type mismatch: declared " + to_string(declaredType) + " but initialized with " + to_string(initType) + ".");
+    }
+    if (!symbol_table_.declareVariable(constant.name.value, declaredType, true, constant.name.line, constant.name.column)) {
+        error(constant.name.line, constant.name.column, "Constant '" + constant.name.value + "' is already defined.");
+    }
 }
 
 void SemanticAnalyzer::error(int line, int column, const std::string& message) {
@@ -32,7 +68,16 @@ void SemanticAnalyzer::error(int line, int column, const std::string& message) {
 }
 
 void SemanticAnalyzer::analyzeFunction(FunctionDecl& node) {
+    checkAnnotations(node.annotations, AnnotationTarget::FUNCTION);
+    for (const auto& annotation : node.annotations) {
+        if (annotation.name.value != "Memoize") continue;
+        if (string_to_type(node.return_type) == SymbolType::UNIT) {
+            error(annotation.name.line, annotation.name.column, "A '@Memoize' function must return a value.");
+        }
+        memoized_.push_back(node.name);
+    }
     symbol_table_.enterScope();
+    current_function_ = node.name.value;
     current_function_return_type_ = string_to_type(node.return_type);
 
     for (const auto& p : node.parameters) {
@@ -46,10 +91,144 @@ void SemanticAnalyzer::analyzeFunction(FunctionDecl& node) {
     }
 
     analyzeBlock(*node.body);
+    current_function_.clear();
+
+    if (node.is_tailrec && !hasTailCall(*node.body, node.name.value, true)) {
+        error(node.name.line, node.name.column, "Function '" + node.name.value + "' is marked 'tailrec' but contains no tail calls.");
+    }
 
     symbol_table_.exitScope();
 }
 
+// The performance annotations, by where they may appear:
+//   functions: @AlwaysInline, @NoInline, @Hot, @Cold, @Memoize, @Memoize(capacity)
+//   loops:     @Unroll, @Unroll(count), @Vectorize, @Vectorize(width)
+//   ifs:       @Likely, @Unlikely
+// A count or width of 1 turns the transform off; a width must be a power of two.
+void SemanticAnalyzer::checkAnnotations(const std::vector<Annotation>& annotations, AnnotationTarget target) {
+    struct Rule {
+        const char* name;
+        AnnotationTarget target;
+        bool takesArgument;
+        const char* conflictsWith;
+    };
+    static const Rule rules[] = {
+        {"AlwaysInline", AnnotationTarget::FUNCTION, false, "NoInline"},
+        {"NoInline", AnnotationTarget::FUNCTION, false, "AlwaysInline"},
+        {"Hot", AnnotationTarget::FUNCTION, false, "Cold"},
+        {"Cold", AnnotationTarget::FUNCTION, false, "Hot"},
+        {"Memoize", AnnotationTarget::FUNCTION, true, nullptr},
+        {"Unroll", AnnotationTarget::LOOP, true, nullptr},
+        {"Vectorize", AnnotationTarget::LOOP, true, nullptr},
+        {"Likely", AnnotationTarget::CONDITION, false, "Unlikely"},
+        {"Unlikely", AnnotationTarget::CONDITION, false, "Likely"},
+    };
+    static const char* targetNames[] = {"a function", "a 'while' loop", "an 'if'"};
+
+    std::vector<std::string> seen;
+    for (const auto& annotation : annotations) {
+        const Token& name = annotation.name;
+        const Rule* rule = nullptr;
+        for (const auto& r : rules) {
+            if (name.value == r.name) rule = &r;
+        }
+        if (!rule) {
+            error(name.line, name.column, "Unknown annotation '@" + name.value + "'.");
+            continue;
+        }
+        if (rule->target != target) {
+            error(name.line, name.column, "Annotation '@" + name.value + "' does not apply to " +
+                                              targetNames[static_cast<int>(target)] + ".");
+            continue;
+        }
+        if (std::find(seen.begin(), seen.end(), name.value) != seen.end()) {
+            error(name.line, name.column, "Duplicate annotation '@" + name.value + "'.");
+        } else if (rule->conflictsWith &&
+                   std::find(seen.begin(), seen.end(), rule->conflictsWith) != seen.end()) {
+            error(name.line, name.column, "Annotation '@" + name.value + "' conflicts with '@" + rule->conflictsWith + "'.");
+        }
+        seen.push_back(name.value);
+
+        size_t maxArguments = rule->takesArgument ? 1 : 0;
+        if (annotation.arguments.size() > maxArguments) {
+            error(name.line, name.column, "Annotation '@" + name.value + "' takes " +
+                                              (maxArguments ? "at most one argument." : "no arguments."));
+            continue;
+        }
+        if (annotation.arguments.empty()) continue;
+        const Token& argument = annotation.arguments[0];
+        long value = 0;
+        try {
+            value = std::stol(argument.value);
+        } catch (const std::exception&) {
+            value = -1;
+        }
+        if (name.value == "Unroll" && (value < 1 || value > 1024)) {
+            error(argument.line, argument.column, "Unroll count must be between 1 and 1024.");
+        } else if (name.value == "Vectorize" && (value < 1 || value > 64 || (value & (value - 1)) != 0)) {
+            error(argument.line, argument.column, "Vector width must be a power of two between 1 and 64.");
+        } else if (name.value == "Memoize" && (value < 1 || value > kMaxMemoizeCapacity)) {
+            error(argument.line, argument.column, "Memoize capacity must be between 1 and " +
+                                                      std::to_string(kMaxMemoizeCapacity) + ".");
+        }
+    }
+}
+
+// A cached result stands in for a call, so a @Memoize function must be pure:
+// neither it nor anything it calls may print or read the clock or the
+// arguments. Needs the calls of every body, so it runs last.
+void SemanticAnalyzer::checkMemoizedFunctions() {
+    std::map<std::string, std::string> impureCall;  // function -> a call that makes it impure
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const auto& [caller, callees] : calls_) {
+            if (impureCall.count(caller)) continue;
+            for (const std::string& callee : callees) {
+                auto builtin = ir::findBuiltin(callee);
+                if ((builtin && builtin->hasIOEffects) || impureCall.count(callee)) {
+                    impureCall[caller] = callee;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    for (const Token& name : memoized_) {
+        auto it = impureCall.find(name.value);
+        if (it == impureCall.end()) continue;
+        std::string why = "it calls '" + it->second + "'";
+        if (!ir::findBuiltin(it->second)) why += ", which is not pure";
+        error(name.line, name.column, "Function '" + name.value + "' is marked '@Memoize' but is not pure: " + why + ".");
+    }
+}
+
+// A self call is in tail position when it is the returned expression, or when a
+// Unit function evaluates it as the last statement on a path out of the body.
+bool SemanticAnalyzer::hasTailCall(const Stmt& node, const std::string& name, bool isTail) const {
+    auto isSelfCall = [&](const Expr* expr) {
+        while (auto* grouping = dynamic_cast<const GroupingExpr*>(expr)) expr = grouping->expression.get();
+        auto* call = dynamic_cast<const CallExpr*>(expr);
+        return call && call->callee.value == name;
+    };
+
+    if (auto* block = dynamic_cast<const BlockStmt*>(&node)) {
+        for (size_t i = 0; i < block->statements.size(); ++i) {
+            bool last = isTail && i + 1 == block->statements.size();
+            if (hasTailCall(*block->statements[i], name, last)) return true;
+        }
+    } else if (auto* ifStmt = dynamic_cast<const IfStmt*>(&node)) {
+        if (hasTailCall(*ifStmt->then_branch, name, isTail)) return true;
+        if (ifStmt->else_branch && hasTailCall(*ifStmt->else_branch, name, isTail)) return true;
+    } else if (auto* whileStmt = dynamic_cast<const WhileStmt*>(&node)) {
+        return hasTailCall(*whileStmt->body, name, false);
+    } else if (auto* retStmt = dynamic_cast<const ReturnStmt*>(&node)) {
+        return retStmt->value && isSelfCall(retStmt->value.get());
+    } else if (auto* exprStmt = dynamic_cast<const ExprStmt*>(&node)) {
+        return isTail && current_function_return_type_ == SymbolType::UNIT && isSelfCall(exprStmt->expression.get());
+    }
+    return false;
+}
+
 void SemanticAnalyzer::analyzeStmt(Stmt& node) {
     if (auto* block = dynamic_cast<BlockStmt*>(&node)) {
         symbol_table_.enterScope();
@@ -61,7 +240,7 @@ void SemanticAnalyzer::analyzeStmt(Stmt& node) {
         
         if (declaredType == SymbolType::UNKNOWN) {
             error(varDecl->name.line, varDecl->name.column, "Unknown type '" + varDecl->type + "'.");
-        } else if (initType != declaredType) {
+        } else if (!conforms(*varDecl->initializer, initType, declaredType)) {
             error(varDecl->name.line, varDecl->name.column, "Type mismatch: declared " + to_string(declaredType) + " but initialized with " + to_string(initType) + ".");
         }
 
@@ -77,24 +256,28 @@ void SemanticAnalyzer::analyzeStmt(Stmt& node) {
                 error(assign->name.line, assign->name.column, "Cannot reassign 'val' variable '" + assign->name.value + "'.");
             }
             SymbolType valType = checkExpr(*assign->value);
-            if (valType != var->type) {
+            if (!conforms(*assign->value, valType, var->type)) {
                 error(assign->name.line, assign->name.column, "Type mismatch in assignment to '" + assign->name.value + "'. Expected " + to_string(var->type) + ", got " + to_string(valType) + ".");
             }
         }
     } else if (auto* ifStmt = dynamic_cast<IfStmt*>(&node)) {
+        checkAnnotations(ifStmt->annotations, AnnotationTarget::CONDITION);
         if (checkExpr(*ifStmt->condition) != SymbolType::BOOLEAN) {
             error(0, 0, "Condition of 'if' must be Boolean."); // Token info missing in AST for condition?
         }
         analyzeStmt(*ifStmt->then_branch);
         if (ifStmt->else_branch) analyzeStmt(*ifStmt->else_branch);
     } else if (auto* whileStmt = dynamic_cast<WhileStmt*>(&node)) {
+        checkAnnotations(whileStmt->annotations, AnnotationTarget::LOOP);
         if (checkExpr(*whileStmt->condition) != SymbolType::BOOLEAN) {
             error(0, 0, "Condition of 'while' must be Boolean.");
         }
         analyzeStmt(*whileStmt->body);
     } else if (auto* retStmt = dynamic_cast<ReturnStmt*>(&node)) {
         SymbolType retType = retStmt->value ? checkExpr(*retStmt->value) : SymbolType::UNIT;
-        if (retType != current_function_return_type_) {
+        bool matches = retStmt->value ? conforms(*retStmt->value, retType, current_function_return_type_)
+                                      : retType == current_function_return_type_;
+        if (!matches) {
             error(retStmt->keyword.line, retStmt->keyword.column, "Return type mismatch. Expected " + to_string(current_function_return_type_) + ", got " + to_string(retType) + ".");
         }
     } else if (auto* exprStmt = dynamic_cast<ExprStmt*>(&node)) {
@@ -115,9 +298,56 @@ SymbolType SemanticAnalyzer::checkExpr(Expr& node) {
     if (auto* var = dynamic_cast<VariableExpr*>(&node)) return checkVariableExpr(*var);
     if (auto* call = dynamic_cast<CallExpr*>(&node)) return checkCallExpr(*call);
     if (auto* grouping = dynamic_cast<GroupingExpr*>(&node)) return checkGroupingExpr(*grouping);
+    if (auto* conversion = dynamic_cast<ConversionExpr*>(&node)) return checkConversionExpr(*conversion);
     return SymbolType::UNKNOWN;
 }
 
+// Kotlin gives an integer literal the type it is used as when the value fits:
+// `val b: Byte = -1`, `val n: Long = 5`, `val u: ULong = 1u`. Other values
+// must have exactly the expected type.
+bool SemanticAnalyzer::conforms(const Expr& expr, SymbolType actual, SymbolType expected) const {
+    if (actual == expected) return true;
+    const Expr* inner = &expr;
+    bool negative = false;
+    while (true) {
+        if (auto* grouping = dynamic_cast<const GroupingExpr*>(inner)) {
+            inner = grouping->expression.get();
+        } else if (auto* unary = dynamic_cast<const UnaryExpr*>(inner); unary && unary->op.type == TokenType::MINUS && !negative) {
+            negative = true;
+            inner = unary->right.get();
+        } else {
+            break;
+        }
+    }
+    auto* literal = dynamic_cast<const LiteralExpr*>(inner);
+    if (!literal || literal->token.type != TokenType::INTEGER) return false;
+    IntegerLiteral value = parseIntegerLiteral(literal->token.value);
+    if (value.overflow) return false;
+    if (value.isUnsigned) return !negative && !value.isLong && expected == SymbolType::ULONG;
+    if (value.isLong && expected != SymbolType::LONG) return false;
+    int bits;
+    switch (expected) {
+        case SymbolType::BYTE: bits = 8; break;
+        case SymbolType::SHORT: bits = 16; break;
+        case SymbolType::INT: bits = 32; break;
+        case SymbolType::LONG: bits = 64; break;
+        default: return false;
+    }
+    uint64_t limit = uint64_t(1) << (bits - 1);
+    return negative ? value.value <= limit : value.value < limit;
+}
+
+// The type of an arithmetic or comparison operation, as Kotlin's overloads
+// give it: Byte and Short operands are promoted to Int and a Long operand
+// makes the result Long; unsigned operands only combine with unsigned ones,
+// into the wider of the two. UNKNOWN if the operands do not combine.
+SymbolType SemanticAnalyzer::arithmeticType(SymbolType left, SymbolType right) {
+    if (!isIntegerType(left) || !isIntegerType(right)) return SymbolType::UNKNOWN;
+    if (isUnsignedType(left) != isUnsignedType(right)) return SymbolType::UNKNOWN;
+    if (isUnsignedType(left)) return left == SymbolType::ULONG || right == SymbolType::ULONG ? SymbolType::ULONG : SymbolType::UINT;
+    return left == SymbolType::LONG || right == SymbolType::LONG ? SymbolType::LONG : SymbolType::INT;
+}
+
 SymbolType SemanticAnalyzer::checkBinaryExpr(BinaryExpr& node) {
     SymbolType left = checkExpr(*node.left);
     SymbolType right = checkExpr(*node.right);
@@ -127,21 +357,24 @@ SymbolType SemanticAnalyzer::checkBinaryExpr(BinaryExpr& node) {
         case TokenType::MINUS:
         case TokenType::STAR:
         case TokenType::SLASH:
-        case TokenType::PERCENT:
-            if (left == SymbolType::INT && right == SymbolType::INT) return SymbolType::INT;
-            error(node.op.line, node.op.column, "Arithmetic operators require Int operands.");
-            return SymbolType::INT;
+        case TokenType::PERCENT: {
+            SymbolType result = arithmeticType(left, right);
+            if (result != SymbolType::UNKNOWN) return result;
+            error(node.op.line, node.op.column, mismatch("Arithmetic", left, right));
+            // Recover with the left operand's type, so uses of the result are not reported too
+            return isIntegerType(left) ? left : SymbolType::INT;
+        }
         case TokenType::EQUAL:
         case TokenType::NOT_EQUAL:
-            if (left == right) return SymbolType::BOOLEAN;
+            if (conforms(*node.right, right, left) || conforms(*node.left, left, right)) return SymbolType::BOOLEAN;
             error(node.op.line, node.op.column, "Equality operators require operands of the same type.");
             return SymbolType::BOOLEAN;
         case TokenType::LESS:
         case TokenType::LESS_EQUAL:
         case TokenType::GREATER:
         case TokenType::GREATER_EQUAL:
-            if (left == SymbolType::INT && right == SymbolType::INT) return SymbolType::BOOLEAN;
-            error(node.op.line, node.op.column, "Comparison operators require Int operands.");
+            if (arithmeticType(left, right) != SymbolType::UNKNOWN) return SymbolType::BOOLEAN;
+            error(node.op.line, node.op.column, mismatch("Comparison", left, right));
             return SymbolType::BOOLEAN;
         case TokenType::AND:
         case TokenType::OR:
@@ -156,9 +389,10 @@ SymbolType SemanticAnalyzer::checkBinaryExpr(BinaryExpr& node) {
 SymbolType SemanticAnalyzer::checkUnaryExpr(UnaryExpr& node) {
     SymbolType right = checkExpr(*node.right);
     if (node.op.type == TokenType::MINUS) {
-        if (right == SymbolType::INT) return SymbolType::INT;
-        error(node.op.line, node.op.column, "Unary minus requires Int operand.");
-        return SymbolType::INT;
+        if (right == SymbolType::LONG) return SymbolType::LONG;
+        if (isIntegerType(right) && !isUnsignedType(right)) return SymbolType::INT;
+        error(node.op.line, node.op.column, "Unary minus requires a signed integer operand, got " + to_string(right) + ".");
+        return isIntegerType(right) ? right : SymbolType::INT;
     }
     if (node.op.type == TokenType::NOT) {
         if (right == SymbolType::BOOLEAN) return SymbolType::BOOLEAN;
@@ -170,7 +404,16 @@ SymbolType SemanticAnalyzer::checkUnaryExpr(UnaryExpr& node) {
 
 SymbolType SemanticAnalyzer::checkLiteralExpr(LiteralExpr& node) {
     switch (node.token.type) {
-        case TokenType::INTEGER: return SymbolType::INT;
+        case TokenType::INTEGER: {
+            // Unsuffixed literals too large for an Int are Longs, and `u` ones too large for a UInt are ULongs
+            IntegerLiteral literal = parseIntegerLiteral(node.token.value);
+            uint64_t limit = literal.isUnsigned ? UINT64_MAX : INT64_MAX;
+            if (literal.overflow || literal.value > limit) {
+                error(node.token.line, node.token.column, "The value " + node.token.value + " is out of range.");
+            }
+            if (literal.isUnsigned) return literal.isLong || literal.value > UINT32_MAX ? SymbolType::ULONG : SymbolType::UINT;
+            return literal.isLong || literal.value > INT32_MAX ? SymbolType::LONG : SymbolType::INT;
+        }
         case TokenType::FLOAT: return SymbolType::FLOAT;
         case TokenType::STRING: return SymbolType::STRING;
         case TokenType::TRUE:
@@ -190,6 +433,7 @@ SymbolType SemanticAnalyzer::checkVariableExpr(VariableExpr& node) {
 }
 
 SymbolType SemanticAnalyzer::checkCallExpr(CallExpr& node) {
+    if (!current_function_.empty()) calls_[current_function_].insert(node.callee.value);
     auto func = symbol_table_.lookupFunction(node.callee.value);
     if (!func) {
         error(node.callee.line, node.callee.column, "Function '" + node.callee.value + "' is not defined.");
@@ -201,7 +445,11 @@ SymbolType SemanticAnalyzer::checkCallExpr(CallExpr& node) {
     } else {
         for (size_t i = 0; i < node.arguments.size(); ++i) {
             SymbolType argType = checkExpr(*node.arguments[i]);
-            if (argType != func->parameter_types[i]) {
+            if (node.callee.value == "blackhole") {
+                if (!isIntegerType(argType) && argType != SymbolType::UNKNOWN) {
+                    error(node.callee.line, node.callee.column, "Argument 1 of 'blackhole' expects an integer, but got " + to_string(argType) + ".");
+                }
+            } else if (!conforms(*node.arguments[i], argType, func->parameter_types[i])) {
                 error(node.callee.line, node.callee.column, "Argument " + std::to_string(i + 1) + " of '" + node.callee.value + "' expects " + to_string(func->parameter_types[i]) + ", but got " + to_string(argType) + ".");
             }
         }
@@ -213,4 +461,32 @@ SymbolType SemanticAnalyzer::checkGroupingExpr(GroupingExpr& node) {
     return checkExpr(*node.expression);
 }
 
+// Between any two integer types: narrowing keeps the low bits, widening
+// extends by the sign of the operand's type, as in Kotlin
+SymbolType SemanticAnalyzer::checkConversionExpr(ConversionExpr& node) {
+    SymbolType operand = checkExpr(*node.operand);
+    static const std::map<std::string, SymbolType> conversions = {
+        {"toByte", SymbolType::BYTE}, {"toShort", SymbolType::SHORT}, {"toInt", SymbolType::INT},
+        {"toLong", SymbolType::LONG}, {"toUInt", SymbolType::UINT}, {"toULong", SymbolType::ULONG},
+    };
+    auto it = conversions.find(node.name.value);
+    if (it == conversions.end()) {
+        error(node.name.line, node.name.column, "Unknown conversion '" + node.name.value + "'.");
+        return SymbolType::UNKNOWN;
+    }
+    if (operand != SymbolType::UNKNOWN && !isIntegerType(operand)) {
+        error(node.name.line, node.name.column, "Conversion '" + node.name.value + "' requires an integer operand, got " +
+                                                    to_string(operand) + ".");
+    }
+    return it->second;
+}
+
+std::string SemanticAnalyzer::mismatch(const std::string& kind, SymbolType left, SymbolType right) {
+    if (isIntegerType(left) && isIntegerType(right)) {
+        return kind + " operators cannot combine " + to_string(left) + " and " + to_string(right) +
+               "; convert one side with toInt(), toUInt() or the like.";
+    }
+    return kind + " operators require integer operands.";
+}
+
 } // namespace kotlin_lite
@@ -1,8 +1,10 @@
 #pragma once
 #include "parser/ast.hpp"
 #include "symbol_table.hpp"
-#include <vector>
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 namespace kotlin_lite {
 
@@ -12,16 +14,35 @@ public:
     void analyze(KotlinFile& file);
     const std::vector<std::string>& getErrors() const { return errors_; }
 
+    // The steps of analyze(), for checking one declaration at a time: all
+    // functions must be declared, then the constants in source order, before
+    // any body is analyzed.
+    void declareFunction(const FunctionDecl& func);
+    void declareConstant(ConstDecl& constant);
+    void analyzeFunction(FunctionDecl& node);
+    // The last step of analyze(), once every body has been analyzed: the
+    // purity of the @Memoize functions
+    void checkMemoizedFunctions();
+
+    static constexpr long kMaxMemoizeCapacity = 1 << 24;
+
 private:
     SymbolTable symbol_table_;
     std::vector<std::string> errors_;
     SymbolType current_function_return_type_ = SymbolType::UNKNOWN;
+    std::string current_function_;
+    // The functions each body calls, and the @Memoize functions
+    std::map<std::string, std::set<std::string>> calls_;
+    std::vector<Token> memoized_;
 
     void error(int line, int column, const std::string& message);
-    
-    void analyzeFunction(FunctionDecl& node);
+
+    enum class AnnotationTarget { FUNCTION, LOOP, CONDITION };
+    void checkAnnotations(const std::vector<Annotation>& annotations, AnnotationTarget target);
+
     void analyzeStmt(Stmt& node);
     void analyzeBlock(BlockStmt& node);
+    bool hasTailCall(const Stmt& node, const std::string& name, bool isTail) const;
     
     SymbolType checkExpr(Expr& node);
     SymbolType checkBinaryExpr(BinaryExpr& node);
@@ -30,6 +51,11 @@ private:
     SymbolType checkVariableExpr(VariableExpr& node);
     SymbolType checkCallExpr(CallExpr& node);
     SymbolType checkGroupingExpr(GroupingExpr& node);
+    SymbolType checkConversionExpr(ConversionExpr& node);
+
+    bool conforms(const Expr& expr, SymbolType actual, SymbolType expected) const;
+    static SymbolType arithmeticType(SymbolType left, SymbolType right);
+    static std::string mismatch(const std::string& kind, SymbolType left, SymbolType right);
 };
 
 } // namespace kotlin_lite
@@ -9,6 +9,11 @@ namespace kotlin_lite {
 
 enum class SymbolType {
     INT,
+    LONG,
+    BYTE,
+    SHORT,
+    UINT,
+    ULONG,
     BOOLEAN,
     UNIT,
     FLOAT,  // Grammar allows it, but backend might not
@@ -19,6 +24,11 @@ enum class SymbolType {
 inline std::string to_string(SymbolType type) {
     switch (type) {
         case SymbolType::INT: return "Int";
+        case SymbolType::LONG: return "Long";
+        case SymbolType::BYTE: return "Byte";
+        case SymbolType::SHORT: return "Short";
+        case SymbolType::UINT: return "UInt";
+        case SymbolType::ULONG: return "ULong";
         case SymbolType::BOOLEAN: return "Boolean";
         case SymbolType::UNIT: return "Unit";
         case SymbolType::FLOAT: return "Float";
@@ -29,6 +39,11 @@ inline std::string to_string(SymbolType type) {
 
 inline SymbolType string_to_type(const std::string& name) {
     if (name == "Int") return SymbolType::INT;
+    if (name == "Long") return SymbolType::LONG;
+    if (name == "Byte") return SymbolType::BYTE;
+    if (name == "Short") return SymbolType::SHORT;
+    if (name == "UInt") return SymbolType::UINT;
+    if (name == "ULong") return SymbolType::ULONG;
     if (name == "Boolean") return SymbolType::BOOLEAN;
     if (name == "Unit") return SymbolType::UNIT;
     if (name == "Float") return SymbolType::FLOAT;
@@ -36,6 +51,14 @@ inline SymbolType string_to_type(const std::string& name) {
     return SymbolType::UNKNOWN;
 }
 
+inline bool isIntegerType(SymbolType type) {
+    return type >= SymbolType::INT && type <= SymbolType::ULONG;
+}
+
+inline bool isUnsignedType(SymbolType type) {
+    return type == SymbolType::UINT || type == SymbolType::ULONG;
+}
+
 struct VariableSymbol {
     std::string name;
     SymbolType type;
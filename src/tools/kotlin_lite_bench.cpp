@@ -0,0 +1,499 @@
+#include "pipeline/program_runner.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Runs the benchmarks/ programs compiled by kotlin-lite and their C
+// counterparts, pinned to one core, and reports robust statistics of the
+// wall time and of hardware counters, optionally against an earlier run.
+
+namespace {
+
+using namespace kotlin_lite;
+
+void printUsage(const char* progName) {
+    std::cout << "Usage: " << progName << " [options] [<benchmark.kt>...]\n"
+              << "Compiles each benchmark (default: every benchmarks/*.kt with a *_c.c\n"
+              << "counterpart), checks that its output matches the C version and times\n"
+              << "both. Run it from the project root.\n"
+              << "Options:\n"
+              << "  --compiler=<path>      kotlin-lite to use (default: next to this tool)\n"
+              << "  --flags=\"<flags>\"      Extra kotlin-lite flags, e.g. \"--auto-parallel\"\n"
+              << "  --runs=<n>             Measured runs per program (default 10)\n"
+              << "  --warmup=<n>           Unmeasured runs before them (default 2)\n"
+              << "  --cpu=<n>              Core to pin the programs to (default: the last one\n"
+              << "                         allowed); --cpu=none leaves them unpinned\n"
+              << "  --no-c                 Only check the C output, do not time it\n"
+              << "  --json=<file>          Write all samples and statistics as JSON\n"
+              << "  --compare=<file>       Compare against the JSON of an earlier run\n"
+              << "  --help                 Show this help message\n";
+}
+
+// --- Minimal JSON, enough to read back what this tool writes ---
+
+struct Json {
+    enum class Kind { Null, Bool, Number, String, Array, Object } kind = Kind::Null;
+    double number = 0;
+    std::string string;
+    std::vector<Json> array;
+    std::map<std::string, Json> object;
+
+    const Json* get(const std::string& key) const {
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text_(text) {}
+
+    Json parse() {
+        Json value = parseValue();
+        skipSpace();
+        if (pos_ != text_.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    const std::string& text_;
+    size_t pos_ = 0;
+
+    [[noreturn]] void fail(const std::string& what) {
+        throw std::runtime_error("JSON offset " + std::to_string(pos_) + ": " + what);
+    }
+    void skipSpace() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+    bool consume(char c) {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+    void expect(char c) {
+        if (!consume(c)) fail(std::string("expected '") + c + "'");
+    }
+
+    std::string parseString() {
+        expect('"');
+        std::string result;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            char c = text_[pos_++];
+            if (c == '\\' && pos_ < text_.size()) {
+                char e = text_[pos_++];
+                result += e == 'n' ? '\n' : e == 't' ? '\t' : e;
+            } else {
+                result += c;
+            }
+        }
+        expect('"');
+        return result;
+    }
+
+    Json parseValue() {
+        skipSpace();
+        if (pos_ >= text_.size()) fail("unexpected end");
+        Json value;
+        char c = text_[pos_];
+        if (c == '{') {
+            value.kind = Json::Kind::Object;
+            ++pos_;
+            if (consume('}')) return value;
+            do {
+                skipSpace();
+                std::string key = parseString();
+                expect(':');
+                value.object[key] = parseValue();
+            } while (consume(','));
+            expect('}');
+        } else if (c == '[') {
+            value.kind = Json::Kind::Array;
+            ++pos_;
+            if (consume(']')) return value;
+            do value.array.push_back(parseValue());
+            while (consume(','));
+            expect(']');
+        } else if (c == '"') {
+            value.kind = Json::Kind::String;
+            value.string = parseString();
+        } else if (text_.compare(pos_, 4, "true") == 0 || text_.compare(pos_, 5, "false") == 0) {
+            value.kind = Json::Kind::Bool;
+            value.number = text_[pos_] == 't';
+            pos_ += text_[pos_] == 't' ? 4 : 5;
+        } else if (text_.compare(pos_, 4, "null") == 0) {
+            pos_ += 4;
+        } else {
+            size_t used = 0;
+            try {
+                value.number = std::stod(text_.substr(pos_, 32), &used);
+            } catch (const std::exception&) {
+                fail("unexpected character");
+            }
+            value.kind = Json::Kind::Number;
+            pos_ += used;
+        }
+        return value;
+    }
+};
+
+std::string jsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        if (c == '\n') {
+            result += "\\n";
+            continue;
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+// --- Benchmarks ---
+
+struct Measurement {
+    std::vector<double> seconds;
+    std::map<std::string, std::vector<double>> counters;
+
+    void add(const Run& run) {
+        seconds.push_back(run.seconds);
+        for (const auto& [name, value] : run.counters) counters[name].push_back(value);
+    }
+};
+
+struct Benchmark {
+    std::string name;
+    std::string source;
+    std::string baseline;
+    bool outputMatches = false;
+    Measurement lite;
+    Measurement c;
+};
+
+void writeSummary(std::ostream& out, const char* key, const std::vector<double>& samples, const char* indent) {
+    Summary s = summarize(samples);
+    out << indent << "\"" << key << "\": {\"median\": " << s.median << ", \"mad\": " << s.mad << ", \"ci95\": ["
+        << s.low << ", " << s.high << "], \"samples\": [";
+    for (size_t i = 0; i < samples.size(); ++i) out << (i ? ", " : "") << samples[i];
+    out << "]}";
+}
+
+void writeMeasurement(std::ostream& out, const char* key, const Measurement& m) {
+    out << "      \"" << key << "\": {\n";
+    writeSummary(out, "seconds", m.seconds, "        ");
+    for (const auto& [name, samples] : m.counters) {
+        out << ",\n";
+        writeSummary(out, name.c_str(), samples, "        ");
+    }
+    out << "\n      }";
+}
+
+void writeJson(std::ostream& out, const std::vector<Benchmark>& benchmarks, int runs, int warmup, int cpu,
+               const std::string& flags) {
+    out << std::setprecision(9);
+    out << "{\n  \"version\": 1,\n  \"runs\": " << runs << ",\n  \"warmup\": " << warmup << ",\n  \"cpu\": " << cpu
+        << ",\n  \"flags\": " << jsonString(flags) << ",\n  \"benchmarks\": {\n";
+    for (size_t i = 0; i < benchmarks.size(); ++i) {
+        const Benchmark& b = benchmarks[i];
+        out << "    " << jsonString(b.name) << ": {\n      \"output_matches\": " << (b.outputMatches ? "true" : "false");
+        if (!b.lite.seconds.empty()) {
+            out << ",\n";
+            writeMeasurement(out, "lite", b.lite);
+        }
+        if (!b.c.seconds.empty()) {
+            out << ",\n";
+            writeMeasurement(out, "c", b.c);
+        }
+        out << "\n    }" << (i + 1 < benchmarks.size() ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+}
+
+std::string formatSeconds(double seconds) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(seconds < 0.1 ? 4 : 3) << seconds;
+    return ss.str();
+}
+
+std::string formatCount(double value) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    if (value >= 1e9) ss << value / 1e9 << "G";
+    else if (value >= 1e6) ss << value / 1e6 << "M";
+    else if (value >= 1e3) ss << value / 1e3 << "k";
+    else ss << std::setprecision(0) << value;
+    return ss.str();
+}
+
+void printResults(const std::vector<Benchmark>& benchmarks, bool haveCounters) {
+    std::cout << "\n"
+              << std::left << std::setw(12) << "benchmark" << std::right << std::setw(10) << "median" << std::setw(8)
+              << "MAD" << std::setw(22) << "95% CI" << std::setw(10) << "C" << std::setw(8) << "lite/C";
+    if (haveCounters) std::cout << std::setw(9) << "cycles" << std::setw(9) << "instr" << std::setw(6) << "IPC"
+                                << std::setw(9) << "br-miss" << std::setw(9) << "$-miss";
+    std::cout << "\n";
+    for (const Benchmark& b : benchmarks) {
+        if (b.lite.seconds.empty()) {
+            std::cout << std::left << std::setw(12) << b.name << "  not measured\n";
+            continue;
+        }
+        Summary lite = summarize(b.lite.seconds);
+        std::ostringstream mad, ci;
+        mad << std::fixed << std::setprecision(1) << (lite.median > 0 ? 100 * lite.mad / lite.median : 0) << "%";
+        ci << "[" << formatSeconds(lite.low) << ", " << formatSeconds(lite.high) << "]";
+        std::cout << std::left << std::setw(12) << b.name << std::right << std::setw(10) << formatSeconds(lite.median)
+                  << std::setw(8) << mad.str() << std::setw(22) << ci.str();
+        if (!b.c.seconds.empty()) {
+            double c = summarize(b.c.seconds).median;
+            std::ostringstream ratio;
+            ratio << std::fixed << std::setprecision(2) << (c > 0 ? lite.median / c : 0);
+            std::cout << std::setw(10) << formatSeconds(c) << std::setw(8) << ratio.str();
+        } else {
+            std::cout << std::setw(10) << "-" << std::setw(8) << "-";
+        }
+        if (haveCounters) {
+            auto counter = [&](const char* name) -> std::optional<double> {
+                auto it = b.lite.counters.find(name);
+                if (it == b.lite.counters.end() || it->second.empty()) return std::nullopt;
+                return median(it->second);
+            };
+            auto cycles = counter("cycles"), instructions = counter("instructions");
+            for (const char* name : {"cycles", "instructions"}) {
+                auto value = counter(name);
+                std::cout << std::setw(9) << (value ? formatCount(*value) : "-");
+            }
+            std::ostringstream ipc;
+            if (cycles && instructions && *cycles > 0) ipc << std::fixed << std::setprecision(2) << *instructions / *cycles;
+            std::cout << std::setw(6) << (ipc.str().empty() ? "-" : ipc.str());
+            for (const char* name : {"branch-misses", "cache-misses"}) {
+                auto value = counter(name);
+                std::cout << std::setw(9) << (value ? formatCount(*value) : "-");
+            }
+        }
+        std::cout << (b.outputMatches ? "" : "  OUTPUT DIFFERS") << "\n";
+    }
+}
+
+// A change is reported as significant when the two 95% intervals of the
+// median do not overlap
+void printComparison(const std::vector<Benchmark>& benchmarks, const Json& previous) {
+    const Json* old = previous.get("benchmarks");
+    if (!old) throw std::runtime_error("no \"benchmarks\" object");
+    std::cout << "\nAgainst the earlier run:\n";
+    for (const Benchmark& b : benchmarks) {
+        const Json* entry = old->get(b.name);
+        const Json* lite = entry ? entry->get("lite") : nullptr;
+        const Json* seconds = lite ? lite->get("seconds") : nullptr;
+        const Json* before = seconds ? seconds->get("median") : nullptr;
+        const Json* ci = seconds ? seconds->get("ci95") : nullptr;
+        if (!before || !ci || ci->array.size() != 2 || b.lite.seconds.empty()) {
+            std::cout << "  " << std::left << std::setw(12) << b.name << "not in both runs\n";
+            continue;
+        }
+        Summary now = summarize(b.lite.seconds);
+        double change = before->number > 0 ? 100 * (now.median / before->number - 1) : 0;
+        bool significant = now.low > ci->array[1].number || now.high < ci->array[0].number;
+        std::ostringstream delta;
+        delta << std::showpos << std::fixed << std::setprecision(1) << change << "%";
+        std::cout << "  " << std::left << std::setw(12) << b.name << std::right << std::setw(10)
+                  << formatSeconds(before->number) << " -> " << std::setw(10) << formatSeconds(now.median) << std::setw(9)
+                  << delta.str() << (significant ? (change > 0 ? "  slower" : "  faster") : "  within noise") << "\n";
+    }
+}
+
+std::vector<std::string> splitFlags(const std::string& flags) {
+    std::istringstream in(flags);
+    std::vector<std::string> result;
+    std::string flag;
+    while (in >> flag) result.push_back(flag);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string compiler = (std::filesystem::canonical("/proc/self/exe").parent_path() / "kotlin-lite").string();
+    std::string flags;
+    std::string jsonFile;
+    std::string compareFile;
+    std::vector<std::string> sources;
+    int runs = 10;
+    int warmup = 2;
+    int cpu = lastAllowedCpu();
+    bool timeC = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg.rfind("--compiler=", 0) == 0) {
+                compiler = arg.substr(11);
+            } else if (arg.rfind("--flags=", 0) == 0) {
+                flags = arg.substr(8);
+            } else if (arg.rfind("--runs=", 0) == 0) {
+                runs = std::stoi(arg.substr(7));
+            } else if (arg.rfind("--warmup=", 0) == 0) {
+                warmup = std::stoi(arg.substr(9));
+            } else if (arg == "--cpu=none") {
+                cpu = -1;
+            } else if (arg.rfind("--cpu=", 0) == 0) {
+                cpu = std::stoi(arg.substr(6));
+            } else if (arg == "--no-c") {
+                timeC = false;
+            } else if (arg.rfind("--json=", 0) == 0) {
+                jsonFile = arg.substr(7);
+            } else if (arg.rfind("--compare=", 0) == 0) {
+                compareFile = arg.substr(10);
+            } else if (arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg.substr(0, 1) != "-") {
+                sources.push_back(arg);
+            } else {
+                std::cerr << "Error: Unknown option " << arg << "\n";
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid number in " << arg << "\n";
+            return 1;
+        }
+    }
+    if (runs < 1 || warmup < 0) {
+        std::cerr << "Error: --runs must be at least 1 and --warmup at least 0\n";
+        return 1;
+    }
+
+    std::optional<Json> previous;
+    if (!compareFile.empty()) {
+        std::ifstream file(compareFile);
+        if (!file) {
+            std::cerr << "Error: Could not open file " << compareFile << "\n";
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        try {
+            previous = JsonParser(buffer.str()).parse();
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << compareFile << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (sources.empty()) {
+        for (const auto& entry : std::filesystem::directory_iterator("benchmarks")) {
+            std::string path = entry.path().string();
+            if (entry.path().extension() == ".kt" && std::filesystem::exists(path.substr(0, path.size() - 3) + "_c.c")) {
+                sources.push_back(path);
+            }
+        }
+        std::sort(sources.begin(), sources.end());
+    }
+    if (sources.empty()) {
+        std::cerr << "Error: No benchmarks found; run from the project root or name them\n";
+        return 1;
+    }
+
+    std::string why;
+    bool haveCounters = hardwareCountersAvailable(why);
+    if (!haveCounters) std::cerr << "note: hardware counters unavailable (" << why << "); reporting wall time only\n";
+
+    std::filesystem::path tmp = std::filesystem::temp_directory_path() / ("kotlin-lite-bench." + std::to_string(getpid()));
+    std::filesystem::create_directories(tmp);
+    std::vector<Benchmark> benchmarks;
+    bool failed = false;
+
+    for (const std::string& source : sources) {
+        Benchmark b;
+        b.source = source;
+        b.name = std::filesystem::path(source).stem().string();
+        b.baseline = source.substr(0, source.size() - 3) + "_c.c";
+        std::string lite = (tmp / (b.name + "_lite")).string();
+        std::string c = (tmp / (b.name + "_c")).string();
+
+        std::string compile = compiler;
+        for (const auto& flag : splitFlags(flags)) compile += " " + flag;
+        compile += " " + source + " -o " + lite + " > /dev/null";
+        std::cerr << "[" << b.name << "] compiling\n";
+        if (system(compile.c_str()) != 0) {
+            std::cerr << "Error: " << compile << " failed\n";
+            failed = true;
+            benchmarks.push_back(b);
+            continue;
+        }
+        bool haveC = std::filesystem::exists(b.baseline) &&
+                     system(("clang -O3 " + b.baseline + " -o " + c + " 2> /dev/null").c_str()) == 0;
+
+        Run liteRun, cRun;
+        std::string error;
+        if (!runProgram(lite, {}, cpu, false, true, liteRun, error)) {
+            std::cerr << "Error: " << error << "\n";
+            failed = true;
+            benchmarks.push_back(b);
+            continue;
+        }
+        if (haveC && runProgram(c, {}, cpu, false, true, cRun, error)) {
+            b.outputMatches = liteRun.output == cRun.output;
+            if (!b.outputMatches) {
+                std::cerr << "Error: " << b.name << " prints\n" << liteRun.output << "but " << b.baseline << " prints\n"
+                          << cRun.output;
+                failed = true;
+            }
+        } else {
+            std::cerr << "warning: no working C baseline for " << b.name << "; output not checked\n";
+            haveC = false;
+        }
+
+        std::cerr << "[" << b.name << "] " << warmup << " warmup + " << runs << " measured run(s)\n";
+        for (int i = 0; i < warmup + runs; ++i) {
+            Run run;
+            // Alternated, so that drift in the machine's speed hits both alike
+            if (!runProgram(lite, {}, cpu, haveCounters, false, run, error)) {
+                std::cerr << "Error: " << error << "\n";
+                failed = true;
+                break;
+            }
+            if (i >= warmup) b.lite.add(run);
+            if (timeC && haveC) {
+                Run baseline;
+                if (runProgram(c, {}, cpu, haveCounters, false, baseline, error) && i >= warmup) b.c.add(baseline);
+            }
+        }
+        benchmarks.push_back(b);
+    }
+    std::filesystem::remove_all(tmp);
+
+    printResults(benchmarks, haveCounters);
+    if (previous) {
+        try {
+            printComparison(benchmarks, *previous);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << compareFile << ": " << e.what() << "\n";
+            failed = true;
+        }
+    }
+    if (!jsonFile.empty()) {
+        std::ofstream out(jsonFile);
+        if (!out) {
+            std::cerr << "Error: Could not open " << jsonFile << " for writing\n";
+            return 1;
+        }
+        writeJson(out, benchmarks, runs, warmup, cpu, flags);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ir/ir_parser.hpp"
+#include "ir/ir_serializer.hpp"
+#include "transforms/pass_registry.hpp"
+
+using namespace kotlin_lite;
+
+void printUsage(const char* progName) {
+    std::cout << "Usage: " << progName << " <input> [options]\n"
+              << "Reads custom IR (text or binary KLIR, detected automatically),\n"
+              << "runs the requested passes in order and writes the result.\n"
+              << "Options:\n"
+              << "  -p <pass>[,<pass>...]  Passes to run\n"
+              << "  -o <file>              Output file (default: stdout for text)\n"
+              << "  --emit=text|binary     Output format (default: text)\n"
+              << "  --time-passes          Report load, pass and write times on stderr\n"
+              << "  --list-passes          List the available passes\n"
+              << "  --help                 Show this help message\n";
+}
+
+int main(int argc, char** argv) {
+    std::string inputFile;
+    std::string outputFile;
+    std::vector<std::string> passes;
+    bool emitBinary = false;
+    bool timePasses = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-p" && i + 1 < argc) {
+            std::stringstream names(argv[++i]);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) passes.push_back(name);
+            }
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (arg == "--emit=text") {
+            emitBinary = false;
+        } else if (arg == "--emit=binary") {
+            emitBinary = true;
+        } else if (arg == "--time-passes") {
+            timePasses = true;
+        } else if (arg == "--list-passes") {
+            for (const auto& pass : ir::passRegistry()) {
+                std::cout << "  " << std::left << std::setw(10) << pass.name << pass.description << "\n";
+            }
+            return 0;
+        } else if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg.substr(0, 1) != "-") {
+            inputFile = arg;
+        } else {
+            std::cerr << "Error: Unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (inputFile.empty()) {
+        std::cerr << "Error: No input file specified.\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (emitBinary && outputFile.empty()) {
+        std::cerr << "Error: --emit=binary needs -o <file>.\n";
+        return 1;
+    }
+    for (const auto& name : passes) {
+        if (!ir::findPass(name)) {
+            std::cerr << "Error: Unknown pass '" << name << "' (see --list-passes).\n";
+            return 1;
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto millis = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::vector<std::pair<std::string, double>> timings;
+
+    try {
+        auto start = Clock::now();
+        std::unique_ptr<ir::Module> module;
+        {
+            std::ifstream file(inputFile, std::ios::binary);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not open file " << inputFile << std::endl;
+                return 1;
+            }
+            char magic[4] = {};
+            file.read(magic, sizeof(magic));
+            if (ir::isBinaryIR(reinterpret_cast<const uint8_t*>(magic), static_cast<size_t>(file.gcount()))) {
+                module = ir::readBinaryFile(inputFile);
+            } else {
+                file.clear();
+                file.seekg(0);
+                std::stringstream buffer;
+                buffer << file.rdbuf();
+                module = ir::IRParser(buffer.str()).parse();
+            }
+        }
+        timings.emplace_back("load", millis(Clock::now() - start));
+
+        for (const auto& name : passes) {
+            start = Clock::now();
+            ir::findPass(name)->run(*module);
+            timings.emplace_back(name, millis(Clock::now() - start));
+        }
+
+        start = Clock::now();
+        if (emitBinary) {
+            ir::writeBinaryFile(*module, outputFile);
+        } else if (outputFile.empty()) {
+            std::cout << module->dump();
+        } else {
+            std::ofstream out(outputFile);
+            if (!out) {
+                std::cerr << "Error: Could not open " << outputFile << " for writing\n";
+                return 1;
+            }
+            out << module->dump();
+        }
+        timings.emplace_back("write", millis(Clock::now() - start));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (timePasses) {
+        std::cerr << "--- Pass timings ---\n";
+        for (const auto& [name, ms] : timings) {
+            std::cerr << "  " << std::left << std::setw(10) << name << std::fixed << std::setprecision(3) << ms << " ms\n";
+        }
+    }
+    return 0;
+}
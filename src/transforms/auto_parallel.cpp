@@ -0,0 +1,329 @@
+#include "auto_parallel.hpp"
+#include "ir/statistics.hpp"
+#include "ir/ir_builder.hpp"
+#include <map>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(ParallelizedLoops, "auto-parallel", "Loops outlined to run on the thread pool");
+
+namespace {
+
+using Op = Instruction::OpKind;
+
+bool isAdditive(Op kind) { return kind == Op::Add || kind == Op::Sub; }
+
+} // namespace
+
+bool AutoParallelization::run(Module& module) {
+    FunctionAttrs attrs(module);
+    // Workers outlined earlier already run a chunk each; they stay serial
+    workers_.clear();
+    for (const auto& func : module.functions) {
+        for (const auto& bb : func->blocks) {
+            for (const auto& inst : bb->instructions) {
+                auto call = dynamic_cast<CallInst*>(inst.get());
+                if (call && call->parallel) workers_.insert(call->callee);
+            }
+        }
+    }
+
+    bool changed = false;
+    // Outlining appends functions; only the ones present now are candidates
+    size_t count = module.functions.size();
+    for (size_t i = 0; i < count; ++i) {
+        changed |= runOnFunction(module, *module.functions[i], attrs);
+    }
+    return changed;
+}
+
+void AutoParallelization::remark(Remark::Kind kind, const char* name, const Function& func, const Loop& loop, std::string message) {
+    if (!remarks_) return;
+    Remark remark;
+    remark.kind = kind;
+    remark.pass = "auto-parallel";
+    remark.name = name;
+    remark.function = func.name;
+    remark.message = std::move(message);
+    locate(remark, *loop.header);
+    remarks_->emit(std::move(remark));
+}
+
+bool AutoParallelization::runOnFunction(Module& module, Function& func, const FunctionAttrs& attrs) {
+    if (func.blocks.empty() || workers_.count(func.name)) return false;
+    bool changed = foldTrivialPhis(func) > 0;
+
+    // Each outermost loop is looked at once; an outlined loop leaves the function
+    std::set<std::string> visited;
+    bool outlined = true;
+    while (outlined) {
+        outlined = false;
+        LoopNestAnalysis nest(func);
+        for (const auto& loop : nest.loopInfo().loops()) {
+            if (loop->parent || !visited.insert(loop->header->label).second) continue;
+            if (tryParallelize(module, func, nest, attrs, loop.get())) {
+                outlined = changed = true;
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+bool AutoParallelization::tryParallelize(Module& module, Function& func, const LoopNestAnalysis& nest,
+                                         const FunctionAttrs& attrs, Loop* loop) {
+    std::string what = describeLoop(loop);
+    auto missed = [&](const char* name, const std::string& why) {
+        remark(Remark::Kind::Missed, name, func, *loop, "cannot parallelize " + what + ": " + why);
+        return false;
+    };
+
+    const CountedLoop* counted = nest.counted(loop);
+    if (!counted) return missed("NotCounted", "it is not counted: " + nest.whyNot(loop));
+    LoopEffects fx = loopEffects(*loop, attrs);
+    if (fx.observable) return missed("Effects", "its iterations print, so they must run in order");
+    if (fx.sharesState) return missed("Memoized", "it calls a @Memoize function, whose cache is not thread-safe");
+
+    Reduction reduction;
+    std::string whyNot;
+    if (!findReduction(nest, *counted, reduction, whyNot)) return missed("NoReduction", whyNot);
+
+    for (BasicBlock* bb : loop->blocks) {
+        for (const auto& inst : bb->instructions) {
+            if (inst.get() == reduction.phi) continue;
+            for (Instruction* user : nest.users(inst.get())) {
+                if (!loop->contains(user->parent)) return missed("LiveOut", inst->getName() + " is used after the loop");
+            }
+        }
+    }
+
+    auto trips = counted->tripCount();
+    if (trips && *trips < options_.minTripCount) {
+        return missed("TooFewIterations", "it runs " + std::to_string(*trips) + " iterations, fewer than " +
+                                          std::to_string(options_.minTripCount));
+    }
+    // Otherwise a --profile-use profile tells how long the loop ran
+    if (!trips && counted->preheader->profileCount && counted->latch->profileCount) {
+        uint64_t entries = *counted->preheader->profileCount;
+        if (entries == 0) return missed("Cold", "it never ran in the profile");
+        uint64_t average = *counted->latch->profileCount / entries;
+        if (average < static_cast<uint64_t>(options_.minTripCount)) {
+            return missed("TooFewIterations", "it ran " + std::to_string(average) +
+                                              " iterations on average in the profile, fewer than " +
+                                              std::to_string(options_.minTripCount));
+        }
+    }
+
+    std::string detail = BinaryInst::opName(reduction.op) + " reduction of " + reduction.phi->getName();
+    // Outlining deletes the loop's blocks, so its position is taken first
+    Remark passed;
+    passed.kind = Remark::Kind::Passed;
+    passed.pass = "auto-parallel";
+    passed.name = "Parallelized";
+    passed.function = func.name;
+    locate(passed, *loop->header);
+    outline(module, func, *counted, reduction);
+    stats_.parallelizedLoops++;
+    ++ParallelizedLoops;
+    passed.message = "outlined " + what + " into @" + module.functions.back()->name + " (" + detail + ")";
+    if (remarks_) remarks_->emit(std::move(passed));
+    return true;
+}
+
+bool AutoParallelization::findReduction(const LoopNestAnalysis& nest, const CountedLoop& loop, Reduction& reduction,
+                                        std::string& whyNot) const {
+    for (const auto& inst : loop.header->instructions) {
+        auto phi = dynamic_cast<PhiInst*>(inst.get());
+        if (!phi) break;
+        if (phi == loop.iv) continue;
+        if (reduction.phi) {
+            whyNot = "it carries more than one value between iterations";
+            return false;
+        }
+        reduction.phi = phi;
+    }
+    if (!reduction.phi) {
+        whyNot = "it computes no result to combine";
+        return false;
+    }
+    if (reduction.phi->type != Type::I32) {
+        whyNot = reduction.phi->getName() + " is not an integer";
+        return false;
+    }
+
+    // Everything derived from the accumulator inside the loop
+    std::set<Value*> chain = {reduction.phi};
+    std::vector<Value*> work = {reduction.phi};
+    while (!work.empty()) {
+        Value* value = work.back();
+        work.pop_back();
+        for (Instruction* user : nest.users(value)) {
+            if (!loop.loop->contains(user->parent)) {
+                if (value == reduction.phi) continue;  // the final value
+                whyNot = "a partial result of " + reduction.phi->getName() + " is used after the loop";
+                return false;
+            }
+            bool combines = user->kind == Op::Add || user->kind == Op::Sub || user->kind == Op::Mul;
+            if (!combines && user->kind != Op::Phi) {
+                whyNot = reduction.phi->getName() + " is read by " + user->getName() + ", not only accumulated";
+                return false;
+            }
+            if (chain.insert(user).second) work.push_back(user);
+        }
+    }
+
+    auto backedge = reduction.phi->incomings.find(loop.latch);
+    if (backedge == reduction.phi->incomings.end() || !chain.count(backedge->second)) {
+        whyNot = reduction.phi->getName() + " is overwritten instead of accumulated";
+        return false;
+    }
+
+    // Each step combines the accumulator with something independent of it;
+    // phis in the body merge paths that did or did not update it
+    bool additive = false, multiplicative = false;
+    for (Value* value : chain) {
+        if (value == reduction.phi) continue;
+        if (auto phi = dynamic_cast<PhiInst*>(value)) {
+            for (const auto& [pred, incoming] : phi->incomings) {
+                if (!chain.count(incoming)) {
+                    whyNot = phi->getName() + " replaces " + reduction.phi->getName() + " on some path";
+                    return false;
+                }
+            }
+            continue;
+        }
+        auto bin = static_cast<BinaryInst*>(value);
+        bool left = chain.count(bin->left) > 0, right = chain.count(bin->right) > 0;
+        if (left == right || (bin->kind == Op::Sub && !left)) {
+            whyNot = bin->getName() + " does not combine " + reduction.phi->getName() + " with an independent value";
+            return false;
+        }
+        additive |= isAdditive(bin->kind);
+        multiplicative |= bin->kind == Op::Mul;
+    }
+    if (additive == multiplicative) {
+        whyNot = additive ? reduction.phi->getName() + " mixes additions and multiplications"
+                          : reduction.phi->getName() + " never changes";
+        return false;
+    }
+    reduction.op = additive ? Op::Add : Op::Mul;
+    return true;
+}
+
+void AutoParallelization::outline(Module& module, Function& func, const CountedLoop& loop, const Reduction& reduction) {
+    std::string name;
+    for (int n = 0; name.empty() || module.getFunction(name); ++n) name = func.name + ".par" + std::to_string(n);
+
+    // Values the loop reads from outside become arguments. The bound is
+    // replaced by the chunk end, and the header phis' initial values by the
+    // chunk start and the identity.
+    std::vector<Value*> invariants;
+    std::set<Value*> seen;
+    for (const auto& bb : func.blocks) {
+        if (!loop.loop->contains(bb.get())) continue;
+        for (const auto& inst : bb->instructions) {
+            std::vector<Value*> operands;
+            if (auto phi = dynamic_cast<PhiInst*>(inst.get())) {
+                for (const auto& [pred, value] : phi->incomings) {
+                    if (pred != loop.preheader || phi->parent != loop.header) operands.push_back(value);
+                }
+            } else if (inst.get() == loop.compare) {
+                operands.push_back(loop.iv);
+            } else {
+                operands = inst->getOperands();
+            }
+            for (Value* op : operands) {
+                bool outside = dynamic_cast<ArgumentValue*>(op) ||
+                               (dynamic_cast<Instruction*>(op) && !loop.loop->contains(static_cast<Instruction*>(op)->parent));
+                if (outside && seen.insert(op).second) invariants.push_back(op);
+            }
+        }
+    }
+
+    std::vector<Argument> args = {{"start", Type::I32}, {"end", Type::I32}};
+    for (Value* value : invariants) {
+        auto arg = dynamic_cast<ArgumentValue*>(value);
+        args.push_back({arg ? arg->name : "v" + static_cast<Instruction*>(value)->id, value->getType()});
+    }
+    auto worker = std::make_unique<Function>(name, Type::I32, args);
+    worker->line = func.line;
+    std::map<const Value*, Value*> valueMap;
+    for (size_t i = 0; i < worker->args.size(); ++i) {
+        worker->args[i].ssaValue = new ArgumentValue(worker->args[i].name, worker->args[i].type);
+        if (i >= 2) valueMap[invariants[i - 2]] = worker->args[i].ssaValue;
+    }
+    Value* start = worker->args[0].ssaValue;
+    Value* end = worker->args[1].ssaValue;
+
+    BasicBlock* entry = worker->createBlock("entry");
+    std::map<BasicBlock*, BasicBlock*> blockMap = {{loop.preheader, entry}};
+    for (const auto& bb : func.blocks) {
+        if (loop.loop->contains(bb.get())) blockMap[bb.get()] = worker->createBlock(bb->label);
+    }
+    BasicBlock* exit = worker->createBlock("exit");
+    blockMap[loop.exit] = exit;
+
+    for (const auto& bb : func.blocks) {
+        if (!loop.loop->contains(bb.get())) continue;
+        for (const auto& inst : bb->instructions) {
+            auto copy = inst->clone();
+            if (inst.get() == loop.compare) {
+                auto cmp = static_cast<BinaryInst*>(copy.get());
+                (cmp->left == loop.iv ? cmp->right : cmp->left) = end;
+            }
+            valueMap[inst.get()] = copy.get();
+            blockMap[bb.get()]->addInstruction(std::move(copy));
+        }
+    }
+    for (const auto& bb : worker->blocks) {
+        for (auto& inst : bb->instructions) {
+            for (Value* op : inst->getOperands()) {
+                auto it = valueMap.find(op);
+                if (it != valueMap.end()) inst->replaceUsesOfWith(op, it->second);
+            }
+            if (auto phi = dynamic_cast<PhiInst*>(inst.get())) {
+                std::map<BasicBlock*, Value*> remapped;
+                for (const auto& [pred, value] : phi->incomings) remapped[blockMap.at(pred)] = value;
+                phi->incomings = std::move(remapped);
+            }
+        }
+        for (BasicBlock* succ : bb->getSuccessors()) {
+            if (blockMap.count(succ)) bb->replaceSuccessor(succ, blockMap.at(succ));
+        }
+    }
+
+    auto iv = static_cast<PhiInst*>(valueMap.at(loop.iv));
+    auto acc = static_cast<PhiInst*>(valueMap.at(reduction.phi));
+    iv->incomings[entry] = start;
+    acc->incomings[entry] = new Constant(Type::I32, reduction.op == Op::Mul ? 1 : 0);
+    IRBuilder builder;
+    builder.setInsertPoint(entry);
+    builder.createBr(blockMap.at(loop.header));
+    builder.setInsertPoint(exit);
+    builder.createRet(acc);
+
+    // The caller combines the worker's result with the accumulator's initial value
+    Value* initial = reduction.phi->incomings.at(loop.preheader);
+    std::vector<Value*> callArgs = {loop.init, loop.bound};
+    callArgs.insert(callArgs.end(), invariants.begin(), invariants.end());
+    IRBuilder caller(func.nextFreeId());
+    caller.setInsertPointBefore(loop.preheader->getTerminator());
+    auto call = static_cast<CallInst*>(caller.createCall(Type::I32, name, callArgs));
+    call->parallel = CallInst::ParallelLoop{reduction.op, loop.predicate, loop.step};
+    Value* total = caller.createBinary(reduction.op, initial, call);
+
+    loop.preheader->replaceSuccessor(loop.header, loop.exit);
+    for (auto& inst : loop.exit->instructions) {
+        if (auto phi = dynamic_cast<PhiInst*>(inst.get())) phi->replaceIncomingBlock(loop.header, loop.preheader);
+    }
+    func.replaceAllUsesWith(reduction.phi, total);
+    func.blocks.remove_if([&](const std::unique_ptr<BasicBlock>& bb) { return loop.loop->contains(bb.get()); });
+
+    workers_.insert(name);
+    module.addFunction(std::move(worker));
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,69 @@
+#pragma once
+#include "ir/ir.hpp"
+#include "ir/function_attrs.hpp"
+#include "ir/loop_nest.hpp"
+#include "ir/remarks.hpp"
+#include <cstdint>
+#include <set>
+#include <string>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Outlines reduction loops whose iterations are independent into worker
+// functions that a backend may run on several threads.
+//
+// A candidate is an outermost counted loop that prints nothing (directly or
+// through callees) and whose only value carried across iterations besides
+// the counter is one integer reduction: every path through the body either
+// leaves the accumulator alone or combines it with values that do not depend
+// on it, all with `+`/`-` or all with `*`. Wrapping add and mul are
+// associative and commutative, so partial results of any split of the
+// iteration range combine to the serial result.
+//
+// The loop becomes
+//
+//     %r = call i32 @f.par0(i32 init, i32 bound, <invariants>) parallel(add, lt, 1)
+//     %sum = add i32 %acc.init, %r
+//
+// where @f.par0 runs the loop from its first to its second argument with the
+// accumulator starting at the identity. See CallInst::ParallelLoop.
+class AutoParallelization {
+public:
+    struct Options {
+        // Loops with a known trip count below this stay serial, as do loops
+        // that ran fewer iterations on average in the profile; the runtime
+        // applies the same threshold (KL_PARALLEL_MIN_TRIPS) to the others
+        int64_t minTripCount = 10000;
+    };
+
+    struct Statistics {
+        int parallelizedLoops = 0;
+    };
+
+    explicit AutoParallelization(RemarkCollector* remarks = nullptr) : remarks_(remarks) {}
+    AutoParallelization(Options options, RemarkCollector* remarks) : options_(options), remarks_(remarks) {}
+
+    bool run(Module& module);
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    struct Reduction {
+        PhiInst* phi = nullptr;
+        Instruction::OpKind op = Instruction::OpKind::Add;
+    };
+
+    Options options_;
+    RemarkCollector* remarks_;
+    Statistics stats_;
+    std::set<std::string> workers_;
+
+    bool runOnFunction(Module& module, Function& func, const FunctionAttrs& attrs);
+    bool tryParallelize(Module& module, Function& func, const LoopNestAnalysis& nest, const FunctionAttrs& attrs, Loop* loop);
+    bool findReduction(const LoopNestAnalysis& nest, const CountedLoop& loop, Reduction& reduction, std::string& whyNot) const;
+    void outline(Module& module, Function& func, const CountedLoop& loop, const Reduction& reduction);
+    void remark(Remark::Kind kind, const char* name, const Function& func, const Loop& loop, std::string message);
+};
+
+} // namespace ir
+} // namespace kotlin_lite
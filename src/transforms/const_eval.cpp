@@ -0,0 +1,299 @@
+#include "const_eval.hpp"
+#include "ir/statistics.hpp"
+#include "ir/call_graph.hpp"
+#include "ir/function_attrs.hpp"
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(FoldedCalls, "consteval", "Calls evaluated at compile time");
+KL_STATISTIC(FoldedInstructions, "consteval", "Instructions folded to constants");
+KL_STATISTIC(RejectedByBudget, "consteval", "Calls left because evaluation exceeded a budget");
+KL_STATISTIC(RejectedByTrap, "consteval", "Calls left because evaluation would trap");
+
+namespace {
+
+// Thrown inside the interpreter to abandon the evaluation of one call.
+struct EvalAbort {
+    enum Reason { Impure, Steps, Memory, Trap } reason;
+};
+
+std::string describe(EvalAbort::Reason reason) {
+    switch (reason) {
+        case EvalAbort::Impure: return "calls a function with side effects";
+        case EvalAbort::Steps: return "exceeds the compile-time step budget";
+        case EvalAbort::Memory: return "exceeds the compile-time memory budget";
+        case EvalAbort::Trap: return "divides by zero, overflows a division or shifts out of range";
+    }
+    return "";
+}
+
+// The low `bitWidth(type)` bits of a value kept sign-extended
+uint64_t unsignedBits(Type type, int64_t v) {
+    unsigned width = bitWidth(type);
+    if (width == 64) return static_cast<uint64_t>(v);
+    return static_cast<uint64_t>(v) & ((uint64_t(1) << width) - 1);
+}
+
+// Same semantics as the LLVM lowering: wrapping add/sub/mul, trapping division.
+// `type` is the operands' type; values are kept sign-extended from it, which
+// preserves unsigned order too.
+bool foldBinary(Instruction::OpKind kind, Type type, int64_t l, int64_t r, int64_t& out) {
+    uint64_t ul = static_cast<uint64_t>(l);
+    uint64_t ur = static_cast<uint64_t>(r);
+    int64_t width = bitWidth(type);
+    int64_t min = static_cast<int64_t>(uint64_t(1) << (width - 1));
+    switch (kind) {
+        case Instruction::OpKind::Add: out = Constant::normalize(type, static_cast<int64_t>(ul + ur)); return true;
+        case Instruction::OpKind::Sub: out = Constant::normalize(type, static_cast<int64_t>(ul - ur)); return true;
+        case Instruction::OpKind::Mul: out = Constant::normalize(type, static_cast<int64_t>(ul * ur)); return true;
+        case Instruction::OpKind::SDiv:
+        case Instruction::OpKind::SRem:
+            if (r == 0 || (l == Constant::normalize(type, min) && r == -1)) return false;
+            out = Constant::normalize(type, kind == Instruction::OpKind::SDiv ? l / r : l % r);
+            return true;
+        case Instruction::OpKind::UDiv:
+        case Instruction::OpKind::URem:
+            if (r == 0) return false;
+            ul = unsignedBits(type, l);
+            ur = unsignedBits(type, r);
+            out = Constant::normalize(type, static_cast<int64_t>(kind == Instruction::OpKind::UDiv ? ul / ur : ul % ur));
+            return true;
+        case Instruction::OpKind::Shl:
+        case Instruction::OpKind::LShr:
+            // Shifting by the bit width or more is undefined in LLVM; never fold it
+            if (r < 0 || r >= width) return false;
+            out = Constant::normalize(type, static_cast<int64_t>(kind == Instruction::OpKind::Shl
+                                                                      ? ul << r
+                                                                      : unsignedBits(type, l) >> r));
+            return true;
+        case Instruction::OpKind::ICmpEq: out = l == r; return true;
+        case Instruction::OpKind::ICmpNe: out = l != r; return true;
+        case Instruction::OpKind::ICmpLt: out = l < r; return true;
+        case Instruction::OpKind::ICmpLe: out = l <= r; return true;
+        case Instruction::OpKind::ICmpGt: out = l > r; return true;
+        case Instruction::OpKind::ICmpGe: out = l >= r; return true;
+        case Instruction::OpKind::ICmpULt: out = ul < ur; return true;
+        case Instruction::OpKind::ICmpULe: out = ul <= ur; return true;
+        case Instruction::OpKind::ICmpUGt: out = ul > ur; return true;
+        case Instruction::OpKind::ICmpUGe: out = ul >= ur; return true;
+        default: return false;
+    }
+}
+
+// `not` and the integer casts
+int64_t foldUnary(const UnaryInst* inst, int64_t v) {
+    switch (inst->kind) {
+        case Instruction::OpKind::Not: return !v;
+        case Instruction::OpKind::ZExt: return static_cast<int64_t>(unsignedBits(inst->operand->getType(), v));
+        default: return Constant::normalize(inst->type, v); // sext, trunc
+    }
+}
+
+class Interpreter {
+public:
+    Interpreter(const Module& module, const FunctionAttrs& attrs, const CompileTimeEvaluation::Options& options)
+        : module_(module), attrs_(attrs), options_(options) {}
+
+    bool isPure(const std::string& name) const {
+        return module_.getFunction(name) && !attrs_.get(name).hasIO;
+    }
+
+    int64_t call(const std::string& name, const std::vector<int64_t>& args) {
+        if (!isPure(name)) throw EvalAbort{EvalAbort::Impure};
+        const Function& func = *module_.getFunction(name);
+
+        size_t frameBytes = 64 + 32 * (func.instructionCount() + func.args.size());
+        memory_ += frameBytes;
+        if (memory_ > options_.maxMemoryBytes) throw EvalAbort{EvalAbort::Memory};
+
+        std::unordered_map<const Value*, int64_t> values;
+        for (size_t i = 0; i < func.args.size() && i < args.size(); ++i) {
+            if (func.args[i].ssaValue) values[func.args[i].ssaValue] = args[i];
+        }
+        auto get = [&](const Value* v) -> int64_t {
+            if (auto c = dynamic_cast<const Constant*>(v)) return c->value;
+            auto it = values.find(v);
+            if (it == values.end()) throw EvalAbort{EvalAbort::Impure}; // e.g. a function reference
+            return it->second;
+        };
+
+        const BasicBlock* prev = nullptr;
+        const BasicBlock* bb = func.blocks.front().get();
+        while (true) {
+            auto it = bb->instructions.begin();
+            // Phis read their inputs before any of them is written
+            std::vector<std::pair<const Instruction*, int64_t>> phiValues;
+            for (; it != bb->instructions.end() && (*it)->kind == Instruction::OpKind::Phi; ++it) {
+                auto phi = static_cast<const PhiInst*>(it->get());
+                auto in = phi->incomings.find(const_cast<BasicBlock*>(prev));
+                if (in == phi->incomings.end()) throw EvalAbort{EvalAbort::Impure};
+                phiValues.emplace_back(phi, get(in->second));
+            }
+            for (const auto& [phi, val] : phiValues) values[phi] = val;
+
+            const BasicBlock* next = nullptr;
+            for (; it != bb->instructions.end() && !next; ++it) {
+                if (++steps_ > options_.maxSteps) throw EvalAbort{EvalAbort::Steps};
+                const Instruction* inst = it->get();
+                switch (inst->kind) {
+                    case Instruction::OpKind::Not:
+                    case Instruction::OpKind::ZExt:
+                    case Instruction::OpKind::SExt:
+                    case Instruction::OpKind::Trunc: {
+                        auto unary = static_cast<const UnaryInst*>(inst);
+                        values[inst] = foldUnary(unary, get(unary->operand));
+                        break;
+                    }
+                    case Instruction::OpKind::Call: {
+                        auto ci = static_cast<const CallInst*>(inst);
+                        std::vector<int64_t> callArgs;
+                        for (Value* arg : ci->args) callArgs.push_back(get(arg));
+                        values[inst] = call(ci->callee, callArgs);
+                        break;
+                    }
+                    case Instruction::OpKind::Br:
+                        next = static_cast<const BranchInst*>(inst)->target;
+                        break;
+                    case Instruction::OpKind::CondBr: {
+                        auto cbr = static_cast<const CondBranchInst*>(inst);
+                        next = get(cbr->condition) ? cbr->thenBB : cbr->elseBB;
+                        break;
+                    }
+                    case Instruction::OpKind::Ret: {
+                        auto ret = static_cast<const ReturnInst*>(inst);
+                        int64_t result = ret->value ? get(ret->value) : 0;
+                        memory_ -= frameBytes;
+                        return result;
+                    }
+                    case Instruction::OpKind::Phi:
+                        throw EvalAbort{EvalAbort::Impure};
+                    default: {
+                        auto bin = static_cast<const BinaryInst*>(inst);
+                        int64_t result;
+                        if (!foldBinary(inst->kind, bin->left->getType(), get(bin->left), get(bin->right), result)) {
+                            throw EvalAbort{EvalAbort::Trap};
+                        }
+                        values[inst] = result;
+                        break;
+                    }
+                }
+            }
+            if (!next) throw EvalAbort{EvalAbort::Impure}; // block without terminator
+            prev = bb;
+            bb = next;
+        }
+    }
+
+private:
+    const Module& module_;
+    const FunctionAttrs& attrs_;
+    const CompileTimeEvaluation::Options& options_;
+    size_t steps_ = 0;
+    size_t memory_ = 0;
+};
+
+bool allConstant(const std::vector<Value*>& operands) {
+    return std::all_of(operands.begin(), operands.end(), [](Value* v) { return dynamic_cast<Constant*>(v) != nullptr; });
+}
+
+} // namespace
+
+bool CompileTimeEvaluation::run(Module& module) {
+    FunctionAttrs attrs(module);
+    std::set<const CallInst*> rejected;
+    std::map<std::string, std::string> failures;
+    bool changed = false;
+
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto& func : module.functions) {
+            for (auto& bb : func->blocks) {
+                for (auto it = bb->instructions.begin(); it != bb->instructions.end();) {
+                    Instruction* inst = it->get();
+                    Constant* folded = nullptr;
+                    bool erase = false;
+
+                    if (inst->kind == Instruction::OpKind::Call) {
+                        auto ci = static_cast<CallInst*>(inst);
+                        bool isConstant = isConstantInitializer(ci->callee);
+                        if ((options_.foldCalls || isConstant) && !rejected.count(ci) && allConstant(ci->args)) {
+                            Interpreter interp(module, attrs, options_);
+                            if (interp.isPure(ci->callee)) {
+                                std::vector<int64_t> args;
+                                for (Value* arg : ci->args) args.push_back(static_cast<Constant*>(arg)->value);
+                                try {
+                                    int64_t result = interp.call(ci->callee, args);
+                                    if (ci->type != Type::Void) folded = new Constant(ci->type, result);
+                                    erase = true;
+                                    stats_.foldedCalls++;
+                                    ++FoldedCalls;
+                                    if (isConstant) stats_.foldedConstants++;
+                                } catch (const EvalAbort& abort) {
+                                    rejected.insert(ci);
+                                    if (abort.reason == EvalAbort::Trap) {
+                                        stats_.rejectedByTrap++;
+                                        ++RejectedByTrap;
+                                    } else if (abort.reason != EvalAbort::Impure) {
+                                        stats_.rejectedByBudget++;
+                                        ++RejectedByBudget;
+                                    }
+                                    if (isConstant) failures[ci->callee] = describe(abort.reason);
+                                }
+                            }
+                        }
+                    } else if (options_.foldCalls && inst->kind != Instruction::OpKind::Phi &&
+                               inst->type != Type::Void && allConstant(inst->getOperands())) {
+                        auto ops = inst->getOperands();
+                        int64_t result;
+                        bool ok = false;
+                        if (auto unary = dynamic_cast<UnaryInst*>(inst)) {
+                            result = foldUnary(unary, static_cast<Constant*>(ops[0])->value);
+                            ok = true;
+                        } else if (ops.size() == 2) {
+                            ok = foldBinary(inst->kind, ops[0]->getType(), static_cast<Constant*>(ops[0])->value,
+                                            static_cast<Constant*>(ops[1])->value, result);
+                        }
+                        if (ok) {
+                            folded = new Constant(inst->type, result);
+                            erase = true;
+                            stats_.foldedInstructions++;
+                            ++FoldedInstructions;
+                        }
+                    }
+
+                    if (!erase) {
+                        ++it;
+                        continue;
+                    }
+                    if (folded) func->replaceAllUsesWith(inst, folded);
+                    it = bb->instructions.erase(it);
+                    progress = changed = true;
+                }
+            }
+        }
+    }
+
+    // Initializers with no calls left are dead; the rest could not be evaluated.
+    CallGraph cg(module);
+    unfolded_constants_.clear();
+    auto& functions = module.functions;
+    functions.erase(std::remove_if(functions.begin(), functions.end(), [&](const std::unique_ptr<Function>& func) {
+        if (!isConstantInitializer(func->name)) return false;
+        if (!cg.callSites(func->name).empty()) {
+            auto it = failures.find(func->name);
+            unfolded_constants_[func->name.substr(6)] = it != failures.end() ? it->second : describe(EvalAbort::Impure);
+            return false;
+        }
+        changed = true;
+        return true;
+    }), functions.end());
+    return changed;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
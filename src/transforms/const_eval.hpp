@@ -0,0 +1,58 @@
+#pragma once
+#include "ir/ir.hpp"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Evaluates calls to pure functions at compile time.
+//
+// A call whose arguments are all constants and whose callee is defined in the
+// module and has no I/O (per `FunctionAttrs`) is run by a small interpreter
+// over the custom IR and replaced by its result. Binary and unary
+// instructions over constants are folded along the way, so `f(g(3) + 1)`
+// folds completely. Evaluation gives up, leaving the call alone, when it
+// would trap (division by zero, INT_MIN / -1) or exceed its budgets.
+//
+// `const val X` initializers arrive as nullary functions named `const.X`.
+// They are always folded, and deleted once no calls to them remain.
+class CompileTimeEvaluation {
+public:
+    struct Options {
+        // false: only `const val` initializers are evaluated
+        bool foldCalls = true;
+        // Instructions executed for one folded call, callees included
+        size_t maxSteps = 1000000;
+        // Interpreter frames live at once for one folded call
+        size_t maxMemoryBytes = 1 << 20;
+    };
+
+    struct Statistics {
+        int foldedCalls = 0;
+        int foldedConstants = 0;     // `const val` uses among foldedCalls
+        int foldedInstructions = 0;
+        int rejectedByBudget = 0;
+        int rejectedByTrap = 0;
+    };
+
+    CompileTimeEvaluation() = default;
+    explicit CompileTimeEvaluation(Options options) : options_(options) {}
+
+    bool run(Module& module);
+    const Statistics& getStatistics() const { return stats_; }
+    // `const val` names whose initializer could not be evaluated, with the reason
+    const std::map<std::string, std::string>& getUnfoldedConstants() const { return unfolded_constants_; }
+
+    static bool isConstantInitializer(const std::string& name) { return name.compare(0, 6, "const.") == 0; }
+
+private:
+    Options options_;
+    Statistics stats_;
+    std::map<std::string, std::string> unfolded_constants_;
+};
+
+} // namespace ir
+} // namespace kotlin_lite
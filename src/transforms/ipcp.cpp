@@ -0,0 +1,230 @@
+#include "ipcp.hpp"
+#include "ir/statistics.hpp"
+#include "ir/cfg.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(PropagatedArguments, "ipcp", "Parameters replaced by a constant");
+KL_STATISTIC(RemovedArguments, "ipcp", "Parameters removed from signatures");
+KL_STATISTIC(SpecializedFunctions, "ipcp", "Functions cloned for constant arguments");
+KL_STATISTIC(RedirectedCallSites, "ipcp", "Call sites redirected to a clone");
+KL_STATISTIC(InstructionGrowth, "ipcp", "Instructions added by cloning");
+KL_STATISTIC(RejectedByBudget, "ipcp", "Clones rejected by the growth budget");
+
+namespace {
+
+bool sameConstant(const Constant* a, const Constant* b) {
+    return a->type == b->type && a->value == b->value;
+}
+
+// Removes the parameters at `indices` from a function and from the given calls.
+void eraseArguments(Function& func, const std::vector<CallInst*>& calls, std::vector<size_t> indices) {
+    std::sort(indices.rbegin(), indices.rend());
+    for (size_t i : indices) {
+        func.args.erase(func.args.begin() + i);
+        for (CallInst* call : calls) {
+            if (i < call->args.size()) call->args.erase(call->args.begin() + i);
+        }
+    }
+}
+
+} // namespace
+
+bool InterproceduralConstantPropagation::run(Module& module) {
+    bool changed = false;
+    auto propagate = [&]() {
+        if (!options_.wholeProgram) return;
+        bool progress = true;
+        while (progress) {
+            progress = propagateConstants(module);
+            progress |= removeDeadArguments(module);
+            changed |= progress;
+        }
+    };
+
+    propagate();
+    if (options_.specialize && specialize(module)) {
+        changed = true;
+        propagate();
+    }
+    return changed;
+}
+
+bool InterproceduralConstantPropagation::canChangeSignature(const CallGraph& cg, const Function& func) const {
+    return options_.wholeProgram && !options_.preserveSignatures.count(func.name) && !cg.isAddressTaken(func.name);
+}
+
+bool InterproceduralConstantPropagation::propagateConstants(Module& module) {
+    CallGraph cg(module);
+    bool changed = false;
+    for (auto& func : module.functions) {
+        const auto& sites = cg.callSites(func->name);
+        if (sites.empty() || !canChangeSignature(cg, *func)) continue;
+
+        for (size_t i = 0; i < func->args.size(); ++i) {
+            Value* param = func->args[i].ssaValue;
+            if (!param) continue;
+
+            Constant* agreed = nullptr;
+            bool agree = true;
+            for (const auto& site : sites) {
+                if (i >= site.call->args.size()) { agree = false; break; }
+                Value* arg = site.call->args[i];
+                // Recursion that passes the parameter through does not disagree
+                if (site.caller == func.get() && arg == param) continue;
+                auto constant = dynamic_cast<Constant*>(arg);
+                if (!constant || (agreed && !sameConstant(agreed, constant))) { agree = false; break; }
+                agreed = constant;
+            }
+            if (!agree || !agreed) continue;
+
+            bool used = false;
+            for (const auto& bb : func->blocks) {
+                for (const auto& inst : bb->instructions) {
+                    auto ops = inst->getOperands();
+                    if (std::find(ops.begin(), ops.end(), param) != ops.end()) { used = true; break; }
+                }
+                if (used) break;
+            }
+            if (!used) continue;
+
+            func->replaceAllUsesWith(param, new Constant(agreed->type, agreed->value));
+            stats_.propagatedArguments++;
+            ++PropagatedArguments;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool InterproceduralConstantPropagation::removeDeadArguments(Module& module) {
+    CallGraph cg(module);
+    bool changed = false;
+    for (auto& func : module.functions) {
+        if (func->args.empty() || !canChangeSignature(cg, *func)) continue;
+
+        std::set<Value*> used;
+        for (const auto& bb : func->blocks) {
+            for (const auto& inst : bb->instructions) {
+                for (Value* op : inst->getOperands()) used.insert(op);
+            }
+        }
+
+        std::vector<size_t> dead;
+        for (size_t i = 0; i < func->args.size(); ++i) {
+            if (!used.count(func->args[i].ssaValue)) dead.push_back(i);
+        }
+        if (dead.empty()) continue;
+
+        std::vector<CallInst*> calls;
+        for (const auto& site : cg.callSites(func->name)) calls.push_back(site.call);
+        eraseArguments(*func, calls, dead);
+        stats_.removedArguments += static_cast<int>(dead.size());
+        RemovedArguments += dead.size();
+        changed = true;
+    }
+    return changed;
+}
+
+bool InterproceduralConstantPropagation::specialize(Module& module) {
+    CallGraph cg(module);
+    size_t budget = std::max(options_.minGrowthBudget, module.instructionCount() * options_.growthBudgetPercent / 100);
+
+    std::map<Function*, std::unique_ptr<LoopInfo>> loopInfos;
+    std::map<Function*, std::unique_ptr<CFG>> cfgs;
+    auto siteWeight = [&](const CallGraph::CallSite& site) {
+        auto& cfg = cfgs[site.caller];
+        if (!cfg) {
+            cfg = std::make_unique<CFG>(*site.caller);
+            loopInfos[site.caller] = std::make_unique<LoopInfo>(*site.caller, *cfg);
+        }
+        int depth = std::min(loopInfos[site.caller]->loopDepth(site.call->parent), 3);
+        return static_cast<int>(std::pow(10, depth));
+    };
+
+    std::vector<std::unique_ptr<Function>> clones;
+    for (auto& func : module.functions) {
+        if (func->blocks.empty()) continue;
+
+        // Group external call sites by the constants they pass: (index, value) pairs
+        using Key = std::vector<std::pair<size_t, Constant*>>;
+        auto keyLess = [](const Key& a, const Key& b) {
+            if (a.size() != b.size()) return a.size() < b.size();
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (a[i].first != b[i].first) return a[i].first < b[i].first;
+                if (a[i].second->value != b[i].second->value) return a[i].second->value < b[i].second->value;
+            }
+            return false;
+        };
+        std::map<Key, std::vector<CallGraph::CallSite>, decltype(keyLess)> groups(keyLess);
+        for (const auto& site : cg.callSites(func->name)) {
+            if (site.caller == func.get() || site.call->args.size() != func->args.size()) continue;
+            Key key;
+            for (size_t i = 0; i < site.call->args.size(); ++i) {
+                if (auto constant = dynamic_cast<Constant*>(site.call->args[i])) key.push_back({i, constant});
+            }
+            if (!key.empty()) groups[key].push_back(site);
+        }
+        if (groups.empty() || static_cast<int>(groups.size()) > options_.maxSpecializationsPerFunction) continue;
+
+        int cloneIndex = 0;
+        for (auto& [key, sites] : groups) {
+            int weight = 0;
+            for (const auto& site : sites) weight += siteWeight(site);
+            if (weight < options_.minCallSiteWeight) continue;
+
+            size_t cost = func->instructionCount();
+            if (cost > options_.maxCloneSize || stats_.instructionGrowth + cost > budget) {
+                stats_.rejectedByBudget++;
+                ++RejectedByBudget;
+                continue;
+            }
+
+            std::string cloneName = func->name + ".spec" + std::to_string(cloneIndex++);
+            while (module.getFunction(cloneName)) cloneName += "_";
+            auto clone = func->clone(cloneName);
+            std::vector<size_t> indices;
+            for (const auto& [i, constant] : key) {
+                if (clone->args[i].ssaValue) clone->replaceAllUsesWith(clone->args[i].ssaValue, new Constant(constant->type, constant->value));
+                indices.push_back(i);
+            }
+
+            // Redirect the grouped sites, plus recursion inside the clone that keeps the same constants
+            std::vector<CallInst*> calls;
+            for (const auto& site : sites) calls.push_back(site.call);
+            for (auto& bb : clone->blocks) {
+                for (auto& inst : bb->instructions) {
+                    if (inst->kind != Instruction::OpKind::Call) continue;
+                    auto call = static_cast<CallInst*>(inst.get());
+                    if (call->callee != func->name || call->args.size() != func->args.size()) continue;
+                    bool matches = true;
+                    for (const auto& [i, constant] : key) {
+                        auto arg = dynamic_cast<Constant*>(call->args[i]);
+                        if (!arg || !sameConstant(arg, constant)) { matches = false; break; }
+                    }
+                    if (matches) calls.push_back(call);
+                }
+            }
+            for (CallInst* call : calls) call->callee = cloneName;
+            eraseArguments(*clone, calls, indices);
+
+            stats_.specializedFunctions++;
+            ++SpecializedFunctions;
+            RedirectedCallSites += sites.size();
+            InstructionGrowth += cost;
+            stats_.redirectedCallSites += static_cast<int>(sites.size());
+            stats_.instructionGrowth += cost;
+            clones.push_back(std::move(clone));
+        }
+    }
+
+    bool changed = !clones.empty();
+    for (auto& clone : clones) module.addFunction(std::move(clone));
+    return changed;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
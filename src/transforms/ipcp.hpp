@@ -0,0 +1,62 @@
+#pragma once
+#include "ir/ir.hpp"
+#include "ir/call_graph.hpp"
+#include <set>
+#include <string>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Interprocedural constant propagation and function specialization.
+//
+// 1. When every call site passes the same constant for a parameter, the
+//    constant replaces the parameter inside the callee.
+// 2. Parameters the callee no longer reads are removed from the signature and
+//    from every call site.
+// 3. Callees reached from hot call sites with a few distinct constant argument
+//    tuples are cloned once per tuple, within a code-growth budget.
+//
+// Signature changes assume the whole program is visible: functions listed in
+// `preserveSignatures` (the entry point, exported functions) are only cloned.
+class InterproceduralConstantPropagation {
+public:
+    struct Options {
+        bool wholeProgram = true;
+        bool specialize = true;
+        std::set<std::string> preserveSignatures = {"main"};
+        int maxSpecializationsPerFunction = 3;
+        // A call site weighs 10^loop-depth; a clone needs this much total weight
+        int minCallSiteWeight = 10;
+        // Clones may grow the module by this share of its size, or the minimum
+        int growthBudgetPercent = 25;
+        size_t minGrowthBudget = 200;
+        size_t maxCloneSize = 400;
+    };
+
+    struct Statistics {
+        int propagatedArguments = 0;
+        int removedArguments = 0;
+        int specializedFunctions = 0;
+        int redirectedCallSites = 0;
+        size_t instructionGrowth = 0;
+        int rejectedByBudget = 0;
+    };
+
+    InterproceduralConstantPropagation() = default;
+    explicit InterproceduralConstantPropagation(Options options) : options_(std::move(options)) {}
+
+    bool run(Module& module);
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    Options options_;
+    Statistics stats_;
+
+    bool canChangeSignature(const CallGraph& cg, const Function& func) const;
+    bool propagateConstants(Module& module);
+    bool removeDeadArguments(Module& module);
+    bool specialize(Module& module);
+};
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,191 @@
+#include "loop_fusion.hpp"
+#include "ir/statistics.hpp"
+#include <algorithm>
+#include <set>
+#include <string>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(FusedLoops, "loop-fusion", "Loop pairs fused");
+KL_STATISTIC(FoldedPhis, "loop-fusion", "Trivial header phis folded");
+
+namespace {
+
+using Op = Instruction::OpKind;
+
+// Arithmetic that can run earlier than written without trapping or printing
+bool isHoistable(const Instruction& inst) {
+    switch (inst.kind) {
+        case Op::Add: case Op::Sub: case Op::Mul: case Op::Shl:
+        case Op::LShr:
+        case Op::ICmpEq: case Op::ICmpNe: case Op::ICmpLt: case Op::ICmpLe: case Op::ICmpGt: case Op::ICmpGe:
+        case Op::ICmpULt: case Op::ICmpULe: case Op::ICmpUGt: case Op::ICmpUGe:
+        case Op::Not: case Op::ZExt: case Op::SExt: case Op::Trunc:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+bool LoopFusion::run(Module& module) {
+    FunctionAttrs attrs(module);
+    bool changed = false;
+    for (auto& func : module.functions) {
+        changed |= runOnFunction(*func, attrs);
+    }
+    return changed;
+}
+
+void LoopFusion::remark(Remark::Kind kind, const char* name, const Function& func, const Loop& loop, std::string message) {
+    if (!remarks_) return;
+    Remark remark;
+    remark.kind = kind;
+    remark.pass = "loop-fusion";
+    remark.name = name;
+    remark.function = func.name;
+    remark.message = std::move(message);
+    locate(remark, *loop.header);
+    remarks_->emit(std::move(remark));
+}
+
+bool LoopFusion::runOnFunction(Function& func, const FunctionAttrs& attrs) {
+    if (func.blocks.empty()) return false;
+    int folded = foldTrivialPhis(func);
+    stats_.foldedPhis += folded;
+    FoldedPhis += folded;
+
+    // Pairs already found not fusable, so each is reported once
+    std::set<std::pair<std::string, std::string>> rejected;
+    bool changed = folded > 0;
+    bool fused = true;
+    while (fused) {
+        fused = false;
+        LoopNestAnalysis nest(func);
+        for (const auto& loop : nest.loopInfo().loops()) {
+            auto exits = loop->exitBlocks();
+            if (exits.size() != 1) continue;
+            Instruction* term = exits.front()->getTerminator();
+            if (!term || term->kind != Op::Br) continue;
+            BasicBlock* target = static_cast<BranchInst*>(term)->target;
+            Loop* next = nest.loopInfo().loopFor(target);
+            if (!next || next->header != target || next->parent != loop->parent) continue;
+            if (rejected.count({loop->header->label, next->header->label})) continue;
+
+            if (tryFuse(func, nest, attrs, loop.get(), next)) {
+                fused = changed = true;
+                break;
+            }
+            rejected.insert({loop->header->label, next->header->label});
+        }
+    }
+    return changed;
+}
+
+bool LoopFusion::tryFuse(Function& func, const LoopNestAnalysis& nest, const FunctionAttrs& attrs, Loop* first, Loop* second) {
+    std::string pair = describeLoop(first) + " with " + describeLoop(second);
+    auto missed = [&](const char* name, const std::string& why) {
+        remark(Remark::Kind::Missed, name, func, *first, "cannot fuse " + pair + ": " + why);
+        return false;
+    };
+
+    if (!first->header->loopHints.empty() || !second->header->loopHints.empty()) {
+        return missed("Annotated", "@Unroll or @Vectorize asks for a loop of its own");
+    }
+    const CountedLoop* a = nest.counted(first);
+    const CountedLoop* b = nest.counted(second);
+    if (!a) return missed("NotCounted", "the first loop is not counted: " + nest.whyNot(first));
+    if (!b) return missed("NotCounted", "the second loop is not counted: " + nest.whyNot(second));
+    if (!a->sameTripCount(*b)) return missed("TripCountMismatch", "their trip counts are not provably equal");
+
+    BasicBlock* between = a->exit;
+    if (b->preheader != between || nest.cfg().predecessors(between).size() != 1) {
+        return missed("NotAdjacent", "other code runs between them");
+    }
+    for (const auto& inst : b->header->instructions) {
+        if (inst->kind == Op::Phi || inst.get() == b->compare || inst.get() == b->header->getTerminator()) continue;
+        return missed("HeaderNotEmpty", "the second loop's header computes " + inst->getName());
+    }
+    if (nest.users(b->compare).size() != 1) return missed("HeaderNotEmpty", "the second loop's exit test is used elsewhere");
+
+    for (const auto& inst : between->instructions) {
+        if (inst.get() == between->getTerminator()) continue;
+        if (!isHoistable(*inst)) return missed("NotAdjacent", inst->getName() + " between the loops cannot be moved above them");
+        for (Value* op : inst->getOperands()) {
+            if (nest.definedInside(first, op)) {
+                return missed("Dependence", inst->getName() + " between the loops uses " + op->getName() + " computed by the first loop");
+            }
+        }
+    }
+    for (BasicBlock* bb : second->blocks) {
+        for (const auto& inst : bb->instructions) {
+            for (Value* op : inst->getOperands()) {
+                if (nest.definedInside(first, op)) {
+                    return missed("Dependence", inst->getName() + " in the second loop uses " + op->getName() + " computed by the first loop");
+                }
+            }
+        }
+    }
+
+    LoopEffects fx1 = loopEffects(*first, attrs);
+    LoopEffects fx2 = loopEffects(*second, attrs);
+    auto anyEffect = [](const LoopEffects& fx) { return fx.observable || fx.mayTrap || fx.mayDiverge; };
+    if ((fx1.observable && anyEffect(fx2)) || (fx2.observable && anyEffect(fx1))) {
+        return missed("Effects", "interleaving their iterations could change what the program prints");
+    }
+
+    auto trips = a->tripCount();
+    std::string detail = trips ? std::to_string(*trips) + " iterations" : "same trip count";
+    fuse(func, *a, *b);
+    stats_.fusedLoops++;
+    ++FusedLoops;
+    remark(Remark::Kind::Passed, "Fused", func, *first, "fused " + pair + " (" + detail + ")");
+    return true;
+}
+
+void LoopFusion::fuse(Function& func, const CountedLoop& a, const CountedLoop& b) {
+    BasicBlock* between = a.exit;
+
+    // Code between the loops runs before the first one instead
+    while (between->instructions.size() > 1) {
+        moveBeforeTerminator(between->instructions.front().get(), a.preheader);
+    }
+
+    // The second body runs after the first one, then loops back to the fused header
+    for (auto& inst : a.header->instructions) {
+        if (auto phi = dynamic_cast<PhiInst*>(inst.get())) phi->replaceIncomingBlock(a.latch, b.latch);
+    }
+    a.latch->replaceSuccessor(a.header, b.body);
+    b.latch->replaceSuccessor(b.header, a.header);
+    for (auto& inst : b.body->instructions) {
+        if (auto phi = dynamic_cast<PhiInst*>(inst.get())) phi->replaceIncomingBlock(b.header, a.latch);
+    }
+
+    // The second loop's phis join the first header
+    auto insertAt = a.header->instructions.begin();
+    while (insertAt != a.header->instructions.end() && (*insertAt)->kind == Op::Phi) ++insertAt;
+    for (auto it = b.header->instructions.begin(); it != b.header->instructions.end();) {
+        auto phi = dynamic_cast<PhiInst*>(it->get());
+        if (!phi) break;
+        phi->replaceIncomingBlock(between, a.preheader);
+        std::unique_ptr<Instruction> owned = std::move(*it);
+        it = b.header->instructions.erase(it);
+        a.header->insertInstruction(insertAt, std::move(owned));
+    }
+
+    // Leaving the fused loop goes where the second loop went
+    a.header->replaceSuccessor(between, b.exit);
+    for (auto& inst : b.exit->instructions) {
+        if (auto phi = dynamic_cast<PhiInst*>(inst.get())) phi->replaceIncomingBlock(b.header, a.header);
+    }
+
+    BasicBlock* dead[] = {between, b.header};
+    func.blocks.remove_if([&](const std::unique_ptr<BasicBlock>& bb) {
+        return std::find(std::begin(dead), std::end(dead), bb.get()) != std::end(dead);
+    });
+}
+
+} // namespace ir
+} // namespace kotlin_lite
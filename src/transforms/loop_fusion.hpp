@@ -0,0 +1,45 @@
+#pragma once
+#include "ir/ir.hpp"
+#include "ir/function_attrs.hpp"
+#include "ir/loop_nest.hpp"
+#include "ir/remarks.hpp"
+
+namespace kotlin_lite {
+namespace ir {
+
+// Fuses adjacent counted loops with the same trip count into one loop.
+//
+// Two loops are adjacent when the first one's exit branches straight to the
+// second one's header, with at most dependence-free arithmetic in between
+// (it is hoisted in front of the first loop). The second loop's phis join the
+// first loop's header, its body runs after the first body in each iteration
+// and its own header test disappears.
+//
+// Fusion is legal when the second loop uses no value the first loop computes
+// (its iterations would otherwise see partial results), and when the loops
+// cannot observe each other's order: at most one of them prints, and then the
+// other can neither trap nor fail to return.
+class LoopFusion {
+public:
+    struct Statistics {
+        int fusedLoops = 0;
+        int foldedPhis = 0;
+    };
+
+    explicit LoopFusion(RemarkCollector* remarks = nullptr) : remarks_(remarks) {}
+
+    bool run(Module& module);
+    bool runOnFunction(Function& func, const FunctionAttrs& attrs);
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    RemarkCollector* remarks_;
+    Statistics stats_;
+
+    bool tryFuse(Function& func, const LoopNestAnalysis& nest, const FunctionAttrs& attrs, Loop* first, Loop* second);
+    void fuse(Function& func, const CountedLoop& first, const CountedLoop& second);
+    void remark(Remark::Kind kind, const char* name, const Function& func, const Loop& loop, std::string message);
+};
+
+} // namespace ir
+} // namespace kotlin_lite
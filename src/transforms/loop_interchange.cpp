@@ -0,0 +1,219 @@
+#include "loop_interchange.hpp"
+#include "ir/statistics.hpp"
+#include <set>
+#include <string>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(InterchangedNests, "loop-interchange", "Loop nests interchanged");
+KL_STATISTIC(FoldedPhis, "loop-interchange", "Trivial header phis folded");
+
+namespace {
+
+using Op = Instruction::OpKind;
+
+// Only phis, the exit test and the branch
+bool isBareHeader(const CountedLoop& loop) {
+    for (const auto& inst : loop.header->instructions) {
+        if (inst->kind != Op::Phi && inst.get() != loop.compare && inst.get() != loop.header->getTerminator()) return false;
+    }
+    return true;
+}
+
+// `phi` accumulates along a chain of adds/subs or of muls inside `loop`,
+// and nothing but the chain (and `carrier`, outside `loop`) reads it.
+bool isReduction(const LoopNestAnalysis& nest, const CountedLoop& loop, PhiInst* phi, const Instruction* carrier) {
+    auto backedge = phi->incomings.find(loop.latch);
+    if (backedge == phi->incomings.end()) return false;
+
+    bool multiplicative = false;
+    Instruction* cur = phi;
+    while (true) {
+        std::vector<Instruction*> next;
+        for (Instruction* user : nest.users(cur)) {
+            if (user != carrier) next.push_back(user);
+        }
+        if (cur == backedge->second) return next.size() == 1 && next.front() == phi;
+        if (next.size() != 1 || !loop.loop->contains(next.front()->parent)) return false;
+
+        auto bin = dynamic_cast<BinaryInst*>(next.front());
+        if (!bin || (bin->left == cur) == (bin->right == cur)) return false;
+        bool mul = bin->kind == Op::Mul;
+        if (!mul && bin->kind != Op::Add && !(bin->kind == Op::Sub && bin->left == cur)) return false;
+        if (cur != phi && mul != multiplicative) return false;
+        multiplicative = mul;
+        cur = bin;
+    }
+}
+
+void resetPhi(PhiInst* phi, BasicBlock* entry, Value* init, BasicBlock* latch, Value* next) {
+    phi->incomings.clear();
+    phi->addIncoming(entry, init);
+    phi->addIncoming(latch, next);
+}
+
+void movePhiToFront(PhiInst* phi, BasicBlock* bb) {
+    BasicBlock* from = phi->parent;
+    auto it = from->find(phi);
+    std::unique_ptr<Instruction> owned = std::move(*it);
+    from->instructions.erase(it);
+    bb->insertInstruction(bb->instructions.begin(), std::move(owned));
+}
+
+} // namespace
+
+bool LoopInterchange::run(Module& module) {
+    FunctionAttrs attrs(module);
+    bool changed = false;
+    for (auto& func : module.functions) {
+        changed |= runOnFunction(*func, attrs);
+    }
+    return changed;
+}
+
+void LoopInterchange::remark(Remark::Kind kind, const char* name, const Function& func, const Loop& loop, std::string message) {
+    if (!remarks_) return;
+    Remark remark;
+    remark.kind = kind;
+    remark.pass = "loop-interchange";
+    remark.name = name;
+    remark.function = func.name;
+    remark.message = std::move(message);
+    locate(remark, *loop.header);
+    remarks_->emit(std::move(remark));
+}
+
+bool LoopInterchange::runOnFunction(Function& func, const FunctionAttrs& attrs) {
+    if (func.blocks.empty()) return false;
+    int folded = foldTrivialPhis(func);
+    stats_.foldedPhis += folded;
+    FoldedPhis += folded;
+
+    // Outer headers already decided on; an interchanged nest is not swapped back
+    std::set<std::string> visited;
+    bool changed = folded > 0;
+    bool swapped = true;
+    while (swapped) {
+        swapped = false;
+        LoopNestAnalysis nest(func);
+        for (const auto& loop : nest.loopInfo().loops()) {
+            if (loop->children.size() != 1 || !visited.insert(loop->header->label).second) continue;
+            if (tryInterchange(func, nest, attrs, loop.get())) {
+                swapped = changed = true;
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+bool LoopInterchange::tryInterchange(Function& func, const LoopNestAnalysis& nest, const FunctionAttrs& attrs, Loop* outerLoop) {
+    Loop* innerLoop = outerLoop->children.front();
+    std::string pair = describeLoop(outerLoop) + " with " + describeLoop(innerLoop);
+    auto missed = [&](const char* name, const std::string& why) {
+        remark(Remark::Kind::Missed, name, func, *outerLoop, "cannot interchange " + pair + ": " + why);
+        return false;
+    };
+
+    if (!outerLoop->header->loopHints.empty() || !innerLoop->header->loopHints.empty()) {
+        return missed("Annotated", "@Unroll or @Vectorize hints are for the loops in source order");
+    }
+    const CountedLoop* outer = nest.counted(outerLoop);
+    const CountedLoop* inner = nest.counted(innerLoop);
+    if (!outer) return missed("NotCounted", "the outer loop is not counted: " + nest.whyNot(outerLoop));
+    if (!inner) return missed("NotCounted", "the inner loop is not counted: " + nest.whyNot(innerLoop));
+
+    // Perfect nest: the outer body is the inner loop plus the outer increment
+    bool perfect = outer->body == inner->preheader && inner->preheader->instructions.size() == 1 &&
+                   inner->exit == outer->latch && outer->latch->instructions.size() == 2 &&
+                   outer->increment->parent == outer->latch && nest.cfg().predecessors(outer->latch).size() == 1 &&
+                   isBareHeader(*outer) && isBareHeader(*inner);
+    if (!perfect) return missed("NotPerfectNest", "code runs between the two loops");
+    for (const CountedLoop* cl : {outer, inner}) {
+        if (nest.users(cl->compare).size() != 1 || nest.users(cl->increment).size() != 1) {
+            return missed("NotPerfectNest", "a loop counter is used outside its loop control");
+        }
+    }
+    if (nest.definedInside(outerLoop, inner->init) || nest.definedInside(outerLoop, inner->bound)) {
+        return missed("NotRectangular", "the inner loop's bounds depend on the outer loop");
+    }
+    for (Instruction* user : nest.users(outer->iv)) {
+        if (!outerLoop->contains(user->parent)) return missed("OuterCounterUsed", outer->iv->getName() + " is used after the nest");
+    }
+
+    LoopEffects fx = loopEffects(*outerLoop, attrs);
+    if (fx.observable) return missed("Effects", "the nest prints, so its iteration order is observable");
+    if (fx.mayDiverge) return missed("Effects", "the nest calls a function that might not return");
+
+    // Every other value carried across iterations must be a reduction
+    std::set<PhiInst*> reductions;
+    for (const auto& inst : outer->header->instructions) {
+        auto p = dynamic_cast<PhiInst*>(inst.get());
+        if (!p) break;
+        if (p == outer->iv || nest.users(p).empty()) continue;
+        auto latchValue = p->incomings.find(outer->latch);
+        auto q = latchValue != p->incomings.end() ? dynamic_cast<PhiInst*>(latchValue->second) : nullptr;
+        bool carried = q && q->parent == inner->header;
+        if (carried) {
+            auto entry = q->incomings.find(inner->preheader);
+            carried = entry != q->incomings.end() && entry->second == p;
+        }
+        for (Instruction* user : nest.users(p)) {
+            if (user != q && outerLoop->contains(user->parent)) carried = false;
+        }
+        if (!carried || !isReduction(nest, *inner, q, p)) {
+            return missed("Recurrence", p->getName() + " carries a value between iterations that is not a reduction");
+        }
+        reductions.insert(q);
+    }
+    for (const auto& inst : inner->header->instructions) {
+        auto q = dynamic_cast<PhiInst*>(inst.get());
+        if (!q) break;
+        if (q != inner->iv && !reductions.count(q)) {
+            return missed("Recurrence", q->getName() + " carries a value between iterations that is not a reduction");
+        }
+    }
+
+    auto outerTrips = outer->tripCount();
+    auto innerTrips = inner->tripCount();
+    if (!outerTrips || !innerTrips) return missed("NotProfitable", "the trip counts are not constant");
+    std::string shape = std::to_string(*outerTrips) + " x " + std::to_string(*innerTrips) + " iterations";
+    if (*outerTrips < *innerTrips * options_.minTripRatio) {
+        return missed("NotProfitable", "the inner loop is not much shorter than the outer one (" + shape + ")");
+    }
+
+    // Interchanging moves the inner counter's phi and test into the outer
+    // header, so its position is taken first
+    Remark passed;
+    passed.kind = Remark::Kind::Passed;
+    passed.pass = "loop-interchange";
+    passed.name = "Interchanged";
+    passed.function = func.name;
+    passed.message = "interchanged " + pair + " (" + shape + ")";
+    locate(passed, *outerLoop->header);
+    interchange(*outer, *inner);
+    stats_.interchangedNests++;
+    ++InterchangedNests;
+    if (remarks_) remarks_->emit(std::move(passed));
+    return true;
+}
+
+void LoopInterchange::interchange(const CountedLoop& outer, const CountedLoop& inner) {
+    // The loop bodies stay where they are; the counters, their tests and
+    // increments trade places. Reduction phis keep flowing outer -> inner.
+    movePhiToFront(outer.iv, inner.header);
+    resetPhi(outer.iv, inner.preheader, outer.init, inner.latch, outer.increment);
+    movePhiToFront(inner.iv, outer.header);
+    resetPhi(inner.iv, outer.preheader, inner.init, outer.latch, inner.increment);
+
+    moveBeforeTerminator(outer.increment, inner.latch);
+    moveBeforeTerminator(inner.increment, outer.latch);
+    moveBeforeTerminator(outer.compare, inner.header);
+    moveBeforeTerminator(inner.compare, outer.header);
+    static_cast<CondBranchInst*>(outer.header->getTerminator())->condition = inner.compare;
+    static_cast<CondBranchInst*>(inner.header->getTerminator())->condition = outer.compare;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,57 @@
+#pragma once
+#include "ir/ir.hpp"
+#include "ir/function_attrs.hpp"
+#include "ir/loop_nest.hpp"
+#include "ir/remarks.hpp"
+
+namespace kotlin_lite {
+namespace ir {
+
+// Swaps the two loops of a perfect nest of counted loops:
+//
+//     while (i < N) { while (j < M) { body } i++ }   // M much smaller than N
+//  -> while (j < M) { while (i < N) { body } j++ }
+//
+// The nest must be perfect (nothing runs between the two headers or after
+// the inner loop except the outer increment) and rectangular (the inner
+// bounds do not depend on the outer loop). Besides the induction variables,
+// the only values carried across iterations may be integer reductions
+// (`s = s + x`, `s = s - x`, `s = s * x`) whose partial results are not read
+// in the body: wrapping add and mul are associative and commutative, so the
+// new iteration order computes the same result.
+//
+// The body has no memory accesses to make more local, so the profitable case
+// is a short inner loop inside a long outer one: after the swap the long loop
+// runs innermost, where LLVM unrolls and vectorizes, and the nest enters its
+// inner loop far less often.
+class LoopInterchange {
+public:
+    struct Options {
+        // Interchange when the outer trip count is at least this many times the inner one
+        int minTripRatio = 4;
+    };
+
+    struct Statistics {
+        int interchangedNests = 0;
+        int foldedPhis = 0;
+    };
+
+    explicit LoopInterchange(RemarkCollector* remarks = nullptr) : remarks_(remarks) {}
+    LoopInterchange(Options options, RemarkCollector* remarks) : options_(options), remarks_(remarks) {}
+
+    bool run(Module& module);
+    bool runOnFunction(Function& func, const FunctionAttrs& attrs);
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    Options options_;
+    RemarkCollector* remarks_;
+    Statistics stats_;
+
+    bool tryInterchange(Function& func, const LoopNestAnalysis& nest, const FunctionAttrs& attrs, Loop* outer);
+    void interchange(const CountedLoop& outer, const CountedLoop& inner);
+    void remark(Remark::Kind kind, const char* name, const Function& func, const Loop& loop, std::string message);
+};
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,41 @@
+#include "pass_registry.hpp"
+#include "const_eval.hpp"
+#include "ipcp.hpp"
+#include "loop_fusion.hpp"
+#include "loop_interchange.hpp"
+#include "auto_parallel.hpp"
+#include "peephole.hpp"
+#include "tail_recursion.hpp"
+
+namespace kotlin_lite {
+namespace ir {
+
+const std::vector<PassInfo>& passRegistry() {
+    static const std::vector<PassInfo> passes = {
+        {"consteval", "Compile-time evaluation of pure calls with constant arguments",
+         [](Module& module) { return CompileTimeEvaluation().run(module); }},
+        {"ipcp", "Interprocedural constant propagation and function specialization",
+         [](Module& module) { return InterproceduralConstantPropagation().run(module); }},
+        {"tailrec", "Tail recursion elimination",
+         [](Module& module) { return TailRecursionElimination().run(module); }},
+        {"peephole", "Algebraic simplification, strength reduction and canonicalization",
+         [](Module& module) { return PeepholeOptimizer().run(module); }},
+        {"loop-fusion", "Fuse adjacent counted loops with equal trip counts",
+         [](Module& module) { return LoopFusion().run(module); }},
+        {"loop-interchange", "Interchange perfect loop nests to run the longer loop innermost",
+         [](Module& module) { return LoopInterchange().run(module); }},
+        {"auto-parallel", "Outline independent reduction loops for multi-threaded execution",
+         [](Module& module) { return AutoParallelization().run(module); }},
+    };
+    return passes;
+}
+
+const PassInfo* findPass(const std::string& name) {
+    for (const auto& pass : passRegistry()) {
+        if (pass.name == name) return &pass;
+    }
+    return nullptr;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
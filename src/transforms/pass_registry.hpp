@@ -0,0 +1,23 @@
+#pragma once
+#include "ir/ir.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Custom IR passes addressable by name, for tools that run an arbitrary
+// pipeline (`kotlin-lite-opt -p ipcp,tailrec`). Each entry runs the pass with
+// its default options and reports whether the module changed.
+struct PassInfo {
+    std::string name;
+    std::string description;
+    std::function<bool(Module&)> run;
+};
+
+const std::vector<PassInfo>& passRegistry();
+const PassInfo* findPass(const std::string& name);
+
+} // namespace ir
+} // namespace kotlin_lite
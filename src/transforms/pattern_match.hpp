@@ -0,0 +1,211 @@
+#pragma once
+#include "ir/ir.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+namespace kotlin_lite {
+namespace ir {
+namespace pattern {
+
+// Tree patterns over the IR, written as types:
+//
+//     Add<X, Const<0>>              add %x, 0
+//     Mul<X, ConstIf<0, isPow2>>    mul %x, <power of two>
+//     Not<Not<X>>                   not (not %x)
+//
+// A pattern's `match` is an ordinary inline function, so a nested pattern
+// compiles down to the opcode and operand checks it spells out. `RuleSet`
+// groups rules by the opcode of their root when it is instantiated; at run
+// time an instruction only meets the rules rooted at its own opcode.
+
+// Values bound by one match: Var<N> binds values[N], AnyConst/ConstIf<N> bind
+// constants[N], AnyCmp binds the compare's opcode.
+struct Captures {
+    Value* values[3] = {};
+    int64_t constants[2] = {};
+    Instruction::OpKind predicate = Instruction::OpKind::ICmpEq;
+};
+
+// Any value. A placeholder used twice must bind the same value both times.
+template <int N>
+struct Var {
+    static bool match(Value* v, Captures& c) {
+        if (c.values[N] && c.values[N] != v) return false;
+        c.values[N] = v;
+        return true;
+    }
+};
+
+// Any value that is not a constant
+template <int N>
+struct NonConst {
+    static bool match(Value* v, Captures& c) { return !dynamic_cast<Constant*>(v) && Var<N>::match(v, c); }
+};
+
+// The integer (or boolean) constant `Value`, at any width
+template <int64_t Value_>
+struct Const {
+    static bool match(Value* v, Captures&) {
+        auto c = dynamic_cast<Constant*>(v);
+        return c && c->value == Value_;
+    }
+};
+
+// Any constant satisfying `Pred`, bound to constants[N]
+template <int N, bool (*Pred)(int64_t)>
+struct ConstIf {
+    static bool match(Value* v, Captures& c) {
+        auto k = dynamic_cast<Constant*>(v);
+        if (!k || !Pred(k->value)) return false;
+        c.constants[N] = k->value;
+        return true;
+    }
+};
+
+inline bool anyInt(int64_t) { return true; }
+
+template <int N>
+using AnyConst = ConstIf<N, anyInt>;
+
+template <Instruction::OpKind Kind, typename L, typename R>
+struct Binary {
+    static constexpr Instruction::OpKind root = Kind;
+    static bool match(Value* v, Captures& c) {
+        auto inst = dynamic_cast<Instruction*>(v);
+        if (!inst || inst->kind != Kind) return false;
+        auto bin = static_cast<BinaryInst*>(inst);
+        return L::match(bin->left, c) && R::match(bin->right, c);
+    }
+};
+
+template <Instruction::OpKind Kind, typename Op>
+struct Unary {
+    static constexpr Instruction::OpKind root = Kind;
+    static bool match(Value* v, Captures& c) {
+        auto inst = dynamic_cast<Instruction*>(v);
+        if (!inst || inst->kind != Kind) return false;
+        return Op::match(static_cast<UnaryInst*>(inst)->operand, c);
+    }
+};
+
+// Any icmp, as an operand pattern; its opcode goes to Captures::predicate
+template <typename L, typename R>
+struct AnyCmp {
+    static bool match(Value* v, Captures& c) {
+        auto inst = dynamic_cast<Instruction*>(v);
+        if (!inst || inst->kind < Instruction::OpKind::ICmpEq || inst->kind > Instruction::OpKind::ICmpUGe) return false;
+        auto bin = static_cast<BinaryInst*>(inst);
+        if (!L::match(bin->left, c) || !R::match(bin->right, c)) return false;
+        c.predicate = inst->kind;
+        return true;
+    }
+};
+
+template <typename L, typename R> using Add = Binary<Instruction::OpKind::Add, L, R>;
+template <typename L, typename R> using Sub = Binary<Instruction::OpKind::Sub, L, R>;
+template <typename L, typename R> using Mul = Binary<Instruction::OpKind::Mul, L, R>;
+template <typename L, typename R> using SDiv = Binary<Instruction::OpKind::SDiv, L, R>;
+template <typename L, typename R> using SRem = Binary<Instruction::OpKind::SRem, L, R>;
+template <typename L, typename R> using Shl = Binary<Instruction::OpKind::Shl, L, R>;
+template <typename L, typename R> using UDiv = Binary<Instruction::OpKind::UDiv, L, R>;
+template <typename L, typename R> using URem = Binary<Instruction::OpKind::URem, L, R>;
+template <typename L, typename R> using LShr = Binary<Instruction::OpKind::LShr, L, R>;
+template <typename L, typename R> using ICmpEq = Binary<Instruction::OpKind::ICmpEq, L, R>;
+template <typename L, typename R> using ICmpNe = Binary<Instruction::OpKind::ICmpNe, L, R>;
+template <typename L, typename R> using ICmpLt = Binary<Instruction::OpKind::ICmpLt, L, R>;
+template <typename L, typename R> using ICmpLe = Binary<Instruction::OpKind::ICmpLe, L, R>;
+template <typename L, typename R> using ICmpGt = Binary<Instruction::OpKind::ICmpGt, L, R>;
+template <typename L, typename R> using ICmpGe = Binary<Instruction::OpKind::ICmpGe, L, R>;
+template <typename Op> using Not = Unary<Instruction::OpKind::Not, Op>;
+
+using X = Var<0>;
+using Y = Var<1>;
+using Z = Var<2>;
+
+// Creates the instructions a rewrite needs, right before the matched root.
+class RewriteContext {
+public:
+    virtual ~RewriteContext() = default;
+    virtual Value* binary(Instruction::OpKind kind, Value* l, Value* r) = 0;
+    virtual Value* unary(Instruction::OpKind kind, Value* operand) = 0;
+    virtual Value* constant(Type type, int64_t value) = 0;
+};
+
+// Base of a rewrite rule. A rule supplies
+//
+//     static constexpr const char* name;
+//     static Value* rewrite(Instruction* root, Captures& c, RewriteContext& ctx);
+//
+// `rewrite` returns the value replacing `root`, `root` itself after changing
+// it in place, or nullptr when a side condition rules the rewrite out.
+template <typename Pattern>
+struct Rule {
+    using pattern = Pattern;
+};
+
+// Instruction::OpKind has no count; Ret is its last enumerator
+constexpr size_t kNumOpKinds = static_cast<size_t>(Instruction::OpKind::Ret) + 1;
+
+template <typename... Rules>
+class RuleSet {
+public:
+    static constexpr size_t size = sizeof...(Rules);
+
+    static const char* name(size_t rule) {
+        static const char* const names[] = {Rules::name...};
+        return names[rule];
+    }
+
+    // Tries the rules rooted at `inst`'s opcode in declaration order. On
+    // success returns the rewrite's result and sets `fired` to the rule index.
+    static Value* apply(Instruction* inst, RewriteContext& ctx, size_t& fired) {
+        return dispatch()[static_cast<size_t>(inst->kind)](inst, ctx, fired);
+    }
+
+private:
+    using Fn = Value* (*)(Instruction*, RewriteContext&, size_t&);
+    using List = std::tuple<Rules...>;
+
+    template <size_t I, Instruction::OpKind Kind>
+    static Value* tryRule(Instruction* inst, RewriteContext& ctx, size_t& fired) {
+        using R = std::tuple_element_t<I, List>;
+        if constexpr (R::pattern::root != Kind) {
+            return nullptr;
+        } else {
+            Captures captures;
+            if (!R::pattern::match(inst, captures)) return nullptr;
+            Value* result = R::rewrite(inst, captures, ctx);
+            if (result) fired = I;
+            return result;
+        }
+    }
+
+    template <Instruction::OpKind Kind, size_t... I>
+    static Value* tryRules(Instruction* inst, RewriteContext& ctx, size_t& fired, std::index_sequence<I...>) {
+        Value* result = nullptr;
+        ((result = result ? result : tryRule<I, Kind>(inst, ctx, fired)), ...);
+        return result;
+    }
+
+    template <size_t K>
+    static Value* forKind(Instruction* inst, RewriteContext& ctx, size_t& fired) {
+        return tryRules<static_cast<Instruction::OpKind>(K)>(inst, ctx, fired, std::index_sequence_for<Rules...>{});
+    }
+
+    template <size_t... K>
+    static constexpr auto makeTable(std::index_sequence<K...>) {
+        return std::array<Fn, sizeof...(K)>{&forKind<K>...};
+    }
+
+    static const std::array<Fn, kNumOpKinds>& dispatch() {
+        static constexpr std::array<Fn, kNumOpKinds> table = makeTable(std::make_index_sequence<kNumOpKinds>{});
+        return table;
+    }
+};
+
+} // namespace pattern
+} // namespace ir
+} // namespace kotlin_lite
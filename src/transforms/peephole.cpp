@@ -0,0 +1,447 @@
+#include "peephole.hpp"
+#include "pattern_match.hpp"
+#include "ir/statistics.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(Rewrites, "peephole", "Peephole rewrites");
+KL_STATISTIC(DeadInstructions, "peephole", "Operands left dead by a rewrite and removed");
+
+namespace {
+
+using namespace pattern;
+using Kind = Instruction::OpKind;
+
+bool isCompare(Kind kind) { return kind >= Kind::ICmpEq && kind <= Kind::ICmpUGe; }
+
+// Predicate of `b op a` given `a op b`
+Kind swapped(Kind kind) {
+    switch (kind) {
+        case Kind::ICmpLt: return Kind::ICmpGt;
+        case Kind::ICmpLe: return Kind::ICmpGe;
+        case Kind::ICmpGt: return Kind::ICmpLt;
+        case Kind::ICmpGe: return Kind::ICmpLe;
+        case Kind::ICmpULt: return Kind::ICmpUGt;
+        case Kind::ICmpULe: return Kind::ICmpUGe;
+        case Kind::ICmpUGt: return Kind::ICmpULt;
+        case Kind::ICmpUGe: return Kind::ICmpULe;
+        default: return kind;
+    }
+}
+
+// Predicate of `!(a op b)`
+Kind inverse(Kind kind) {
+    switch (kind) {
+        case Kind::ICmpEq: return Kind::ICmpNe;
+        case Kind::ICmpNe: return Kind::ICmpEq;
+        case Kind::ICmpLt: return Kind::ICmpGe;
+        case Kind::ICmpLe: return Kind::ICmpGt;
+        case Kind::ICmpGt: return Kind::ICmpLe;
+        case Kind::ICmpULt: return Kind::ICmpUGe;
+        case Kind::ICmpULe: return Kind::ICmpUGt;
+        case Kind::ICmpUGt: return Kind::ICmpULe;
+        case Kind::ICmpUGe: return Kind::ICmpULt;
+        default: return Kind::ICmpLt;
+    }
+}
+
+// Constants are sign-extended, so an unsigned divisor of 2^(w-1) or more is
+// negative here and is left alone
+bool isPowerOfTwo(int64_t v) { return v > 1 && (v & (v - 1)) == 0; }
+bool notInt64Min(int64_t v) { return v != INT64_MIN; }
+
+int log2(int64_t powerOfTwo) {
+    int shift = 0;
+    while ((int64_t(1) << shift) != powerOfTwo) ++shift;
+    return shift;
+}
+
+// Constant folds truncate to the type, so wrapping at 64 bits suffices
+int64_t wrapAdd(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+constexpr const char* constRhsName(Kind kind) {
+    switch (kind) {
+        case Kind::Add: return "const-rhs.add";
+        case Kind::Mul: return "const-rhs.mul";
+        case Kind::ICmpEq: return "const-rhs.icmp-eq";
+        case Kind::ICmpNe: return "const-rhs.icmp-ne";
+        case Kind::ICmpLt: return "const-rhs.icmp-lt";
+        case Kind::ICmpLe: return "const-rhs.icmp-le";
+        case Kind::ICmpGt: return "const-rhs.icmp-gt";
+        case Kind::ICmpULt: return "const-rhs.icmp-ult";
+        case Kind::ICmpULe: return "const-rhs.icmp-ule";
+        case Kind::ICmpUGt: return "const-rhs.icmp-ugt";
+        case Kind::ICmpUGe: return "const-rhs.icmp-uge";
+        default: return "const-rhs.icmp-ge";
+    }
+}
+
+constexpr const char* selfCompareName(Kind kind) {
+    switch (kind) {
+        case Kind::ICmpEq: return "icmp-self.eq";
+        case Kind::ICmpNe: return "icmp-self.ne";
+        case Kind::ICmpLt: return "icmp-self.lt";
+        case Kind::ICmpLe: return "icmp-self.le";
+        case Kind::ICmpGt: return "icmp-self.gt";
+        case Kind::ICmpULt: return "icmp-self.ult";
+        case Kind::ICmpULe: return "icmp-self.ule";
+        case Kind::ICmpUGt: return "icmp-self.ugt";
+        case Kind::ICmpUGe: return "icmp-self.uge";
+        default: return "icmp-self.ge";
+    }
+}
+
+// --- Canonical forms ---
+
+// `c op x` -> `x op' c` for commutative ops and compares
+template <Kind K>
+struct ConstToRhs : Rule<Binary<K, AnyConst<0>, NonConst<0>>> {
+    static constexpr const char* name = constRhsName(K);
+    static Value* rewrite(Instruction* root, Captures&, RewriteContext&) {
+        auto bin = static_cast<BinaryInst*>(root);
+        std::swap(bin->left, bin->right);
+        bin->kind = swapped(K);
+        return root;
+    }
+};
+
+// `x - c` -> `x + (-c)`, so that constant chains meet in one opcode
+struct SubConstToAdd : Rule<Sub<NonConst<0>, ConstIf<0, notInt64Min>>> {
+    static constexpr const char* name = "sub-const-to-add";
+    static Value* rewrite(Instruction* root, Captures& c, RewriteContext& ctx) {
+        if (c.constants[0] == 0) return c.values[0];
+        return ctx.binary(Kind::Add, c.values[0], ctx.constant(root->type, -c.constants[0]));
+    }
+};
+
+// --- Identities ---
+
+struct AddZero : Rule<Add<X, Const<0>>> {
+    static constexpr const char* name = "add-zero";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct AddConstChain : Rule<Add<Add<X, AnyConst<0>>, AnyConst<1>>> {
+    static constexpr const char* name = "add-const-chain";
+    static Value* rewrite(Instruction* root, Captures& c, RewriteContext& ctx) {
+        return ctx.binary(Kind::Add, c.values[0], ctx.constant(root->type, wrapAdd(c.constants[0], c.constants[1])));
+    }
+};
+
+struct AddSubCancel : Rule<Add<Sub<X, Y>, Y>> {
+    static constexpr const char* name = "add-sub-cancel";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct SubSelf : Rule<Sub<X, X>> {
+    static constexpr const char* name = "sub-self";
+    static Value* rewrite(Instruction* root, Captures&, RewriteContext& ctx) { return ctx.constant(root->type, 0); }
+};
+
+struct SubAddCancel : Rule<Sub<Add<X, Y>, Y>> {
+    static constexpr const char* name = "sub-add-cancel";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct MulZero : Rule<Mul<X, Const<0>>> {
+    static constexpr const char* name = "mul-zero";
+    static Value* rewrite(Instruction* root, Captures&, RewriteContext& ctx) { return ctx.constant(root->type, 0); }
+};
+
+struct MulOne : Rule<Mul<X, Const<1>>> {
+    static constexpr const char* name = "mul-one";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct MulMinusOne : Rule<Mul<X, Const<-1>>> {
+    static constexpr const char* name = "mul-minus-one";
+    static Value* rewrite(Instruction* root, Captures& c, RewriteContext& ctx) {
+        return ctx.binary(Kind::Sub, ctx.constant(root->type, 0), c.values[0]);
+    }
+};
+
+// Strength reduction: `x * 2^k` -> `x shl k` (both wrap the same way)
+struct MulPowerOfTwo : Rule<Mul<X, ConstIf<0, isPowerOfTwo>>> {
+    static constexpr const char* name = "mul-pow2-to-shl";
+    static Value* rewrite(Instruction* root, Captures& c, RewriteContext& ctx) {
+        return ctx.binary(Kind::Shl, c.values[0], ctx.constant(root->type, log2(c.constants[0])));
+    }
+};
+
+struct ShlZero : Rule<Shl<X, Const<0>>> {
+    static constexpr const char* name = "shl-zero";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct SDivOne : Rule<SDiv<X, Const<1>>> {
+    static constexpr const char* name = "sdiv-one";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct SRemOne : Rule<SRem<X, Const<1>>> {
+    static constexpr const char* name = "srem-one";
+    static Value* rewrite(Instruction* root, Captures&, RewriteContext& ctx) { return ctx.constant(root->type, 0); }
+};
+
+// --- Unsigned division ---
+
+struct UDivOne : Rule<UDiv<X, Const<1>>> {
+    static constexpr const char* name = "udiv-one";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct URemOne : Rule<URem<X, Const<1>>> {
+    static constexpr const char* name = "urem-one";
+    static Value* rewrite(Instruction* root, Captures&, RewriteContext& ctx) { return ctx.constant(root->type, 0); }
+};
+
+// `x udiv 2^k` -> `x lshr k`; the reason unsigned division is the cheap kind
+struct UDivPowerOfTwo : Rule<UDiv<X, ConstIf<0, isPowerOfTwo>>> {
+    static constexpr const char* name = "udiv-pow2-to-lshr";
+    static Value* rewrite(Instruction* root, Captures& c, RewriteContext& ctx) {
+        return ctx.binary(Kind::LShr, c.values[0], ctx.constant(root->type, log2(c.constants[0])));
+    }
+};
+
+// `x urem 2^k` -> the low k bits, `(x shl (w - k)) lshr (w - k)`, as the IR
+// has no `and`
+struct URemPowerOfTwo : Rule<URem<X, ConstIf<0, isPowerOfTwo>>> {
+    static constexpr const char* name = "urem-pow2-to-shifts";
+    static Value* rewrite(Instruction* root, Captures& c, RewriteContext& ctx) {
+        Value* shift = ctx.constant(root->type, static_cast<int64_t>(bitWidth(root->type)) - log2(c.constants[0]));
+        return ctx.binary(Kind::LShr, ctx.binary(Kind::Shl, c.values[0], shift), shift);
+    }
+};
+
+struct LShrZero : Rule<LShr<X, Const<0>>> {
+    static constexpr const char* name = "lshr-zero";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+// --- Booleans and compares ---
+
+template <Kind K>
+struct CompareSelf : Rule<Binary<K, X, X>> {
+    static constexpr const char* name = selfCompareName(K);
+    static Value* rewrite(Instruction*, Captures&, RewriteContext& ctx) {
+        bool reflexive = K == Kind::ICmpEq || K == Kind::ICmpLe || K == Kind::ICmpGe || K == Kind::ICmpULe ||
+                         K == Kind::ICmpUGe;
+        return ctx.constant(Type::I1, reflexive);
+    }
+};
+
+struct NotNot : Rule<Not<Not<X>>> {
+    static constexpr const char* name = "not-not";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) { return c.values[0]; }
+};
+
+struct NotCompare : Rule<Not<AnyCmp<X, Y>>> {
+    static constexpr const char* name = "not-icmp";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext& ctx) {
+        return ctx.binary(inverse(c.predicate), c.values[0], c.values[1]);
+    }
+};
+
+// `b == true` / `b != false` -> `b` for a Boolean `b`
+template <Kind K, int32_t Value_>
+struct BoolCompareIdentity : Rule<Binary<K, X, Const<Value_>>> {
+    static constexpr const char* name = K == Kind::ICmpEq ? "bool-eq-true" : "bool-ne-false";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext&) {
+        return c.values[0]->getType() == Type::I1 ? c.values[0] : nullptr;
+    }
+};
+
+// `b == false` / `b != true` -> `not b` for a Boolean `b`
+template <Kind K, int32_t Value_>
+struct BoolCompareNot : Rule<Binary<K, X, Const<Value_>>> {
+    static constexpr const char* name = K == Kind::ICmpEq ? "bool-eq-false" : "bool-ne-true";
+    static Value* rewrite(Instruction*, Captures& c, RewriteContext& ctx) {
+        return c.values[0]->getType() == Type::I1 ? ctx.unary(Kind::Not, c.values[0]) : nullptr;
+    }
+};
+
+// Per opcode, rules are tried in this order; canonicalization comes first
+using PeepholeRules = RuleSet<
+    ConstToRhs<Kind::Add>, ConstToRhs<Kind::Mul>,
+    ConstToRhs<Kind::ICmpEq>, ConstToRhs<Kind::ICmpNe>, ConstToRhs<Kind::ICmpLt>,
+    ConstToRhs<Kind::ICmpLe>, ConstToRhs<Kind::ICmpGt>, ConstToRhs<Kind::ICmpGe>,
+    ConstToRhs<Kind::ICmpULt>, ConstToRhs<Kind::ICmpULe>, ConstToRhs<Kind::ICmpUGt>, ConstToRhs<Kind::ICmpUGe>,
+    SubConstToAdd,
+    AddZero, AddConstChain, AddSubCancel,
+    SubSelf, SubAddCancel,
+    MulZero, MulOne, MulMinusOne, MulPowerOfTwo,
+    ShlZero, SDivOne, SRemOne,
+    UDivOne, URemOne, UDivPowerOfTwo, URemPowerOfTwo, LShrZero,
+    CompareSelf<Kind::ICmpEq>, CompareSelf<Kind::ICmpNe>, CompareSelf<Kind::ICmpLt>,
+    CompareSelf<Kind::ICmpLe>, CompareSelf<Kind::ICmpGt>, CompareSelf<Kind::ICmpGe>,
+    CompareSelf<Kind::ICmpULt>, CompareSelf<Kind::ICmpULe>, CompareSelf<Kind::ICmpUGt>, CompareSelf<Kind::ICmpUGe>,
+    BoolCompareIdentity<Kind::ICmpEq, 1>, BoolCompareIdentity<Kind::ICmpNe, 0>,
+    BoolCompareNot<Kind::ICmpEq, 0>, BoolCompareNot<Kind::ICmpNe, 1>,
+    NotNot, NotCompare>;
+
+// Worklist driver for one function. Rewritten instructions are unlinked but
+// kept alive until the end, so stale worklist entries can never alias a new
+// instruction.
+class FunctionRewriter : public RewriteContext {
+public:
+    FunctionRewriter(Function& func, std::vector<size_t>& counts)
+        : func_(func), counts_(counts), next_id_(func.nextFreeId()) {}
+
+    bool run() {
+        for (auto& bb : func_.blocks) {
+            for (auto& inst : bb->instructions) {
+                for (Value* op : inst->getOperands()) users_[op].push_back(inst.get());
+            }
+        }
+        for (auto bb = func_.blocks.rbegin(); bb != func_.blocks.rend(); ++bb) {
+            for (auto inst = (*bb)->instructions.rbegin(); inst != (*bb)->instructions.rend(); ++inst) {
+                push(inst->get());
+            }
+        }
+
+        bool changed = false;
+        while (!worklist_.empty()) {
+            Instruction* inst = worklist_.back();
+            worklist_.pop_back();
+            queued_.erase(inst);
+            if (removed_.count(inst)) continue;
+
+            current_ = inst;
+            size_t fired = 0;
+            Value* result = PeepholeRules::apply(inst, *this, fired);
+            if (!result) continue;
+            counts_[fired]++;
+            ++Rewrites;
+            changed = true;
+
+            if (result == inst) {
+                push(inst);
+            } else {
+                replace(inst, result);
+            }
+            for (Instruction* user : users_[inst]) push(user);
+            for (Instruction* created : created_) push(created);
+            created_.clear();
+        }
+        if (changed) removeDeadCode();
+        return changed;
+    }
+
+    Value* binary(Kind kind, Value* l, Value* r) override {
+        Type type = isCompare(kind) ? Type::I1 : l->getType();
+        return insert(std::make_unique<BinaryInst>(kind, type, std::to_string(next_id_++), l, r));
+    }
+
+    Value* unary(Kind kind, Value* operand) override {
+        return insert(std::make_unique<UnaryInst>(kind, operand->getType(), std::to_string(next_id_++), operand));
+    }
+
+    Value* constant(Type type, int64_t value) override { return new Constant(type, value); }
+
+private:
+    Function& func_;
+    std::vector<size_t>& counts_;
+    int next_id_;
+    Instruction* current_ = nullptr;
+    std::vector<Instruction*> worklist_;
+    std::unordered_set<Instruction*> queued_;
+    std::unordered_set<Instruction*> removed_;
+    std::unordered_map<Value*, std::vector<Instruction*>> users_;
+    std::vector<Instruction*> created_;
+    std::vector<std::unique_ptr<Instruction>> graveyard_;
+
+    void push(Instruction* inst) {
+        if (queued_.insert(inst).second) worklist_.push_back(inst);
+    }
+
+    Instruction* insert(std::unique_ptr<Instruction> inst) {
+        Instruction* raw = inst.get();
+        for (Value* op : raw->getOperands()) users_[op].push_back(raw);
+        BasicBlock* bb = current_->parent;
+        bb->insertInstruction(bb->find(current_), std::move(inst));
+        created_.push_back(raw);
+        return raw;
+    }
+
+    // Rewrites leave their old operand trees behind. Division is kept even
+    // when unused: the interpreters report its traps.
+    void removeDeadCode() {
+        std::unordered_map<Value*, int> uses;
+        for (auto& bb : func_.blocks) {
+            for (auto& inst : bb->instructions) {
+                for (Value* op : inst->getOperands()) uses[op]++;
+            }
+        }
+        std::vector<Instruction*> dead;
+        auto removable = [&](Instruction* inst) {
+            bool pure = dynamic_cast<BinaryInst*>(inst) || dynamic_cast<UnaryInst*>(inst);
+            bool traps = inst->kind == Kind::SDiv || inst->kind == Kind::SRem || inst->kind == Kind::UDiv ||
+                         inst->kind == Kind::URem;
+            return pure && !traps && uses[inst] == 0;
+        };
+        for (auto& bb : func_.blocks) {
+            for (auto& inst : bb->instructions) {
+                if (removable(inst.get())) dead.push_back(inst.get());
+            }
+        }
+        while (!dead.empty()) {
+            Instruction* inst = dead.back();
+            dead.pop_back();
+            for (Value* op : inst->getOperands()) {
+                auto opInst = dynamic_cast<Instruction*>(op);
+                if (--uses[op] == 0 && opInst && removable(opInst)) dead.push_back(opInst);
+            }
+            inst->parent->eraseInstruction(inst);
+            ++DeadInstructions;
+        }
+    }
+
+    void replace(Instruction* inst, Value* with) {
+        auto& withUsers = users_[with];
+        for (Instruction* user : users_[inst]) {
+            user->replaceUsesOfWith(inst, with);
+            withUsers.push_back(user);
+        }
+        BasicBlock* bb = inst->parent;
+        auto it = bb->find(inst);
+        graveyard_.push_back(std::move(*it));
+        bb->instructions.erase(it);
+        removed_.insert(inst);
+    }
+};
+
+} // namespace
+
+bool PeepholeOptimizer::run(Module& module) {
+    bool changed = false;
+    for (auto& func : module.functions) changed |= runOnFunction(*func);
+    return changed;
+}
+
+bool PeepholeOptimizer::runOnFunction(Function& func) {
+    counts_.resize(PeepholeRules::size, 0);
+    return FunctionRewriter(func, counts_).run();
+}
+
+std::vector<std::pair<std::string, size_t>> PeepholeOptimizer::getRuleCounts() const {
+    std::vector<std::pair<std::string, size_t>> result;
+    for (size_t i = 0; i < PeepholeRules::size; ++i) {
+        result.emplace_back(PeepholeRules::name(i), i < counts_.size() ? counts_[i] : 0);
+    }
+    return result;
+}
+
+size_t PeepholeOptimizer::getTotalRewrites() const {
+    size_t total = 0;
+    for (size_t count : counts_) total += count;
+    return total;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
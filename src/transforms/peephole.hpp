@@ -0,0 +1,32 @@
+#pragma once
+#include "ir/ir.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// Local algebraic rewrites: identities (`x + 0`, `x * 1`, `not not x`),
+// strength reduction (`x * 2^k` -> `x shl k`) and canonical forms for
+// commutative operations and compares (constants on the right).
+//
+// Rules are written in the pattern DSL of pattern_match.hpp, in
+// peephole.cpp. Each function is processed with a worklist until no rule
+// applies: when an instruction is rewritten, its users and any instruction
+// the rewrite created are revisited.
+class PeepholeOptimizer {
+public:
+    bool run(Module& module);
+    bool runOnFunction(Function& func);
+
+    // (rule name, rewrites) for every rule, in declaration order
+    std::vector<std::pair<std::string, size_t>> getRuleCounts() const;
+    size_t getTotalRewrites() const;
+
+private:
+    std::vector<size_t> counts_;
+};
+
+} // namespace ir
+} // namespace kotlin_lite
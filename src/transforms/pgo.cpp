@@ -0,0 +1,107 @@
+#include "pgo.hpp"
+#include "ir/statistics.hpp"
+#include "ir/ir_builder.hpp"
+#include <set>
+#include <sstream>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(Counters, "pgo", "Profile counters inserted");
+KL_STATISTIC(Annotated, "pgo", "Functions annotated with a profile");
+KL_STATISTIC(Renamed, "pgo", "Profiles matched to a renamed function");
+KL_STATISTIC(Stale, "pgo", "Profiles dropped because the function changed");
+
+bool ProfileInstrumentation::run(Module& module) {
+    layout_.clear();
+    counters_ = 0;
+    for (const auto& func : module.functions) {
+        if (func->blocks.empty()) continue;
+        // The hash is of the code the profile will be applied to
+        uint64_t hash = profileHash(*func);
+        size_t first = counters_;
+
+        IRBuilder builder;
+        auto count = [&](Instruction* before, Value* taken) {
+            builder.setInsertPointBefore(before);
+            ++Counters;
+            builder.createCall(Type::Void, kProfileCounterFunction,
+                               {new Constant(Type::I32, static_cast<int32_t>(counters_++)), taken});
+        };
+        for (const auto& bb : func->blocks) {
+            auto it = bb->instructions.begin();
+            while ((*it)->kind == Instruction::OpKind::Phi) ++it;
+            count(it->get(), new Constant(Type::I1, 1));
+        }
+        for (const auto& bb : func->blocks) {
+            if (auto cbr = dynamic_cast<CondBranchInst*>(bb->getTerminator())) count(cbr, cbr->condition);
+        }
+
+        std::stringstream line;
+        line << func->name << " " << std::hex << hash << std::dec << " " << counters_ - first << "\n";
+        layout_ += line.str();
+    }
+    return counters_ > 0;
+}
+
+bool ProfileAnnotation::run(Module& module) {
+    auto matches = [](const Function& func, uint64_t hash, const FunctionProfile& profile) {
+        return profile.hash == hash && profile.counts.size() == profileCounterCount(func);
+    };
+
+    std::set<std::string> used;
+    std::vector<std::pair<Function*, uint64_t>> unmatched;
+    for (const auto& func : module.functions) {
+        if (func->blocks.empty()) continue;
+        uint64_t hash = profileHash(*func);
+        auto it = profile_.functions.find(func->name);
+        if (it != profile_.functions.end() && matches(*func, hash, it->second)) {
+            annotate(*func, it->second);
+            used.insert(func->name);
+            stats_.annotated++;
+            ++Annotated;
+        } else {
+            unmatched.push_back({func.get(), hash});
+        }
+    }
+
+    // A renamed function: exactly one entry with its hash, for a name the module no longer has
+    for (const auto& [func, hash] : unmatched) {
+        const std::pair<const std::string, FunctionProfile>* found = nullptr;
+        int candidates = 0;
+        for (const auto& entry : profile_.functions) {
+            if (used.count(entry.first) || module.getFunction(entry.first) || !matches(*func, hash, entry.second)) continue;
+            found = &entry;
+            candidates++;
+        }
+        if (candidates == 1) {
+            annotate(*func, found->second);
+            used.insert(found->first);
+            stats_.annotated++;
+            stats_.renamed++;
+            ++Annotated;
+            ++Renamed;
+        } else if (profile_.functions.count(func->name)) {
+            warnings_.push_back("profile of '" + func->name + "' does not match its code any more; ignored");
+            stats_.stale++;
+            ++Stale;
+        }
+    }
+    return stats_.annotated > 0;
+}
+
+void ProfileAnnotation::annotate(Function& func, const FunctionProfile& profile) {
+    size_t next = 0;
+    for (const auto& bb : func.blocks) bb->profileCount = profile.counts[next++];
+    func.entryCount = func.blocks.front()->profileCount;
+    for (const auto& bb : func.blocks) {
+        auto cbr = dynamic_cast<CondBranchInst*>(bb->getTerminator());
+        if (!cbr) continue;
+        uint64_t taken = profile.counts[next++];
+        uint64_t total = *bb->profileCount;
+        cbr->weights = CondBranchInst::BranchWeights{taken, total > taken ? total - taken : 0};
+    }
+}
+
+} // namespace ir
+} // namespace kotlin_lite
@@ -0,0 +1,65 @@
+#pragma once
+#include "ir/ir.hpp"
+#include "ir/profile.hpp"
+#include <string>
+#include <vector>
+
+namespace kotlin_lite {
+namespace ir {
+
+// --profile-generate: counts block executions and taken then-edges.
+//
+// Every block starts (after its phis) with
+//
+//     call void @kl_prof_count(i32 <counter>, i1 true)
+//
+// and every condbr is preceded by the same call with its condition, so the
+// then-edge counter only moves when the branch is taken. The LLVM backend
+// turns these calls into increments of a counter array that the runtime
+// writes out at exit, described by getLayout(). See Profile for the order of
+// a function's counters.
+class ProfileInstrumentation {
+public:
+    bool run(Module& module);
+
+    // One line per function, "<name> <hash> <counters>", in counter order
+    const std::string& getLayout() const { return layout_; }
+    size_t getCounterCount() const { return counters_; }
+
+private:
+    std::string layout_;
+    size_t counters_ = 0;
+};
+
+// --profile-use: attaches a profile to the IR as function entry counts,
+// block counts and condbr weights, for the custom passes and the backend.
+//
+// Functions are matched by name and hash. A function whose shape changed
+// since the profile was taken (different hash) is left without counts; one
+// that was renamed is still found if exactly one unmatched profile entry has
+// its hash.
+class ProfileAnnotation {
+public:
+    struct Statistics {
+        int annotated = 0;
+        int renamed = 0;
+        int stale = 0;
+    };
+
+    explicit ProfileAnnotation(const Profile& profile) : profile_(profile) {}
+
+    bool run(Module& module);
+    const Statistics& getStatistics() const { return stats_; }
+    // One line per function whose profile was dropped
+    const std::vector<std::string>& getWarnings() const { return warnings_; }
+
+private:
+    const Profile& profile_;
+    Statistics stats_;
+    std::vector<std::string> warnings_;
+
+    void annotate(Function& func, const FunctionProfile& profile);
+};
+
+} // namespace ir
+} // namespace kotlin_lite
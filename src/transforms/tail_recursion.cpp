@@ -0,0 +1,179 @@
+#include "tail_recursion.hpp"
+#include "ir/statistics.hpp"
+#include "ir/ir_builder.hpp"
+#include <set>
+
+namespace kotlin_lite {
+namespace ir {
+
+KL_STATISTIC(FunctionsLooped, "tailrec", "Functions turned into loops");
+KL_STATISTIC(EliminatedCalls, "tailrec", "Tail calls replaced by branches");
+KL_STATISTIC(AccumulatedCalls, "tailrec", "Tail calls folded into an accumulator");
+
+bool TailRecursionElimination::run(Module& module) {
+    bool changed = false;
+    for (auto& func : module.functions) {
+        changed |= runOnFunction(*func);
+    }
+    return changed;
+}
+
+bool TailRecursionElimination::runOnTailrecFunctions(Module& module) {
+    bool changed = false;
+    for (auto& func : module.functions) {
+        if (func->tailrec) changed |= runOnFunction(*func);
+    }
+    return changed;
+}
+
+bool TailRecursionElimination::findTailSite(Function& func, BasicBlock& bb, TailSite& site) const {
+    Instruction* term = bb.getTerminator();
+    if (!term || bb.instructions.size() < 2) return false;
+
+    auto isSelfCall = [&](Instruction* inst) {
+        return inst->kind == Instruction::OpKind::Call && static_cast<CallInst*>(inst)->callee == func.name;
+    };
+
+    auto it = std::prev(bb.instructions.end());
+    Instruction* prev = std::prev(it)->get();
+
+    if (term->kind == Instruction::OpKind::Br) {
+        // `f(x)` as the last statement of a Unit function: the call branches to a bare `ret void`.
+        auto target = static_cast<BranchInst*>(term)->target;
+        if (func.returnType != Type::Void || target->instructions.size() != 1) return false;
+        auto ret = target->getTerminator();
+        if (!ret || ret->kind != Instruction::OpKind::Ret || !isSelfCall(prev)) return false;
+        site = {&bb, static_cast<CallInst*>(prev), nullptr, term};
+        return true;
+    }
+    if (term->kind != Instruction::OpKind::Ret) return false;
+
+    Value* retVal = static_cast<ReturnInst*>(term)->value;
+    if (isSelfCall(prev) && (retVal == prev || (!retVal && func.returnType == Type::Void))) {
+        site = {&bb, static_cast<CallInst*>(prev), nullptr, term};
+        return true;
+    }
+
+    if (retVal != prev || std::prev(it) == bb.instructions.begin()) return false;
+    if (prev->kind != Instruction::OpKind::Add && prev->kind != Instruction::OpKind::Mul) return false;
+    Instruction* callInst = std::prev(std::prev(it))->get();
+    if (!isSelfCall(callInst)) return false;
+    auto bin = static_cast<BinaryInst*>(prev);
+    if ((bin->left == callInst) == (bin->right == callInst)) return false;
+    site = {&bb, static_cast<CallInst*>(callInst), bin, term};
+    return true;
+}
+
+bool TailRecursionElimination::runOnFunction(Function& func) {
+    if (func.blocks.empty()) return false;
+
+    std::vector<TailSite> sites;
+    std::set<Instruction::OpKind> accumulateOps;
+    for (auto& bb : func.blocks) {
+        TailSite site;
+        if (findTailSite(func, *bb, site)) {
+            sites.push_back(site);
+            if (site.accumulate) accumulateOps.insert(site.accumulate->kind);
+        }
+    }
+
+    // Mixing + and * accumulators would need two of them; keep only plain tail calls then.
+    if (accumulateOps.size() > 1) {
+        std::vector<TailSite> plain;
+        for (const auto& site : sites) {
+            if (!site.accumulate) plain.push_back(site);
+        }
+        sites = std::move(plain);
+        accumulateOps.clear();
+    }
+    if (sites.empty()) return false;
+
+    bool useAccumulator = !accumulateOps.empty();
+    ++FunctionsLooped;
+    Instruction::OpKind accOp = useAccumulator ? *accumulateOps.begin() : Instruction::OpKind::Add;
+
+    // The old entry becomes the loop header; a fresh entry jumps into it.
+    std::set<std::string> labels;
+    for (const auto& bb : func.blocks) labels.insert(bb->label);
+    BasicBlock* header = func.blocks.front().get();
+    std::string headerLabel = "tailrec.header";
+    for (int n = 1; labels.count(headerLabel); ++n) headerLabel = "tailrec.header" + std::to_string(n);
+    header->label = headerLabel;
+
+    func.blocks.push_front(std::make_unique<BasicBlock>("entry", &func));
+    BasicBlock* entry = func.blocks.front().get();
+
+    IRBuilder builder(func.nextFreeId());
+    builder.setInsertPoint(entry);
+    builder.createBr(header);
+
+    std::vector<PhiInst*> argPhis(func.args.size(), nullptr);
+    PhiInst* accPhi = nullptr;
+    Instruction* first = header->instructions.empty() ? nullptr : header->instructions.front().get();
+    for (size_t i = 0; i < func.args.size(); ++i) {
+        if (!func.args[i].ssaValue) continue;
+        if (first) builder.setInsertPointBefore(first);
+        else builder.setInsertPoint(header);
+        argPhis[i] = builder.createPhi(func.args[i].type);
+    }
+    if (useAccumulator) {
+        if (first) builder.setInsertPointBefore(first);
+        else builder.setInsertPoint(header);
+        accPhi = builder.createPhi(func.returnType);
+    }
+
+    for (size_t i = 0; i < func.args.size(); ++i) {
+        if (!argPhis[i]) continue;
+        func.replaceAllUsesWith(func.args[i].ssaValue, argPhis[i]);
+        argPhis[i]->addIncoming(entry, func.args[i].ssaValue);
+    }
+    if (accPhi) {
+        int64_t identity = (accOp == Instruction::OpKind::Mul) ? 1 : 0;
+        accPhi->addIncoming(entry, new Constant(func.returnType, identity));
+    }
+
+    for (const auto& site : sites) {
+        std::vector<Value*> callArgs = site.call->args;
+        Value* other = nullptr;
+        if (site.accumulate) {
+            other = (site.accumulate->left == site.call) ? site.accumulate->right : site.accumulate->left;
+        }
+
+        site.block->eraseInstruction(site.ret);
+        if (site.accumulate) site.block->eraseInstruction(site.accumulate);
+        site.block->eraseInstruction(site.call);
+
+        builder.setInsertPoint(site.block);
+        Value* nextAcc = accPhi;
+        if (site.accumulate) {
+            nextAcc = builder.createBinary(accOp, accPhi, other);
+            accumulated_calls_++;
+            ++AccumulatedCalls;
+        }
+        builder.createBr(header);
+
+        for (size_t i = 0; i < argPhis.size() && i < callArgs.size(); ++i) {
+            if (argPhis[i]) argPhis[i]->addIncoming(site.block, callArgs[i]);
+        }
+        if (accPhi) accPhi->addIncoming(site.block, nextAcc);
+        eliminated_calls_++;
+        ++EliminatedCalls;
+    }
+
+    // Every remaining exit returns the accumulated value combined with its own result.
+    if (accPhi) {
+        for (auto& bb : func.blocks) {
+            Instruction* term = bb->getTerminator();
+            if (!term || term->kind != Instruction::OpKind::Ret) continue;
+            auto ret = static_cast<ReturnInst*>(term);
+            if (!ret->value) continue;
+            builder.setInsertPointBefore(ret);
+            ret->value = builder.createBinary(accOp, accPhi, ret->value);
+        }
+    }
+
+    return true;
+}
+
+} // namespace ir
+} // namespace kotlin_lite
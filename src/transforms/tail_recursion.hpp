@@ -0,0 +1,41 @@
+#pragma once
+#include "ir/ir.hpp"
+
+namespace kotlin_lite {
+namespace ir {
+
+// Rewrites self-recursive calls in tail position into a loop.
+//
+// The old entry block becomes a loop header with one phi per argument, and
+// every `call @self(...); ret` pair becomes a branch back to it. Returns of the
+// form `ret (x op call @self(...))` with an associative `op` (add/mul) are
+// handled too, by threading an accumulator phi through the header and folding
+// it into every remaining return.
+//
+// Functions marked `tailrec` must run in constant stack space, so the
+// pipelines call runOnTailrecFunctions() when the pass itself is off.
+class TailRecursionElimination {
+public:
+    bool run(Module& module);
+    bool runOnTailrecFunctions(Module& module);
+    bool runOnFunction(Function& func);
+
+    int getEliminatedCalls() const { return eliminated_calls_; }
+    int getAccumulatedCalls() const { return accumulated_calls_; }
+
+private:
+    struct TailSite {
+        BasicBlock* block;
+        CallInst* call;
+        BinaryInst* accumulate; // nullptr for a plain tail call
+        Instruction* ret;       // the return (or branch to a bare return) closing the block
+    };
+
+    int eliminated_calls_ = 0;
+    int accumulated_calls_ = 0;
+
+    bool findTailSite(Function& func, BasicBlock& bb, TailSite& site) const;
+};
+
+} // namespace ir
+} // namespace kotlin_lite
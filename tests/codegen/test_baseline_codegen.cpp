@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "transforms/tail_recursion.hpp"
+#include "codegen/baseline_codegen.hpp"
+#include "codegen/elf_writer.hpp"
+#include "codegen/executable_buffer.hpp"
+#include <cstring>
+#include <elf.h>
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::test;
+
+static std::string runProgram(const std::string& source, const std::vector<std::string>& args = {}) {
+    auto mod = lower(source);
+    MachineCode code = BaselineCodegen().generate(*mod);
+    testing::internal::CaptureStdout();
+    ExecutableBuffer(code).run("main", args);
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(BaselineCodegenTest, RecursionAndBuiltins) {
+    EXPECT_EQ(runProgram("fun fib(n: Int): Int {\n"
+                         "    if (n <= 1) { return n }\n"
+                         "    return fib(n - 1) + fib(n - 2)\n"
+                         "}\n"
+                         "fun main() {\n"
+                         "    print_i32(fib(20))\n"
+                         "    print_bool(fib(5) == 5 && !(1 > 2))\n"
+                         "    print_i32(-7 / 2)\n"
+                         "    print_i32(-7 % 2)\n"
+                         "    print_i32(65536 * 65536)\n"
+                         "}"),
+              "6765\ntrue\n-3\n-1\n0\n");
+}
+
+TEST(BaselineCodegenTest, BenchmarkingBuiltins) {
+    EXPECT_EQ(runProgram("fun main() {\n"
+                         "    var sum = 0\n"
+                         "    var i = 0\n"
+                         "    while (i < argInt(0, 10)) { sum = sum + i\n i = i + 1 }\n"
+                         "    blackhole(sum)\n"
+                         "    print_i32(sum)\n"
+                         "    print_i32(argCount())\n"
+                         "    print_i32(argInt(1, -1) + argInt(2, -1) + argInt(5, -1))\n"
+                         "}",
+                         {"5", "7"}),
+              "10\n2\n5\n");
+    // The clock reads a Long, which the baseline leaves to LLVM
+    EXPECT_THROW(runProgram("fun main() { blackhole(nanoTime()) }"), std::runtime_error);
+}
+
+TEST(BaselineCodegenTest, PhiSwapUsesParallelMoves) {
+    EXPECT_EQ(runProgram("fun main() {\n"
+                         "    var a = 1\n"
+                         "    var b = 2\n"
+                         "    var i = 0\n"
+                         "    while (i < 3) {\n"
+                         "        val t = a\n"
+                         "        a = b\n"
+                         "        b = t\n"
+                         "        i = i + 1\n"
+                         "    }\n"
+                         "    print_i32(a)\n"
+                         "    print_i32(b)\n"
+                         "}"),
+              "2\n1\n");
+}
+
+TEST(BaselineCodegenTest, SpillsAndStackArguments) {
+    // Nine values live across the calls exceed the five callee-saved
+    // registers, and sum8 takes two arguments on the stack
+    EXPECT_EQ(runProgram("fun sum8(a: Int, b: Int, c: Int, d: Int, e: Int, f: Int, g: Int, h: Int): Int {\n"
+                         "    return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h\n"
+                         "}\n"
+                         "fun id(x: Int): Int { return x }\n"
+                         "fun main() {\n"
+                         "    val a = id(1)\n"
+                         "    val b = id(2)\n"
+                         "    val c = id(3)\n"
+                         "    val d = id(4)\n"
+                         "    val e = id(5)\n"
+                         "    val f = id(6)\n"
+                         "    val g = id(7)\n"
+                         "    val h = id(8)\n"
+                         "    val k = id(9)\n"
+                         "    print_i32(sum8(a, b, c, d, e, f, g, h) + k)\n"
+                         "    print_i32(a + b + c + d + e + f + g + h + k)\n"
+                         "}"),
+              "213\n45\n");
+}
+
+TEST(BaselineCodegenTest, LoopsAfterTailRecursionElimination) {
+    auto mod = lower("fun gcd(a: Int, b: Int): Int {\n"
+                     "    if (b == 0) { return a }\n"
+                     "    return gcd(b, a % b)\n"
+                     "}\n"
+                     "fun main() { print_i32(gcd(1071, 462)) }");
+    ir::TailRecursionElimination().run(*mod);
+    MachineCode code = BaselineCodegen().generate(*mod);
+    testing::internal::CaptureStdout();
+    ExecutableBuffer(code).run();
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "21\n");
+}
+
+TEST(BaselineCodegenTest, WritesRelocatableElfObject) {
+    auto mod = lower("fun square(x: Int): Int { return x * x }\n"
+                     "fun main() { print_i32(square(3)) }");
+    CodegenOptions options;
+    options.wholeProgram = true;
+    MachineCode code = BaselineCodegen(options).generate(*mod);
+    ASSERT_EQ(code.relocations.size(), 1u);
+    EXPECT_EQ(code.relocations[0].symbol, "print_i32");
+    EXPECT_FALSE(code.findFunction("square")->global);
+    EXPECT_TRUE(code.findFunction("main")->global);
+
+    std::vector<uint8_t> object = writeElfObject(code);
+    ASSERT_GE(object.size(), sizeof(Elf64_Ehdr));
+    Elf64_Ehdr ehdr;
+    std::memcpy(&ehdr, object.data(), sizeof(ehdr));
+    EXPECT_EQ(std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG), 0);
+    EXPECT_EQ(ehdr.e_type, ET_REL);
+    EXPECT_EQ(ehdr.e_machine, EM_X86_64);
+    std::string bytes(object.begin(), object.end());
+    EXPECT_NE(bytes.find(std::string("print_i32\0", 10)), std::string::npos);
+    EXPECT_NE(bytes.find(".rela.text"), std::string::npos);
+}
+
+TEST(BaselineCodegenTest, UnknownCalleeIsAnError) {
+    auto mod = lower("fun main() { print_i32(1) }");
+    auto& call = static_cast<ir::CallInst&>(*mod->getFunction("main")->blocks.front()->instructions.front());
+    call.callee = "missing";
+    EXPECT_THROW(BaselineCodegen().generate(*mod), std::runtime_error);
+}
@@ -0,0 +1,457 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "codegen/llvm_codegen.hpp"
+#include "codegen/llvm_optimizer.hpp"
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Verifier.h>
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::test;
+
+static const char* kProgram =
+    "fun square(x: Int): Int { return x * x }\n"
+    "fun show(x: Int) { print_i32(square(x)) }\n"
+    "fun count(n: Int): Int {\n"
+    "    var i = 0\n"
+    "    while (i < n) { i = i + 1 }\n"
+    "    return i\n"
+    "}\n"
+    "fun main() { show(count(3)) }";
+
+TEST(LLVMCodegenTest, WholeProgramInternalizes) {
+    auto irMod = lower(kProgram);
+    CodegenOptions options;
+    options.wholeProgram = true;
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    auto square = mod->getFunction("square");
+    EXPECT_TRUE(square->hasInternalLinkage());
+    EXPECT_EQ(square->getCallingConv(), llvm::CallingConv::Fast);
+    auto main = mod->getFunction("main");
+    EXPECT_TRUE(main->hasExternalLinkage());
+    EXPECT_EQ(main->getCallingConv(), llvm::CallingConv::C);
+    EXPECT_EQ(mod->getFunction("print_i32")->getCallingConv(), llvm::CallingConv::C);
+}
+
+TEST(LLVMCodegenTest, InferredAttributes) {
+    auto irMod = lower(kProgram);
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+
+    auto square = mod->getFunction("square");
+    EXPECT_TRUE(square->hasExternalLinkage());
+    EXPECT_TRUE(square->doesNotAccessMemory());
+    EXPECT_TRUE(square->hasFnAttribute(llvm::Attribute::WillReturn));
+    EXPECT_TRUE(square->doesNotRecurse());
+    EXPECT_TRUE(square->doesNotThrow());
+
+    // A loop may not terminate, and output is an I/O effect.
+    EXPECT_FALSE(mod->getFunction("count")->hasFnAttribute(llvm::Attribute::WillReturn));
+    auto show = mod->getFunction("show");
+    EXPECT_FALSE(show->doesNotAccessMemory());
+    EXPECT_TRUE(show->onlyAccessesInaccessibleMemory());
+    EXPECT_TRUE(mod->getFunction("print_i32")->onlyAccessesInaccessibleMemory());
+}
+
+TEST(LLVMCodegenTest, RecursionBlocksNoRecurse) {
+    auto irMod = lower("fun fib(n: Int): Int {\n"
+                       "    if (n <= 1) { return n }\n"
+                       "    return fib(n - 1) + fib(n - 2)\n"
+                       "}\n"
+                       "fun main() { print_i32(fib(10)) }");
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+    auto fib = mod->getFunction("fib");
+    EXPECT_FALSE(fib->doesNotRecurse());
+    EXPECT_FALSE(fib->hasFnAttribute(llvm::Attribute::WillReturn));
+    EXPECT_TRUE(fib->doesNotAccessMemory());
+}
+
+TEST(LLVMCodegenTest, FramePointersKeptForTheSamplingProfiler) {
+    auto irMod = lower(kProgram);
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+    EXPECT_EQ(mod->getFunction("count")->getFnAttribute("frame-pointer").getValueAsString(), "all");
+    EXPECT_FALSE(mod->getFunction("print_i32")->hasFnAttribute("frame-pointer"));
+
+    CodegenOptions options;
+    options.framePointers = false;
+    LLVMCodegen omitting(options);
+    auto omitted = omitting.generate(*irMod);
+    EXPECT_FALSE(omitted->getFunction("count")->hasFnAttribute("frame-pointer"));
+}
+
+TEST(LLVMCodegenTest, InstrumentationCountsFunctionsAndLoops) {
+    auto irMod = lower(kProgram);
+    CodegenOptions options;
+    options.instrument = CodegenOptions::Instrumentation{"report"};
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    // Small loop-free functions are only counted; loops report their line
+    auto layout = mod->getGlobalVariable("kl_inst_layout", true);
+    ASSERT_NE(layout, nullptr);
+    std::string text = llvm::cast<llvm::ConstantDataArray>(layout->getInitializer())->getAsCString().str();
+    EXPECT_NE(text.find("function square 1 counted\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("function count 3 timed\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("loop count 5\n"), std::string::npos) << text;
+
+    EXPECT_NE(mod->getFunction("kl_inst_register"), nullptr);
+    EXPECT_NE(mod->getFunction("kl_inst_loop"), nullptr);
+    EXPECT_NE(mod->getFunction("llvm.readcyclecounter"), nullptr);
+    EXPECT_TRUE(mod->getGlobalVariable("kl_inst_buffer")->isThreadLocal());
+}
+
+TEST(LLVMCodegenTest, InstrumentedFunctionsClaimNoMemoryAttributes) {
+    // The counters are memory every function writes; a readnone `square`
+    // would have its calls hoisted out of loops and never counted
+    auto irMod = lower(kProgram);
+    CodegenOptions options;
+    options.instrument = CodegenOptions::Instrumentation{"report"};
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+    for (const char* name : {"square", "show", "count", "main"}) {
+        llvm::Function* func = mod->getFunction(name);
+        ASSERT_NE(func, nullptr) << name;
+        EXPECT_FALSE(func->doesNotAccessMemory()) << name;
+        EXPECT_FALSE(func->onlyAccessesInaccessibleMemory()) << name;
+        EXPECT_FALSE(func->hasFnAttribute(llvm::Attribute::NoSync)) << name;
+    }
+}
+
+TEST(LLVMCodegenTest, DebugInfoLocatesInstructionsAndVariables) {
+    auto irMod = lower(kProgram);
+    CodegenOptions options;
+    options.debugInfo = CodegenOptions::DebugInfo{"program.kt", "/src"};
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    llvm::Function* count = mod->getFunction("count");
+    llvm::DISubprogram* subprogram = count->getSubprogram();
+    ASSERT_NE(subprogram, nullptr);
+    EXPECT_EQ(subprogram->getLine(), 3u);
+    EXPECT_EQ(subprogram->getFilename(), "program.kt");
+
+    std::set<unsigned> lines;
+    std::set<std::string> variables;
+    for (const auto& bb : *count) {
+        for (const auto& inst : bb) {
+            ASSERT_TRUE(inst.getDebugLoc()) << "no location on an instruction of count";
+            lines.insert(inst.getDebugLoc().getLine());
+            if (auto value = llvm::dyn_cast<llvm::DbgValueInst>(&inst)) variables.insert(value->getVariable()->getName().str());
+        }
+    }
+    EXPECT_TRUE(lines.count(5)) << "loop body";
+    EXPECT_TRUE(lines.count(6)) << "return";
+    EXPECT_EQ(variables, (std::set<std::string>{"i", "n"}));
+}
+
+TEST(LLVMCodegenTest, OptimizerReportsLLVMRemarksAtKotlinLines) {
+    auto irMod = lower(kProgram);
+    CodegenOptions options;
+    options.debugInfo = CodegenOptions::DebugInfo{"program.kt", "/src"};
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+
+    ir::RemarkCollector remarks("inline");
+    LLVMOptimizer optimizer;
+    optimizer.optimize(*mod, &remarks);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    bool squareInlined = false;
+    for (const auto& remark : remarks.remarks()) {
+        EXPECT_EQ(remark.pass, "inline");
+        if (remark.kind == ir::Remark::Kind::Passed && remark.function == "show" &&
+            remark.message.find("'square' inlined") != std::string::npos) {
+            squareInlined = true;
+            EXPECT_EQ(remark.file, "program.kt");
+            EXPECT_EQ(remark.line, 2);
+        }
+    }
+    EXPECT_TRUE(squareInlined) << remarks.format();
+}
+
+TEST(LLVMCodegenTest, BlackholeKeepsAnUnusedResultThroughO3) {
+    auto irMod = lower("fun work(n: Int): Int {\n"
+                       "    var i = 0\n"
+                       "    var sum = 0\n"
+                       "    while (i < n) { sum = sum + i * i\n i = i + 1 }\n"
+                       "    return sum\n"
+                       "}\n"
+                       "fun main() {\n"
+                       "    val start = nanoTime()\n"
+                       "    blackhole(work(argInt(0, 100)))\n"
+                       "    print_i64(nanoTime() - start)\n"
+                       "}");
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+    EXPECT_EQ(mod->getFunction("blackhole"), nullptr);
+    EXPECT_TRUE(mod->getFunction("nanoTime")->onlyAccessesInaccessibleMemory());
+    EXPECT_TRUE(mod->getFunction("nanoTime")->getReturnType()->isIntegerTy(64));
+
+    LLVMOptimizer().optimize(*mod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+    // The sum is still computed, between the two clock reads, and fed to the asm
+    std::vector<std::string> order;
+    for (const llvm::Instruction& inst : llvm::instructions(*mod->getFunction("main"))) {
+        auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+        if (!call) continue;
+        if (call->isInlineAsm()) {
+            EXPECT_FALSE(llvm::isa<llvm::Constant>(call->getArgOperand(0)));
+            order.push_back("asm");
+        } else if (call->getCalledFunction()) {
+            order.push_back(call->getCalledFunction()->getName().str());
+        }
+    }
+    EXPECT_EQ(order, (std::vector<std::string>{"nanoTime", "argInt", "asm", "nanoTime", "print_i64"}));
+}
+
+TEST(LLVMCodegenTest, LoopHintsOfATuningMarkEveryLatch) {
+    auto irMod = lower(kProgram);
+    CodegenOptions options;
+    options.loopHints = CodegenOptions::LoopHints{4, 1, 0};
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    int hinted = 0;
+    for (const llvm::Instruction& inst : llvm::instructions(*mod->getFunction("count"))) {
+        llvm::MDNode* loop = inst.getMetadata(llvm::LLVMContext::MD_loop);
+        if (!loop) continue;
+        hinted++;
+        EXPECT_EQ(loop->getOperand(0), loop);
+        ASSERT_EQ(loop->getNumOperands(), 3u);
+        auto unroll = llvm::cast<llvm::MDNode>(loop->getOperand(1));
+        EXPECT_EQ(llvm::cast<llvm::MDString>(unroll->getOperand(0))->getString(), "llvm.loop.unroll.count");
+        auto width = llvm::cast<llvm::MDNode>(loop->getOperand(2));
+        EXPECT_EQ(llvm::cast<llvm::MDString>(width->getOperand(0))->getString(), "llvm.loop.vectorize.width");
+    }
+    EXPECT_EQ(hinted, 1);
+
+    // The optimizer takes every pipeline a tuning may name
+    for (const char* pipeline : {"O1", "O2", "O3", "Os"}) {
+        LLVMOptimizer::Options optimizerOptions;
+        optimizerOptions.pipeline = pipeline;
+        optimizerOptions.inlineThreshold = 500;
+        LLVMCodegen generator(options);
+        auto copy = generator.generate(*lower(kProgram));
+        LLVMOptimizer(optimizerOptions).optimize(*copy);
+        EXPECT_FALSE(llvm::verifyModule(*copy, &llvm::errs())) << pipeline;
+    }
+    LLVMOptimizer::Options unknown;
+    unknown.pipeline = "O9";
+    EXPECT_THROW(LLVMOptimizer{unknown}, std::runtime_error);
+}
+
+TEST(LLVMCodegenTest, MultiversionedFunctionsDispatchThroughAnIfunc) {
+    auto irMod = lower(kProgram);
+    CodegenOptions options;
+    options.target = LLVMOptimizer::resolveTarget("x86-64", "+sse4.2");
+    options.multiversion = {"square", "main"};
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    EXPECT_EQ(mod->getFunction("count")->getFnAttribute("target-cpu").getValueAsString(), "x86-64");
+    EXPECT_EQ(mod->getFunction("count")->getFnAttribute("target-features").getValueAsString(), "+sse4.2");
+    EXPECT_EQ(mod->getFunction("square.default")->getFnAttribute("target-cpu").getValueAsString(), "x86-64");
+    EXPECT_EQ(mod->getFunction("square.v3")->getFnAttribute("target-cpu").getValueAsString(), "x86-64-v3");
+    EXPECT_EQ(mod->getFunction("square.v4")->getFnAttribute("target-features").getValueAsString(), "");
+    EXPECT_TRUE(mod->getFunction("square.v2")->hasInternalLinkage());
+
+    // Callers go through the ifunc; main stays a function that calls main.ifunc
+    llvm::GlobalIFunc* square = mod->getNamedIFunc("square");
+    ASSERT_TRUE(square);
+    EXPECT_EQ(square->getResolverFunction(), mod->getFunction("square.resolver"));
+    EXPECT_TRUE(mod->getFunction("square.default")->hasOneUse());  // the resolver's select
+    bool callsIfunc = false;
+    for (const llvm::Instruction& inst : llvm::instructions(*mod->getFunction("show"))) {
+        if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst)) callsIfunc |= call->getCalledOperand() == square;
+    }
+    EXPECT_TRUE(callsIfunc);
+    ASSERT_TRUE(mod->getNamedIFunc("main.ifunc"));
+    EXPECT_FALSE(mod->getFunction("main")->isDeclaration());
+    EXPECT_TRUE(mod->getFunction("main")->hasExternalLinkage());
+
+    LLVMOptimizer::Options optimizerOptions;
+    optimizerOptions.target = *options.target;
+    LLVMOptimizer(optimizerOptions).optimize(*mod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+    EXPECT_TRUE(mod->getNamedIFunc("main.ifunc"));
+}
+
+TEST(LLVMCodegenTest, ResolvesTargetCPUs) {
+    CodegenOptions::Target native = LLVMOptimizer::resolveTarget("native", "-avx512f");
+    EXPECT_NE(native.cpu, "native");
+    EXPECT_NE(native.features.find("-avx512f"), std::string::npos);
+    EXPECT_EQ(LLVMOptimizer::resolveTarget("", "").cpu, "generic");
+    EXPECT_THROW(LLVMOptimizer::resolveTarget("pentium9", ""), std::runtime_error);
+    EXPECT_THROW(LLVMOptimizer::resolveTarget("x86-64-v3", "avx2"), std::runtime_error);
+}
+
+TEST(LLVMCodegenTest, AnnotationsBecomeAttributesLoopMetadataAndWeights) {
+    auto irMod = lower("@AlwaysInline fun fib(n: Int): Int {\n"
+                       "    if (n <= 1) { return n }\n"
+                       "    return fib(n - 1) + fib(n - 2)\n"
+                       "}\n"
+                       "@Cold @NoInline fun report(x: Int) { print_i32(x) }\n"
+                       "@Hot fun count(n: Int): Int {\n"
+                       "    var i = 0\n"
+                       "    @Unroll(1) @Vectorize(4) while (i < n) { i = i + 1 }\n"
+                       "    @Unlikely if (i < 0) { report(i) }\n"
+                       "    return i\n"
+                       "}\n"
+                       "fun main() { print_i32(fib(count(5))) }");
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    llvm::Function* report = mod->getFunction("report");
+    EXPECT_TRUE(report->hasFnAttribute(llvm::Attribute::Cold));
+    EXPECT_TRUE(report->hasFnAttribute(llvm::Attribute::NoInline));
+    EXPECT_EQ(report->getSectionPrefix(), llvm::Optional<llvm::StringRef>("unlikely"));
+    llvm::Function* count = mod->getFunction("count");
+    EXPECT_TRUE(count->hasFnAttribute(llvm::Attribute::Hot));
+    EXPECT_EQ(count->getSectionPrefix(), llvm::Optional<llvm::StringRef>("hot"));
+    EXPECT_TRUE(mod->getFunction("fib")->hasFnAttribute(llvm::Attribute::AlwaysInline));
+
+    std::vector<std::string> hints;
+    bool weighted = false;
+    for (const llvm::Instruction& inst : llvm::instructions(*count)) {
+        if (llvm::MDNode* loop = inst.getMetadata(llvm::LLVMContext::MD_loop)) {
+            for (unsigned i = 1; i < loop->getNumOperands(); ++i) {
+                auto hint = llvm::cast<llvm::MDNode>(loop->getOperand(i));
+                hints.push_back(llvm::cast<llvm::MDString>(hint->getOperand(0))->getString().str());
+            }
+        }
+        uint64_t taken = 0, notTaken = 0;
+        if (inst.extractProfMetadata(taken, notTaken)) {
+            weighted = true;
+            EXPECT_EQ(taken, 1u);
+            EXPECT_EQ(notTaken, ir::CondBranchInst::kLikelyWeight);
+        }
+    }
+    EXPECT_EQ(hints, (std::vector<std::string>{"llvm.loop.unroll.disable", "llvm.loop.vectorize.enable",
+                                                "llvm.loop.vectorize.width"}));
+    EXPECT_TRUE(weighted);
+
+    // The recursive calls cannot be inlined; the remarks say so
+    ir::RemarkCollector remarks;
+    LLVMOptimizer().optimize(*mod, &remarks);
+    bool reported = false;
+    for (const ir::Remark& remark : remarks.remarks()) {
+        if (remark.pass == "always-inline" && remark.name == "NotInlined") reported = true;
+    }
+    EXPECT_TRUE(reported) << remarks.format();
+}
+
+TEST(LLVMCodegenTest, MemoizedFunctionsLookUpACacheAtEntry) {
+    auto irMod = lower("@Memoize fun fib(n: Int): Int {\n"
+                       "    if (n <= 1) { return n }\n"
+                       "    return fib(n - 1) + fib(n - 2)\n"
+                       "}\n"
+                       "@Memoize(100) fun grid(r: Int, c: Int): Int {\n"
+                       "    if (r == 0 || c == 0) { return 1 }\n"
+                       "    return grid(r - 1, c) + grid(r, c - 1)\n"
+                       "}\n"
+                       "@Memoize fun pick(b: Boolean): Int { if (b) { return 1 }\n return 2 }\n"
+                       "fun main() { print_i32(fib(grid(3, 3)) + pick(true)) }");
+    CodegenOptions options;
+    options.memoizeCapacity = 1000;
+    LLVMCodegen codegen(options);
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    // fib: a direct table for 0..999 and a hashed one for the rest; grid: a
+    // hashed table of 128 slots; pick: one slot per Boolean
+    auto entries = [&](const char* name) -> uint64_t {
+        llvm::GlobalVariable* table = mod->getGlobalVariable(name, true);
+        return table ? llvm::cast<llvm::ArrayType>(table->getValueType())->getNumElements() : 0;
+    };
+    EXPECT_EQ(entries("fib.memo"), 1000u);
+    EXPECT_EQ(entries("fib.memo.hash"), 1024u);
+    EXPECT_EQ(entries("grid.memo"), 0u);
+    EXPECT_EQ(entries("grid.memo.hash"), 128u);
+    EXPECT_EQ(entries("pick.memo"), 2u);
+    EXPECT_EQ(entries("pick.memo.hash"), 0u);
+
+    // The cache is memory the function writes, so calls may not be merged
+    llvm::Function* fib = mod->getFunction("fib");
+    EXPECT_EQ(fib->getEntryBlock().getName(), "memo.entry");
+    EXPECT_FALSE(fib->doesNotAccessMemory());
+    EXPECT_FALSE(mod->getFunction("main")->onlyAccessesInaccessibleMemory());
+
+    LLVMOptimizer().optimize(*mod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+}
+
+TEST(LLVMCodegenTest, MemoizedNarrowKeysFitTheirRange) {
+    auto irMod = lower("@Memoize fun g(x: Short): Int { return x.toInt() * 2 }\n"
+                       "@Memoize fun h(x: Byte): Int { return x.toInt() + 1 }\n"
+                       "@Memoize(1000) fun k(x: Short): Int { return x.toInt() - 1 }\n"
+                       "fun main() { print_i32(g(3.toShort()) + h(4.toByte()) + k(5.toShort())) }");
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    // The default 65536 entries hold every Short, and 256 every Byte, so
+    // neither needs a range check or a hashed table
+    auto entries = [&](const char* name) -> uint64_t {
+        llvm::GlobalVariable* table = mod->getGlobalVariable(name, true);
+        return table ? llvm::cast<llvm::ArrayType>(table->getValueType())->getNumElements() : 0;
+    };
+    EXPECT_EQ(entries("g.memo"), 65536u);
+    EXPECT_EQ(entries("g.memo.hash"), 0u);
+    EXPECT_EQ(entries("h.memo"), 256u);
+    EXPECT_EQ(entries("h.memo.hash"), 0u);
+    EXPECT_EQ(entries("k.memo"), 1000u);
+    EXPECT_EQ(entries("k.memo.hash"), 1024u);
+    auto rangeChecks = [&](const char* name) {
+        std::vector<uint64_t> bounds;
+        for (const llvm::Instruction& inst : llvm::instructions(*mod->getFunction(name))) {
+            auto cmp = llvm::dyn_cast<llvm::ICmpInst>(&inst);
+            if (!cmp || cmp->getPredicate() != llvm::CmpInst::ICMP_ULT) continue;
+            if (auto bound = llvm::dyn_cast<llvm::ConstantInt>(cmp->getOperand(1))) bounds.push_back(bound->getZExtValue());
+        }
+        return bounds;
+    };
+    EXPECT_TRUE(rangeChecks("g").empty());
+    EXPECT_TRUE(rangeChecks("h").empty());
+    EXPECT_EQ(rangeChecks("k").front(), 1000u);
+
+    LLVMOptimizer().optimize(*mod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+}
+
+TEST(LLVMCodegenTest, IntegerTypesLowerToTypedInstructions) {
+    auto irMod = lower("fun mix(a: UInt, b: Long, c: Byte): ULong {\n"
+                       "    val d: UInt = a % 10u\n"
+                       "    print_i64(b + c)\n"
+                       "    if (a > d) { return d.toULong() / 3u }\n"
+                       "    return b.toULong()\n"
+                       "}\n"
+                       "fun main() { print_u64(mix(7u, 5L, -1)) }");
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+
+    llvm::Function* mix = mod->getFunction("mix");
+    EXPECT_TRUE(mix->getReturnType()->isIntegerTy(64));
+    EXPECT_TRUE(mix->getArg(2)->getType()->isIntegerTy(8));
+    std::set<unsigned> opcodes;
+    std::set<llvm::CmpInst::Predicate> predicates;
+    for (llvm::Instruction& inst : llvm::instructions(mix)) {
+        opcodes.insert(inst.getOpcode());
+        if (auto cmp = llvm::dyn_cast<llvm::ICmpInst>(&inst)) predicates.insert(cmp->getPredicate());
+    }
+    EXPECT_TRUE(opcodes.count(llvm::Instruction::URem));
+    EXPECT_TRUE(opcodes.count(llvm::Instruction::UDiv));
+    EXPECT_TRUE(opcodes.count(llvm::Instruction::ZExt));
+    EXPECT_TRUE(opcodes.count(llvm::Instruction::SExt));
+    EXPECT_TRUE(predicates.count(llvm::CmpInst::ICMP_UGT));
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::interp;
+using namespace kotlin_lite::test;
+
+TEST(InterpreterTest, RecursionAndBuiltins) {
+    EXPECT_EQ(interpret("fun fib(n: Int): Int {\n"
+                         "    if (n <= 1) { return n }\n"
+                         "    return fib(n - 1) + fib(n - 2)\n"
+                         "}\n"
+                         "fun main() {\n"
+                         "    print_i32(fib(20))\n"
+                         "    print_bool(fib(5) == 5 && !(1 > 2))\n"
+                         "    print_i32(-7 / 2)\n"
+                         "    print_i32(-7 % 2)\n"
+                         "}"),
+              "6765\ntrue\n-3\n-1\n");
+}
+
+TEST(InterpreterTest, BenchmarkingBuiltins) {
+    // Arguments that are missing or not an Int give the fallback
+    EXPECT_EQ(interpret("fun main() {\n"
+                         "    val start = nanoTime()\n"
+                         "    var sum = 0\n"
+                         "    var i = 0\n"
+                         "    while (i < argInt(0, 10)) { sum = sum + i\n i = i + 1 }\n"
+                         "    blackhole(sum)\n"
+                         "    blackhole(sum.toByte())\n"
+                         "    print_i32(sum)\n"
+                         "    print_i32(argCount())\n"
+                         "    print_i32(argInt(1, -1) + argInt(2, -1) + argInt(5, -1) + 4)\n"
+                         "    blackhole(start)\n"
+                         "    print_bool(start > 0 && nanoTime() - start >= 0)\n"
+                         "}",
+                         {"5", "x", "2147483648"}),
+              "10\n3\n1\ntrue\n");
+}
+
+TEST(InterpreterTest, PhiSwapUsesParallelMoves) {
+    // a and b swap on the back edge, a cycle that needs the scratch register
+    EXPECT_EQ(interpret("fun main() {\n"
+                         "    var a = 1\n"
+                         "    var b = 2\n"
+                         "    var i = 0\n"
+                         "    while (i < 3) {\n"
+                         "        val t = a\n"
+                         "        a = b\n"
+                         "        b = t\n"
+                         "        i = i + 1\n"
+                         "    }\n"
+                         "    print_i32(a)\n"
+                         "    print_i32(b)\n"
+                         "}"),
+              "2\n1\n");
+}
+
+TEST(InterpreterTest, WrapsLikeNativeCode) {
+    EXPECT_EQ(interpret("fun main() {\n"
+                         "    var x = 2147483647\n"
+                         "    print_i32(x + 1)\n"
+                         "    print_i32(65536 * 65536)\n"
+                         "}"),
+              "-2147483648\n0\n");
+}
+
+TEST(InterpreterTest, CompareFusesIntoBranch) {
+    auto mod = lower("fun main() {\n"
+                     "    var i = 0\n"
+                     "    while (i < 10) { i = i + 1 }\n"
+                     "    print_i32(i)\n"
+                     "}");
+    BytecodeModule bc = lowerToBytecode(*mod);
+    std::string listing = bc.disassemble();
+    EXPECT_NE(listing.find("br.lt"), std::string::npos) << listing;
+    EXPECT_EQ(listing.find("cmp.lt"), std::string::npos) << listing;
+}
+
+TEST(InterpreterTest, DivisionByZeroIsARuntimeError) {
+    auto mod = lower("fun div(a: Int, b: Int): Int { return a / b }\n"
+                     "fun main() { print_i32(div(1, 0)) }");
+    Interpreter interpreter(lowerToBytecode(*mod));
+    EXPECT_THROW(interpreter.run(), std::runtime_error);
+}
+
+TEST(InterpreterTest, DeepRecursionOverflowsCleanly) {
+    auto mod = lower("fun down(n: Int): Int { return down(n + 1) + 1 }\n"
+                     "fun main() { print_i32(down(0)) }");
+    Interpreter interpreter(lowerToBytecode(*mod), stdout, 4096);
+    EXPECT_THROW(interpreter.run(), std::runtime_error);
+}
+
+TEST(InterpreterTest, LongUnsignedAndNarrowIntegers) {
+    EXPECT_EQ(interpret("fun sumTo(n: Long): Long {\n"
+                         "    var i = 0L\n"
+                         "    var sum = 0L\n"
+                         "    while (i < n) { sum = sum + i\n i = i + 1 }\n"
+                         "    return sum\n"
+                         "}\n"
+                         "fun half(x: UInt): UInt { return x / 2u }\n"
+                         "fun main() {\n"
+                         "    print_i64(sumTo(100000L))\n"
+                         "    val max: UInt = 4294967295u\n"
+                         "    print_u32(half(max))\n"
+                         "    print_u32(max % 10u)\n"
+                         "    print_bool(max > 1u)\n"
+                         "    print_u64((-1).toULong())\n"
+                         "    print_i64(max.toLong() + 1)\n"
+                         "    val b: Byte = 127\n"
+                         "    print_i32((b + 1).toByte().toInt())\n"
+                         "    val s: Short = -1\n"
+                         "    print_u32(s.toUInt())\n"
+                         "}"),
+              "4999950000\n2147483647\n5\ntrue\n18446744073709551615\n4294967296\n-128\n4294967295\n");
+}
+
+TEST(InterpreterTest, UnsignedDivisionByZeroIsARuntimeError) {
+    auto mod = lower("fun div(a: ULong, b: ULong): ULong { return a / b }\n"
+                     "fun main() { print_u64(div(1u, 0u)) }");
+    Interpreter interpreter(lowerToBytecode(*mod));
+    EXPECT_THROW(interpreter.run(), std::runtime_error);
+}
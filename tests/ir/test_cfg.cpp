@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "ir/cfg.hpp"
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+TEST(CFGTest, IfDominators) {
+    auto mod = lower("fun f(c: Boolean): Int {\n    var x = 1\n    if (c) { x = 2 } else { x = 3 }\n    return x\n}");
+    Function& func = *mod->functions[0];
+    CFG cfg(func);
+    BasicBlock* entry = func.blocks.front().get();
+    BasicBlock* thenBB = nullptr;
+    BasicBlock* mergeBB = nullptr;
+    for (const auto& bb : func.blocks) {
+        if (bb->label == "if.then") thenBB = bb.get();
+        if (bb->label == "if.merge") mergeBB = bb.get();
+    }
+    ASSERT_NE(mergeBB, nullptr);
+    EXPECT_EQ(cfg.idom(mergeBB), entry);
+    EXPECT_TRUE(cfg.dominates(entry, thenBB));
+    EXPECT_FALSE(cfg.dominates(thenBB, mergeBB));
+    EXPECT_EQ(cfg.predecessors(mergeBB).size(), 2);
+}
+
+TEST(CFGTest, LoopDepth) {
+    auto mod = lower("fun main() {\n"
+                     "    var i = 0\n"
+                     "    while (i < 10) {\n"
+                     "        var j = 0\n"
+                     "        while (j < 10) { j = j + 1 }\n"
+                     "        i = i + 1\n"
+                     "    }\n"
+                     "}");
+    Function& func = *mod->functions[0];
+    CFG cfg(func);
+    LoopInfo loops(func, cfg);
+    ASSERT_EQ(loops.loops().size(), 2);
+    ASSERT_EQ(loops.topLevelLoops().size(), 1);
+    int maxDepth = 0;
+    for (const auto& bb : func.blocks) maxDepth = std::max(maxDepth, loops.loopDepth(bb.get()));
+    EXPECT_EQ(maxDepth, 2);
+    EXPECT_EQ(loops.loopDepth(func.blocks.front().get()), 0);
+}
@@ -2,6 +2,7 @@
 #include "lexer/lexer.hpp"
 #include "parser/parser.hpp"
 #include "ir/ir_generator.hpp"
+#include "ir/statistics.hpp"
 
 using namespace kotlin_lite;
 using namespace kotlin_lite::ir;
@@ -50,3 +51,68 @@ TEST(IRGeneratorTest, ShortCircuitAnd) {
     // Relax expectations to see what's actually generated
     EXPECT_NE(output.find("phi i1"), std::string::npos);
 }
+
+TEST(IRGeneratorTest, SourcePositions) {
+    std::string source = "fun test(n: Int): Int {\n    var s = 0\n    while (s < n) {\n        s = s + 2\n    }\n    return s\n}";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    IRGenerator generator;
+    auto mod = generator.generate(*file);
+    Function* func = mod->getFunction("test");
+    EXPECT_EQ(func->line, 1);
+
+    // Operators carry their token's position; loop phis and edges that of the `while`
+    Instruction* add = nullptr;
+    Instruction* phi = nullptr;
+    for (const auto& bb : func->blocks) {
+        for (const auto& inst : bb->instructions) {
+            EXPECT_NE(inst->line, 0) << inst->dump();
+            if (inst->kind == Instruction::OpKind::Add) add = inst.get();
+            if (inst->kind == Instruction::OpKind::Phi && inst->variable == "s") phi = inst.get();
+        }
+    }
+    ASSERT_TRUE(add && phi);
+    EXPECT_EQ(add->line, 4);
+    EXPECT_EQ(add->variable, "s");
+    EXPECT_EQ(phi->line, 3);
+    EXPECT_EQ(phi->column, 5);
+    EXPECT_EQ(func->blocks.back()->getTerminator()->line, 6);
+}
+
+TEST(IRGeneratorTest, CountsStatisticsOnlyWhileEnabled) {
+    std::string source = "fun test(c: Boolean): Int {\n    var x = 10\n    if (c) {\n        x = 20\n    }\n    return x\n}";
+    auto lowerSource = [&] {
+        Lexer lexer(source);
+        Parser parser(lexer.tokenize());
+        auto file = parser.parse();
+        return IRGenerator().generate(*file);
+    };
+    auto value = [](const std::string& key) -> uint64_t {
+        for (Statistic* stat : allStatistics()) {
+            if (std::string(stat->pass()) + "." + stat->name() == key) return stat->value();
+        }
+        ADD_FAILURE() << "no statistic " << key;
+        return 0;
+    };
+
+    resetStatistics();
+    lowerSource();
+    EXPECT_EQ(value("irgen.FunctionsLowered"), 0u);
+
+    Statistic::enable();
+    auto mod = lowerSource();
+    recordIRSize(*mod, false);
+    Statistic::enable(false);
+    EXPECT_EQ(value("irgen.FunctionsLowered"), 1u);
+    EXPECT_EQ(value("irgen.IfBlocks"), 3u);
+    EXPECT_EQ(value("irgen.MergePhis"), 1u);
+    EXPECT_EQ(value("ir-size.FunctionsBeforeOpt"), 1u);
+
+    EXPECT_NE(formatStatistics().find("irgen - Phis created by phiMerge"), std::string::npos);
+    std::string json = formatStatisticsJSON();
+    EXPECT_NE(json.find("\"irgen.MergePhis\": 1"), std::string::npos) << json;
+    EXPECT_NE(json.find("\"loop-fusion.FusedLoops\": 0"), std::string::npos) << json;
+    resetStatistics();
+}
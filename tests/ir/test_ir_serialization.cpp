@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "ir/ir_parser.hpp"
+#include "ir/ir_serializer.hpp"
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+static const char* kProgram =
+    "fun sum(n: Int): Int {\n"
+    "    var i = 0\n"
+    "    var acc = 0\n"
+    "    while (i < n) {\n"
+    "        if (i % 3 == 0 && i != 9) { acc = acc + i } else { acc = acc - 1 }\n"
+    "        i = i + 1\n"
+    "    }\n"
+    "    return acc\n"
+    "}\n"
+    "fun main() {\n"
+    "    print_i32(sum(-20))\n"
+    "    print_bool(!(sum(5) > 2))\n"
+    "}";
+
+TEST(IRSerializationTest, TextRoundTrip) {
+    auto mod = lower(kProgram);
+    std::string text = mod->dump();
+    auto parsed = IRParser(text).parse();
+    EXPECT_EQ(parsed->dump(), text);
+    ASSERT_NE(parsed->getFunction("sum"), nullptr);
+    EXPECT_EQ(parsed->getFunction("sum")->instructionCount(), mod->getFunction("sum")->instructionCount());
+}
+
+TEST(IRSerializationTest, BinaryRoundTrip) {
+    auto mod = lower(kProgram);
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    ASSERT_TRUE(isBinaryIR(bytes.data(), bytes.size()));
+    auto loaded = readBinary(bytes.data(), bytes.size());
+    EXPECT_EQ(loaded->dump(), mod->dump());
+    // Writing the loaded module again gives the same bytes
+    EXPECT_EQ(writeBinary(*loaded), bytes);
+}
+
+TEST(IRSerializationTest, ParsesForwardReferencesAndFunctionOperands) {
+    auto mod = IRParser("define i32 @count(i32 %n) {\n"
+                        "entry:\n"
+                        "  br label %loop\n"
+                        "loop:\n"
+                        "  %1 = phi i32 [ 0, %entry ], [ %2, %loop ]\n"
+                        "  %2 = add i32 %1, 1\n"
+                        "  %3 = icmp lt i32 %2, %n\n"
+                        "  condbr i1 %3, label %loop, label %exit\n"
+                        "exit:\n"
+                        "  call void @use(i32 @count)\n"
+                        "  ret i32 -7\n"
+                        "}\n"
+                        "define void @use(i32 %f) {\n"
+                        "entry:\n"
+                        "  ret void\n"
+                        "}\n").parse();
+    Function* func = mod->getFunction("count");
+    ASSERT_NE(func, nullptr);
+    auto phi = static_cast<PhiInst*>(std::next(func->blocks.begin())->get()->instructions.front().get());
+    ASSERT_EQ(phi->kind, Instruction::OpKind::Phi);
+    for (const auto& [bb, val] : phi->incomings) {
+        if (bb->label == "loop") {
+            EXPECT_EQ(val->getName(), "%2");
+        }
+    }
+    auto call = static_cast<CallInst*>(func->blocks.back()->instructions.front().get());
+    EXPECT_EQ(call->args[0], func);
+
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    EXPECT_EQ(readBinary(bytes.data(), bytes.size())->dump(), mod->dump());
+}
+
+TEST(IRSerializationTest, ParseErrorsReportLine) {
+    try {
+        IRParser("define i32 @f() {\nentry:\n  %0 = frob i32 1, 2\n  ret i32 %0\n}\n").parse();
+        FAIL() << "expected a parse error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("line 3"), std::string::npos) << e.what();
+    }
+    EXPECT_THROW(IRParser("define i32 @f() {\nentry:\n  ret i32 %9\n}\n").parse(), std::runtime_error);
+}
+
+TEST(IRSerializationTest, RejectsOtherVersions) {
+    auto mod = lower("fun main() { print_i32(1) }");
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    bytes[4] = 99;
+    EXPECT_THROW(readBinary(bytes.data(), bytes.size()), std::runtime_error);
+    bytes.resize(16);
+    EXPECT_THROW(readBinary(bytes.data(), bytes.size()), std::runtime_error);
+}
+
+TEST(IRSerializationTest, AnnotationsRoundTrip) {
+    auto mod = lower("@NoInline @Cold fun f(n: Int): Int {\n"
+                     "    var i = 0\n"
+                     "    @Unroll(4) @Vectorize while (i < n) { i = i + 1 }\n"
+                     "    @Likely if (i > 0) { return i }\n"
+                     "    return 0\n"
+                     "}\n"
+                     "tailrec fun g(n: Int): Int { if (n <= 0) { return n }\n return g(n - 1) }\n"
+                     "fun main() { print_i32(f(3) + g(3)) }");
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("define i32 @f(i32 %n) noinline cold {"), std::string::npos) << text;
+    EXPECT_NE(text.find("define i32 @g(i32 %n) tailrec {"), std::string::npos) << text;
+    EXPECT_NE(text.find("while.header: unroll(4) vectorize\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("weights(2000, 1)"), std::string::npos) << text;
+
+    EXPECT_EQ(IRParser(text).parse()->dump(), text);
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    EXPECT_EQ(readBinary(bytes.data(), bytes.size())->dump(), text);
+
+    EXPECT_THROW(IRParser("define void @f() alwaysinline noinline {\nentry:\n  ret void\n}\n").parse(), std::runtime_error);
+    EXPECT_THROW(IRParser("define void @f() {\nentry: unroll(0)\n  ret void\n}\n").parse(), std::runtime_error);
+}
+
+TEST(IRSerializationTest, MemoizeRoundTrips) {
+    auto mod = lower("@Memoize fun f(n: Int): Int { return n * n }\n"
+                     "@Memoize(100) fun g(a: Int, b: Boolean): Int { return f(a) }\n"
+                     "fun main() { print_i32(g(3, true)) }");
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("define i32 @f(i32 %n) memoize {"), std::string::npos) << text;
+    EXPECT_NE(text.find("define i32 @g(i32 %a, i1 %b) memoize(100) {"), std::string::npos) << text;
+
+    EXPECT_EQ(IRParser(text).parse()->dump(), text);
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    EXPECT_EQ(readBinary(bytes.data(), bytes.size())->dump(), text);
+    EXPECT_EQ(mod->getFunction("g")->clone("g.copy")->memoize, 100u);
+
+    EXPECT_THROW(IRParser("define i32 @f() memoize(0) {\nentry:\n  ret i32 0\n}\n").parse(), std::runtime_error);
+}
+
+TEST(IRSerializationTest, WideIntegersCastsAndUnsignedOpsRoundTrip) {
+    const char* text = "define i64 @f(i32 %x, i8 %b) {\n"
+                       "entry:\n"
+                       "  %0 = zext i32 %x to i64\n"
+                       "  %1 = sext i8 %b to i64\n"
+                       "  %2 = udiv i64 %0, 3\n"
+                       "  %3 = urem i64 %2, %1\n"
+                       "  %4 = lshr i64 %3, 1\n"
+                       "  %5 = icmp ult i64 %4, -1\n"
+                       "  %6 = trunc i64 %4 to i16\n"
+                       "  condbr i1 %5, label %small, label %large\n"
+                       "small:\n"
+                       "  ret i64 9223372036854775807\n"
+                       "large:\n"
+                       "  ret i64 %4\n"
+                       "}\n\n";
+    auto mod = IRParser(text).parse();
+    EXPECT_EQ(mod->dump(), text);
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    EXPECT_EQ(readBinary(bytes.data(), bytes.size())->dump(), text);
+
+    EXPECT_THROW(IRParser("define i32 @f(i64 %x) {\nentry:\n  %0 = zext i64 %x to i32\n  ret i32 %0\n}\n").parse(),
+                 std::runtime_error);
+    EXPECT_THROW(IRParser("define i8 @f() {\nentry:\n  ret i8 300\n}\n").parse(), std::runtime_error);
+}
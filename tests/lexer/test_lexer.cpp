@@ -57,3 +57,22 @@ TEST(LexerTest, Comments) {
     ASSERT_EQ(tokens.size(), 5); // val, x, =, 1, EOF
     EXPECT_EQ(tokens[0].type, TokenType::VAL);
 }
+
+TEST(LexerTest, IntegerLiteralSuffixes) {
+    Lexer lexer("5L 7u 9uL");
+    auto tokens = lexer.tokenize();
+    ASSERT_EQ(tokens.size(), 4u);
+    EXPECT_EQ(tokens[0].type, TokenType::INTEGER);
+    EXPECT_EQ(tokens[0].value, "5L");
+    EXPECT_EQ(tokens[1].value, "7u");
+    EXPECT_EQ(tokens[2].value, "9uL");
+
+    IntegerLiteral isLong = parseIntegerLiteral("5L");
+    EXPECT_TRUE(isLong.isLong);
+    EXPECT_FALSE(isLong.isUnsigned);
+    IntegerLiteral max = parseIntegerLiteral("18446744073709551615uL");
+    EXPECT_EQ(max.value, UINT64_MAX);
+    EXPECT_TRUE(max.isUnsigned && max.isLong && !max.overflow);
+    EXPECT_TRUE(parseIntegerLiteral("18446744073709551616u").overflow);
+    EXPECT_EQ(parseIntegerLiteral("3000000000").value, 3000000000u);
+}
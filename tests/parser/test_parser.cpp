@@ -51,3 +51,62 @@ TEST(ParserTest, ExpressionPrecedence) {
     ASSERT_NE(rightBinary, nullptr);
     EXPECT_EQ(rightBinary->op.type, TokenType::STAR);
 }
+
+TEST(ParserTest, TailrecModifier) {
+    std::string source = "tailrec fun loop(n: Int): Int { return loop(n) }\nfun main() {}";
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(std::move(tokens));
+    auto file = parser.parse();
+
+    ASSERT_EQ(file->functions.size(), 2);
+    EXPECT_TRUE(file->functions[0]->is_tailrec);
+    EXPECT_FALSE(file->functions[1]->is_tailrec);
+}
+
+TEST(ParserTest, ConstVal) {
+    std::string source = "const val LIMIT: Int = 10 * 2\nfun main() {}";
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(std::move(tokens));
+    auto file = parser.parse();
+
+    ASSERT_EQ(file->constants.size(), 1);
+    ASSERT_EQ(file->functions.size(), 1);
+    EXPECT_EQ(file->constants[0]->name.value, "LIMIT");
+    EXPECT_EQ(file->constants[0]->type, "Int");
+    EXPECT_NE(dynamic_cast<BinaryExpr*>(file->constants[0]->initializer.get()), nullptr);
+}
+
+TEST(ParserTest, Annotations) {
+    std::string source = "@AlwaysInline @Cold tailrec fun f(n: Int): Int { return n }\n"
+                         "fun main() {\n"
+                         "    @Unroll(4) @Vectorize while (true) { }\n"
+                         "    @Unlikely if (false) { }\n"
+                         "}";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    ASSERT_EQ(file->functions.size(), 2);
+    const auto& annotations = file->functions[0]->annotations;
+    ASSERT_EQ(annotations.size(), 2);
+    EXPECT_EQ(annotations[0].name.value, "AlwaysInline");
+    EXPECT_EQ(annotations[1].name.value, "Cold");
+    EXPECT_TRUE(file->functions[0]->is_tailrec);
+
+    const auto& body = file->functions[1]->body->statements;
+    auto* loop = dynamic_cast<WhileStmt*>(body[0].get());
+    ASSERT_NE(loop, nullptr);
+    ASSERT_EQ(loop->annotations.size(), 2);
+    ASSERT_EQ(loop->annotations[0].arguments.size(), 1);
+    EXPECT_EQ(loop->annotations[0].arguments[0].value, "4");
+    EXPECT_TRUE(loop->annotations[1].arguments.empty());
+    auto* branch = dynamic_cast<IfStmt*>(body[1].get());
+    ASSERT_NE(branch, nullptr);
+    ASSERT_EQ(branch->annotations.size(), 1);
+    EXPECT_EQ(branch->annotations[0].name.value, "Unlikely");
+
+    Lexer misplaced("fun main() { @Likely val x = 1 }");
+    EXPECT_THROW(Parser(misplaced.tokenize()).parse(), std::runtime_error);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "pipeline/autotuner.hpp"
+#include <stdexcept>
+
+using namespace kotlin_lite;
+
+static Summary seconds(double median) {
+    Summary s;
+    s.median = s.low = s.high = median;
+    return s;
+}
+
+TEST(AutotunerTest, TuningRoundTripsAndRejectsMalformedInput) {
+    Tuning tuning;
+    tuning.pipeline = "O2";
+    tuning.unrollCount = 4;
+    tuning.slpVectorization = false;
+    tuning.disabledPasses = {"loop-fusion", "ipcp"};
+    tuning.sourceHash = 0x1a2b;
+    tuning.note = "prime.kt: 0.4 s";
+    std::string text = tuning.format();
+    EXPECT_EQ(Tuning::parse(text).format(), text);
+    EXPECT_EQ(tuning.describe(), "pipeline=O2 unroll-count=4 slp-vectorize=0 disable-pass=ipcp disable-pass=loop-fusion");
+    EXPECT_EQ(Tuning().describe(), "defaults");
+    EXPECT_EQ(Tuning::defaultPath("benchmarks/prime.kt"), "benchmarks/prime.kltune");
+
+    EXPECT_THROW(Tuning::parse("pipeline O3\n"), std::runtime_error);
+    EXPECT_THROW(Tuning::parse("kotlin-lite tuning 1\npipeline O9\n"), std::runtime_error);
+    EXPECT_THROW(Tuning::parse("kotlin-lite tuning 1\nunroll-count -2\n"), std::runtime_error);
+    EXPECT_THROW(Tuning::parse("kotlin-lite tuning 1\ndisable-pass auto-parallel\n"), std::runtime_error);
+    EXPECT_THROW(Tuning::parse("kotlin-lite tuning 1\ndisable-pass tailrec\n"), std::runtime_error);
+    EXPECT_THROW(Tuning::parse("kotlin-lite tuning 1\nvectorise 4\n"), std::runtime_error);
+}
+
+TEST(AutotunerTest, CoordinateDescentFindsTheFastestSettings) {
+    // Each of these settings saves time independently; everything else is noise-level
+    auto cost = [](const Tuning& t) {
+        double time = 1.0;
+        if (t.pipeline == "O2") time -= 0.10;
+        if (t.vectorWidth == 4) time -= 0.20;
+        if (!t.passEnabled("loop-fusion")) time -= 0.05;
+        if (t.inlineThreshold == 100) time += 0.004;
+        return time;
+    };
+    Autotuner::Options options;
+    options.maxTrials = 1000;
+    Autotuner tuner(options, [&](const Tuning& t) { return std::optional<Summary>(seconds(cost(t))); });
+    std::optional<Tuning> best = tuner.run();
+    ASSERT_TRUE(best);
+    EXPECT_EQ(best->describe(), "pipeline=O2 vector-width=4 disable-pass=loop-fusion");
+    EXPECT_EQ(tuner.getTrials().front().tuning.describe(), "defaults");
+
+    // Every configuration is built once
+    std::set<std::string> seen;
+    for (const auto& trial : tuner.getTrials()) EXPECT_TRUE(seen.insert(trial.tuning.format()).second);
+}
+
+TEST(AutotunerTest, FailuresNoiseAndBudget) {
+    Autotuner::Options options;
+    options.maxTrials = 6;
+    int calls = 0;
+    Autotuner tuner(options, [&](const Tuning& t) -> std::optional<Summary> {
+        ++calls;
+        // A broken build looks fastest but never wins; a gain inside the noise does not count
+        if (t.pipeline == "O2") return std::nullopt;
+        Summary s = seconds(t.pipeline == "Os" ? 0.97 : 1.0);
+        s.mad = 0.02;
+        return s;
+    });
+    std::optional<Tuning> best = tuner.run();
+    ASSERT_TRUE(best);
+    EXPECT_EQ(best->describe(), "defaults");
+    EXPECT_EQ(calls, 6);
+    EXPECT_EQ(tuner.getTrials().size(), 6u);
+    EXPECT_FALSE(tuner.getTrials()[1].time);
+
+    Autotuner broken(options, [](const Tuning&) { return std::optional<Summary>(); });
+    EXPECT_FALSE(broken.run());
+    EXPECT_EQ(broken.getTrials().size(), 1u);
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include "pipeline/program_runner.hpp"
+#include <algorithm>
+#include <random>
+
+using namespace kotlin_lite;
+
+TEST(ProgramRunnerTest, MedianOfOddAndEvenCounts) {
+    EXPECT_DOUBLE_EQ(median({5, 1, 3}), 3);
+    EXPECT_DOUBLE_EQ(median({4, 1, 3, 2}), 2.5);
+    EXPECT_DOUBLE_EQ(median({7}), 7);
+    EXPECT_DOUBLE_EQ(median({}), 0);
+}
+
+TEST(ProgramRunnerTest, SummaryOfKnownSamples) {
+    // Deviations from the median 2 are {1, 1, 0, 0, 2, 4, 7}
+    Summary s = summarize({1, 1, 2, 2, 4, 6, 9});
+    EXPECT_DOUBLE_EQ(s.median, 2);
+    EXPECT_DOUBLE_EQ(s.mad, 1);
+
+    Summary even = summarize({10, 40, 20, 30});
+    EXPECT_DOUBLE_EQ(even.median, 25);
+    EXPECT_DOUBLE_EQ(even.mad, 10);
+}
+
+TEST(ProgramRunnerTest, ConfidenceIntervalRanksStayInRange) {
+    // With so few runs the ranks fall outside the samples and clamp to them
+    Summary one = summarize({3});
+    EXPECT_DOUBLE_EQ(one.low, 3);
+    EXPECT_DOUBLE_EQ(one.high, 3);
+    Summary two = summarize({8, 2});
+    EXPECT_DOUBLE_EQ(two.low, 2);
+    EXPECT_DOUBLE_EQ(two.high, 8);
+    Summary five = summarize({5, 3, 1, 4, 2});
+    EXPECT_DOUBLE_EQ(five.low, 1);
+    EXPECT_DOUBLE_EQ(five.high, 5);
+
+    // n = 100: ranks floor(50 - 9.8) and ceil(50 + 9.8)
+    std::vector<double> samples;
+    for (int i = 0; i < 100; i++) samples.push_back(i);
+    std::shuffle(samples.begin(), samples.end(), std::mt19937(42));
+    Summary hundred = summarize(samples);
+    EXPECT_DOUBLE_EQ(hundred.median, 49.5);
+    EXPECT_DOUBLE_EQ(hundred.low, 40);
+    EXPECT_DOUBLE_EQ(hundred.high, 60);
+}
+
+TEST(ProgramRunnerTest, EmptySamplesSummarizeToZero) {
+    Summary s = summarize({});
+    EXPECT_DOUBLE_EQ(s.median, 0);
+    EXPECT_DOUBLE_EQ(s.mad, 0);
+    EXPECT_DOUBLE_EQ(s.low, 0);
+    EXPECT_DOUBLE_EQ(s.high, 0);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "parser/declaration_stream.hpp"
+#include "pipeline/bounded_queue.hpp"
+#include "pipeline/streaming_compiler.hpp"
+#include <llvm/IR/Verifier.h>
+#include <thread>
+
+using namespace kotlin_lite;
+
+static const char* kProgram =
+    "const val LIMIT = 3 * 4\n"
+    "fun main() {\n"
+    "    print_i32(sum(LIMIT))\n"
+    "    print_bool(isEven(LIMIT))\n"
+    "}\n"
+    "tailrec fun count(n: Int, acc: Int): Int {\n"
+    "    if (n == 0) { return acc }\n"
+    "    return count(n - 1, acc + 1)\n"
+    "}\n"
+    "fun sum(n: Int): Int {\n"
+    "    var i = 0\n"
+    "    var s = 0\n"
+    "    while (i < n) { s = s + (i + 1) * 2\n i = i + 1 }\n"
+    "    return s + count(n, 0)\n"
+    "}\n"
+    "fun isEven(n: Int): Boolean { return n % 2 == 0 }\n";
+
+TEST(StreamingTest, SplitsTopLevelDeclarations) {
+    DeclarationStream stream(kProgram);
+    std::vector<std::vector<Token>> chunks;
+    while (auto tokens = stream.next()) chunks.push_back(std::move(*tokens));
+    ASSERT_EQ(chunks.size(), 5u);
+    EXPECT_EQ(chunks[0].front().type, TokenType::CONST);
+    EXPECT_EQ(chunks[0].size(), 8u);  // const val LIMIT = 3 * 4 EOF
+    EXPECT_EQ(chunks[2].front().type, TokenType::TAILREC);
+    EXPECT_EQ(chunks[2][2].value, "count");
+    EXPECT_EQ(chunks[4].front().line, 17);
+    for (const auto& chunk : chunks) EXPECT_EQ(chunk.back().type, TokenType::EOF_TOKEN);
+}
+
+TEST(StreamingTest, BoundedQueueBlocksProducerAndDrainsOnClose) {
+    BoundedQueue<int> queue(2);
+    std::thread producer([&] {
+        for (int i = 0; i < 100; ++i) ASSERT_TRUE(queue.push(i));
+        queue.close();
+    });
+    int expected = 0;
+    while (auto item = queue.pop()) EXPECT_EQ(*item, expected++);
+    producer.join();
+    EXPECT_EQ(expected, 100);
+    EXPECT_LE(queue.highWater(), 2u);
+    EXPECT_FALSE(queue.push(1));
+}
+
+TEST(StreamingTest, CompilesOneFunctionAtATime) {
+    StreamingCompiler::Options options;
+    options.queueCapacity = 1;
+    options.codegen.wholeProgram = true;
+    StreamingCompiler compiler(options);
+    auto mod = compiler.compile(kProgram);
+    ASSERT_NE(mod, nullptr) << (compiler.getErrors().empty() ? compiler.getUnsupported() : compiler.getErrors().front());
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+    EXPECT_EQ(compiler.getStatistics().functions, 4);
+    EXPECT_LE(compiler.getStatistics().maxQueuedFunctions, 1u);
+
+    ASSERT_NE(mod->getFunction("sum"), nullptr);
+    EXPECT_FALSE(mod->getFunction("sum")->isDeclaration());
+    EXPECT_TRUE(mod->getFunction("sum")->hasInternalLinkage());
+    // The constant was substituted, not called
+    EXPECT_EQ(mod->getFunction("const.LIMIT"), nullptr);
+}
+
+TEST(StreamingTest, ReportsErrorsAndUnsupportedConstants) {
+    StreamingCompiler compiler({});
+    EXPECT_EQ(compiler.compile("fun main() { print_i32(f(true)) }\nfun f(x: Int): Int { return x }\n"), nullptr);
+    ASSERT_FALSE(compiler.getErrors().empty());
+
+    // A constant computed by a user function needs the whole-file pipeline
+    EXPECT_EQ(compiler.compile("fun three(): Int { return 3 }\nconst val X = three()\nfun main() { print_i32(X) }\n"), nullptr);
+    EXPECT_TRUE(compiler.getErrors().empty());
+    EXPECT_FALSE(compiler.getUnsupported().empty());
+
+    EXPECT_THROW(compiler.compile("fun main() { print_i32(1 }\n"), std::runtime_error);
+}
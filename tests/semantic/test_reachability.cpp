@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include "lexer/lexer.hpp"
+#include "parser/parser.hpp"
+#include "semantic/reachability.hpp"
+#include "ir/ir_generator.hpp"
+
+using namespace kotlin_lite;
+
+static const char* kLibrary =
+    "fun used(x: Int): Int { return helper(x) + 1 }\n"
+    "fun helper(x: Int): Int { return x * 2 }\n"
+    "fun unused(x: Int): Int { return orphan(x) }\n"
+    "fun orphan(x: Int): Int { return unused(x - 1) }\n"
+    "fun api(x: Int): Int { return x }\n"
+    "fun main() { print_i32(used(3)) }";
+
+TEST(ReachabilityTest, OnlyReachableFromMainAreLive) {
+    Lexer lexer(kLibrary);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    ReachabilityAnalysis reachability;
+    reachability.analyze(*file, {"main"});
+    EXPECT_EQ(reachability.getLiveFunctions(), (std::set<std::string>{"main", "used", "helper"}));
+
+    const auto& dead = reachability.getDeadFunctions();
+    ASSERT_EQ(dead.size(), 3);
+    EXPECT_EQ(dead[0]->name.value, "unused");
+    EXPECT_EQ(dead[1]->name.value, "orphan");
+    EXPECT_EQ(dead[2]->name.value, "api");
+}
+
+TEST(ReachabilityTest, ExportedFunctionsAreRoots) {
+    Lexer lexer(kLibrary);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    ReachabilityAnalysis reachability;
+    reachability.analyze(*file, {"main", "api", "missing"});
+    EXPECT_TRUE(reachability.getLiveFunctions().count("api"));
+    EXPECT_FALSE(reachability.getLiveFunctions().count("missing"));
+    EXPECT_EQ(reachability.getDeadFunctions().size(), 2);
+
+    ir::IRGenerator generator;
+    auto mod = generator.generate(*file, &reachability.getLiveFunctions());
+    EXPECT_EQ(mod->functions.size(), 4);
+    EXPECT_EQ(mod->getFunction("orphan"), nullptr);
+}
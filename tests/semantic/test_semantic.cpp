@@ -87,3 +87,153 @@ TEST(SemanticTest, ReturnTypeMismatch) {
     ASSERT_FALSE(analyzer.getErrors().empty());
     EXPECT_NE(analyzer.getErrors()[0].find("Return type mismatch"), std::string::npos);
 }
+
+TEST(SemanticTest, TailrecWithoutTailCall) {
+    std::string source = "tailrec fun f(n: Int): Int {\n    if (n <= 0) { return 0 }\n    return f(n - 1) + 1\n}";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+    
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(*file);
+    
+    ASSERT_EQ(analyzer.getErrors().size(), 1);
+    EXPECT_NE(analyzer.getErrors()[0].find("marked 'tailrec' but contains no tail calls"), std::string::npos);
+}
+
+TEST(SemanticTest, TailrecWithTailCall) {
+    std::string source = "tailrec fun f(n: Int, acc: Int): Int {\n    if (n <= 0) { return acc }\n    return f(n - 1, acc + 1)\n}";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+    
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(*file);
+    
+    EXPECT_TRUE(analyzer.getErrors().empty());
+}
+
+TEST(SemanticTest, ConstValIsGlobalAndReadOnly) {
+    std::string source = "const val N = 3\nconst val M: Boolean = 4\nfun main() {\n    N = 4\n    print_i32(N)\n}";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+    
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(*file);
+    
+    ASSERT_EQ(analyzer.getErrors().size(), 2);
+    EXPECT_NE(analyzer.getErrors()[0].find("Type mismatch: declared Boolean"), std::string::npos);
+    EXPECT_NE(analyzer.getErrors()[1].find("Cannot reassign 'val' variable 'N'"), std::string::npos);
+}
+
+TEST(SemanticTest, AnnotationsAreChecked) {
+    std::string source = "@AlwaysInline @NoInline @Unroll\n"
+                         "fun f(x: Int): Int {\n"
+                         "    @Vectorize(3) @Likely while (x < 0) { }\n"
+                         "    @Unroll(0) @Vectorize(8) while (x < 0) { }\n"
+                         "    @Likely if (x > 0) { return 1 }\n"
+                         "    return x\n"
+                         "}\n"
+                         "@Hot(2) @Fast\n"
+                         "fun main() { print_i32(f(1)) }";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(*file);
+
+    const auto& errors = analyzer.getErrors();
+    ASSERT_EQ(errors.size(), 7);
+    EXPECT_NE(errors[0].find("'@NoInline' conflicts with '@AlwaysInline'"), std::string::npos);
+    EXPECT_NE(errors[1].find("'@Unroll' does not apply to a function"), std::string::npos);
+    EXPECT_NE(errors[2].find("Vector width must be a power of two"), std::string::npos);
+    EXPECT_NE(errors[3].find("'@Likely' does not apply to a 'while' loop"), std::string::npos);
+    EXPECT_NE(errors[4].find("Unroll count must be between 1 and 1024"), std::string::npos);
+    EXPECT_NE(errors[5].find("'@Hot' takes no arguments"), std::string::npos);
+    EXPECT_NE(errors[6].find("Unknown annotation '@Fast'"), std::string::npos);
+}
+
+TEST(SemanticTest, MemoizedFunctionsMustBePure) {
+    std::string source = "fun log(x: Int): Int { print_i32(x)\n return x }\n"
+                         "fun twice(x: Int): Int { return log(x) * 2 }\n"
+                         "@Memoize fun ok(x: Int, y: Int): Int { return x * y }\n"
+                         "@Memoize fun traced(x: Int): Int { return twice(x) + ok(x, x) }\n"
+                         "@Memoize fun timed(x: Int): Int { return nanoTime().toInt() - x }\n"
+                         "@Memoize(0) fun unit(x: Int) { }\n"
+                         "fun main() { print_i32(traced(ok(1, 2))) }";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(*file);
+
+    const auto& errors = analyzer.getErrors();
+    ASSERT_EQ(errors.size(), 4);
+    EXPECT_NE(errors[0].find("Memoize capacity must be between 1 and"), std::string::npos);
+    EXPECT_NE(errors[1].find("A '@Memoize' function must return a value"), std::string::npos);
+    EXPECT_NE(errors[2].find("'traced' is marked '@Memoize' but is not pure: it calls 'twice', which is not pure"),
+              std::string::npos);
+    EXPECT_NE(errors[3].find("'timed' is marked '@Memoize' but is not pure: it calls 'nanoTime'"), std::string::npos);
+}
+
+TEST(SemanticTest, IntegerTypesConvertExplicitly) {
+    std::string source = "fun main() {\n"
+                         "    val big: Long = 3000000000\n"
+                         "    val small: Byte = -128\n"
+                         "    val mask: UInt = 255u\n"
+                         "    val wide: ULong = 1u\n"
+                         "    print_i64(big + small)\n"
+                         "    print_i64(big + 1)\n"
+                         "    print_u64(wide * mask)\n"
+                         "    print_i32(mask.toInt() + small.toInt())\n"
+                         "    print_i32(big + 1)\n"
+                         "    print_u32(mask + 1)\n"
+                         "    val tooBig: Byte = 200\n"
+                         "    print_u32(-mask)\n"
+                         "    print_bool(mask == 255)\n"
+                         "    print_i32(5000000000u)\n"
+                         "    print_i32(true.toInt())\n"
+                         "}";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(*file);
+
+    const auto& errors = analyzer.getErrors();
+    ASSERT_EQ(errors.size(), 7);
+    EXPECT_NE(errors[0].find("Argument 1 of 'print_i32'"), std::string::npos) << errors[0];
+    EXPECT_NE(errors[1].find("Arithmetic operators cannot combine UInt and Int"), std::string::npos) << errors[1];
+    EXPECT_NE(errors[2].find("declared Byte but initialized with Int"), std::string::npos) << errors[2];
+    EXPECT_NE(errors[3].find("Unary minus requires a signed integer operand, got UInt"), std::string::npos) << errors[3];
+    EXPECT_NE(errors[4].find("Equality operators require operands of the same type"), std::string::npos) << errors[4];
+    EXPECT_NE(errors[5].find("Argument 1 of 'print_i32'"), std::string::npos) << errors[5];
+    EXPECT_NE(errors[6].find("Conversion 'toInt' requires an integer operand, got Boolean"), std::string::npos) << errors[6];
+}
+
+TEST(SemanticTest, BlackholeTakesAnyInteger) {
+    std::string source = "fun main() {\n"
+                         "    val start: Long = nanoTime()\n"
+                         "    blackhole(start)\n"
+                         "    blackhole(3.toByte())\n"
+                         "    blackhole(7u)\n"
+                         "    blackhole(nanoTime() - start)\n"
+                         "    blackhole(true)\n"
+                         "    val late: Int = nanoTime()\n"
+                         "}";
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(*file);
+
+    const auto& errors = analyzer.getErrors();
+    ASSERT_EQ(errors.size(), 2);
+    EXPECT_NE(errors[0].find("Argument 1 of 'blackhole' expects an integer, but got Boolean"), std::string::npos) << errors[0];
+    EXPECT_NE(errors[1].find("declared Int but initialized with Long"), std::string::npos) << errors[1];
+}
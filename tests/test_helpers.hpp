@@ -0,0 +1,53 @@
+#pragma once
+#include "lexer/lexer.hpp"
+#include "parser/parser.hpp"
+#include "ir/ir_generator.hpp"
+#include "ir/remarks.hpp"
+#include "interp/interpreter.hpp"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fixtures shared by the unit tests: compiling Kotlin source to custom IR,
+// running IR on the interpreter and looking up optimization remarks.
+
+namespace kotlin_lite {
+namespace test {
+
+// Lexes, parses and lowers `source`, without semantic analysis
+inline std::unique_ptr<ir::Module> lower(const std::string& source) {
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto file = parser.parse();
+    return ir::IRGenerator().generate(*file);
+}
+
+// Runs `mod` on the bytecode interpreter and returns what it printed
+inline std::string interpret(const ir::Module& mod, const std::vector<std::string>& args = {}) {
+    std::FILE* out = std::tmpfile();
+    interp::Interpreter interpreter(interp::lowerToBytecode(mod), out);
+    interpreter.setArguments(args);
+    interpreter.run();
+    std::rewind(out);
+    std::string result;
+    char buf[256];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), out)) > 0) result.append(buf, n);
+    std::fclose(out);
+    return result;
+}
+
+inline std::string interpret(const std::string& source, const std::vector<std::string>& args = {}) {
+    return interpret(*lower(source), args);
+}
+
+inline bool hasRemark(const ir::RemarkCollector& remarks, ir::Remark::Kind kind, const std::string& name) {
+    for (const auto& remark : remarks.remarks()) {
+        if (remark.kind == kind && remark.name == name) return true;
+    }
+    return false;
+}
+
+} // namespace test
+} // namespace kotlin_lite
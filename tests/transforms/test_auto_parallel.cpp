@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "ir/ir_parser.hpp"
+#include "ir/ir_serializer.hpp"
+#include "transforms/auto_parallel.hpp"
+#include "codegen/llvm_codegen.hpp"
+#include <llvm/IR/Verifier.h>
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+static CallInst* findParallelCall(const Function& func) {
+    for (const auto& bb : func.blocks) {
+        for (const auto& inst : bb->instructions) {
+            auto call = dynamic_cast<CallInst*>(inst.get());
+            if (call && call->parallel) return call;
+        }
+    }
+    return nullptr;
+}
+
+// Counts the primes below n, starting from 3
+static const char* kCountProgram =
+    "fun isPrime(n: Int): Boolean {\n"
+    "    if (n < 2) { return false }\n"
+    "    var d = 2\n"
+    "    while (d * d <= n) {\n"
+    "        if (n % d == 0) { return false }\n"
+    "        d = d + 1\n"
+    "    }\n"
+    "    return true\n"
+    "}\n"
+    "fun main() {\n"
+    "    val n = 20000\n"
+    "    var count = 3\n"
+    "    var i = 2\n"
+    "    while (i < n) {\n"
+    "        if (isPrime(i)) { count = count + 1 }\n"
+    "        i = i + 1\n"
+    "    }\n"
+    "    print_i32(count)\n"
+    "}";
+
+TEST(AutoParallelTest, OutlinesIndependentReduction) {
+    auto mod = lower(kCountProgram);
+    std::string expected = interpret(*mod);
+
+    RemarkCollector remarks;
+    AutoParallelization parallel(&remarks);
+    EXPECT_TRUE(parallel.run(*mod));
+    EXPECT_EQ(parallel.getStatistics().parallelizedLoops, 1) << remarks.format();
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Passed, "Parallelized"));
+
+    ASSERT_NE(mod->getFunction("main.par0"), nullptr) << mod->dump();
+    CallInst* call = findParallelCall(*mod->getFunction("main"));
+    ASSERT_NE(call, nullptr) << mod->dump();
+    EXPECT_EQ(call->callee, "main.par0");
+    EXPECT_EQ(call->parallel->reduction, Instruction::OpKind::Add);
+    EXPECT_EQ(call->parallel->predicate, Instruction::OpKind::ICmpLt);
+    EXPECT_EQ(call->parallel->step, 1);
+
+    // The interpreter runs the worker over the whole range at once
+    EXPECT_EQ(interpret(*mod), expected);
+
+    // Running the pass again does not outline the worker's own loop
+    AutoParallelization again;
+    again.run(*mod);
+    EXPECT_EQ(again.getStatistics().parallelizedLoops, 0);
+}
+
+TEST(AutoParallelTest, ParallelCallsRoundTrip) {
+    auto mod = lower(kCountProgram);
+    AutoParallelization().run(*mod);
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("parallel(add, lt, 1)"), std::string::npos) << text;
+    EXPECT_EQ(IRParser(text).parse()->dump(), text);
+
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    EXPECT_EQ(readBinary(bytes.data(), bytes.size())->dump(), text);
+
+    EXPECT_THROW(IRParser("define i32 @f(i32 %a) {\n"
+                          "entry:\n"
+                          "  %0 = call i32 @f(i32 %a) parallel(sub, lt, 1)\n"
+                          "  ret i32 %0\n"
+                          "}\n").parse(),
+                 std::runtime_error);
+}
+
+TEST(AutoParallelTest, KeepsLoopsWithOrderedEffectsOrState) {
+    auto mod = lower("@Memoize fun cube(x: Int): Int { return x * x * x }\n"
+                     "fun main() {\n"
+                     "    var i = 0\n"
+                     "    var s = 0\n"
+                     "    while (i < 100000) { s = s + i\n if (i == 5) { print_i32(s) }\n i = i + 1 }\n"
+                     "    var j = 0\n"
+                     "    var a = 0\n"
+                     "    var b = 1\n"
+                     "    while (j < 100000) { a = a + j\n b = b * 3\n j = j + 1 }\n"
+                     "    var k = 0\n"
+                     "    var last = 0\n"
+                     "    while (k < 100000) { last = k * 2\n k = k + 1 }\n"
+                     "    var m = 0\n"
+                     "    var t = 0\n"
+                     "    while (m < 100) { t = t + m\n m = m + 1 }\n"
+                     "    var n = 0\n"
+                     "    var c = 0\n"
+                     "    while (n < 100000) { c = c + cube(n % 10)\n n = n + 1 }\n"
+                     "    print_i32(s)\n"
+                     "    print_i32(a + b)\n"
+                     "    print_i32(last)\n"
+                     "    print_i32(t)\n"
+                     "    print_i32(c)\n"
+                     "}");
+    std::string expected = interpret(*mod);
+
+    RemarkCollector remarks;
+    AutoParallelization parallel(&remarks);
+    parallel.run(*mod);
+    EXPECT_EQ(parallel.getStatistics().parallelizedLoops, 0) << remarks.format();
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "Effects")) << remarks.format();
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "NoReduction")) << remarks.format();
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "TooFewIterations")) << remarks.format();
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "Memoized")) << remarks.format();
+    EXPECT_EQ(interpret(*mod), expected);
+}
+
+TEST(AutoParallelTest, LowersToRuntimeCall) {
+    auto irMod = lower("fun sum(n: Int, scale: Int): Int {\n"
+                       "    var i = n\n"
+                       "    var s = 1\n"
+                       "    while (i > 0) { s = s + i * scale\n i = i - 2 }\n"
+                       "    return s\n"
+                       "}\n"
+                       "fun main() { print_i32(sum(50000, 3)) }");
+    AutoParallelization parallel;
+    parallel.run(*irMod);
+    ASSERT_EQ(parallel.getStatistics().parallelizedLoops, 1) << irMod->dump();
+    EXPECT_EQ(findParallelCall(*irMod->getFunction("sum"))->parallel->step, -2);
+
+    LLVMCodegen codegen;
+    auto mod = codegen.generate(*irMod);
+    EXPECT_FALSE(llvm::verifyModule(*mod, &llvm::errs()));
+    ASSERT_NE(mod->getFunction("kl_parallel_reduce"), nullptr);
+    ASSERT_NE(mod->getFunction("sum.par0.chunk"), nullptr);
+    EXPECT_TRUE(mod->getFunction("sum.par0.chunk")->hasInternalLinkage());
+
+    // The worker is pure, but the runtime running it locks, allocates and
+    // writes its globals; so do `sum` and its callers
+    for (const char* name : {"sum", "main"}) {
+        llvm::Function* func = mod->getFunction(name);
+        EXPECT_FALSE(func->doesNotAccessMemory()) << name;
+        EXPECT_FALSE(func->onlyAccessesInaccessibleMemory()) << name;
+        EXPECT_FALSE(func->hasFnAttribute(llvm::Attribute::NoSync)) << name;
+        EXPECT_FALSE(func->hasFnAttribute(llvm::Attribute::NoFree)) << name;
+    }
+    EXPECT_TRUE(mod->getFunction("sum.par0")->doesNotAccessMemory());
+}
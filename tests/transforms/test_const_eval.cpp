@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "transforms/const_eval.hpp"
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+TEST(ConstEvalTest, FoldsPureCallWithConstantArguments) {
+    auto mod = lower("fun factorial(n: Int): Int {\n"
+                     "    var acc = 1\n"
+                     "    var i = 2\n"
+                     "    while (i <= n) { acc = acc * i\n i = i + 1 }\n"
+                     "    return acc\n"
+                     "}\n"
+                     "fun main() {\n"
+                     "    print_i32(factorial(5) + 1)\n"
+                     "}");
+    CompileTimeEvaluation eval;
+    EXPECT_TRUE(eval.run(*mod));
+    EXPECT_EQ(eval.getStatistics().foldedCalls, 1);
+    std::string output = mod->dump();
+    EXPECT_NE(output.find("call void @print_i32(i32 121)"), std::string::npos) << output;
+}
+
+TEST(ConstEvalTest, LeavesImpureTrappingAndExpensiveCallsAlone) {
+    auto mod = lower("fun noisy(x: Int): Int { print_i32(x)\n return x }\n"
+                     "fun div(x: Int): Int { return 10 / x }\n"
+                     "fun fib(n: Int): Int { if (n <= 1) { return n }\n return fib(n - 1) + fib(n - 2) }\n"
+                     "fun main() {\n"
+                     "    print_i32(noisy(1))\n"
+                     "    print_i32(div(0))\n"
+                     "    print_i32(fib(40))\n"
+                     "    print_i32(fib(10))\n"
+                     "}");
+    CompileTimeEvaluation eval;
+    eval.run(*mod);
+    EXPECT_EQ(eval.getStatistics().foldedCalls, 1);
+    EXPECT_EQ(eval.getStatistics().rejectedByTrap, 1);
+    EXPECT_EQ(eval.getStatistics().rejectedByBudget, 1);
+    std::string output = mod->dump();
+    EXPECT_NE(output.find("@noisy(i32 1)"), std::string::npos);
+    EXPECT_NE(output.find("@div(i32 0)"), std::string::npos);
+    EXPECT_NE(output.find("@fib(i32 40)"), std::string::npos);
+    EXPECT_NE(output.find("call void @print_i32(i32 55)"), std::string::npos);
+}
+
+TEST(ConstEvalTest, MemoryBudgetStopsDeepRecursion) {
+    auto mod = lower("fun depth(n: Int): Int { if (n == 0) { return 0 }\n return depth(n - 1) + 1 }\n"
+                     "fun main() { print_i32(depth(100000)) }");
+    CompileTimeEvaluation::Options options;
+    options.maxSteps = 100000000;
+    CompileTimeEvaluation eval(options);
+    eval.run(*mod);
+    EXPECT_EQ(eval.getStatistics().foldedCalls, 0);
+    EXPECT_EQ(eval.getStatistics().rejectedByBudget, 1);
+}
+
+TEST(ConstEvalTest, ConstValInitializersAreFoldedAndRemoved) {
+    auto mod = lower("fun square(x: Int): Int { return x * x }\n"
+                     "const val SIDE = 7\n"
+                     "const val AREA: Int = square(SIDE) + 1\n"
+                     "const val BIG = AREA > 40\n"
+                     "fun main() {\n"
+                     "    print_i32(AREA)\n"
+                     "    print_bool(BIG)\n"
+                     "}");
+    CompileTimeEvaluation::Options options;
+    options.foldCalls = false;
+    CompileTimeEvaluation eval(options);
+    EXPECT_TRUE(eval.run(*mod));
+    EXPECT_TRUE(eval.getUnfoldedConstants().empty());
+    EXPECT_EQ(eval.getStatistics().foldedConstants, 4); // SIDE and AREA in initializers, AREA and BIG in main
+    EXPECT_EQ(mod->getFunction("const.AREA"), nullptr);
+    std::string output = mod->dump();
+    EXPECT_NE(output.find("call void @print_i32(i32 50)"), std::string::npos) << output;
+    EXPECT_NE(output.find("call void @print_bool(i1 1)"), std::string::npos) << output;
+}
+
+TEST(ConstEvalTest, ImpureConstValIsReported) {
+    auto mod = lower("fun noisy(): Int { print_i32(1)\n return 1 }\n"
+                     "const val X = noisy()\n"
+                     "fun main() { print_i32(X) }");
+    CompileTimeEvaluation eval;
+    eval.run(*mod);
+    ASSERT_EQ(eval.getUnfoldedConstants().size(), 1);
+    EXPECT_EQ(eval.getUnfoldedConstants().begin()->first, "X");
+}
+
+TEST(ConstEvalTest, FoldsLongAndUnsignedArithmetic) {
+    auto mod = lower("fun factorial(n: Long): Long {\n"
+                     "    var acc = 1L\n"
+                     "    var i = 2L\n"
+                     "    while (i <= n) { acc = acc * i\n i = i + 1 }\n"
+                     "    return acc\n"
+                     "}\n"
+                     "fun third(x: UInt): UInt { return x / 3u }\n"
+                     "fun main() {\n"
+                     "    print_i64(factorial(20L))\n"
+                     "    print_u32(third(4294967295u))\n"
+                     "    print_i32(third(4294967295u).toByte().toInt())\n"
+                     "}");
+    CompileTimeEvaluation eval;
+    EXPECT_TRUE(eval.run(*mod));
+    std::string output = mod->dump();
+    EXPECT_NE(output.find("call void @print_i64(i64 2432902008176640000)"), std::string::npos) << output;
+    EXPECT_NE(output.find("call void @print_u32(i32 1431655765)"), std::string::npos) << output;
+    EXPECT_NE(output.find("call void @print_i32(i32 85)"), std::string::npos) << output;
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "transforms/ipcp.hpp"
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+TEST(IPCPTest, AgreedConstantIsPropagatedAndArgumentRemoved) {
+    auto mod = lower("fun scale(x: Int, k: Int): Int { return x * k }\n"
+                     "fun main() {\n"
+                     "    print_i32(scale(1, 3))\n"
+                     "    print_i32(scale(2, 3))\n"
+                     "}");
+    InterproceduralConstantPropagation ipcp;
+    EXPECT_TRUE(ipcp.run(*mod));
+    EXPECT_EQ(ipcp.getStatistics().propagatedArguments, 1);
+    EXPECT_EQ(ipcp.getStatistics().removedArguments, 1);
+
+    Function* scale = mod->getFunction("scale");
+    ASSERT_EQ(scale->args.size(), 1);
+    EXPECT_EQ(scale->args[0].name, "x");
+    std::string output = mod->dump();
+    EXPECT_NE(output.find("mul i32 %x, 3"), std::string::npos);
+    EXPECT_NE(output.find("call i32 @scale(i32 1)"), std::string::npos);
+}
+
+TEST(IPCPTest, RecursivePassThroughStillAgrees) {
+    auto mod = lower("fun down(n: Int, step: Int): Int {\n"
+                     "    if (n <= 0) { return 0 }\n"
+                     "    return down(n - step, step) + 1\n"
+                     "}\n"
+                     "fun main() { print_i32(down(10, 2)) }");
+    InterproceduralConstantPropagation ipcp;
+    ipcp.run(*mod);
+    EXPECT_EQ(mod->getFunction("down")->args.size(), 1);
+    EXPECT_NE(mod->dump().find("sub i32 %n, 2"), std::string::npos);
+}
+
+TEST(IPCPTest, HotCallSitesAreSpecialized) {
+    auto mod = lower("fun poly(x: Int, k: Int): Int { return x * k + k }\n"
+                     "fun main() {\n"
+                     "    var i = 0\n"
+                     "    var sum = 0\n"
+                     "    while (i < 100) {\n"
+                     "        sum = sum + poly(i, 3) + poly(i, 5)\n"
+                     "        i = i + 1\n"
+                     "    }\n"
+                     "    print_i32(sum + poly(sum, 7))\n"
+                     "}");
+    InterproceduralConstantPropagation ipcp;
+    EXPECT_TRUE(ipcp.run(*mod));
+    const auto& stats = ipcp.getStatistics();
+    // The two loop call sites are hot; the single call after the loop is not.
+    EXPECT_EQ(stats.specializedFunctions, 2);
+    EXPECT_EQ(stats.redirectedCallSites, 2);
+    EXPECT_GT(stats.instructionGrowth, 0u);
+
+    Function* spec = mod->getFunction("poly.spec0");
+    ASSERT_NE(spec, nullptr);
+    EXPECT_EQ(spec->args.size(), 1);
+    EXPECT_NE(mod->dump().find("call i32 @poly(i32 %"), std::string::npos);
+}
+
+TEST(IPCPTest, GrowthBudgetLimitsClones) {
+    auto mod = lower("fun poly(x: Int, k: Int): Int { return x * k + k }\n"
+                     "fun main() {\n"
+                     "    var i = 0\n"
+                     "    while (i < 100) {\n"
+                     "        print_i32(poly(i, 3) + poly(i, 5))\n"
+                     "        i = i + 1\n"
+                     "    }\n"
+                     "}");
+    InterproceduralConstantPropagation::Options options;
+    options.minGrowthBudget = 4;
+    options.growthBudgetPercent = 0;
+    InterproceduralConstantPropagation ipcp(options);
+    ipcp.run(*mod);
+    EXPECT_EQ(ipcp.getStatistics().specializedFunctions, 1);
+    EXPECT_EQ(ipcp.getStatistics().rejectedByBudget, 1);
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "ir/loop_nest.hpp"
+#include "transforms/loop_fusion.hpp"
+#include "transforms/loop_interchange.hpp"
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+static Loop* loopAt(const LoopNestAnalysis& nest, const std::string& header) {
+    for (const auto& loop : nest.loopInfo().loops()) {
+        if (loop->header->label == header) return loop.get();
+    }
+    return nullptr;
+}
+
+TEST(LoopNestTest, RecognizesCountedLoops) {
+    auto mod = lower("fun f(n: Int): Int {\n"
+                     "    var s = 0\n"
+                     "    var i = 10\n"
+                     "    while (i >= 0) { s = s + i\n i = i - 3 }\n"
+                     "    var j = 0\n"
+                     "    while (j < n) { s = s + j\n j = j + 2 }\n"
+                     "    var k = 0\n"
+                     "    while (s < 100) { s = s + k\n k = k + 1 }\n"
+                     "    return s\n"
+                     "}");
+    Function* f = mod->getFunction("f");
+    foldTrivialPhis(*f);
+    LoopNestAnalysis nest(*f);
+    ASSERT_EQ(nest.loopInfo().loops().size(), 3u);
+
+    const CountedLoop* down = nest.counted(loopAt(nest, "while.header"));
+    ASSERT_NE(down, nullptr);
+    EXPECT_EQ(down->step, -3);
+    EXPECT_EQ(down->tripCount(), 4);  // 10, 7, 4, 1
+
+    const CountedLoop* up = nest.counted(loopAt(nest, "while.header1"));
+    ASSERT_NE(up, nullptr);
+    EXPECT_EQ(up->bound, f->args[0].ssaValue);
+    EXPECT_FALSE(up->tripCount().has_value());
+
+    // The condition tests the accumulator, not the counter
+    Loop* notCounted = loopAt(nest, "while.header2");
+    ASSERT_NE(notCounted, nullptr);
+    EXPECT_EQ(nest.counted(notCounted), nullptr);
+    EXPECT_FALSE(nest.whyNot(notCounted).empty());
+}
+
+TEST(LoopNestTest, FusesIndependentLoops) {
+    const char* source = "fun main() {\n"
+                         "    var i = 0\n"
+                         "    var a = 0\n"
+                         "    while (i < 100) { a = a + i\n i = i + 1 }\n"
+                         "    var j = 0\n"
+                         "    var b = 1\n"
+                         "    val step = 3 * 7\n"
+                         "    while (j < 100) { b = b + j * step\n j = j + 1 }\n"
+                         "    print_i32(a)\n"
+                         "    print_i32(b)\n"
+                         "}";
+    auto mod = lower(source);
+    std::string expected = interpret(*mod);
+
+    RemarkCollector remarks;
+    LoopFusion fusion(&remarks);
+    EXPECT_TRUE(fusion.run(*mod));
+    EXPECT_EQ(fusion.getStatistics().fusedLoops, 1);
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Passed, "Fused")) << remarks.format();
+
+    CFG cfg(*mod->getFunction("main"));
+    EXPECT_EQ(LoopInfo(*mod->getFunction("main"), cfg).loops().size(), 1u) << mod->dump();
+    EXPECT_EQ(interpret(*mod), expected);
+}
+
+TEST(LoopNestTest, DoesNotFuseDependentOrMismatchedLoops) {
+    auto mod = lower("fun main() {\n"
+                     "    var i = 0\n"
+                     "    var a = 0\n"
+                     "    while (i < 10) { a = a + i\n i = i + 1 }\n"
+                     "    var j = 0\n"
+                     "    while (j < 10) { a = a * 2\n j = j + 1 }\n"
+                     "    var k = 0\n"
+                     "    var c = 0\n"
+                     "    while (k < 11) { c = c + k\n k = k + 1 }\n"
+                     "    print_i32(a)\n"
+                     "    print_i32(c)\n"
+                     "}");
+    std::string expected = interpret(*mod);
+
+    RemarkCollector remarks;
+    LoopFusion fusion(&remarks);
+    fusion.run(*mod);
+    EXPECT_EQ(fusion.getStatistics().fusedLoops, 0);
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "Dependence")) << remarks.format();
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "TripCountMismatch")) << remarks.format();
+    EXPECT_EQ(interpret(*mod), expected);
+}
+
+TEST(LoopNestTest, RemarksArePlacedAtTheirLoops) {
+    auto mod = lower("fun main() {\n"
+                     "    var i = 0\n"
+                     "    var a = 0\n"
+                     "    while (i < 10) { a = a + i\n i = i + 1 }\n"
+                     "    var j = 0\n"
+                     "    while (j < 11) { a = a * 2\n j = j + 1 }\n"
+                     "    print_i32(a)\n"
+                     "}");
+    RemarkCollector remarks;
+    remarks.setFile("loops.kt");
+    LoopFusion fusion(&remarks);
+    fusion.run(*mod);
+    ASSERT_EQ(remarks.remarks().size(), 1u) << remarks.format();
+    const Remark& remark = remarks.remarks()[0];
+    EXPECT_EQ(remark.file, "loops.kt");
+    EXPECT_EQ(remark.line, 4);
+    EXPECT_EQ(remark.column, 5);
+
+    EXPECT_EQ(remarks.format().rfind("loops.kt:4:5: main: missed: cannot fuse", 0), 0u) << remarks.format();
+    EXPECT_EQ(remarks.formatSummary(), "1 remark(s):\n  loop-fusion: 1 missed\n");
+    std::string yaml = remarks.formatYAML();
+    EXPECT_EQ(yaml.rfind("--- !Missed\nPass:            loop-fusion\nName:            TripCountMismatch\n"
+                         "DebugLoc:        { File: loops.kt, Line: 4, Column: 5 }\nFunction:        main\n"
+                         "Message:         'cannot fuse", 0), 0u) << yaml;
+}
+
+TEST(LoopNestTest, DoesNotFuseLoopsThatBothPrint) {
+    auto mod = lower("fun main() {\n"
+                     "    var i = 0\n"
+                     "    while (i < 3) { print_i32(i)\n i = i + 1 }\n"
+                     "    var j = 0\n"
+                     "    while (j < 3) { print_i32(j * 10)\n j = j + 1 }\n"
+                     "}");
+    RemarkCollector remarks;
+    LoopFusion fusion(&remarks);
+    EXPECT_FALSE(fusion.run(*mod) && fusion.getStatistics().fusedLoops > 0);
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "Effects")) << remarks.format();
+    EXPECT_EQ(interpret(*mod), "0\n1\n2\n0\n10\n20\n");
+}
+
+TEST(LoopNestTest, InterchangesShortInnerLoop) {
+    auto mod = lower("fun main() {\n"
+                     "    var i = 0\n"
+                     "    var sum = 0\n"
+                     "    var product = 1\n"
+                     "    while (i < 1000) {\n"
+                     "        var j = 0\n"
+                     "        while (j < 3) {\n"
+                     "            sum = sum + i * j - 1\n"
+                     "            product = product * (j + 2)\n"
+                     "            j = j + 1\n"
+                     "        }\n"
+                     "        i = i + 1\n"
+                     "    }\n"
+                     "    print_i32(sum)\n"
+                     "    print_i32(product)\n"
+                     "}");
+    std::string expected = interpret(*mod);
+
+    RemarkCollector remarks;
+    LoopInterchange interchange(&remarks);
+    EXPECT_TRUE(interchange.run(*mod));
+    EXPECT_EQ(interchange.getStatistics().interchangedNests, 1) << remarks.format();
+    ASSERT_TRUE(hasRemark(remarks, Remark::Kind::Passed, "Interchanged"));
+    // At the outer loop as written, not at the inner loop now in its place
+    EXPECT_EQ(remarks.remarks().back().line, 5) << remarks.format();
+
+    // The outer header now tests j against 3
+    Function* f = mod->getFunction("main");
+    LoopNestAnalysis nest(*f);
+    Loop* outer = nest.loopInfo().topLevelLoops().front();
+    ASSERT_NE(nest.counted(outer), nullptr) << mod->dump();
+    EXPECT_EQ(nest.counted(outer)->tripCount(), 3);
+    EXPECT_EQ(interpret(*mod), expected);
+}
+
+TEST(LoopNestTest, KeepsNestsThatAreNotWorthOrNotSafeToInterchange) {
+    auto mod = lower("fun main() {\n"
+                     "    var i = 0\n"
+                     "    var count = 0\n"
+                     "    var last = 0\n"
+                     "    while (i < 40) {\n"
+                     "        var j = 0\n"
+                     "        while (j < 40) { count = count + 1\n j = j + 1 }\n"
+                     "        i = i + 1\n"
+                     "    }\n"
+                     "    var k = 0\n"
+                     "    while (k < 100) {\n"
+                     "        var m = 0\n"
+                     "        while (m < 2) { last = k * 2 + m\n m = m + 1 }\n"
+                     "        k = k + 1\n"
+                     "    }\n"
+                     "    print_i32(count)\n"
+                     "    print_i32(last)\n"
+                     "}");
+    std::string expected = interpret(*mod);
+
+    RemarkCollector remarks("interchange");
+    LoopInterchange interchange(&remarks);
+    interchange.run(*mod);
+    EXPECT_EQ(interchange.getStatistics().interchangedNests, 0);
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "NotProfitable")) << remarks.format();
+    EXPECT_TRUE(hasRemark(remarks, Remark::Kind::Missed, "Recurrence")) << remarks.format();
+    EXPECT_EQ(interpret(*mod), expected);
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "ir/ir_parser.hpp"
+#include "transforms/peephole.hpp"
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+static size_t ruleCount(const PeepholeOptimizer& peephole, const std::string& rule) {
+    for (const auto& [name, count] : peephole.getRuleCounts()) {
+        if (name == rule) return count;
+    }
+    ADD_FAILURE() << "no rule " << rule;
+    return 0;
+}
+
+TEST(PeepholeTest, IdentitiesFoldAway) {
+    auto mod = IRParser("define i32 @f(i32 %x, i32 %y) {\n"
+                        "entry:\n"
+                        "  %0 = add i32 %x, 0\n"
+                        "  %1 = mul i32 %0, 1\n"
+                        "  %2 = sub i32 %1, %y\n"
+                        "  %3 = add i32 %2, %y\n"
+                        "  ret i32 %3\n"
+                        "}\n").parse();
+    PeepholeOptimizer peephole;
+    EXPECT_TRUE(peephole.run(*mod));
+    Function* f = mod->getFunction("f");
+    EXPECT_EQ(f->instructionCount(), 1u) << mod->dump();
+    auto ret = static_cast<ReturnInst*>(f->blocks.front()->getTerminator());
+    EXPECT_EQ(ret->value, f->args[0].ssaValue);
+    EXPECT_EQ(ruleCount(peephole, "add-zero"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "mul-one"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "add-sub-cancel"), 1u);
+}
+
+TEST(PeepholeTest, MultiplyByPowerOfTwoBecomesShift) {
+    auto mod = IRParser("define i32 @f(i32 %x) {\n"
+                        "entry:\n"
+                        "  %0 = mul i32 8, %x\n"
+                        "  ret i32 %0\n"
+                        "}\n").parse();
+    PeepholeOptimizer peephole;
+    peephole.run(*mod);
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("shl i32 %x, 3"), std::string::npos) << text;
+    EXPECT_EQ(text.find("mul"), std::string::npos) << text;
+    // The constant was first moved to the right
+    EXPECT_EQ(ruleCount(peephole, "const-rhs.mul"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "mul-pow2-to-shl"), 1u);
+}
+
+TEST(PeepholeTest, CanonicalizesAndInvertsCompares) {
+    auto mod = IRParser("define i1 @f(i32 %x) {\n"
+                        "entry:\n"
+                        "  %0 = icmp lt i32 5, %x\n"
+                        "  %1 = not i1 %0\n"
+                        "  %2 = not i1 %1\n"
+                        "  %3 = not i1 %2\n"
+                        "  ret i1 %3\n"
+                        "}\n").parse();
+    PeepholeOptimizer peephole;
+    peephole.run(*mod);
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("icmp le i32 %x, 5"), std::string::npos) << text;
+    EXPECT_EQ(text.find("not"), std::string::npos) << text;
+    EXPECT_EQ(mod->getFunction("f")->instructionCount(), 2u) << text;
+}
+
+TEST(PeepholeTest, WorklistReachesFixedPoint) {
+    // Each fold exposes the next one up the chain
+    auto mod = IRParser("define i32 @f(i32 %x) {\n"
+                        "entry:\n"
+                        "  %0 = sub i32 %x, 1\n"
+                        "  %1 = add i32 %0, 2\n"
+                        "  %2 = add i32 %1, 3\n"
+                        "  %3 = sub i32 %2, 4\n"
+                        "  ret i32 %3\n"
+                        "}\n").parse();
+    PeepholeOptimizer peephole;
+    peephole.run(*mod);
+    Function* f = mod->getFunction("f");
+    EXPECT_EQ(f->instructionCount(), 1u) << mod->dump();
+    auto ret = static_cast<ReturnInst*>(f->blocks.front()->getTerminator());
+    EXPECT_EQ(ret->value, f->args[0].ssaValue) << mod->dump();
+    EXPECT_FALSE(PeepholeOptimizer().run(*mod));
+}
+
+TEST(PeepholeTest, BooleanComparesAndSelfCompares) {
+    auto mod = IRParser("define i1 @f(i1 %b, i32 %x) {\n"
+                        "entry:\n"
+                        "  %0 = icmp eq i1 %b, true\n"
+                        "  %1 = icmp eq i1 %0, false\n"
+                        "  %2 = icmp ge i32 %x, %x\n"
+                        "  condbr i1 %2, label %yes, label %no\n"
+                        "yes:\n"
+                        "  ret i1 %1\n"
+                        "no:\n"
+                        "  ret i1 false\n"
+                        "}\n").parse();
+    PeepholeOptimizer peephole;
+    peephole.run(*mod);
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("not i1 %b"), std::string::npos) << text;
+    EXPECT_NE(text.find("condbr i1 1,"), std::string::npos) << text;
+    EXPECT_EQ(ruleCount(peephole, "bool-eq-true"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "bool-eq-false"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "icmp-self.ge"), 1u);
+}
+
+TEST(PeepholeTest, RewrittenProgramRunsTheSame) {
+    auto mod = lower("fun scale(x: Int): Int { return 0 + x * 16 - 1 + 1 }\n"
+                     "fun main() {\n"
+                     "    print_i32(scale(-3))\n"
+                     "    print_i32(scale(268435456))\n"
+                     "    print_bool(!(scale(1) < 16))\n"
+                     "}");
+    PeepholeOptimizer peephole;
+    EXPECT_TRUE(peephole.run(*mod));
+    EXPECT_EQ(ruleCount(peephole, "mul-pow2-to-shl"), 1u);
+    EXPECT_EQ(interpret(*mod), "-48\n0\ntrue\n");
+}
+
+TEST(PeepholeTest, UnsignedDivisionByPowerOfTwoBecomesShifts) {
+    auto mod = IRParser("define i64 @f(i64 %x) {\n"
+                        "entry:\n"
+                        "  %0 = udiv i64 %x, 16\n"
+                        "  %1 = urem i64 %0, 8\n"
+                        "  %2 = icmp ult i64 7, %1\n"
+                        "  %3 = icmp uge i64 %x, %x\n"
+                        "  condbr i1 %3, label %a, label %b\n"
+                        "a:\n"
+                        "  ret i64 %1\n"
+                        "b:\n"
+                        "  %4 = udiv i64 %x, -2\n"
+                        "  ret i64 %4\n"
+                        "}\n").parse();
+    PeepholeOptimizer peephole;
+    EXPECT_TRUE(peephole.run(*mod));
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("lshr i64 %x, 4"), std::string::npos) << text;
+    EXPECT_NE(text.find("shl i64 %"), std::string::npos) << text;
+    EXPECT_NE(text.find(", 61"), std::string::npos) << text;
+    // A divisor of 2^64 - 2 is not a power of two, only negative as a signed value
+    EXPECT_NE(text.find("udiv i64 %x, -2"), std::string::npos) << text;
+    EXPECT_EQ(ruleCount(peephole, "udiv-pow2-to-lshr"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "urem-pow2-to-shifts"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "icmp-self.uge"), 1u);
+    EXPECT_EQ(ruleCount(peephole, "const-rhs.icmp-ult"), 1u);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "ir/ir_parser.hpp"
+#include "ir/ir_serializer.hpp"
+#include "ir/profile.hpp"
+#include "transforms/pgo.hpp"
+#include "codegen/llvm_codegen.hpp"
+#include <llvm/IR/Verifier.h>
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+static const char* kProgram =
+    "fun classify(n: Int): Int {\n"
+    "    if (n % 7 == 0) { return 1 }\n"
+    "    return 0\n"
+    "}\n"
+    "fun main() {\n"
+    "    var i = 0\n"
+    "    var hits = 0\n"
+    "    while (i < 700) {\n"
+    "        hits = hits + classify(i)\n"
+    "        i = i + 1\n"
+    "    }\n"
+    "    print_i32(hits)\n"
+    "}";
+
+static size_t countCalls(const Module& mod, const std::string& callee) {
+    size_t count = 0;
+    for (const auto& func : mod.functions) {
+        for (const auto& bb : func->blocks) {
+            for (const auto& inst : bb->instructions) {
+                auto call = dynamic_cast<CallInst*>(inst.get());
+                if (call && call->callee == callee) count++;
+            }
+        }
+    }
+    return count;
+}
+
+// The counts an instrumented run of kProgram would record
+static Profile expectedProfile(const Module& mod) {
+    Profile profile;
+    for (const auto& func : mod.functions) {
+        FunctionProfile& entry = profile.functions[func->name];
+        entry.hash = profileHash(*func);
+        entry.counts.assign(profileCounterCount(*func), 0);
+    }
+    // classify: entry, if.then, if.else, if.merge, then the taken edge of its branch
+    profile.functions["classify"].counts = {700, 100, 600, 600, 100};
+    return profile;
+}
+
+TEST(PGOTest, InstrumentationCountsBlocksAndTakenEdges) {
+    auto mod = lower(kProgram);
+    size_t counters = 0;
+    for (const auto& func : mod->functions) counters += profileCounterCount(*func);
+    uint64_t mainHash = profileHash(*mod->getFunction("main"));
+
+    ProfileInstrumentation instrumentation;
+    EXPECT_TRUE(instrumentation.run(*mod));
+    EXPECT_EQ(instrumentation.getCounterCount(), counters);
+    EXPECT_EQ(countCalls(*mod, kProfileCounterFunction), counters);
+
+    std::stringstream hash;
+    hash << std::hex << mainHash;
+    EXPECT_NE(instrumentation.getLayout().find("main " + hash.str() + " "), std::string::npos)
+        << instrumentation.getLayout();
+
+    CodegenOptions options;
+    options.profileGenerate = CodegenOptions::ProfileGeneration{"out.klprof", instrumentation.getLayout(), counters};
+    LLVMCodegen codegen(options);
+    auto llvmMod = codegen.generate(*mod);
+    EXPECT_FALSE(llvm::verifyModule(*llvmMod, &llvm::errs()));
+    EXPECT_NE(llvmMod->getGlobalVariable("kl_prof_counters", true), nullptr);
+    EXPECT_NE(llvmMod->getFunction("kl_prof_register"), nullptr);
+    EXPECT_EQ(llvmMod->getFunction(kProfileCounterFunction), nullptr);
+}
+
+TEST(PGOTest, ProfileRoundTripsAndRejectsMalformedInput) {
+    Profile profile = expectedProfile(*lower(kProgram));
+    std::string text = profile.format();
+    EXPECT_EQ(Profile::parse(text).format(), text);
+
+    EXPECT_THROW(Profile::parse("not a profile\n"), std::runtime_error);
+    EXPECT_THROW(Profile::parse("kotlin-lite profile 1\nf 1a 3\n1 2\n"), std::runtime_error);
+    EXPECT_THROW(Profile::parse("kotlin-lite profile 1\nf xyz 1\n1\n"), std::runtime_error);
+    EXPECT_THROW(Profile::parse("kotlin-lite profile 1\nf 1a 1\n"), std::runtime_error);
+}
+
+TEST(PGOTest, AnnotatesMatchingFunctions) {
+    auto mod = lower(kProgram);
+    Profile profile = expectedProfile(*mod);
+    ProfileAnnotation annotation(profile);
+    EXPECT_TRUE(annotation.run(*mod));
+    EXPECT_EQ(annotation.getStatistics().annotated, 2);
+
+    Function* classify = mod->getFunction("classify");
+    EXPECT_EQ(classify->entryCount, 700u);
+    auto branch = static_cast<CondBranchInst*>(classify->blocks.front()->getTerminator());
+    ASSERT_TRUE(branch->weights);
+    EXPECT_EQ(branch->weights->thenCount, 100u);
+    EXPECT_EQ(branch->weights->elseCount, 600u);
+
+    // Weights survive printing, parsing and KLIR
+    std::string text = mod->dump();
+    EXPECT_NE(text.find("weights(100, 600)"), std::string::npos) << text;
+    EXPECT_EQ(IRParser(text).parse()->dump(), text);
+    std::vector<uint8_t> bytes = writeBinary(*mod);
+    EXPECT_EQ(readBinary(bytes.data(), bytes.size())->dump(), text);
+
+    LLVMCodegen codegen;
+    auto llvmMod = codegen.generate(*mod);
+    EXPECT_FALSE(llvm::verifyModule(*llvmMod, &llvm::errs()));
+    EXPECT_EQ(llvmMod->getFunction("classify")->getEntryCount()->getCount(), 700u);
+    EXPECT_NE(llvmMod->getProfileSummary(false), nullptr);
+    auto br = llvmMod->getFunction("classify")->getEntryBlock().getTerminator();
+    EXPECT_NE(br->getMetadata(llvm::LLVMContext::MD_prof), nullptr);
+}
+
+TEST(PGOTest, ToleratesEditsAndRenames) {
+    Profile profile = expectedProfile(*lower(kProgram));
+
+    // A changed literal keeps the shape; a renamed function is found by its hash
+    std::string edited = kProgram;
+    edited.replace(edited.find("700"), 3, "900");
+    for (size_t at; (at = edited.find("classify")) != std::string::npos;) edited.replace(at, 8, "category");
+    auto mod = lower(edited);
+    ProfileAnnotation annotation(profile);
+    annotation.run(*mod);
+    EXPECT_EQ(annotation.getStatistics().annotated, 2);
+    EXPECT_EQ(annotation.getStatistics().renamed, 1);
+    EXPECT_EQ(mod->getFunction("category")->entryCount, 700u);
+
+    // A changed control flow drops that function's counts only
+    std::string reshaped = kProgram;
+    reshaped.replace(reshaped.find("return 0"), 8, "if (n < 0) { return 2 }\n    return 0");
+    mod = lower(reshaped);
+    ProfileAnnotation stale(profile);
+    stale.run(*mod);
+    EXPECT_EQ(stale.getStatistics().annotated, 1);
+    EXPECT_EQ(stale.getStatistics().stale, 1);
+    ASSERT_EQ(stale.getWarnings().size(), 1u);
+    EXPECT_NE(stale.getWarnings()[0].find("classify"), std::string::npos);
+    EXPECT_FALSE(mod->getFunction("classify")->entryCount);
+    EXPECT_TRUE(mod->getFunction("main")->entryCount);
+}
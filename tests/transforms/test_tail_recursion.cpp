@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "test_helpers.hpp"
+#include "transforms/tail_recursion.hpp"
+#include "compiler.hpp"
+#include <cstdio>
+#include <fstream>
+
+using namespace kotlin_lite;
+using namespace kotlin_lite::ir;
+using namespace kotlin_lite::test;
+
+static int countCalls(const Function& func, const std::string& callee) {
+    int calls = 0;
+    for (const auto& bb : func.blocks) {
+        for (const auto& inst : bb->instructions) {
+            if (inst->kind == Instruction::OpKind::Call && static_cast<CallInst*>(inst.get())->callee == callee) calls++;
+        }
+    }
+    return calls;
+}
+
+TEST(TailRecursionTest, PlainTailCallBecomesLoop) {
+    auto mod = lower("tailrec fun sum(n: Int, acc: Int): Int {\n"
+                     "    if (n == 0) { return acc }\n"
+                     "    return sum(n - 1, acc + n)\n"
+                     "}");
+    TailRecursionElimination tre;
+    EXPECT_TRUE(tre.run(*mod));
+    EXPECT_EQ(tre.getEliminatedCalls(), 1);
+    EXPECT_EQ(tre.getAccumulatedCalls(), 0);
+
+    auto& func = *mod->functions[0];
+    EXPECT_EQ(countCalls(func, "sum"), 0);
+    std::string output = mod->dump();
+    EXPECT_NE(output.find("tailrec.header:"), std::string::npos);
+    EXPECT_NE(output.find("= phi i32 [ %n, %entry ]"), std::string::npos);
+    EXPECT_NE(output.find("br label %tailrec.header"), std::string::npos);
+}
+
+TEST(TailRecursionTest, MultiplicativeAccumulator) {
+    auto mod = lower("fun factorial(n: Int): Int {\n"
+                     "    if (n <= 1) {\n"
+                     "        return 1\n"
+                     "    } else {\n"
+                     "        return n * factorial(n - 1)\n"
+                     "    }\n"
+                     "}");
+    TailRecursionElimination tre;
+    EXPECT_TRUE(tre.run(*mod));
+    EXPECT_EQ(tre.getAccumulatedCalls(), 1);
+
+    auto& func = *mod->functions[0];
+    EXPECT_EQ(countCalls(func, "factorial"), 0);
+    std::string output = mod->dump();
+    // The accumulator starts at the identity of `*` and is folded into the base case.
+    EXPECT_NE(output.find("= phi i32 [ 1, %entry ]"), std::string::npos);
+    EXPECT_NE(output.find("mul i32 %"), std::string::npos);
+}
+
+TEST(TailRecursionTest, FibKeepsOneRecursiveCall) {
+    auto mod = lower("fun fib(n: Int): Int {\n"
+                     "    if (n <= 1) {\n"
+                     "        return n\n"
+                     "    }\n"
+                     "    return fib(n - 1) + fib(n - 2)\n"
+                     "}");
+    TailRecursionElimination tre;
+    EXPECT_TRUE(tre.run(*mod));
+    EXPECT_EQ(countCalls(*mod->functions[0], "fib"), 1);
+}
+
+TEST(TailRecursionTest, NonTailRecursionUntouched) {
+    auto mod = lower("fun f(n: Int): Int {\n"
+                     "    if (n <= 0) { return 0 }\n"
+                     "    return f(n - 1) - 1\n"
+                     "}");
+    TailRecursionElimination tre;
+    EXPECT_FALSE(tre.run(*mod));
+    EXPECT_EQ(countCalls(*mod->functions[0], "f"), 1);
+}
+
+TEST(TailRecursionTest, TailrecIsEliminatedWithoutIROptimizations) {
+    auto mod = lower("tailrec fun good(n: Int, acc: Int): Int {\n"
+                     "    if (n == 0) { return acc }\n"
+                     "    return good(n - 1, acc + n)\n"
+                     "}\n"
+                     "fun plain(n: Int, acc: Int): Int {\n"
+                     "    if (n == 0) { return acc }\n"
+                     "    return plain(n - 1, acc + n)\n"
+                     "}");
+    EXPECT_TRUE(mod->getFunction("good")->tailrec);
+    EXPECT_NE(mod->dump().find("@good(i32 %n, i32 %acc) tailrec {"), std::string::npos);
+    TailRecursionElimination tre;
+    EXPECT_TRUE(tre.runOnTailrecFunctions(*mod));
+    EXPECT_EQ(countCalls(*mod->getFunction("good"), "good"), 0);
+    EXPECT_EQ(countCalls(*mod->getFunction("plain"), "plain"), 1);
+
+    // Ten million frames would overflow the interpreter's stack
+    std::string path = testing::TempDir() + "tailrec_no_ir_opt.kt";
+    std::ofstream(path) << "tailrec fun good(n: Int, acc: Int): Int {\n"
+                           "    if (n == 0) { return acc }\n"
+                           "    return good(n - 1, acc + 1)\n"
+                           "}\n"
+                           "fun main() { print_i32(good(10000000, 0)) }\n";
+    CompileOptions options;
+    options.inputFile = path;
+    options.shouldRun = true;
+    options.interpret = true;
+    options.optimizeIR = false;
+    testing::internal::CaptureStdout();
+    int result = Compiler().compile(options);
+    std::fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "10000000\n");
+    EXPECT_EQ(result, 0);
+    std::remove(path.c_str());
+}